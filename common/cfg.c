@@ -144,6 +144,13 @@ engine_config(const char* cfgfile,
         ecfg->num_worker_threads_enforcer = parse_conf_worker_threads(cfgfile, 1);
         ecfg->num_worker_threads_signer = parse_conf_worker_threads(cfgfile, 0);
         ecfg->num_signer_threads = parse_conf_signer_threads(cfgfile);
+        ecfg->signer_coalesce_window = parse_conf_signer_coalesce_window(cfgfile);
+        ecfg->signer_memory_budget = parse_conf_signer_memory_budget(cfgfile);
+        ecfg->signer_instances = parse_conf_signer_instances(cfgfile);
+        ecfg->signer_http_port = parse_conf_signer_http_port(cfgfile);
+        ecfg->signer_mass_concurrency = parse_conf_signer_mass_concurrency(cfgfile);
+        ecfg->signer_notify_concurrency = parse_conf_signer_notify_concurrency(cfgfile);
+        ecfg->signer_refresh_rate = parse_conf_signer_refresh_rate(cfgfile);
         ecfg->manual_keygen = parse_conf_manual_keygen(cfgfile);
         ecfg->repositories = parse_conf_repositories(cfgfile);
         /* If any verbosity has been specified at cmd line we will use that */
@@ -153,6 +160,8 @@ engine_config(const char* cfgfile,
             parse_conf_automatic_keygen_period(cfgfile);
         ecfg->rollover_notification =
             parse_conf_rollover_notification(cfgfile);
+        ecfg->enforcer_startup_rate = parse_conf_enforcer_startup_rate(cfgfile);
+        ecfg->resalt_concurrency = parse_conf_resalt_concurrency(cfgfile);
         ecfg->interfaces = parse_conf_listener(cfgfile);
         ecfg->notify_command = parse_conf_notify_command(cfgfile);
 
@@ -376,6 +385,10 @@ engine_config_print(FILE* out, engineconfig_type* config)
         if (config->manual_keygen) {
             fprintf(out, "\t\t<ManualKeyGeneration/>\n");
         }
+        fprintf(out, "\t\t<StartupRate>%i</StartupRate>\n",
+            config->enforcer_startup_rate);
+        fprintf(out, "\t\t<ResaltConcurrency>%i</ResaltConcurrency>\n",
+            config->resalt_concurrency);
         if (config->delegation_signer_submit_command) {
             fprintf(out, "\t\t<DelegationSignerSubmitCommand>%s</DelegationSignerSubmitCommand>\n",
                 config->delegation_signer_submit_command);
@@ -431,6 +444,28 @@ engine_config_print(FILE* out, engineconfig_type* config)
             config->num_worker_threads_signer);
         fprintf(out, "\t\t<SignerThreads>%i</SignerThreads>\n",
             config->num_signer_threads);
+        fprintf(out, "\t\t<CoalesceWindow>%i</CoalesceWindow>\n",
+            config->signer_coalesce_window);
+        if (config->signer_memory_budget) {
+            fprintf(out, "\t\t<MemoryBudget>%ld</MemoryBudget>\n",
+                config->signer_memory_budget);
+        }
+        if (config->signer_instances > 1) {
+            fprintf(out, "\t\t<Instances>%i</Instances>\n",
+                config->signer_instances);
+        }
+        fprintf(out, "\t\t<HttpPort>%i</HttpPort>\n",
+            config->signer_http_port);
+        if (config->signer_mass_concurrency > 0) {
+            fprintf(out, "\t\t<MassConcurrency>%i</MassConcurrency>\n",
+                config->signer_mass_concurrency);
+        }
+        if (config->signer_notify_concurrency > 0) {
+            fprintf(out, "\t\t<NotifyConcurrency>%i</NotifyConcurrency>\n",
+                config->signer_notify_concurrency);
+        }
+        fprintf(out, "\t\t<RefreshRate>%i</RefreshRate>\n",
+            config->signer_refresh_rate);
         if (config->notify_command) {
             fprintf(out, "\t\t<NotifyCommand>%s</NotifyCommand>\n",
                 config->notify_command);
@@ -102,6 +102,15 @@ struct engineconfig_struct {
     int db_port; /* Datastore/MySQL/Host/@Port */
     time_t automatic_keygen_duration;
     time_t rollover_notification;
+    int enforcer_startup_rate;
+    int resalt_concurrency;
+    int signer_coalesce_window; /* milliseconds */
+    long signer_memory_budget; /* megabytes, zero for unlimited */
+    int signer_instances; /* engines the zones are partitioned over */
+    int signer_http_port; /* of the first instance, zero for none */
+    int signer_mass_concurrency; /* zones in flight in a mass operation */
+    int signer_notify_concurrency; /* notify commands running at once */
+    int signer_refresh_rate; /* udp transfer requests per second per master */
     struct engineconfig_repository* repositories;
     struct engineconfig_listener* interfaces;
     engineconfig_database_type_t db_type;
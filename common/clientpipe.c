@@ -33,6 +33,9 @@
 #include <assert.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <arpa/inet.h>
 
 #include "log.h"
@@ -58,11 +61,220 @@ header(char *buf, enum msg_type opc, uint16_t datalen) {
 	memcpy(&buf[1], &datalen, 2);
 }
 
+/* Output buffering. A command handler thread collects everything it sends
+ * to its client in one buffer, so a command printing many lines costs a
+ * few large writes instead of two per line. Consecutive output of the same
+ * kind is merged into one frame, frames never grow beyond what the client
+ * reads at once. A flusher thread sends output that has waited too long,
+ * so the client sees it while the command is busy with other work. */
+#define CLIENT_BUFSIZE 65536
+#define CLIENT_FRAMEMAX (ODS_SE_MAXLINE - 3)
+#define CLIENT_FLUSHMS 250
+
+struct client_buffer {
+	pthread_mutex_t lock; /* against the flusher */
+	struct client_buffer *next; /* all buffers, for the flusher */
+	int sockfd;
+	int failed; /* the flusher failed to send */
+	size_t len;
+	size_t last; /* offset of the last frame header or len if none */
+	struct timespec since; /* when the oldest unsent data was added */
+	char data[CLIENT_BUFSIZE];
+};
+
+static pthread_once_t client_buffer_once = PTHREAD_ONCE_INIT;
+static pthread_once_t client_flusher_once = PTHREAD_ONCE_INIT;
+static pthread_key_t client_buffer_key;
+static pthread_mutex_t client_buffers_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct client_buffer *client_buffers;
+
+static void
+client_buffer_free(void *arg)
+{
+	struct client_buffer **p, *cb = arg;
+	pthread_mutex_lock(&client_buffers_lock);
+	for (p = &client_buffers; *p; p = &(*p)->next) {
+		if (*p == cb) {
+			*p = cb->next;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&client_buffers_lock);
+	pthread_mutex_destroy(&cb->lock);
+	free(cb);
+}
+
+static void
+client_buffer_init(void)
+{
+	(void) pthread_key_create(&client_buffer_key, client_buffer_free);
+}
+
+static struct client_buffer *
+client_buffer_get(int sockfd)
+{
+	struct client_buffer *cb;
+	(void) pthread_once(&client_buffer_once, client_buffer_init);
+	cb = pthread_getspecific(client_buffer_key);
+	if (!cb || cb->sockfd != sockfd) return NULL;
+	return cb;
+}
+
+static int
+client_buffer_send(struct client_buffer *cb)
+{
+	ssize_t r = 0;
+	if (cb->len) r = ods_writen(cb->sockfd, cb->data, cb->len);
+	cb->len = 0;
+	cb->last = 0;
+	return r != -1;
+}
+
+static int
+client_buffer_add(struct client_buffer *cb, char opc, const char *data,
+	uint16_t count)
+{
+	uint16_t framelen, n;
+
+	if (cb->failed) return 0;
+	if (cb->len == 0) clock_gettime(CLOCK_MONOTONIC, &cb->since);
+	while (count > 0) {
+		/* extend the last frame if it carries the same stream */
+		if (cb->last < cb->len && cb->data[cb->last] == opc &&
+			opc != CLIENT_OPC_EXIT)
+		{
+			memcpy(&framelen, &cb->data[cb->last+1], 2);
+			framelen = ntohs(framelen);
+			n = CLIENT_FRAMEMAX - framelen;
+			if (n > count) n = count;
+			if (n > CLIENT_BUFSIZE - cb->len) n = CLIENT_BUFSIZE - cb->len;
+			if (n > 0) {
+				memcpy(&cb->data[cb->len], data, n);
+				header(&cb->data[cb->last], opc, framelen + n);
+				cb->len += n;
+				data += n;
+				count -= n;
+				continue;
+			}
+		}
+		if (cb->len + 3 >= CLIENT_BUFSIZE && !client_buffer_send(cb))
+			return 0;
+		cb->last = cb->len;
+		header(&cb->data[cb->len], opc, 0);
+		cb->len += 3;
+		if (opc == CLIENT_OPC_EXIT) {
+			/* the exit code is the only payload */
+			cb->data[cb->len++] = *data;
+			header(&cb->data[cb->last], opc, 1);
+			cb->last = cb->len;
+			return 1;
+		}
+	}
+	return 1;
+}
+
+static int
+client_buffer_put(struct client_buffer *cb, char opc, const char *data,
+	uint16_t count)
+{
+	int r;
+	pthread_mutex_lock(&cb->lock);
+	r = client_buffer_add(cb, opc, data, count);
+	pthread_mutex_unlock(&cb->lock);
+	return r;
+}
+
+/* Send the output of commands that has waited for CLIENT_FLUSHMS. A buffer
+ * that is locked is being written to, its command is not silent. */
+static void *
+client_flusher(void *arg)
+{
+	struct client_buffer *cb;
+	struct timespec now;
+	(void) arg;
+	for (;;) {
+		usleep(CLIENT_FLUSHMS * 1000 / 5);
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		pthread_mutex_lock(&client_buffers_lock);
+		for (cb = client_buffers; cb; cb = cb->next) {
+			if (pthread_mutex_trylock(&cb->lock)) continue;
+			if (cb->sockfd != -1 && cb->len > 0 &&
+				(now.tv_sec - cb->since.tv_sec) * 1000 +
+				(now.tv_nsec - cb->since.tv_nsec) / 1000000 >= CLIENT_FLUSHMS &&
+				!client_buffer_send(cb))
+			{
+				cb->failed = 1;
+			}
+			pthread_mutex_unlock(&cb->lock);
+		}
+		pthread_mutex_unlock(&client_buffers_lock);
+	}
+	return NULL;
+}
+
+static void
+client_flusher_start(void)
+{
+	pthread_t thread;
+	if (!pthread_create(&thread, NULL, client_flusher, NULL))
+		(void) pthread_detach(thread);
+}
+
+int
+client_buffer_start(int sockfd)
+{
+	struct client_buffer *cb;
+	(void) pthread_once(&client_buffer_once, client_buffer_init);
+	cb = pthread_getspecific(client_buffer_key);
+	if (!cb) {
+		if (!(cb = malloc(sizeof(struct client_buffer)))) return 0;
+		if (pthread_mutex_init(&cb->lock, NULL)) {
+			free(cb);
+			return 0;
+		}
+		if (pthread_setspecific(client_buffer_key, cb)) {
+			pthread_mutex_destroy(&cb->lock);
+			free(cb);
+			return 0;
+		}
+		cb->sockfd = -1;
+		pthread_mutex_lock(&client_buffers_lock);
+		cb->next = client_buffers;
+		client_buffers = cb;
+		pthread_mutex_unlock(&client_buffers_lock);
+		(void) pthread_once(&client_flusher_once, client_flusher_start);
+	}
+	pthread_mutex_lock(&cb->lock);
+	if (cb->sockfd != -1 && cb->sockfd != sockfd)
+		(void) client_buffer_send(cb);
+	cb->sockfd = sockfd;
+	cb->failed = 0;
+	cb->len = 0;
+	cb->last = 0;
+	pthread_mutex_unlock(&cb->lock);
+	return 1;
+}
+
+int
+client_buffer_stop(int sockfd)
+{
+	int r;
+	struct client_buffer *cb = client_buffer_get(sockfd);
+	if (!cb) return 1;
+	pthread_mutex_lock(&cb->lock);
+	r = client_buffer_send(cb) && !cb->failed;
+	cb->sockfd = -1;
+	pthread_mutex_unlock(&cb->lock);
+	return r;
+}
+
 /* 1 on succes, 0 on fail */
 int
 client_exit(int sockfd, char exitcode)
 {
 	char ctrl[4];
+	struct client_buffer *cb = client_buffer_get(sockfd);
+	if (cb) return client_buffer_put(cb, CLIENT_OPC_EXIT, &exitcode, 1);
 	header(ctrl, CLIENT_OPC_EXIT, 1);
 	ctrl[3] = exitcode;
 	return (ods_writen(sockfd, ctrl, 4) != -1);
@@ -73,7 +285,10 @@ static int
 client_msg(int sockfd, char opc, const char *cmd, uint16_t count)
 {
 	char ctrl[3];
+	struct client_buffer *cb;
 	if (sockfd == -1) return 0;
+	if ((cb = client_buffer_get(sockfd)))
+		return client_buffer_put(cb, opc, cmd, count);
 	header(ctrl, opc, count);
 	if (ods_writen(sockfd, ctrl, 3) == -1)
 		return 0;
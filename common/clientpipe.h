@@ -69,4 +69,15 @@ int client_stdin(int sockfd, const char *cmd, uint16_t count);
 int client_stdout(int sockfd, const char *cmd, uint16_t count);
 int client_stderr(int sockfd, const char *cmd, uint16_t count);
 
+/**
+ * Collect all output of this thread to sockfd in a buffer instead of
+ * writing each message. The buffer is sent when full, on
+ * client_buffer_stop(), and by a flusher thread once its oldest data is a
+ * quarter second old, also while the command is silent. Output to other
+ * sockets or from other threads is not affected.
+ * \return 0 on failure, output then stays unbuffered.
+ */
+int client_buffer_start(int sockfd);
+int client_buffer_stop(int sockfd);
+
 #endif /* DAEMON_CLIENTPIPE_H */
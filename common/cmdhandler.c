@@ -200,6 +200,7 @@ extract_msg(char* buf, int *pos, int buflen, int *exitcode, struct cmdhandler_ct
             ods_str_trim(data, 0);
 
             if (opc == CLIENT_OPC_STDIN) {
+                (void) client_buffer_start(context->sockfd);
                 *exitcode = cmdhandler_perform_command(data, context);
                 return 1;
             }
@@ -257,7 +258,9 @@ cmdhandler_handle_client_conversation(struct cmdhandler_ctx_struct* context)
                 ods_log_error("[%s] Error receiving message from client.", module_str);
                 break;
             } else if (r == 1) {
-                if (!client_exit(context->sockfd, exitcode)) {
+                if (!client_exit(context->sockfd, exitcode) ||
+                    !client_buffer_stop(context->sockfd))
+                {
                     ods_log_error("[%s] Error sending message to client.", module_str);
                 }
             }
@@ -265,6 +268,59 @@ cmdhandler_handle_client_conversation(struct cmdhandler_ctx_struct* context)
     }
 }
 
+/**
+ * Take a local context from the pool, or create one if none is idle.
+ * Contexts idle for too long are dropped rather than reused, a database
+ * server may have closed their connection in the mean time.
+ *
+ */
+static void*
+cmdhandler_getlocalcontext(cmdhandler_type* cmdh)
+{
+    void* localcontext = NULL;
+    time_t now = time(NULL);
+    int i;
+
+    pthread_mutex_lock(&cmdh->pool_lock);
+    if (cmdh->npool > 0) {
+        cmdh->npool--;
+        if (now - cmdh->pool[cmdh->npool].idle < CMDHANDLER_POOL_IDLE) {
+            localcontext = cmdh->pool[cmdh->npool].localcontext;
+        } else {
+            /* The top of the pool was used last, so all are stale. */
+            for (i = 0; i <= cmdh->npool; i++) {
+                cmdh->destroylocalcontext(cmdh->pool[i].localcontext);
+            }
+            cmdh->npool = 0;
+        }
+    }
+    pthread_mutex_unlock(&cmdh->pool_lock);
+    if (!localcontext) {
+        localcontext = cmdh->createlocalcontext(cmdh->globalcontext);
+    }
+    return localcontext;
+}
+
+/**
+ * Return a local context to the pool, destroying it if the pool is full.
+ *
+ */
+static void
+cmdhandler_putlocalcontext(cmdhandler_type* cmdh, void* localcontext)
+{
+    pthread_mutex_lock(&cmdh->pool_lock);
+    if (cmdh->npool < CMDHANDLER_POOL_SIZE && !cmdh->need_to_exit) {
+        cmdh->pool[cmdh->npool].localcontext = localcontext;
+        cmdh->pool[cmdh->npool].idle = time(NULL);
+        cmdh->npool++;
+        localcontext = NULL;
+    }
+    pthread_mutex_unlock(&cmdh->pool_lock);
+    if (localcontext) {
+        cmdh->destroylocalcontext(localcontext);
+    }
+}
+
 /**
  * Accept client.
  *
@@ -278,7 +334,7 @@ cmdhandler_accept_client(void* arg)
     ods_log_debug("[%s] accept client %i", module_str, context->sockfd);
 
     if (context->cmdhandler->createlocalcontext) {
-        context->localcontext = context->cmdhandler->createlocalcontext(context->globalcontext);
+        context->localcontext = cmdhandler_getlocalcontext(context->cmdhandler);
         if (!context->localcontext) {
             client_printf_err(context->sockfd, "Failed to open DB connection.\n");
             client_exit(context->sockfd, 1);
@@ -291,8 +347,10 @@ cmdhandler_accept_client(void* arg)
         shutdown(context->sockfd, SHUT_RDWR);
         close(context->sockfd);
     }
-    if (context->cmdhandler->destroylocalcontext) {
-        context->cmdhandler->destroylocalcontext(context->localcontext);
+    if (context->localcontext) {
+        if (context->cmdhandler->destroylocalcontext) {
+            cmdhandler_putlocalcontext(context->cmdhandler, context->localcontext);
+        }
     }
     free(context);
 }
@@ -365,6 +423,8 @@ cmdhandler_create(const char* filename, struct cmd_func_block** commands, void*
     cmdh->globalcontext = globalcontext;
     cmdh->createlocalcontext = createlocalcontext;
     cmdh->destroylocalcontext = destroylocalcontext;
+    cmdh->npool = 0;
+    pthread_mutex_init(&cmdh->pool_lock, NULL);
     return cmdh;
 }
 
@@ -375,9 +435,14 @@ cmdhandler_create(const char* filename, struct cmd_func_block** commands, void*
 void
 cmdhandler_cleanup(cmdhandler_type* cmdhandler)
 {
+    int i;
     if (cmdhandler) {
         if (cmdhandler->listen_fd >= 0)
             close(cmdhandler->listen_fd);
+        for (i = 0; i < cmdhandler->npool; i++) {
+            cmdhandler->destroylocalcontext(cmdhandler->pool[i].localcontext);
+        }
+        pthread_mutex_destroy(&cmdhandler->pool_lock);
         free(cmdhandler);
     }
 }
@@ -34,6 +34,8 @@
 
 #include "config.h"
 #include <sys/un.h>
+#include <pthread.h>
+#include <time.h>
 
 typedef struct cmdhandler_struct cmdhandler_type;
 
@@ -70,6 +72,11 @@ struct cmd_func_block {
     int (*run)(int sockfd, cmdhandler_ctx_type*, char *cmd);
 };
 
+/* Idle local contexts (database connections for the enforcer) kept for
+ * the next client, and for how many seconds an idle one may be reused. */
+#define CMDHANDLER_POOL_SIZE 8
+#define CMDHANDLER_POOL_IDLE 300
+
 struct cmdhandler_struct {
     struct sockaddr_un listen_addr;
     janitor_thread_t thread_id;
@@ -80,6 +87,12 @@ struct cmdhandler_struct {
     void* globalcontext;
     void* (*createlocalcontext)(void*);
     void  (*destroylocalcontext)(void*);
+    pthread_mutex_t pool_lock;
+    int npool;
+    struct {
+        void* localcontext;
+        time_t idle;
+    } pool[CMDHANDLER_POOL_SIZE];
 };
 
 /**
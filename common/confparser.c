@@ -45,35 +45,18 @@
 static const char* parser_str = "parser";
 
 /**
- * Parse elements from the configuration file.
+ * Validate a document with rng file, the document is freed.
  *
  */
-ods_status
-parse_file_check(const char* cfgfile, const char* rngfile)
+static ods_status
+parse_doc_check(xmlDocPtr doc, const char* cfgfile, const char* rngfile)
 {
-    xmlDocPtr doc = NULL;
     xmlDocPtr rngdoc = NULL;
     xmlRelaxNGParserCtxtPtr rngpctx = NULL;
     xmlRelaxNGValidCtxtPtr rngctx = NULL;
     xmlRelaxNGPtr schema = NULL;
     int status;
 
-    if (!cfgfile || !rngfile) {
-        ods_log_error("[%s] no cfgfile or rngfile", parser_str);
-        return ODS_STATUS_ASSERT_ERR;
-    }
-    ods_log_assert(cfgfile);
-    ods_log_assert(rngfile);
-    ods_log_debug("[%s] check cfgfile %s with rngfile %s", parser_str,
-        cfgfile, rngfile);
-
-    /* Load XML document */
-    doc = xmlParseFile(cfgfile);
-    if (doc == NULL) {
-        ods_log_error("[%s] unable to read cfgfile %s", parser_str,
-            cfgfile);
-        return ODS_STATUS_XML_ERR;
-    }
     /* Load rng document */
     rngdoc = xmlParseFile(rngfile);
     if (rngdoc == NULL) {
@@ -135,6 +118,61 @@ parse_file_check(const char* cfgfile, const char* rngfile)
     return ODS_STATUS_OK;
 }
 
+/**
+ * Parse elements from the configuration file.
+ *
+ */
+ods_status
+parse_file_check(const char* cfgfile, const char* rngfile)
+{
+    xmlDocPtr doc = NULL;
+
+    if (!cfgfile || !rngfile) {
+        ods_log_error("[%s] no cfgfile or rngfile", parser_str);
+        return ODS_STATUS_ASSERT_ERR;
+    }
+    ods_log_assert(cfgfile);
+    ods_log_assert(rngfile);
+    ods_log_debug("[%s] check cfgfile %s with rngfile %s", parser_str,
+        cfgfile, rngfile);
+
+    /* Load XML document */
+    doc = xmlParseFile(cfgfile);
+    if (doc == NULL) {
+        ods_log_error("[%s] unable to read cfgfile %s", parser_str,
+            cfgfile);
+        return ODS_STATUS_XML_ERR;
+    }
+    return parse_doc_check(doc, cfgfile, rngfile);
+}
+
+/**
+ * Check configuration already read into memory.
+ *
+ */
+ods_status
+parse_memory_check(const char* cfgfile, const char* content, size_t size,
+    const char* rngfile)
+{
+    xmlDocPtr doc = NULL;
+
+    if (!cfgfile || !content || !rngfile) {
+        ods_log_error("[%s] no cfgfile, content or rngfile", parser_str);
+        return ODS_STATUS_ASSERT_ERR;
+    }
+    ods_log_debug("[%s] check content of cfgfile %s with rngfile %s",
+        parser_str, cfgfile, rngfile);
+
+    /* Load XML document */
+    doc = xmlReadMemory(content, (int) size, cfgfile, NULL, 0);
+    if (doc == NULL) {
+        ods_log_error("[%s] unable to read cfgfile %s", parser_str,
+            cfgfile);
+        return ODS_STATUS_XML_ERR;
+    }
+    return parse_doc_check(doc, cfgfile, rngfile);
+}
+
 /* TODO: look how the enforcer reads this now */
 
 /**
@@ -651,6 +689,24 @@ parse_conf_use_syslog(const char* cfgfile)
     return 0;
 }
 
+/**
+ * Parse a number from the configuration file, dflt when absent or empty.
+ *
+ */
+static long
+parse_conf_number(const char* cfgfile, const char* expr, long dflt)
+{
+    long number = dflt;
+    const char* str = parse_conf_string(cfgfile, expr, 0);
+    if (str) {
+        if (strlen(str) > 0) {
+            number = atol(str);
+        }
+        free((void*)str);
+    }
+    return number;
+}
+
 int
 parse_conf_verbosity(const char* cfgfile)
 {
@@ -784,6 +840,20 @@ parse_conf_rollover_notification(const char* cfgfile)
     return period;
 }
 
+int
+parse_conf_enforcer_startup_rate(const char* cfgfile)
+{
+    return (int) parse_conf_number(cfgfile,
+        "//Configuration/Enforcer/StartupRate", ODS_EN_STARTUPRATE);
+}
+
+int
+parse_conf_resalt_concurrency(const char* cfgfile)
+{
+    return (int) parse_conf_number(cfgfile,
+        "//Configuration/Enforcer/ResaltConcurrency", ODS_EN_RESALTCONCURRENCY);
+}
+
 /**
  * Parse the listener interfaces.
  *
@@ -897,3 +967,53 @@ parse_conf_signer_threads(const char* cfgfile)
     /* no SignerThreads value configured, look at WorkerThreads */
     return parse_conf_worker_threads(cfgfile, 0);
 }
+
+int
+parse_conf_signer_coalesce_window(const char* cfgfile)
+{
+    return (int) parse_conf_number(cfgfile,
+        "//Configuration/Signer/CoalesceWindow", ODS_SE_COALESCEWINDOW);
+}
+
+long
+parse_conf_signer_memory_budget(const char* cfgfile)
+{
+    return parse_conf_number(cfgfile,
+        "//Configuration/Signer/MemoryBudget", ODS_SE_MEMORYBUDGET);
+}
+
+int
+parse_conf_signer_instances(const char* cfgfile)
+{
+    int instances = (int) parse_conf_number(cfgfile,
+        "//Configuration/Signer/Instances", ODS_SE_INSTANCES);
+    return (instances < 1 ? 1 : instances);
+}
+
+int
+parse_conf_signer_http_port(const char* cfgfile)
+{
+    return (int) parse_conf_number(cfgfile,
+        "//Configuration/Signer/HttpPort", ODS_SE_HTTPPORT);
+}
+
+int
+parse_conf_signer_mass_concurrency(const char* cfgfile)
+{
+    return (int) parse_conf_number(cfgfile,
+        "//Configuration/Signer/MassConcurrency", ODS_SE_MASSCONCURRENCY);
+}
+
+int
+parse_conf_signer_notify_concurrency(const char* cfgfile)
+{
+    return (int) parse_conf_number(cfgfile,
+        "//Configuration/Signer/NotifyConcurrency", ODS_SE_NOTIFYCONCURRENCY);
+}
+
+int
+parse_conf_signer_refresh_rate(const char* cfgfile)
+{
+    return (int) parse_conf_number(cfgfile,
+        "//Configuration/Signer/RefreshRate", ODS_SE_REFRESHRATE);
+}
@@ -47,6 +47,18 @@
  */
 ods_status parse_file_check(const char* cfgfile, const char* rngfile);
 
+/**
+ * Check configuration already read into memory with rng file.
+ * \param[in] cfgfile the configuration file name, for messages
+ * \param[in] content the configuration
+ * \param[in] size size of content
+ * \param[in] rngfile the rng file name
+ * \return ods_status status
+ *
+ */
+ods_status parse_memory_check(const char* cfgfile, const char* content,
+    size_t size, const char* rngfile);
+
 /**
  * Parse elements from the configuration file.
  * \param[in] cfgfile configuration file
@@ -102,10 +114,19 @@ int parse_conf_verbosity(const char* cfgfile);
 /** Enforcer and signer specific */
 int parse_conf_worker_threads(const char* cfgfile, int is_enforcer);
 int parse_conf_signer_threads(const char* cfgfile);
+int parse_conf_signer_coalesce_window(const char* cfgfile);
+long parse_conf_signer_memory_budget(const char* cfgfile);
+int parse_conf_signer_instances(const char* cfgfile);
+int parse_conf_signer_http_port(const char* cfgfile);
+int parse_conf_signer_mass_concurrency(const char* cfgfile);
+int parse_conf_signer_notify_concurrency(const char* cfgfile);
+int parse_conf_signer_refresh_rate(const char* cfgfile);
 int parse_conf_manual_keygen(const char* cfgfile);
 int parse_conf_db_port(const char *cfgfile);
 time_t parse_conf_automatic_keygen_period(const char* cfgfile);
 time_t parse_conf_rollover_notification(const char* cfgfile);
+int parse_conf_enforcer_startup_rate(const char* cfgfile);
+int parse_conf_resalt_concurrency(const char* cfgfile);
 struct engineconfig_repository* parse_conf_repositories(const char* cfgfile);
 const char* parse_conf_notify_command(const char* cfgfile);
 struct engineconfig_listener* parse_conf_listener(const char* cfgfile);
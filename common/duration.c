@@ -38,6 +38,7 @@
 #include <string.h>
 #include <time.h>
 #include <ctype.h>
+#include <pthread.h>
 
 static const char* duration_str = "duration";
 
@@ -471,6 +472,61 @@ time_now(void)
     return time_now_set ? time_now_set: time(NULL);
 }
 
+static int64_t time_offset_ns; /* wall clock minus monotonic clock */
+static pthread_once_t time_offset_once = PTHREAD_ONCE_INIT;
+
+static int64_t
+time_ns(clockid_t clockid)
+{
+    struct timespec ts;
+    clock_gettime(clockid, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+time_offset_init(void)
+{
+    time_offset_ns = time_ns(CLOCK_REALTIME) - time_ns(CLOCK_MONOTONIC);
+}
+
+int64_t
+time_now_ns(void)
+{
+    if (time_now_set) {
+        return (int64_t) time_now_set * 1000000000;
+    }
+    pthread_once(&time_offset_once, time_offset_init);
+    return time_ns(CLOCK_MONOTONIC) + time_offset_ns;
+}
+
+int64_t
+time_due_ns(time_t when, long nsec)
+{
+    int64_t due = (int64_t) when * 1000000000 + nsec;
+    if (time_now_set) {
+        return due;
+    }
+    /* correct for the wall clock being stepped since the clock started */
+    return due + (time_now_ns() - time_ns(CLOCK_REALTIME));
+}
+
+void
+time_cond_deadline(int64_t ns, struct timespec* ts)
+{
+#ifdef HAVE_PTHREAD_CONDATTR_SETCLOCK
+    pthread_once(&time_offset_once, time_offset_init);
+    ns -= time_offset_ns;
+#else
+    /* condition variables wait on the wall clock */
+    ns += time_ns(CLOCK_REALTIME) - time_now_ns();
+#endif
+    if (ns < 0) {
+        ns = 0;
+    }
+    ts->tv_sec = ns / 1000000000;
+    ts->tv_nsec = ns % 1000000000;
+}
+
 int
 time_leaped(void)
 {
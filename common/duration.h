@@ -148,6 +148,36 @@ int set_time_now_str(char* now);
  */
 time_t time_now(void);
 
+/**
+ * Return the time since Epoch, measured in nanoseconds on a clock that
+ * does not follow steps of the wall clock.  It starts at the wall clock
+ * time of its first use and then advances with CLOCK_MONOTONIC.  When
+ * the time has been leaped it follows time_now().
+ * \return int64_t now
+ *
+ */
+int64_t time_now_ns(void);
+
+/**
+ * Convert a wall clock time to the clock of time_now_ns().
+ * \param[in] when seconds since Epoch
+ * \param[in] nsec nanoseconds past when
+ * \return int64_t when on the clock of time_now_ns()
+ *
+ */
+int64_t time_due_ns(time_t when, long nsec);
+
+/**
+ * Convert a time of time_now_ns() to an absolute deadline for
+ * pthread_cond_timedwait() on a condition variable set up like the
+ * scheduler's: CLOCK_MONOTONIC where pthread_condattr_setclock() is
+ * available, the wall clock otherwise.
+ * \param[in] ns time on the clock of time_now_ns()
+ * \param[out] ts deadline
+ *
+ */
+void time_cond_deadline(int64_t ns, struct timespec* ts);
+
 /**
  * Clean up duration.
  * \param[in] duration duration to be cleaned up
@@ -188,6 +188,7 @@ schedule_type*
 schedule_create()
 {
     schedule_type* schedule;
+    pthread_condattr_t condattr;
     CHECKALLOC(schedule = (schedule_type*) malloc(sizeof(schedule_type)));
 
     schedule->tasks = ldns_rbtree_create(task_compare_time_then_ttuple);
@@ -195,7 +196,13 @@ schedule_create()
     schedule->locks_by_name = ldns_rbtree_create(task_compare_ttuple_lock);
 
     pthread_mutex_init(&schedule->schedule_lock, NULL);
-    pthread_cond_init(&schedule->schedule_cond, NULL);
+    /* workers wait for due tasks on the monotonic clock, where supported */
+    pthread_condattr_init(&condattr);
+#ifdef HAVE_PTHREAD_CONDATTR_SETCLOCK
+    pthread_condattr_setclock(&condattr, CLOCK_MONOTONIC);
+#endif
+    pthread_cond_init(&schedule->schedule_cond, &condattr);
+    pthread_condattr_destroy(&condattr);
     schedule->num_waiting = 0;
     schedule->handlers = NULL;
     schedule->nhandlers = 0;
@@ -335,6 +342,7 @@ schedule_task(schedule_type* schedule, task_type* task, int replace, int log)
     }
     ods_log_debug("[%s] schedule task %s for %s", schedule_str,
             task->type, task->owner);
+    task->due_ns = time_due_ns(task->due_date, task->due_nsec);
 
     pthread_mutex_lock(&schedule->schedule_lock);
     if (fetch_node_pair(schedule, task, &node1, &node2, replace)) {
@@ -375,8 +383,11 @@ schedule_task(schedule_type* schedule, task_type* task, int replace, int log)
         } else {
             ods_log_assert(node1->key == node2->key);
             existing_task = (task_type*) node1->key;
-            if (task->due_date < existing_task->due_date)
+            if (task->due_ns < existing_task->due_ns) {
                 existing_task->due_date = task->due_date;
+                existing_task->due_nsec = task->due_nsec;
+                existing_task->due_ns = task->due_ns;
+            }
             if (existing_task->freedata)
                 existing_task->freedata(existing_task->userdata);
             existing_task->userdata = task->userdata;
@@ -444,22 +455,33 @@ schedule_unschedule(schedule_type* schedule, task_type* task)
 task_type*
 schedule_pop_task(schedule_type* schedule)
 {
-    time_t timeout, now = time_now();
+    int64_t wakeup, now = time_now_ns();
+    struct timespec deadline;
     task_type* task;
 
     pthread_mutex_lock(&schedule->schedule_lock);
     task = schedule_get_first_task(schedule);
-    if (task && (task->due_date <= now)) {
+    if (task && (task->due_ns <= now)) {
         ods_log_debug("[%s] pop task for zone %s", schedule_str, task->owner);
         task = unschedule_task(schedule, task);
+        /* hand the wake up for the next task to another waiting worker */
+        if (schedule_get_first_task(schedule)) {
+            pthread_cond_signal(&schedule->schedule_cond);
+        }
     } else {
-        /* nothing to do now, sleep and wait for signal */
+        /* nothing to do now, sleep until the first task is due or
+         * until a signal */
         schedule->num_waiting += 1;
-        timeout = clamp((task ? (task->due_date - now) : 0),
-                        ((task && !strcmp(task->class, TASK_CLASS_ENFORCER)) ? 0 : 60),
-                        ODS_SE_MAX_BACKOFF);
-        if (time_leaped()) timeout = -1;
-        ods_thread_wait(&schedule->schedule_cond, &schedule->schedule_lock, timeout);
+        if (time_leaped()) {
+            pthread_cond_wait(&schedule->schedule_cond, &schedule->schedule_lock);
+        } else {
+            wakeup = now + (int64_t) (task ? ODS_SE_MAX_BACKOFF : 60) * 1000000000;
+            if (task && task->due_ns < wakeup) {
+                wakeup = task->due_ns;
+            }
+            time_cond_deadline(wakeup, &deadline);
+            pthread_cond_timedwait(&schedule->schedule_cond, &schedule->schedule_lock, &deadline);
+        }
         schedule->num_waiting -= 1;
         task = NULL;
     }
@@ -492,12 +514,14 @@ schedule_flush(schedule_type* schedule)
         node = ldns_rbtree_last(schedule->tasks);
         if (node && node != LDNS_RBTREE_NULL) {
             task = (task_type*) node->data;
-            if (task->due_date > time_now()) {
+            if (task->due_ns > time_now_ns()) {
                 /* we only need to delete the node from the tasks tree as we
                  * are immediately inserting it again.
                  */
                 ldns_rbtree_delete(schedule->tasks, task);
                 task->due_date = time_now();
+                task->due_nsec = 0;
+                task->due_ns = time_now_ns();
                 ldns_rbtree_insert(schedule->tasks, node);
             } else {
                 /* the last in the ordered tree is already executing
@@ -578,7 +602,8 @@ schedule_describetask(task_type* task)
     }
     strtask = (char*) calloc(ODS_SE_MAXLINE, sizeof(char));
     if (strtask) {
-        char const *entity = strcmp(TASK_TYPE_RESALT, task->type) ? "zone" : "policy";
+        char const *entity = (strcmp(TASK_TYPE_RESALT, task->type) &&
+            strcmp(TASK_TYPE_ENFORCEPOLICY, task->type)) ? "zone" : "policy";
         snprintf(strtask, ODS_SE_MAXLINE, "On %s I will %s %s %s\n",
             strtime, task->type, entity, task->owner);
         return strtask;
@@ -609,8 +634,8 @@ schedule_registertask(schedule_type* schedule, task_id taskclass, task_id taskty
     }
 }
 
-void
-schedule_scheduletask(schedule_type* schedule, task_id type, const char* owner, void* userdata, pthread_mutex_t* resource, time_t when)
+static void
+schedule_handlertask(schedule_type* schedule, task_id type, const char* owner, void* userdata, pthread_mutex_t* resource, time_t when, long nsec, int replace)
 {
     int i;
     task_type* task;
@@ -622,11 +647,40 @@ schedule_scheduletask(schedule_type* schedule, task_id type, const char* owner,
     }
     if (handler) {
         task = task_create(strdup(owner), handler->class, type, handler->callback, userdata, NULL, when);
+        task->due_nsec = nsec;
         task->lock = resource;
-        schedule_task(schedule, task, 0, 0);
+        schedule_task(schedule, task, replace, 0);
     }
 }
 
+void
+schedule_scheduletask(schedule_type* schedule, task_id type, const char* owner, void* userdata, pthread_mutex_t* resource, time_t when)
+{
+    schedule_handlertask(schedule, type, owner, userdata, resource, when, 0, 0);
+}
+
+void
+schedule_rescheduletask(schedule_type* schedule, task_id type, const char* owner, void* userdata, pthread_mutex_t* resource, time_t when)
+{
+    schedule_handlertask(schedule, type, owner, userdata, resource, when, 0, 1);
+}
+
+void
+schedule_scheduletask_in(schedule_type* schedule, task_id type, const char* owner, void* userdata, pthread_mutex_t* resource, long msec)
+{
+    struct timespec now;
+    int64_t nsec;
+    if (time_leaped()) {
+        now.tv_sec = time_now();
+        now.tv_nsec = 0;
+    } else {
+        clock_gettime(CLOCK_REALTIME, &now);
+    }
+    nsec = now.tv_nsec + (int64_t) msec * 1000000;
+    schedule_handlertask(schedule, type, owner, userdata, resource,
+        now.tv_sec + nsec / 1000000000, nsec % 1000000000, 0);
+}
+
 void
 schedule_unscheduletask(schedule_type* schedule, task_id type, const char* owner)
 {
@@ -644,3 +698,59 @@ schedule_unscheduletask(schedule_type* schedule, task_id type, const char* owner
     pthread_mutex_unlock(&schedule->schedule_lock);
     free(match); /* do not perform a destroy, this is a temporary, internal, flat task only */
 }
+
+time_t
+schedule_nextdue(schedule_type* schedule, const char* owner)
+{
+    int i;
+    ldns_rbnode_t* node1;
+    ldns_rbnode_t* node2;
+    task_type* match;
+    time_t due = -1;
+    pthread_mutex_lock(&schedule->schedule_lock);
+    for (i = 0; i < schedule->nhandlers; i++) {
+        match = task_create(owner, schedule->handlers[i].class, schedule->handlers[i].type, NULL, NULL, NULL, schedule_WHENEVER);
+        if (fetch_node_pair(schedule, match, &node1, &node2, 0) == 0) {
+            if (due < 0 || ((task_type*)node1->key)->due_date < due)
+                due = ((task_type*)node1->key)->due_date;
+        }
+        free(match); /* temporary, internal, flat task only */
+    }
+    pthread_mutex_unlock(&schedule->schedule_lock);
+    return due;
+}
+
+int
+schedule_flush_owner(schedule_type* schedule, const char* owner)
+{
+    int i, count = 0;
+    ldns_rbnode_t* node1;
+    ldns_rbnode_t* node2;
+    task_type* match;
+    task_type* task;
+    time_t now = time_now();
+    int64_t now_ns = time_now_ns();
+    pthread_mutex_lock(&schedule->schedule_lock);
+    for (i = 0; i < schedule->nhandlers; i++) {
+        match = task_create(owner, schedule->handlers[i].class, schedule->handlers[i].type, NULL, NULL, NULL, schedule_WHENEVER);
+        if (fetch_node_pair(schedule, match, &node1, &node2, 0) == 0) {
+            task = (task_type*) node1->key;
+            if (task->due_ns > now_ns) {
+                /* the name tree does not order by time, only the tasks
+                 * tree needs the node reinserted */
+                node1 = ldns_rbtree_delete(schedule->tasks, task);
+                task->due_date = now;
+                task->due_nsec = 0;
+                task->due_ns = now_ns;
+                ldns_rbtree_insert(schedule->tasks, node1);
+            }
+            count++;
+        }
+        free(match); /* temporary, internal, flat task only */
+    }
+    if (count) {
+        pthread_cond_signal(&schedule->schedule_cond);
+    }
+    pthread_mutex_unlock(&schedule->schedule_lock);
+    return count;
+}
@@ -125,6 +125,18 @@ void schedule_purge_owner(schedule_type* schedule, char const *class,
 ods_status schedule_task(schedule_type* schedule, task_type* task, int replace, int log);
 void schedule_scheduletask(schedule_type* schedule, task_id task, const char* owner, void* userdata, pthread_mutex_t* resource, time_t when);
 
+/**
+ * Schedule a task, or move it forward if it is already scheduled later.
+ *
+ */
+void schedule_rescheduletask(schedule_type* schedule, task_id task, const char* owner, void* userdata, pthread_mutex_t* resource, time_t when);
+
+/**
+ * Schedule a task msec milliseconds from now, with sub-second precision.
+ *
+ */
+void schedule_scheduletask_in(schedule_type* schedule, task_id task, const char* owner, void* userdata, pthread_mutex_t* resource, long msec);
+
 /**
  * Unschedule task.
  * \return task_type* task, if it was scheduled
@@ -132,6 +144,20 @@ void schedule_scheduletask(schedule_type* schedule, task_id task, const char* ow
  */
 void schedule_unscheduletask(schedule_type* schedule, task_id task, const char* userdata);
 
+/**
+ * Earliest time any task of an owner is due.
+ * \return time_t due time, or -1 when nothing is scheduled for the owner
+ *
+ */
+time_t schedule_nextdue(schedule_type* schedule, const char* owner);
+
+/**
+ * Make all tasks of an owner due now.
+ * \return int number of tasks of the owner
+ *
+ */
+int schedule_flush_owner(schedule_type* schedule, const char* owner);
+
 /**
  * Pop the first scheduled task that is due. If an item is directly
  * available it will be returned. Else the call will block and return
@@ -51,6 +51,7 @@ const char* TASK_CLASS_SIGNER   = "signer";
 const char* TASK_NONE           = "[ignore]";
 
 const char* TASK_TYPE_ENFORCE   = "enforce";
+const char* TASK_TYPE_ENFORCEPOLICY = "enforce-policy";
 const char* TASK_TYPE_RESALT    = "resalt";
 const char* TASK_TYPE_HSMKEYGEN = "hsmkeygen";
 const char* TASK_TYPE_DSSUBMIT  = "ds-submit";
@@ -64,6 +65,8 @@ const char* TASK_SIGN           = "[sign]";
 const char* TASK_WRITE          = "[write]";
 const char* TASK_FORCESIGNCONF  = "[forcesignconf]";
 const char* TASK_FORCEREAD      = "[forceread]";
+const char* TASK_PROPAGATE      = "[propagate]";
+const char* TASK_SIGNPUSHED     = "[signpushed]";
 
 task_type*
 task_create(const char *owner, char const *class, char const *type,
@@ -83,6 +86,8 @@ task_create(const char *owner, char const *class, char const *type,
     task->userdata = userdata;
     task->freedata = freedata;
     task->due_date = due_date;
+    task->due_nsec = 0;
+    task->due_ns = 0;
     task->lock = NULL;
 
     task->backoff = 0;
@@ -132,6 +137,7 @@ task_perform(schedule_type* scheduler, task_type* task, void* context)
     }
     if (rescheduleTime >= 0) {
         task->due_date = rescheduleTime;
+        task->due_nsec = 0;
         status = schedule_task(scheduler, task, (!strcmp(task->class, TASK_CLASS_ENFORCER) ? 1 : 0),
                                                 (!strcmp(task->class, TASK_CLASS_SIGNER) ? 1 : 0));
         if (status != ODS_STATUS_OK) {
@@ -205,8 +211,8 @@ task_compare_time_then_ttuple(const void* a, const void* b)
     ods_log_assert(b);
 
     if (x->due_date != schedule_WHENEVER && y->due_date != schedule_WHENEVER) {
-        if (x->due_date != y->due_date) {
-            return x->due_date - y->due_date;
+        if (x->due_ns != y->due_ns) {
+            return (x->due_ns < y->due_ns ? -1 : 1);
         }
     }
     return cmp_ttuple(x, y);
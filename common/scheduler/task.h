@@ -38,7 +38,9 @@
  * due_date: The time this task should run on. Unix timestamp. Anything
  * smaller than now() should be considered ASAP. Negative values should
  * not be given. They are special and tell the signer not to schedule a
- * task.
+ * task. The scheduler orders and wakes up on due_ns, the due date on
+ * the monotonic clock of time_now_ns(), so steps of the wall clock do
+ * not delay or advance tasks once scheduled.
  *
  * Payload: the callback, a context passed to the callback and method
  * to free the context.
@@ -49,6 +51,7 @@
 #define SCHEDULER_TASK_H
 
 #include "config.h"
+#include <stdint.h>
 #include <time.h>
 #include <pthread.h>
 #include "status.h"
@@ -67,6 +70,11 @@ struct task_struct {
     /* date and time this task should execute anything. If time is in
      * the past interpret it as *now* */
     time_t due_date;
+    /* nanoseconds past due_date, for tasks due within a second */
+    long due_nsec;
+    /* due_date and due_nsec on the clock of time_now_ns(), set by the
+     * scheduler */
+    int64_t due_ns;
 
     /* if returned time >= 0 the task is rescheduled for that time.
      * keeping context. otherwise scheduler will free context, owner,
@@ -93,6 +101,7 @@ extern const char* TASK_CLASS_ENFORCER;
 extern const char* TASK_CLASS_SIGNER;
 
 extern const char* TASK_TYPE_ENFORCE;
+extern const char* TASK_TYPE_ENFORCEPOLICY;
 extern const char* TASK_TYPE_RESALT;
 extern const char* TASK_TYPE_HSMKEYGEN;
 extern const char* TASK_TYPE_DSSUBMIT;
@@ -107,6 +116,8 @@ extern const char* TASK_SIGN;
 extern const char* TASK_WRITE;
 extern const char* TASK_FORCESIGNCONF;
 extern const char* TASK_FORCEREAD;
+extern const char* TASK_PROPAGATE;
+extern const char* TASK_SIGNPUSHED;
 
 /*
  * owner: string is owned by task.
@@ -35,9 +35,12 @@
 #include "log.h"
 #include "util.h"
 
+#include <ctype.h>
 #include <fcntl.h>
 #include <ldns/ldns.h>
 #include <signal.h>
+#include <stdio.h>
+#include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <time.h>
@@ -340,3 +343,48 @@ clamp(int value, int lbnd, int ubnd)
     else
         return value;
 }
+
+/**
+ * Determine owning instance of a zone.
+ *
+ */
+int
+util_instance_of(const char* name, int instances)
+{
+    uint32_t hash = 2166136261U;
+    size_t len;
+    size_t i;
+    if (!name || instances <= 1) {
+        return 0;
+    }
+    len = strlen(name);
+    if (len > 1 && name[len-1] == '.') {
+        len--;
+    }
+    /* FNV-1a, stable across processes and restarts */
+    for (i = 0; i < len; i++) {
+        hash ^= (uint32_t) tolower((unsigned char) name[i]);
+        hash *= 16777619U;
+    }
+    return (int) (hash % (uint32_t) instances);
+}
+
+/**
+ * Derive per-instance file name.
+ *
+ */
+char*
+util_instance_file(const char* file, int instance)
+{
+    char* name = NULL;
+    if (!file) {
+        return NULL;
+    }
+    if (instance <= 0) {
+        return strdup(file);
+    }
+    if (asprintf(&name, "%s.%d", file, instance) < 0) {
+        return NULL;
+    }
+    return name;
+}
@@ -136,5 +136,28 @@ int util_pidfile_avail(const char* pidfile);
  */
 int clamp(int value, int lbnd, int ubnd);
 
+/**
+ * Determine which of a number of signer instances owns a zone.
+ *
+ * The zone name is hashed case insensitively and without a trailing
+ * dot, so names as found in the zonelist and as found in queries map
+ * onto the same instance.
+ * \param[in] name zone name
+ * \param[in] instances number of instances
+ * \return int index of the owning instance, 0 if there is only one
+ *
+ */
+int util_instance_of(const char* name, int instances);
+
+/**
+ * Derive the name of a per-instance file from a configured file name.
+ * Instance 0 keeps the configured name, others get ".<instance>" appended.
+ * \param[in] file configured file name
+ * \param[in] instance instance index
+ * \return char* allocated file name
+ *
+ */
+char* util_instance_file(const char* file, int instance);
+
 
 #endif /* UTIL_UTIL_H */
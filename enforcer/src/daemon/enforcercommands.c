@@ -25,6 +25,7 @@
 #include "enforcer/update_conf_cmd.h"
 #include "enforcer/enforce_cmd.h"
 #include "enforcer/lookahead_cmd.h"
+#include "enforcer/simulate_cmd.h"
 #include "policy/policy_import_cmd.h"
 #include "policy/policy_export_cmd.h"
 #include "policy/policy_purge_cmd.h"
@@ -90,6 +91,7 @@ static struct cmd_func_block* enforcecommands[] = {
 
         &enforce_funcblock,
         &lookahead_funcblock,
+        &simulate_funcblock,
         &signconf_funcblock,
 
 
@@ -44,6 +44,7 @@
 
 #include "daemon/queue_cmd.h"
 #include "scheduler/task.h"
+#include "enforcer/enforce_task.h"
 
 static const char *module_str = "queue_cmd";
 
@@ -78,6 +79,7 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
 	ldns_rbnode_t* node = LDNS_RBTREE_NULL;
 	task_type* task = NULL;
 	int num_waiting;
+	size_t done, total;
         engine_type* engine = getglobalcontext(context);
 	(void)cmd;
 
@@ -106,6 +108,9 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
 	} else if (nextFireTime >= 0) {
 			client_printf(sockfd, "Next task scheduled immediately\n");
 	} /* else: no tasks scheduled at all. */
+	if (enforce_task_catchup_progress(&done, &total)) {
+		client_printf(sockfd, "Startup catch-up: %zu of %zu zones enforced\n", done, total);
+	}
 	
 	/* list tasks */
 	pthread_mutex_lock(&engine->taskq->schedule_lock);
@@ -28,7 +28,7 @@
 
 const char* db_schema_mysql_create[] = {
     "CREATE TABLE zone ( id BIGINT UNSIGNED PRIMARY KEY AUTO_INCREMENT NOT NULL,  rev INT UNSIGNED NOT NULL DEFAULT 1,  policyId BIGINT UNSIGNED NOT NULL,  name TEXT NOT NULL,  signconfNeedsWriting INT UNSIGNED NOT NULL,  signconfPath TEXT NOT NULL,  nextChange INT NOT NULL,  ttlEndDs INT UNSIGNED NOT NULL,  ttlEndDk INT UNSIGNED NOT NULL,  ttlEndRs INT UNSIGNED NOT NULL,  rollKskNow INT UNSIGNED NOT NULL,  rollZskNow INT UNSIGNED NOT NULL,  rollCskNow INT UNSIGNED NOT NULL,  inputAdapterType TEXT NO",
-    "T NULL,  inputAdapterUri TEXT NOT NULL,  outputAdapterType TEXT NOT NULL,  outputAdapterUri TEXT NOT NULL,  nextKskRoll INT UNSIGNED NOT NULL,  nextZskRoll INT UNSIGNED NOT NULL,  nextCskRoll INT UNSIGNED NOT NULL)",
+    "T NULL,  inputAdapterUri TEXT NOT NULL,  outputAdapterType TEXT NOT NULL,  outputAdapterUri TEXT NOT NULL,  nextKskRoll INT UNSIGNED NOT NULL,  nextZskRoll INT UNSIGNED NOT NULL,  nextCskRoll INT UNSIGNED NOT NULL,  denialSaltPublished INT UNSIGNED NOT NULL DEFAULT 0)",
     0,
     "CREATE INDEX zonePolicyId ON zone ( policyId )",
     0,
@@ -391,6 +391,7 @@ dbw_zone_update(const db_connection_t *dbconn, struct dbrow *row)
     dbx_obj->next_ksk_roll                  = zone->next_ksk_roll;
     dbx_obj->next_zsk_roll                  = zone->next_zsk_roll;
     dbx_obj->next_csk_roll                  = zone->next_csk_roll;
+    dbx_obj->denial_salt_published          = zone->denial_salt_published;
 
     if (row->dirty == DBW_UPDATE) {
         ret = zone_db_update(dbx_obj);
@@ -769,6 +770,7 @@ zone_dbx_to_dbw(const zone_db_t *dbx_item)
     row->next_ksk_roll       = dbx_item->next_ksk_roll;
     row->next_zsk_roll       = dbx_item->next_zsk_roll;
     row->next_csk_roll       = dbx_item->next_csk_roll;
+    row->denial_salt_published = dbx_item->denial_salt_published;
     row->ttl_end_ds          = dbx_item->ttl_end_ds;
     row->ttl_end_dk          = dbx_item->ttl_end_dk;
     row->ttl_end_rs          = dbx_item->ttl_end_rs;
@@ -1258,6 +1260,20 @@ dbw_policykeys(db_connection_t *dbconn, int fetch)
     return list;
 }
 
+static void
+dbw_merge(struct dbw_db *db)
+{
+    merge_pl_pk(db->policies, db->policykeys);
+    merge_pl_hk(db->policies, db->hsmkeys);
+    merge_pl_zn(db->policies, db->zones);
+    merge_zn_kd(db->zones,    db->keys);
+    merge_kd_ks(db->keys,     db->keystates);
+    merge_hk_kd(db->hsmkeys,  db->keys);
+    merge_zn_dp(db->zones,    db->keydependencies);
+    merge_kt_dp(db->keys,     db->keydependencies);
+    merge_kf_dp(db->keys,     db->keydependencies);
+}
+
 void
 dbw_free(struct dbw_db *db)
 {
@@ -1302,15 +1318,7 @@ dbw_fetch_filtered(db_connection_t *conn, int mask)
         ods_log_error("[dbw_fetch] Failed to read from database.");
         return NULL;
     }
-    merge_pl_pk(db->policies, db->policykeys);
-    merge_pl_hk(db->policies, db->hsmkeys);
-    merge_pl_zn(db->policies, db->zones);
-    merge_zn_kd(db->zones,    db->keys);
-    merge_kd_ks(db->keys,     db->keystates);
-    merge_hk_kd(db->hsmkeys,  db->keys);
-    merge_zn_dp(db->zones,    db->keydependencies);
-    merge_kt_dp(db->keys,     db->keydependencies);
-    merge_kf_dp(db->keys,     db->keydependencies);
+    dbw_merge(db);
     return db;
 }
 
@@ -1386,7 +1394,7 @@ dbw_commit(struct dbw_db *db)
     if (dbw_verify_revisions(db)) {
         ods_log_error("[dbw_commit] Some records are stale, can't commit to database.");
         (void)pthread_rwlock_unlock(&db_lock);
-        return 1;
+        return DBW_COMMIT_STALE;
     }
     int r = 0;
     r |= dbw_commit_list(db->conn, db->policies);
@@ -1455,6 +1463,86 @@ dbw_get_hsmkey(struct dbw_db *db, char const *locator)
     return NULL;
 }
 
+struct dbw_hsmkey *
+dbw_get_hsmkey_by_id(struct dbw_db *db, int id)
+{
+    struct dbw_list *list = db->hsmkeys;
+    size_t lo = 0, hi = list->n;
+    /* Fetched rows are sorted by id, rows added since are appended. */
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (list->set[mid]->id == id) return (struct dbw_hsmkey *)list->set[mid];
+        if (list->set[mid]->id < id) lo = mid + 1;
+        else hi = mid;
+    }
+    for (size_t n = 0; n < list->n; n++) {
+        if (list->set[n]->id == id) return (struct dbw_hsmkey *)list->set[n];
+    }
+    return NULL;
+}
+
+int
+dbw_hsmkey_key_count(struct dbw_db *db, struct dbw_hsmkey *hsmkey)
+{
+    struct db_value id;
+    db_clause_list_t *clause_list = NULL;
+    key_data_t *dbx_obj = NULL;
+    size_t count = 0;
+    int r = -1;
+
+    memset(&id, 0, sizeof (id));
+    if (pthread_rwlock_rdlock(&db_lock)) {
+        ods_log_error("[dbw_hsmkey_key_count] Unable to obtain database read lock.");
+        return -1;
+    }
+    if ((clause_list = db_clause_list_new())
+        && (dbx_obj = key_data_new(db->conn))
+        && !db_value_from_int32(&id, hsmkey->id)
+        && key_data_hsm_key_id_clause(clause_list, &id)
+        && !key_data_count(dbx_obj, clause_list, &count))
+    {
+        r = (int)count;
+    }
+    key_data_free(dbx_obj);
+    db_clause_list_free(clause_list);
+    (void)pthread_rwlock_unlock(&db_lock);
+    return r;
+}
+
+int
+dbw_hsmkey_swap_state(struct dbw_db *db, struct dbw_hsmkey *hsmkey,
+    int expected, int state)
+{
+    struct db_value id;
+    hsm_key_t *dbx_obj;
+    int r = 1;
+
+    memset(&id, 0, sizeof (id));
+    if (pthread_rwlock_wrlock(&db_lock)) {
+        ods_log_error("[dbw_hsmkey_swap_state] Unable to obtain database write lock.");
+        return -1;
+    }
+    if (!(dbx_obj = hsm_key_new(db->conn))
+        || db_value_from_int32(&id, hsmkey->id)
+        || hsm_key_get_by_id(dbx_obj, &id))
+    {
+        r = -1;
+    } else if ((int)dbx_obj->state == expected) {
+        dbx_obj->state = state;
+        if (hsm_key_update(dbx_obj)) {
+            r = -1;
+        } else {
+            /* The row is current again, later commits of db won't collide. */
+            hsmkey->state = state;
+            hsmkey->revision = dbw_hsmkey_revision(db->conn, &id);
+            r = 0;
+        }
+    }
+    hsm_key_free(dbx_obj);
+    (void)pthread_rwlock_unlock(&db_lock);
+    return r;
+}
+
 /* Add object to array */
 static int
 append(void ***array, int *count, void *obj)
@@ -1712,3 +1800,590 @@ sort_keys(const struct dbw_key *arr[], int n)
 {
     qsort(arr, n, sizeof(const struct dbw_key*), compare_keys);
 }
+
+/**
+ *  PER ZONE FETCHES
+ *
+ *  Rather than reading whole tables these fetch only the rows belonging to a
+ *  batch of zones, so listing commands need memory for one batch at a time.
+ *  Rows are selected by lists of ids, at most DBW_BATCH_IDS per query.
+ */
+
+#define DBW_BATCH_IDS  100 /* ids per query, well below the sqlite limit */
+#define DBW_BATCH_ZONES 50 /* zones per database handed to callbacks */
+
+struct zone_ref {
+    int id;
+    char *name;
+};
+
+static int
+compare_zone_refs(const void *a, const void *b)
+{
+    const struct zone_ref *aa = (const struct zone_ref *)a;
+    const struct zone_ref *bb = (const struct zone_ref *)b;
+    return strcmp(aa->name, bb->name);
+}
+
+static int
+list_has_id(struct dbw_list *list, int id)
+{
+    for (size_t i = 0; i < list->n; i++) {
+        if (list->set[i]->id == id) return 1;
+    }
+    return 0;
+}
+
+static int
+fetch_policy_by_id(const db_connection_t *conn, struct dbw_list *list, int id)
+{
+    struct db_value dbid;
+    policy_t *dbx_obj;
+    struct dbrow *row;
+
+    if (list_has_id(list, id)) return 0;
+    memset(&dbid, 0, sizeof (dbid));
+    if (!(dbx_obj = policy_new(conn))) return 1;
+    if (db_value_from_int32(&dbid, id) || policy_get_by_id(dbx_obj, &dbid)) {
+        policy_free(dbx_obj);
+        return 1;
+    }
+    row = (struct dbrow *)policy_dbx_to_dbw(dbx_obj);
+    policy_free(dbx_obj);
+    if (!row) return 1;
+    if (list_add(list, row)) {
+        list->free(row);
+        return 1;
+    }
+    return 0;
+}
+
+static int
+compare_ints(const void *a, const void *b)
+{
+    int aa = *(const int *)a;
+    int bb = *(const int *)b;
+    return (aa > bb) - (aa < bb);
+}
+
+/* Sort ids and drop duplicates, return the new count. */
+static size_t
+unique_ids(int *ids, size_t n)
+{
+    size_t u = 0;
+    qsort(ids, n, sizeof (int), compare_ints);
+    for (size_t i = 0; i < n; i++) {
+        if (!u || ids[u-1] != ids[i]) ids[u++] = ids[i];
+    }
+    return u;
+}
+
+/* Clause list matching field against any of n ids. */
+static db_clause_list_t *
+clause_list_any(const char *field, const int *ids, size_t n)
+{
+    db_clause_list_t *clause_list = db_clause_list_new();
+    db_clause_t *clause;
+
+    if (!clause_list) return NULL;
+    for (size_t i = 0; i < n; i++) {
+        if (!(clause = db_clause_new())
+            || db_clause_set_field(clause, field)
+            || db_clause_set_type(clause, DB_CLAUSE_EQUAL)
+            || db_clause_set_operator(clause, DB_CLAUSE_OPERATOR_OR)
+            || db_value_from_int32(db_clause_get_value(clause), ids[i])
+            || db_clause_list_add(clause_list, clause))
+        {
+            db_clause_free(clause);
+            db_clause_list_free(clause_list);
+            return NULL;
+        }
+    }
+    return clause_list;
+}
+
+static int
+fetch_zones_by_ids(const db_connection_t *conn, struct dbw_list *list,
+    const int *ids, size_t n)
+{
+    db_clause_list_t *clause_list;
+    zone_list_db_t *dbx_list;
+    const zone_db_t *dbx_item;
+    struct dbrow *row;
+    int r = 0;
+
+    for (size_t off = 0; !r && off < n; off += DBW_BATCH_IDS) {
+        size_t c = n - off < DBW_BATCH_IDS ? n - off : DBW_BATCH_IDS;
+        if (!(clause_list = clause_list_any("id", ids + off, c)))
+            return 1;
+        if (!(dbx_list = zone_list_db_new(conn))
+            || zone_list_db_get_by_clauses(dbx_list, clause_list))
+        {
+            zone_list_db_free(dbx_list);
+            db_clause_list_free(clause_list);
+            return 1;
+        }
+        db_clause_list_free(clause_list);
+        while (!r && (dbx_item = zone_list_db_next(dbx_list))) {
+            if (!(row = (struct dbrow *)zone_dbx_to_dbw(dbx_item))) {
+                r = 1;
+            } else if (list_add(list, row)) {
+                list->free(row);
+                r = 1;
+            }
+        }
+        zone_list_db_free(dbx_list);
+    }
+    return r;
+}
+
+/* ids must be unique */
+static int
+fetch_hsmkeys_by_ids(const db_connection_t *conn, struct dbw_list *list,
+    const int *ids, size_t n)
+{
+    db_clause_list_t *clause_list;
+    hsm_key_list_t *dbx_list;
+    const hsm_key_t *dbx_item;
+    struct dbrow *row;
+    int r = 0;
+
+    for (size_t off = 0; !r && off < n; off += DBW_BATCH_IDS) {
+        size_t c = n - off < DBW_BATCH_IDS ? n - off : DBW_BATCH_IDS;
+        if (!(clause_list = clause_list_any("id", ids + off, c)))
+            return 1;
+        if (!(dbx_list = hsm_key_list_new(conn))
+            || hsm_key_list_get_by_clauses(dbx_list, clause_list))
+        {
+            hsm_key_list_free(dbx_list);
+            db_clause_list_free(clause_list);
+            return 1;
+        }
+        db_clause_list_free(clause_list);
+        while (!r && (dbx_item = hsm_key_list_next(dbx_list))) {
+            if (!(row = (struct dbrow *)hsmkey_dbx_to_dbw(dbx_item))) {
+                r = 1;
+            } else if (list_add(list, row)) {
+                list->free(row);
+                r = 1;
+            }
+        }
+        hsm_key_list_free(dbx_list);
+    }
+    return r;
+}
+
+static int
+fetch_keystates_by_key_ids(const db_connection_t *conn, struct dbw_list *list,
+    const int *ids, size_t n)
+{
+    db_clause_list_t *clause_list;
+    key_state_list_t *dbx_list;
+    const key_state_t *dbx_item;
+    struct dbrow *row;
+    int r = 0;
+
+    for (size_t off = 0; !r && off < n; off += DBW_BATCH_IDS) {
+        size_t c = n - off < DBW_BATCH_IDS ? n - off : DBW_BATCH_IDS;
+        if (!(clause_list = clause_list_any("keyDataId", ids + off, c)))
+            return 1;
+        if (!(dbx_list = key_state_list_new(conn))
+            || key_state_list_get_by_clauses(dbx_list, clause_list))
+        {
+            key_state_list_free(dbx_list);
+            db_clause_list_free(clause_list);
+            return 1;
+        }
+        db_clause_list_free(clause_list);
+        while (!r && (dbx_item = key_state_list_next(dbx_list))) {
+            if (!(row = (struct dbrow *)keystate_dbx_to_dbw(dbx_item))) {
+                r = 1;
+            } else if (list_add(list, row)) {
+                list->free(row);
+                r = 1;
+            }
+        }
+        key_state_list_free(dbx_list);
+    }
+    return r;
+}
+
+static int
+fetch_policykeys_by_policy_id(const db_connection_t *conn, struct dbw_list *list, int id)
+{
+    struct db_value dbid;
+    policy_key_list_t *dbx_list;
+    const policy_key_t *dbx_item;
+    struct dbrow *row;
+    int r = 0;
+
+    memset(&dbid, 0, sizeof (dbid));
+    if (db_value_from_int32(&dbid, id)
+        || !(dbx_list = policy_key_list_new_get_by_policy_id(conn, &dbid)))
+    {
+        return 1;
+    }
+    while (!r && (dbx_item = policy_key_list_next(dbx_list))) {
+        if (!(row = (struct dbrow *)policykey_dbx_to_dbw(dbx_item))) {
+            r = 1;
+        } else if (list_add(list, row)) {
+            list->free(row);
+            r = 1;
+        }
+    }
+    policy_key_list_free(dbx_list);
+    return r;
+}
+
+/* Keys of the zones, optionally only those with the given role. */
+static int
+fetch_keys_by_zone_ids(const db_connection_t *conn, struct dbw_list *list,
+    const int *ids, size_t n, int role)
+{
+    db_clause_list_t *clause_list;
+    key_data_list_t *dbx_list;
+    const key_data_t *dbx_item;
+    struct dbw_key *key;
+    int r = 0;
+
+    for (size_t off = 0; !r && off < n; off += DBW_BATCH_IDS) {
+        size_t c = n - off < DBW_BATCH_IDS ? n - off : DBW_BATCH_IDS;
+        if (!(clause_list = clause_list_any("zoneId", ids + off, c)))
+            return 1;
+        if (!(dbx_list = key_data_list_new(conn))
+            || key_data_list_get_by_clauses(dbx_list, clause_list))
+        {
+            key_data_list_free(dbx_list);
+            db_clause_list_free(clause_list);
+            return 1;
+        }
+        db_clause_list_free(clause_list);
+        while (!r && (dbx_item = key_data_list_next(dbx_list))) {
+            if (!(key = key_dbx_to_dbw(dbx_item))) {
+                r = 1;
+            } else if (role && key->role != (unsigned int)role) {
+                list->free((struct dbrow *)key);
+            } else if (list_add(list, (struct dbrow *)key)) {
+                list->free((struct dbrow *)key);
+                r = 1;
+            }
+        }
+        key_data_list_free(dbx_list);
+    }
+    return r;
+}
+
+/* Key dependencies of the zones. Those referring to keys not in the key list
+ * (because of a role filter) are dropped so every row has its parents. */
+static int
+fetch_keydependencies_by_zone_ids(const db_connection_t *conn,
+    struct dbw_list *list, struct dbw_list *keys, const int *ids, size_t n)
+{
+    db_clause_list_t *clause_list;
+    key_dependency_list_t *dbx_list;
+    const key_dependency_t *dbx_item;
+    struct dbw_keydependency *dep;
+    int r = 0;
+
+    for (size_t off = 0; !r && off < n; off += DBW_BATCH_IDS) {
+        size_t c = n - off < DBW_BATCH_IDS ? n - off : DBW_BATCH_IDS;
+        if (!(clause_list = clause_list_any("zoneId", ids + off, c)))
+            return 1;
+        if (!(dbx_list = key_dependency_list_new(conn))
+            || key_dependency_list_get_by_clauses(dbx_list, clause_list))
+        {
+            key_dependency_list_free(dbx_list);
+            db_clause_list_free(clause_list);
+            return 1;
+        }
+        db_clause_list_free(clause_list);
+        while (!r && (dbx_item = key_dependency_list_next(dbx_list))) {
+            if (!(dep = keydependency_dbx_to_dbw(dbx_item))) {
+                r = 1;
+            } else if (!list_has_id(keys, dep->fromkey_id) ||
+                    !list_has_id(keys, dep->tokey_id))
+            {
+                list->free((struct dbrow *)dep);
+            } else if (list_add(list, (struct dbrow *)dep)) {
+                list->free((struct dbrow *)dep);
+                r = 1;
+            }
+        }
+        key_dependency_list_free(dbx_list);
+    }
+    return r;
+}
+
+static struct dbw_db *
+dbw_db_new_empty(db_connection_t *conn)
+{
+    struct dbw_db *db = calloc(1, sizeof(struct dbw_db));
+    if (!db) return NULL;
+    db->conn            = conn;
+    db->policies        = dbw_policies(conn, 0);
+    db->zones           = dbw_zones(conn, 0);
+    db->keys            = dbw_keys(conn, 0);
+    db->keystates       = dbw_keystates(conn, 0);
+    db->hsmkeys         = dbw_hsmkeys(conn, 0);
+    db->policykeys      = dbw_policykeys(conn, 0);
+    db->keydependencies = dbw_keydependencies(conn, 0);
+    if (!db->policies || !db->zones || !db->keys || !db->keystates ||
+            !db->hsmkeys || !db->policykeys || !db->keydependencies)
+    {
+        dbw_free(db);
+        return NULL;
+    }
+    return db;
+}
+
+/**
+ * Read a batch of zones with their keys and everything they refer to. Only
+ * the policies referenced by the zones and their hsmkeys are included.
+ */
+static struct dbw_db *
+dbw_fetch_zones(db_connection_t *conn, const int *zone_ids, size_t n,
+    int role, int mask)
+{
+    struct dbw_db *db = dbw_db_new_empty(conn);
+    int *ids = NULL;
+    size_t nids = 0;
+    int r;
+
+    if (!db) return NULL;
+    if (pthread_rwlock_rdlock(&db_lock)) {
+        ods_log_error("[dbw_fetch_zones] Unable to obtain database read lock.");
+        dbw_free(db);
+        return NULL;
+    }
+    r = fetch_zones_by_ids(conn, db->zones, zone_ids, n);
+    for (size_t z = 0; !r && z < db->zones->n; z++) {
+        struct dbw_zone *zone = (struct dbw_zone *)db->zones->set[z];
+        r = fetch_policy_by_id(conn, db->policies, zone->policy_id);
+    }
+    if (!r && (mask & DBW_F_KEY))
+        r = fetch_keys_by_zone_ids(conn, db->keys, zone_ids, n, role);
+    if (!r && db->keys->n && !(ids = malloc(db->keys->n * sizeof (int))))
+        r = 1;
+    if (!r && (mask & DBW_F_KEYSTATE)) {
+        for (nids = 0; nids < db->keys->n; nids++)
+            ids[nids] = db->keys->set[nids]->id;
+        r = fetch_keystates_by_key_ids(conn, db->keystates, ids, nids);
+    }
+    if (!r && (mask & DBW_F_HSMKEY)) {
+        for (nids = 0; nids < db->keys->n; nids++)
+            ids[nids] = ((struct dbw_key *)db->keys->set[nids])->hsmkey_id;
+        nids = unique_ids(ids, nids);
+        r = fetch_hsmkeys_by_ids(conn, db->hsmkeys, ids, nids);
+    }
+    free(ids);
+    for (size_t h = 0; !r && h < db->hsmkeys->n; h++) {
+        struct dbw_hsmkey *hsmkey = (struct dbw_hsmkey *)db->hsmkeys->set[h];
+        r = fetch_policy_by_id(conn, db->policies, hsmkey->policy_id);
+    }
+    if (!r && (mask & DBW_F_KEYDEPENDENCY))
+        r = fetch_keydependencies_by_zone_ids(conn, db->keydependencies,
+            db->keys, zone_ids, n);
+    for (size_t p = 0; !r && (mask & DBW_F_POLICYKEY) && p < db->policies->n; p++)
+        r = fetch_policykeys_by_policy_id(conn, db->policykeys, db->policies->set[p]->id);
+    (void)pthread_rwlock_unlock(&db_lock);
+
+    if (r) {
+        dbw_free(db);
+        return NULL;
+    }
+    dbw_merge(db);
+    return db;
+}
+
+static struct dbw_zone *
+zone_by_id(struct dbw_db *db, int id)
+{
+    for (size_t z = 0; z < db->zones->n; z++) {
+        if (db->zones->set[z]->id == id) return (struct dbw_zone *)db->zones->set[z];
+    }
+    return NULL;
+}
+
+struct dbw_db *
+dbw_fetch_zone_by_name(db_connection_t *conn, const char *zonename, int mask)
+{
+    zone_db_t *dbx_zone;
+    int zone_id;
+
+    if (pthread_rwlock_rdlock(&db_lock)) {
+        ods_log_error("[dbw_fetch_zone_by_name] Unable to obtain database read lock.");
+        return NULL;
+    }
+    dbx_zone = zone_db_new_get_by_name(conn, zonename);
+    (void)pthread_rwlock_unlock(&db_lock);
+    if (!dbx_zone) return dbw_db_new_empty(conn);
+    zone_id = dbxvalue2int(&dbx_zone->id);
+    zone_db_free(dbx_zone);
+    return dbw_fetch_zones(conn, &zone_id, 1, 0, mask);
+}
+
+/* Ids and names of the zones of one policy, or of a single named zone. */
+static struct zone_ref *
+zone_refs(db_connection_t *conn, const struct dbw_policy *policy,
+    const char *zonename, size_t *count)
+{
+    struct db_value dbid;
+    zone_list_db_t *dbx_list = NULL;
+    const zone_db_t *dbx_item;
+    zone_db_t *dbx_zone = NULL;
+    struct zone_ref *refs;
+    size_t n = 0;
+
+    *count = 0;
+    memset(&dbid, 0, sizeof (dbid));
+    if (zonename) {
+        if (!(dbx_zone = zone_db_new_get_by_name(conn, zonename)))
+            return calloc(1, sizeof (struct zone_ref));
+        if (dbxvalue2int(&dbx_zone->policy_id) != policy->id) {
+            zone_db_free(dbx_zone);
+            return calloc(1, sizeof (struct zone_ref));
+        }
+        n = 1;
+    } else {
+        if (db_value_from_int32(&dbid, policy->id)
+            || !(dbx_list = zone_list_db_new_get_by_policy_id(conn, &dbid)))
+        {
+            return NULL;
+        }
+        n = zone_list_db_size(dbx_list);
+    }
+    if (!(refs = calloc(n + 1, sizeof (struct zone_ref)))) {
+        zone_db_free(dbx_zone);
+        zone_list_db_free(dbx_list);
+        return NULL;
+    }
+    while (*count < n) {
+        dbx_item = dbx_zone ? dbx_zone : zone_list_db_next(dbx_list);
+        if (!dbx_item) break;
+        refs[*count].id = dbxvalue2int(&dbx_item->id);
+        if (!(refs[*count].name = strdup(dbx_item->name))) break;
+        (*count)++;
+        if (dbx_zone) break;
+    }
+    zone_db_free(dbx_zone);
+    zone_list_db_free(dbx_list);
+    qsort(refs, *count, sizeof (struct zone_ref), compare_zone_refs);
+    return refs;
+}
+
+int
+dbw_foreach_zone(db_connection_t *conn, const struct dbw_filter *filter,
+    int mask, int (*cb)(struct dbw_db *db, struct dbw_zone *zone, void *arg),
+    void *arg)
+{
+    struct dbw_list *policies;
+    struct zone_ref *refs;
+    size_t nrefs;
+    int visited = 0;
+    int stop = 0;
+
+    if (pthread_rwlock_rdlock(&db_lock)) {
+        ods_log_error("[dbw_foreach_zone] Unable to obtain database read lock.");
+        return -1;
+    }
+    policies = dbw_policies(conn, 1);
+    (void)pthread_rwlock_unlock(&db_lock);
+    if (!policies) {
+        ods_log_error("[dbw_foreach_zone] Failed to read from database.");
+        return -1;
+    }
+    sort_policies((const struct dbw_policy **)policies->set, policies->n);
+
+    for (size_t p = 0; !stop && p < policies->n; p++) {
+        struct dbw_policy *policy = (struct dbw_policy *)policies->set[p];
+        if (filter->policy && strcmp(filter->policy, policy->name)) continue;
+
+        if (!(refs = zone_refs(conn, policy, filter->zone, &nrefs))) {
+            ods_log_error("[dbw_foreach_zone] Failed to read zones of "
+                "policy %s.", policy->name);
+            visited = -1;
+            break;
+        }
+        for (size_t b = 0; !stop && b < nrefs; b += DBW_BATCH_ZONES) {
+            size_t n = nrefs - b < DBW_BATCH_ZONES ? nrefs - b : DBW_BATCH_ZONES;
+            int ids[DBW_BATCH_ZONES];
+            struct dbw_db *db;
+            for (size_t z = 0; z < n; z++) ids[z] = refs[b+z].id;
+            if (!(db = dbw_fetch_zones(conn, ids, n, filter->role, mask))) {
+                ods_log_error("[dbw_foreach_zone] Failed to read zones of "
+                    "policy %s.", policy->name);
+                visited = -1;
+                stop = 1;
+                break;
+            }
+            /* in name order, skipping zones deleted meanwhile */
+            for (size_t z = 0; !stop && z < n; z++) {
+                struct dbw_zone *zone = zone_by_id(db, ids[z]);
+                if (!zone) continue;
+                visited++;
+                stop = (*cb)(db, zone, arg);
+            }
+            dbw_free(db);
+        }
+        for (size_t z = 0; z < nrefs; z++) free(refs[z].name);
+        free(refs);
+    }
+    dbw_list_free(policies);
+    return visited;
+}
+
+struct dbw_db *
+dbw_fetch_hsmkeys(db_connection_t *conn, int state)
+{
+    db_clause_list_t *clause_list;
+    hsm_key_list_t *dbx_list = NULL;
+    const hsm_key_t *dbx_item;
+    struct dbrow *row;
+    int r = 0;
+
+    struct dbw_db *db = dbw_db_new_empty(conn);
+    if (!db) {
+        ods_log_error("[dbw_fetch_hsmkeys] Memory allocation failure.");
+        return NULL;
+    }
+    if (!(clause_list = db_clause_list_new())
+        || !hsm_key_state_clause(clause_list, (hsm_key_state_t)state))
+    {
+        db_clause_list_free(clause_list);
+        dbw_free(db);
+        return NULL;
+    }
+    if (pthread_rwlock_rdlock(&db_lock)) {
+        ods_log_error("[dbw_fetch_hsmkeys] Unable to obtain database read lock.");
+        db_clause_list_free(clause_list);
+        dbw_free(db);
+        return NULL;
+    }
+    dbw_list_free(db->policies);
+    db->policies = dbw_policies(conn, 1);
+    dbx_list = hsm_key_list_new_get_by_clauses(conn, clause_list);
+    (void)pthread_rwlock_unlock(&db_lock);
+    db_clause_list_free(clause_list);
+
+    if (!db->policies || !dbx_list) {
+        hsm_key_list_free(dbx_list);
+        dbw_free(db);
+        ods_log_error("[dbw_fetch_hsmkeys] Failed to read from database.");
+        return NULL;
+    }
+    while (!r && (dbx_item = hsm_key_list_next(dbx_list))) {
+        if (!(row = (struct dbrow *)hsmkey_dbx_to_dbw(dbx_item))) {
+            r = 1;
+        } else if (list_add(db->hsmkeys, row)) {
+            db->hsmkeys->free(row);
+            r = 1;
+        }
+    }
+    hsm_key_list_free(dbx_list);
+    if (r) {
+        dbw_free(db);
+        return NULL;
+    }
+    dbw_merge(db);
+    return db;
+}
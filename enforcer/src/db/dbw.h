@@ -333,6 +333,7 @@ struct dbw_zone {
     time_t next_ksk_roll;
     time_t next_zsk_roll;
     time_t next_csk_roll;
+    time_t denial_salt_published; /* salt change of the policy in signconf */
     unsigned int signconf_needs_writing;
     time_t ttl_end_ds;
     time_t ttl_end_dk;
@@ -390,12 +391,57 @@ struct dbw_db *dbw_fetch(db_connection_t *conn);
  */
 struct dbw_db *dbw_fetch_filtered(db_connection_t *conn, int mask);
 
+/* Selection for dbw_foreach_zone. NULL or 0 members match everything. */
+struct dbw_filter {
+    const char *zone;
+    const char *policy;
+    int role;
+};
+
+/**
+ * Call cb for every zone matching filter, ordered by policy name and zone
+ * name. Each call gets a database structure holding a small batch of zones
+ * including this one, their keys (restricted to filter->role) and the tables
+ * included in mask which those refer to. It is freed after the last zone of
+ * the batch, so memory use is bounded by the batch rather than the whole
+ * database. Zones are read batch by batch, the listing as a whole is not a
+ * consistent snapshot.
+ *
+ * Iteration stops early when cb returns non-zero.
+ *
+ * return number of zones visited, -1 on failure
+ */
+int dbw_foreach_zone(db_connection_t *conn, const struct dbw_filter *filter,
+    int mask, int (*cb)(struct dbw_db *db, struct dbw_zone *zone, void *arg),
+    void *arg);
+
+/**
+ * Read a single zone by name with its keys and the tables included in mask
+ * which those refer to, like the databases passed by dbw_foreach_zone. An
+ * hsmkey only lists the keys of this zone; use dbw_hsmkey_key_count to
+ * learn whether other zones share it.
+ *
+ * return NULL on failure, a database without zones if there is no such zone
+ */
+struct dbw_db *dbw_fetch_zone_by_name(db_connection_t *conn,
+    const char *zonename, int mask);
+
+/**
+ * Fetch all policies and only those hsmkeys in the given state.
+ *
+ * return NULL on failure
+ */
+struct dbw_db *dbw_fetch_hsmkeys(db_connection_t *conn, int state);
+
 /**
  * Commit changes to the database. Guarded by a R/W lock. Only records marked
  * as dirty will be considered for writing.
  *
- * return 0 on success. 1 otherwise.
+ * return 0 on success. DBW_COMMIT_STALE if some records were changed by
+ * others and nothing was written, 1 otherwise. In the latter case part of
+ * the changes may have been written.
  */
+#define DBW_COMMIT_STALE 2
 int dbw_commit(struct dbw_db *db);
 
 /**
@@ -419,8 +465,28 @@ struct dbw_zone * dbw_get_zone(struct dbw_db *db, char const *zonename);
 struct dbw_policy * dbw_get_policy(struct dbw_db *db, char const *policyname);
 struct dbw_policykey * dbw_get_policykey(struct dbw_db *db, int id);
 struct dbw_hsmkey * dbw_get_hsmkey(struct dbw_db *db, char const *locator);
+struct dbw_hsmkey * dbw_get_hsmkey_by_id(struct dbw_db *db, int id);
 struct dbw_keystate * dbw_get_keystate(struct dbw_key *key, int type);
 
+/**
+ * Count the keys in the database referring to hsmkey, including those of
+ * zones not read into db.
+ *
+ * @return number of keys, -1 on error.
+ */
+int dbw_hsmkey_key_count(struct dbw_db *db, struct dbw_hsmkey *hsmkey);
+
+/**
+ * Atomically change the state of hsmkey in the database from expected to
+ * state, without waiting for the commit of db. The hsmkey is updated to
+ * match the database row.
+ *
+ * @return 0 on success, 1 if the state in the database was not expected,
+ *         -1 on error.
+ */
+int dbw_hsmkey_swap_state(struct dbw_db *db, struct dbw_hsmkey *hsmkey,
+    int expected, int state);
+
 /* TODO functions below this need to be cleaned up / evaluated*/
 
 void dbw_zone_free(struct dbrow *row);
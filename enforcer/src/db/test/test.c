@@ -37,6 +37,7 @@
 #include "test_policy_key.h"
 #include "test_database_version.h"
 #include "test_zone.h"
+#include "test_keystate_counts.h"
 
 #include "CUnit/Basic.h"
 
@@ -167,6 +168,7 @@ int main(void) {
     test_policy_key_add_suite();
     test_database_version_add_suite();
     test_zone_add_suite();
+    test_keystate_counts_add_suite();
 
     CU_basic_set_mode(CU_BRM_VERBOSE);
     CU_basic_run_tests();
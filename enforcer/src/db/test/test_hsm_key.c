@@ -32,6 +32,7 @@
 #include "../db_configuration.h"
 #include "../db_connection.h"
 #include "../hsm_key.h"
+#include "db/dbw.h"
 
 #include <string.h>
 
@@ -605,6 +606,48 @@ static void test_hsm_key_verify2(void) {
     db_value_reset(&policy_id);
 }
 
+/* Claim and return the key the way the key factory of the enforcer does. */
+static void test_hsm_key_claim(void) {
+    struct dbw_db db;
+    struct dbw_hsmkey hsmkey;
+    hsm_key_t* local_object;
+    db_type_int32_t id32;
+    db_type_uint64_t id64;
+
+    memset(&db, 0, sizeof (db));
+    memset(&hsmkey, 0, sizeof (hsmkey));
+    db.conn = connection;
+    if (db_sqlite) {
+        CU_ASSERT_FATAL(!db_value_to_int32(hsm_key_id(object), &id32));
+        hsmkey.id = id32;
+    }
+    if (db_mysql) {
+        CU_ASSERT_FATAL(!db_value_to_uint64(hsm_key_id(object), &id64));
+        hsmkey.id = (int)id64;
+    }
+    hsmkey.state = DBW_HSMKEY_UNUSED;
+    CU_ASSERT_PTR_NOT_NULL_FATAL((local_object = hsm_key_new(connection)));
+
+    CU_ASSERT(!dbw_hsmkey_swap_state(&db, &hsmkey, DBW_HSMKEY_UNUSED, DBW_HSMKEY_PRIVATE));
+    CU_ASSERT(hsmkey.state == DBW_HSMKEY_PRIVATE);
+    CU_ASSERT_FATAL(!hsm_key_get_by_id(local_object, hsm_key_id(object)));
+    CU_ASSERT(hsm_key_state(local_object) == HSM_KEY_STATE_PRIVATE);
+
+    /* Someone else claiming it finds it taken */
+    CU_ASSERT(dbw_hsmkey_swap_state(&db, &hsmkey, DBW_HSMKEY_UNUSED, DBW_HSMKEY_SHARED) == 1);
+    CU_ASSERT(hsmkey.state == DBW_HSMKEY_PRIVATE);
+    CU_ASSERT_FATAL(!hsm_key_get_by_id(local_object, hsm_key_id(object)));
+    CU_ASSERT(hsm_key_state(local_object) == HSM_KEY_STATE_PRIVATE);
+
+    /* Give it back, after which it can be claimed again */
+    CU_ASSERT(!dbw_hsmkey_swap_state(&db, &hsmkey, DBW_HSMKEY_PRIVATE, DBW_HSMKEY_UNUSED));
+    CU_ASSERT_FATAL(!hsm_key_get_by_id(local_object, hsm_key_id(object)));
+    CU_ASSERT(hsm_key_state(local_object) == HSM_KEY_STATE_UNUSED);
+    CU_ASSERT(!dbw_hsmkey_swap_state(&db, &hsmkey, DBW_HSMKEY_UNUSED, DBW_HSMKEY_SHARED));
+    CU_ASSERT(!dbw_hsmkey_swap_state(&db, &hsmkey, DBW_HSMKEY_SHARED, DBW_HSMKEY_UNUSED));
+    hsm_key_free(local_object);
+}
+
 static void test_hsm_key_cmp(void) {
     hsm_key_t* local_object;
 
@@ -670,6 +713,7 @@ static int test_hsm_key_add_tests(CU_pSuite pSuite) {
         || !CU_add_test(pSuite, "change object", test_hsm_key_change)
         || !CU_add_test(pSuite, "update object", test_hsm_key_update)
         || !CU_add_test(pSuite, "verify fields after update", test_hsm_key_verify2)
+        || !CU_add_test(pSuite, "claim and return object", test_hsm_key_claim)
         || !CU_add_test(pSuite, "compare objects", test_hsm_key_cmp)
         || !CU_add_test(pSuite, "reread object by locator", test_hsm_key_read_by_locator2)
         || !CU_add_test(pSuite, "verify fields after update (locator)", test_hsm_key_verify_locator2)
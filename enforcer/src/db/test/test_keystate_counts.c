@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2018 NLNet Labs.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Property test of the aggregated key state counts used by the enforcer
+ * rules. Random key sets are checked against the straightforward scans
+ * over all keys of the zone the enforcer used to do.
+ */
+
+#include "CUnit/Basic.h"
+
+#include "db/dbw.h"
+#include "enforcer/keystate_counts.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ZONES    500
+#define MAXKEYS  12
+#define CHANGES  50
+
+static const unsigned int algorithms[] = { 8, 13, 15 };
+
+static struct dbw_zone zone;
+static struct dbw_key *keys[MAXKEYS];
+static struct dbw_key key_store[MAXKEYS];
+static struct dbw_keystate *keystates[MAXKEYS][4];
+static struct dbw_keystate keystate_store[MAXKEYS][4];
+static unsigned int seed = 1;
+
+/* Reference implementation, scan all keys. */
+
+static enum dbw_keystate_state
+ref_state(struct dbw_key *key, int type)
+{
+    for (int s = 0; s < key->keystate_count; s++) {
+        if (key->keystate[s]->type == (unsigned int)type)
+            return key->keystate[s]->state;
+    }
+    return DBW_NA;
+}
+
+static int
+ref_match(struct dbw_key *key, int algorithm, int same_algorithm,
+    const enum dbw_keystate_state mask[4])
+{
+    if (same_algorithm && key->algorithm != (unsigned int)algorithm) return 0;
+    for (int i = 0; i < 4; i++) {
+        if (mask[i] != DBW_NA && ref_state(key, i) != mask[i])
+            return 0;
+    }
+    return 1;
+}
+
+static int
+ref_exists(int algorithm, int same_algorithm, const enum dbw_keystate_state mask[4])
+{
+    for (int k = 0; k < zone.key_count; k++) {
+        if (ref_match(zone.key[k], algorithm, same_algorithm, mask)) return 1;
+    }
+    return 0;
+}
+
+static int
+ref_exists_with_ds_state(int algorithm, const enum dbw_keystate_state mask[4],
+    unsigned int ds_state)
+{
+    for (int k = 0; k < zone.key_count; k++) {
+        struct dbw_key *key = zone.key[k];
+        if (!ref_match(key, algorithm, 1, mask)) continue;
+        if ((key->ds_at_parent == ds_state)
+         || ( key->ds_at_parent > ds_state && key->ds_at_parent <= DBW_DS_AT_PARENT_SEEN))
+            return 1;
+    }
+    return 0;
+}
+
+static int
+ref_unsigned_ok(int algorithm, const enum dbw_keystate_state mask[4], int type)
+{
+    for (int k = 0; k < zone.key_count; k++) {
+        struct dbw_key *key = zone.key[k];
+        enum dbw_keystate_state cmp_mask[4];
+        if (key->algorithm != (unsigned int)algorithm) continue;
+        memcpy(cmp_mask, mask, 4 * sizeof(enum dbw_keystate_state));
+        cmp_mask[type] = ref_state(key, type);
+        if (cmp_mask[type] == DBW_HIDDEN || cmp_mask[type] == DBW_NA) continue;
+        cmp_mask[DBW_DS] = DBW_NA;
+        if (!ref_exists_with_ds_state(algorithm, cmp_mask, key->ds_at_parent)) return 0;
+    }
+    return 1;
+}
+
+static int
+ref_all_ds_hidden(int algorithm)
+{
+    for (int k = 0; k < zone.key_count; k++) {
+        struct dbw_key *key = zone.key[k];
+        if (key->algorithm != (unsigned int)algorithm) continue;
+        enum dbw_keystate_state state = ref_state(key, DBW_DS);
+        if (state != DBW_HIDDEN && state != DBW_NA) return 0;
+    }
+    return 1;
+}
+
+/* Random zones */
+
+static unsigned int
+random_algorithm(void)
+{
+    return algorithms[rand_r(&seed) % (sizeof(algorithms)/sizeof(algorithms[0]))];
+}
+
+static void
+random_key(struct dbw_key *key)
+{
+    key->algorithm = random_algorithm();
+    key->ds_at_parent = rand_r(&seed) % (DBW_DS_AT_PARENT_GONE + 1);
+    for (int s = 0; s < key->keystate_count; s++)
+        key->keystate[s]->state = rand_r(&seed) % (DBW_NA + 1);
+}
+
+static void
+random_zone(void)
+{
+    memset(&zone, 0, sizeof(zone));
+    memset(key_store, 0, sizeof(key_store));
+    memset(keystate_store, 0, sizeof(keystate_store));
+    zone.key_count = 1 + rand_r(&seed) % MAXKEYS;
+    zone.key = keys;
+    for (int k = 0; k < zone.key_count; k++) {
+        struct dbw_key *key = &key_store[k];
+        keys[k] = key;
+        key->id = k + 1;
+        key->zone = &zone;
+        key->keystate = keystates[k];
+        key->keystate_count = 4;
+        for (int s = 0; s < 4; s++) {
+            /* Shuffle the order of the key states a bit. */
+            int t = (s + k) % 4;
+            keystates[k][s] = &keystate_store[k][s];
+            keystates[k][s]->type = t;
+            keystates[k][s]->key = key;
+        }
+        random_key(key);
+    }
+}
+
+static void
+random_mask(enum dbw_keystate_state mask[4])
+{
+    for (int i = 0; i < 4; i++) {
+        /* favour NA, most masks of the rules leave states open */
+        mask[i] = rand_r(&seed) % 2 ? DBW_NA : rand_r(&seed) % (DBW_NA + 1);
+    }
+}
+
+static void
+compare(struct keystate_counts *counts)
+{
+    enum dbw_keystate_state mask[4];
+    for (int q = 0; q < 20; q++) {
+        int algorithm = random_algorithm();
+        int type = rand_r(&seed) % 4;
+        unsigned int ds_state = rand_r(&seed) % (DBW_DS_AT_PARENT_GONE + 1);
+        random_mask(mask);
+        CU_ASSERT_EQUAL(keystate_counts_exists(counts, algorithm, 0, mask),
+            ref_exists(algorithm, 0, mask));
+        CU_ASSERT_EQUAL(keystate_counts_exists(counts, algorithm, 1, mask),
+            ref_exists(algorithm, 1, mask));
+        CU_ASSERT_EQUAL(keystate_counts_exists_with_ds_state(counts, algorithm, mask, ds_state),
+            ref_exists_with_ds_state(algorithm, mask, ds_state));
+        CU_ASSERT_EQUAL(keystate_counts_unsigned_ok(counts, algorithm, mask, type),
+            ref_unsigned_ok(algorithm, mask, type));
+        CU_ASSERT_EQUAL(keystate_counts_all_ds_hidden(counts, algorithm),
+            ref_all_ds_hidden(algorithm));
+    }
+}
+
+static void
+test_keystate_counts_random(void)
+{
+    for (int z = 0; z < ZONES; z++) {
+        random_zone();
+        struct keystate_counts *counts = keystate_counts_create(&zone);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(counts);
+        compare(counts);
+        keystate_counts_free(counts);
+    }
+}
+
+static void
+test_keystate_counts_incremental(void)
+{
+    for (int z = 0; z < ZONES; z++) {
+        random_zone();
+        struct keystate_counts *counts = keystate_counts_create(&zone);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(counts);
+        for (int c = 0; c < CHANGES; c++) {
+            struct dbw_key *key = zone.key[rand_r(&seed) % zone.key_count];
+            if (rand_r(&seed) % 4) {
+                /* single transition, as the enforcer does */
+                struct dbw_keystate *keystate = key->keystate[rand_r(&seed) % 4];
+                keystate->state = rand_r(&seed) % (DBW_NA + 1);
+            } else {
+                random_key(key);
+            }
+            keystate_counts_update(counts, key);
+            compare(counts);
+        }
+        keystate_counts_free(counts);
+    }
+}
+
+int
+test_keystate_counts_add_suite(void)
+{
+    CU_pSuite pSuite = NULL;
+
+    pSuite = CU_add_suite("Test of keystate counts", NULL, NULL);
+    if (!pSuite) {
+        return CU_get_error();
+    }
+    if (!CU_add_test(pSuite, "random key sets", test_keystate_counts_random)
+        || !CU_add_test(pSuite, "incremental updates", test_keystate_counts_incremental))
+    {
+        return CU_get_error();
+    }
+    return 0;
+}
@@ -283,6 +283,7 @@ static void test_zone_set(void) {
     CU_ASSERT(!zone_db_set_next_ksk_roll(object, 1));
     CU_ASSERT(!zone_db_set_next_zsk_roll(object, 1));
     CU_ASSERT(!zone_db_set_next_csk_roll(object, 1));
+    CU_ASSERT(!zone_db_set_denial_salt_published(object, 1));
     db_value_reset(&policy_id);
 }
 
@@ -320,6 +321,7 @@ static void test_zone_get(void) {
     CU_ASSERT(zone_db_next_ksk_roll(object) == 1);
     CU_ASSERT(zone_db_next_zsk_roll(object) == 1);
     CU_ASSERT(zone_db_next_csk_roll(object) == 1);
+    CU_ASSERT(zone_db_denial_salt_published(object) == 1);
     db_value_reset(&policy_id);
 }
 
@@ -641,6 +643,7 @@ static void test_zone_verify(void) {
     CU_ASSERT(zone_db_next_ksk_roll(object) == 1);
     CU_ASSERT(zone_db_next_zsk_roll(object) == 1);
     CU_ASSERT(zone_db_next_csk_roll(object) == 1);
+    CU_ASSERT(zone_db_denial_salt_published(object) == 1);
     db_value_reset(&policy_id);
 }
 
@@ -682,6 +685,7 @@ static void test_zone_verify_name(void) {
     CU_ASSERT(zone_db_next_ksk_roll(object) == 1);
     CU_ASSERT(zone_db_next_zsk_roll(object) == 1);
     CU_ASSERT(zone_db_next_csk_roll(object) == 1);
+    CU_ASSERT(zone_db_denial_salt_published(object) == 1);
     db_value_reset(&policy_id);
 }
 
@@ -711,6 +715,7 @@ static void test_zone_change(void) {
     CU_ASSERT(!zone_db_set_next_ksk_roll(object, 2));
     CU_ASSERT(!zone_db_set_next_zsk_roll(object, 2));
     CU_ASSERT(!zone_db_set_next_csk_roll(object, 2));
+    CU_ASSERT(!zone_db_set_denial_salt_published(object, 2));
     db_value_reset(&policy_id);
 }
 
@@ -756,6 +761,7 @@ static void test_zone_verify2(void) {
     CU_ASSERT(zone_db_next_ksk_roll(object) == 2);
     CU_ASSERT(zone_db_next_zsk_roll(object) == 2);
     CU_ASSERT(zone_db_next_csk_roll(object) == 2);
+    CU_ASSERT(zone_db_denial_salt_published(object) == 2);
     db_value_reset(&policy_id);
 }
 
@@ -797,6 +803,7 @@ static void test_zone_verify_name2(void) {
     CU_ASSERT(zone_db_next_ksk_roll(object) == 2);
     CU_ASSERT(zone_db_next_zsk_roll(object) == 2);
     CU_ASSERT(zone_db_next_csk_roll(object) == 2);
+    CU_ASSERT(zone_db_denial_salt_published(object) == 2);
     db_value_reset(&policy_id);
 }
 
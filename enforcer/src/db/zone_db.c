@@ -273,6 +273,17 @@ static db_object_t* __zone_db_new_object(const db_connection_t* connection) {
         return NULL;
     }
 
+    if (!(object_field = db_object_field_new())
+        || db_object_field_set_name(object_field, "denialSaltPublished")
+        || db_object_field_set_type(object_field, DB_TYPE_UINT32)
+        || db_object_field_list_add(object_field_list, object_field))
+    {
+        db_object_field_free(object_field);
+        db_object_field_list_free(object_field_list);
+        db_object_free(object);
+        return NULL;
+    }
+
     if (db_object_set_object_field_list(object, object_field_list)) {
         db_object_field_list_free(object_field_list);
         db_object_free(object);
@@ -656,6 +667,7 @@ int zone_db_copy(zone_db_t* zone, const zone_db_t* zone_copy) {
     zone->next_ksk_roll = zone_copy->next_ksk_roll;
     zone->next_zsk_roll = zone_copy->next_zsk_roll;
     zone->next_csk_roll = zone_copy->next_csk_roll;
+    zone->denial_salt_published = zone_copy->denial_salt_published;
     return DB_OK;
 }
 
@@ -717,7 +729,8 @@ int zone_db_from_result(zone_db_t* zone, const db_result_t* result) {
         || db_value_to_text(db_value_set_at(value_set, 16), &(zone->output_adapter_uri))
         || db_value_to_uint32(db_value_set_at(value_set, 17), &(zone->next_ksk_roll))
         || db_value_to_uint32(db_value_set_at(value_set, 18), &(zone->next_zsk_roll))
-        || db_value_to_uint32(db_value_set_at(value_set, 19), &(zone->next_csk_roll)))
+        || db_value_to_uint32(db_value_set_at(value_set, 19), &(zone->next_csk_roll))
+        || db_value_to_uint32(db_value_set_at(value_set, 20), &(zone->denial_salt_published)))
     {
         return DB_ERROR_UNKNOWN;
     }
@@ -915,6 +928,14 @@ unsigned int zone_db_next_csk_roll(const zone_db_t* zone) {
     return zone->next_csk_roll;
 }
 
+unsigned int zone_db_denial_salt_published(const zone_db_t* zone) {
+    if (!zone) {
+        return 0;
+    }
+
+    return zone->denial_salt_published;
+}
+
 int zone_db_set_policy_id(zone_db_t* zone, const db_value_t* policy_id) {
     if (!zone) {
         return DB_ERROR_UNKNOWN;
@@ -1176,6 +1197,16 @@ int zone_db_set_next_csk_roll(zone_db_t* zone, unsigned int next_csk_roll) {
     return DB_OK;
 }
 
+int zone_db_set_denial_salt_published(zone_db_t* zone, unsigned int denial_salt_published) {
+    if (!zone) {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    zone->denial_salt_published = denial_salt_published;
+
+    return DB_OK;
+}
+
 db_clause_t* zone_db_policy_id_clause(db_clause_list_t* clause_list, const db_value_t* policy_id) {
     db_clause_t* clause;
 
@@ -1428,7 +1459,17 @@ int zone_db_create(zone_db_t* zone) {
         return DB_ERROR_UNKNOWN;
     }
 
-    if (!(value_set = db_value_set_new(18))) {
+    if (!(object_field = db_object_field_new())
+        || db_object_field_set_name(object_field, "denialSaltPublished")
+        || db_object_field_set_type(object_field, DB_TYPE_UINT32)
+        || db_object_field_list_add(object_field_list, object_field))
+    {
+        db_object_field_free(object_field);
+        db_object_field_list_free(object_field_list);
+        return DB_ERROR_UNKNOWN;
+    }
+
+    if (!(value_set = db_value_set_new(19))) {
         db_object_field_list_free(object_field_list);
         return DB_ERROR_UNKNOWN;
     }
@@ -1450,7 +1491,8 @@ int zone_db_create(zone_db_t* zone) {
         || db_value_from_text(db_value_set_get(value_set, 14), zone->output_adapter_uri)
         || db_value_from_uint32(db_value_set_get(value_set, 15), zone->next_ksk_roll)
         || db_value_from_uint32(db_value_set_get(value_set, 16), zone->next_zsk_roll)
-        || db_value_from_uint32(db_value_set_get(value_set, 17), zone->next_csk_roll))
+        || db_value_from_uint32(db_value_set_get(value_set, 17), zone->next_csk_roll)
+        || db_value_from_uint32(db_value_set_get(value_set, 18), zone->denial_salt_published))
     {
         db_value_set_free(value_set);
         db_object_field_list_free(object_field_list);
@@ -1813,7 +1855,17 @@ int zone_db_update(zone_db_t* zone) {
         return DB_ERROR_UNKNOWN;
     }
 
-    if (!(value_set = db_value_set_new(18))) {
+    if (!(object_field = db_object_field_new())
+        || db_object_field_set_name(object_field, "denialSaltPublished")
+        || db_object_field_set_type(object_field, DB_TYPE_UINT32)
+        || db_object_field_list_add(object_field_list, object_field))
+    {
+        db_object_field_free(object_field);
+        db_object_field_list_free(object_field_list);
+        return DB_ERROR_UNKNOWN;
+    }
+
+    if (!(value_set = db_value_set_new(19))) {
         db_object_field_list_free(object_field_list);
         return DB_ERROR_UNKNOWN;
     }
@@ -1835,7 +1887,8 @@ int zone_db_update(zone_db_t* zone) {
         || db_value_from_text(db_value_set_get(value_set, 14), zone->output_adapter_uri)
         || db_value_from_uint32(db_value_set_get(value_set, 15), zone->next_ksk_roll)
         || db_value_from_uint32(db_value_set_get(value_set, 16), zone->next_zsk_roll)
-        || db_value_from_uint32(db_value_set_get(value_set, 17), zone->next_csk_roll))
+        || db_value_from_uint32(db_value_set_get(value_set, 17), zone->next_csk_roll)
+        || db_value_from_uint32(db_value_set_get(value_set, 18), zone->denial_salt_published))
     {
         db_value_set_free(value_set);
         db_object_field_list_free(object_field_list);
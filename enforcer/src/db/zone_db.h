@@ -67,6 +67,7 @@ struct zone_db {
     unsigned int next_ksk_roll;
     unsigned int next_zsk_roll;
     unsigned int next_csk_roll;
+    unsigned int denial_salt_published;
     key_data_list_t* key_data_list;
     key_dependency_list_t* key_dependency_list;
 };
@@ -248,6 +249,13 @@ extern unsigned int zone_db_next_zsk_roll(const zone_db_t* zone);
  */
 extern unsigned int zone_db_next_csk_roll(const zone_db_t* zone);
 
+/**
+ * Get the denial_salt_published of a zone object. Undefined behavior if `zone` is NULL.
+ * \param[in] zone a zone_db_t pointer.
+ * \return an unsigned integer.
+ */
+extern unsigned int zone_db_denial_salt_published(const zone_db_t* zone);
+
 /**
  * Set the policy_id of a zone object. If this fails the original value may have been lost.
  * \param[in] zone a zone_db_t pointer.
@@ -392,6 +400,14 @@ extern int zone_db_set_next_zsk_roll(zone_db_t* zone, unsigned int next_zsk_roll
  */
 extern int zone_db_set_next_csk_roll(zone_db_t* zone, unsigned int next_csk_roll);
 
+/**
+ * Set the denial_salt_published of a zone object.
+ * \param[in] zone a zone_db_t pointer.
+ * \param[in] denial_salt_published an unsigned integer.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+extern int zone_db_set_denial_salt_published(zone_db_t* zone, unsigned int denial_salt_published);
+
 /**
  * Create a clause for policy_id of a zone object and add it to a database clause list.
  * The clause operator is set to DB_CLAUSE_OPERATOR_AND and the clause type is
@@ -56,6 +56,8 @@ autostart(engine_type* engine)
 	if (status != ODS_STATUS_OK)
 		ods_log_crit("[%s] failed to create resalt tasks", module_str);
 
-	enforce_task_flush_all(engine, dbconn);
+	enforce_task_schedule_all(engine, dbconn);
+	/* Claims on keys a previous run did not get to use. */
+	hsm_key_factory_schedule_reclaim(engine);
 	db_connection_free(dbconn);
 }
@@ -30,6 +30,8 @@
 #include "config.h"
 
 #include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "enforcer/enforcer.h"
 #include "clientpipe.h"
@@ -43,11 +45,23 @@
 #include "scheduler/schedule.h"
 #include "scheduler/task.h"
 #include "db/dbw.h"
+#include "hsmkey/hsm_key_factory.h"
 
 #include "enforcer/enforce_task.h"
 
 static const char *module_str = "enforce_task";
 
+/* Zones of a policy enforced per database read and commit. */
+#define ENFORCE_POLICY_BATCH 100
+
+/* Progress of the enforcement of overdue zones after daemon start. The
+ * zones still to go are kept by name, whichever task enforces them. */
+static struct {
+    pthread_mutex_t lock;
+    size_t total;
+    ldns_rbtree_t *pending;
+} catchup = { PTHREAD_MUTEX_INITIALIZER, 0, NULL };
+
 static void
 schedule_ds_tasks(engine_type *engine, struct dbw_zone *zone)
 {
@@ -82,62 +96,182 @@ schedule_ds_tasks(engine_type *engine, struct dbw_zone *zone)
     }
 }
 
+/**
+ * Run the enforcer for zone. Changes are left uncommitted in the database
+ * structure, *zone_updated is set when there are any.
+ * \return the time zone needs attention again.
+ */
 static time_t
-perform_enforce(int sockfd, engine_type *engine, char const *zonename,
-    db_connection_t *dbconn)
+enforce_zone(engine_type *engine, struct dbw_db *db, struct dbw_zone *zone,
+    struct enforcer_policy_cache *cache, int *zone_updated)
 {
-    struct dbw_db *db = dbw_fetch(dbconn);
-    if (!db) {
-        ods_log_error("[%s] Error reading database", module_str);
-        return -1;
-    }
-    struct dbw_zone *zone = dbw_get_zone(db, zonename);
-    if (!zone) {
-        ods_log_error("[%s] Could not find zone %s in database", module_str, zonename);
-        dbw_free(db);
-        return -1;
-    }
     time_t t_next;
-    int zone_updated = 0;
     if (zone->policy->passthrough) {
         ods_log_info("Passing through zone %s.\n", zone->name);
         t_next = schedule_SUCCESS;
+    } else if (cache) {
+        t_next = update_cached(engine, db, zone, time_now(), zone_updated, cache);
     } else {
-        t_next = update(engine, db, zone, time_now(), &zone_updated);
+        t_next = update(engine, db, zone, time_now(), zone_updated);
     }
-    /* Commit zone to database before we schedule signconf */
     if (zone->next_change != t_next && t_next >= 0) {
-        zone_updated = 1;
+        *zone_updated = 1;
         dbw_mark_dirty((struct dbrow *)zone);
     }
-    if (zone_updated) {
-        zone->next_change = t_next;
-        if (dbw_commit(db)) {
-            ods_log_error("[%s] Unable to commit changes to zone %s to "
-                "database, deferring.", module_str, zonename);
-            dbw_free(db);
-            return schedule_DEFER;
-        }
-    }
+    if (*zone_updated) zone->next_change = t_next;
+    return t_next;
+}
+
+/* Work to do for zone once its enforcement is committed to the database. */
+static void
+enforce_zone_committed(engine_type *engine, db_connection_t *dbconn,
+    struct dbw_zone *zone)
+{
     if (zone->signconf_needs_writing || zone->policy->passthrough) {
         /* We always write signconf on passthrough, but we won't schedule the
          * zone so the signconf will not be written over and over. Unless
          * scheduled by user or first start which is desirable. */
-        signconf_task_flush_zone(engine, dbconn, zonename);
+        signconf_task_flush_zone(engine, dbconn, zone->name);
     } else {
         ods_log_info("[%s] No changes to signconf file required for zone %s",
-            module_str, zonename);
+            module_str, zone->name);
     }
     schedule_ds_tasks(engine, zone);
+}
+
+static time_t
+perform_enforce(int sockfd, engine_type *engine, char const *zonename,
+    db_connection_t *dbconn)
+{
+    struct dbw_db *db = dbw_fetch(dbconn);
+    if (!db) {
+        ods_log_error("[%s] Error reading database", module_str);
+        return -1;
+    }
+    struct dbw_zone *zone = dbw_get_zone(db, zonename);
+    if (!zone) {
+        ods_log_error("[%s] Could not find zone %s in database", module_str, zonename);
+        dbw_free(db);
+        return -1;
+    }
+    int zone_updated = 0;
+    int r;
+    time_t t_next = enforce_zone(engine, db, zone, NULL, &zone_updated);
+    /* Commit zone to database before we schedule signconf */
+    if (zone_updated && (r = dbw_commit(db))) {
+        ods_log_error("[%s] Unable to commit changes to zone %s to "
+            "database, deferring.", module_str, zonename);
+        /* Keys may only go back if none of our key rows got written. */
+        if (r == DBW_COMMIT_STALE) hsm_key_factory_return_keys(db);
+        hsm_key_factory_settle_keys(db);
+        dbw_free(db);
+        return schedule_DEFER;
+    }
+    hsm_key_factory_settle_keys(db);
+    enforce_zone_committed(engine, dbconn, zone);
     dbw_free(db);
     return t_next;
 }
 
+/**
+ * Enforce all zones of policy. The database is read once per batch of
+ * ENFORCE_POLICY_BATCH zones and the changes of a batch are committed at
+ * once. Zones are then handed back to their own enforce task for their
+ * next change.
+ */
+static time_t
+perform_enforce_policy(engine_type *engine, char const *policyname,
+    db_connection_t *dbconn)
+{
+    struct dbw_db *db = dbw_fetch(dbconn);
+    if (!db) {
+        ods_log_error("[%s] Error reading database", module_str);
+        return schedule_DEFER;
+    }
+    struct dbw_policy *policy = dbw_get_policy(db, policyname);
+    if (!policy) {
+        ods_log_error("[%s] Could not find policy %s in database", module_str,
+            policyname);
+        dbw_free(db);
+        return -1;
+    }
+    /* Zones may come and go while we work, remember them by name. */
+    size_t count = policy->zone_count;
+    char **names;
+    CHECKALLOC(names = malloc((count + 1) * sizeof(char *)));
+    for (size_t z = 0; z < count; z++)
+        CHECKALLOC(names[z] = strdup(policy->zone[z]->name));
+    ods_log_info("[%s] enforcing %zu zones of policy %s", module_str, count,
+        policyname);
+
+    size_t done = 0;
+    while (done < count) {
+        struct dbw_zone *zones[ENFORCE_POLICY_BATCH];
+        time_t t_next[ENFORCE_POLICY_BATCH];
+        size_t n = count - done < ENFORCE_POLICY_BATCH ? count - done : ENFORCE_POLICY_BATCH;
+        int updated = 0;
+        int r;
+
+        /* Committed rows can't be reused, every batch starts afresh. */
+        if (!db && (db = dbw_fetch(dbconn)))
+            policy = dbw_get_policy(db, policyname);
+        if (!db || !policy) break;
+        struct enforcer_policy_cache *cache = enforcer_policy_cache_create(policy);
+        for (size_t i = 0; i < n; i++) {
+            int zone_updated = 0;
+            zones[i] = dbw_get_zone(db, names[done + i]);
+            /* Deleted or moved to other policy in the mean time. */
+            if (zones[i] && zones[i]->policy != policy) zones[i] = NULL;
+            if (!zones[i]) continue;
+            t_next[i] = enforce_zone(engine, db, zones[i], cache, &zone_updated);
+            updated |= zone_updated;
+        }
+        enforcer_policy_cache_free(cache);
+        if (updated && (r = dbw_commit(db))) {
+            ods_log_error("[%s] Unable to commit changes to zones of policy "
+                "%s to database, deferring to the individual zones.",
+                module_str, policyname);
+            if (r == DBW_COMMIT_STALE) hsm_key_factory_return_keys(db);
+            hsm_key_factory_settle_keys(db);
+            break;
+        }
+        hsm_key_factory_settle_keys(db);
+        for (size_t i = 0; i < n; i++) {
+            enforce_task_catchup_done(names[done + i]);
+            if (!zones[i]) continue;
+            enforce_zone_committed(engine, dbconn, zones[i]);
+            if (t_next[i] < 0) continue;
+            task_type *task = enforce_task(engine, zones[i]->name);
+            task->due_date = t_next[i];
+            (void)schedule_task(engine->taskq, task, 1, 0);
+        }
+        dbw_free(db);
+        db = NULL;
+        done += n;
+    }
+    if (db) dbw_free(db);
+    /* Whatever is left over is retried by the zones' own tasks. */
+    for (size_t z = done; z < count; z++)
+        enforce_task_flush_zone(engine, names[z]);
+    for (size_t z = 0; z < count; z++) free(names[z]);
+    free(names);
+    return schedule_SUCCESS;
+}
+
+static time_t
+enforce_task_policy_perform(task_type* task, char const *owner, void *userdata, void *context)
+{
+    db_connection_t* dbconn = (db_connection_t*) context;
+    return perform_enforce_policy((engine_type *)userdata, owner, dbconn);
+}
+
 time_t
 enforce_task_perform(task_type* task, char const *owner, void *userdata, void *context)
 {
     db_connection_t* dbconn = (db_connection_t*) context;
-    return perform_enforce(-1, (engine_type *)userdata, owner, dbconn);
+    time_t t_next = perform_enforce(-1, (engine_type *)userdata, owner, dbconn);
+    enforce_task_catchup_done(owner);
+    return t_next;
 }
 
 task_type *
@@ -147,6 +281,76 @@ enforce_task(engine_type *engine, char const *owner)
         enforce_task_perform, engine, NULL, time_now());
 }
 
+static int
+compare_next_change(const void *a, const void *b)
+{
+    struct dbw_zone *za = *(struct dbw_zone **)a;
+    struct dbw_zone *zb = *(struct dbw_zone **)b;
+    return (za->next_change > zb->next_change) - (za->next_change < zb->next_change);
+}
+
+static void
+catchup_free_node(ldns_rbnode_t *node, void *arg)
+{
+    (void)arg;
+    free((void *)node->key);
+    free(node);
+}
+
+/* Start over with the given zones pending. */
+static void
+catchup_start(struct dbw_zone **zones, size_t count)
+{
+    ldns_rbnode_t *node;
+    pthread_mutex_lock(&catchup.lock);
+    if (catchup.pending) {
+        ldns_traverse_postorder(catchup.pending, catchup_free_node, NULL);
+        ldns_rbtree_free(catchup.pending);
+    }
+    catchup.pending = ldns_rbtree_create((int (*)(const void *, const void *))strcmp);
+    for (size_t z = 0; z < count; z++) {
+        CHECKALLOC(node = malloc(sizeof(ldns_rbnode_t)));
+        CHECKALLOC(node->key = strdup(zones[z]->name));
+        node->data = NULL;
+        if (!ldns_rbtree_insert(catchup.pending, node))
+            catchup_free_node(node, NULL);
+    }
+    catchup.total = catchup.pending->count;
+    pthread_mutex_unlock(&catchup.lock);
+}
+
+void
+enforce_task_catchup_done(char const *zonename)
+{
+    ldns_rbnode_t *node = NULL;
+    size_t done = 0, total = 0;
+    pthread_mutex_lock(&catchup.lock);
+    if (catchup.pending && (node = ldns_rbtree_delete(catchup.pending, zonename))) {
+        total = catchup.total;
+        done = total - catchup.pending->count;
+    }
+    pthread_mutex_unlock(&catchup.lock);
+    if (!node) return;
+    catchup_free_node(node, NULL);
+    if (done == total) {
+        ods_log_info("[%s] startup catch-up finished, %zu zones enforced",
+            module_str, total);
+    } else if (done % (total/10 > 0 ? total/10 : 1) == 0) {
+        ods_log_info("[%s] startup catch-up: %zu of %zu zones enforced",
+            module_str, done, total);
+    }
+}
+
+int
+enforce_task_catchup_progress(size_t *done, size_t *total)
+{
+    pthread_mutex_lock(&catchup.lock);
+    *total = catchup.total;
+    *done = catchup.total - (catchup.pending ? catchup.pending->count : 0);
+    pthread_mutex_unlock(&catchup.lock);
+    return *done < *total;
+}
+
 void
 enforce_task_flush_zone(engine_type *engine, char const *zonename)
 {
@@ -156,10 +360,10 @@ enforce_task_flush_zone(engine_type *engine, char const *zonename)
 void
 enforce_task_flush_policy(engine_type *engine, struct dbw_policy *policy)
 {
-    for (size_t z = 0; z < policy->zone_count; z++) {
-        struct dbw_zone *zone = policy->zone[z];
-        (void)schedule_task(engine->taskq, enforce_task(engine, zone->name), 1, 0);
-    }
+    task_type *task = task_create(strdup(policy->name), TASK_CLASS_ENFORCER,
+        TASK_TYPE_ENFORCEPOLICY, enforce_task_policy_perform, engine, NULL,
+        time_now());
+    (void)schedule_task(engine->taskq, task, 1, 0);
 }
 
 void
@@ -173,3 +377,41 @@ enforce_task_flush_all(engine_type *engine, db_connection_t *dbconn)
     }
     dbw_free(db);
 }
+
+void
+enforce_task_schedule_all(engine_type *engine, db_connection_t *dbconn)
+{
+    struct dbw_zone **overdue;
+    size_t noverdue = 0;
+    time_t now = time_now();
+    int rate = engine->config->enforcer_startup_rate;
+    task_type *task;
+    struct dbw_db *db = dbw_fetch(dbconn);
+    if (!db) ods_fatal_exit("[%s] failed to list zones from DB", module_str);
+    CHECKALLOC(overdue = malloc((db->zones->n + 1) * sizeof(struct dbw_zone *)));
+    for (size_t z = 0; z < db->zones->n; z++) {
+        struct dbw_zone *zone = (struct dbw_zone *)db->zones->set[z];
+        /* Zones never enforced, overdue or with pending signconf changes
+         * need attention now, all others resume at their next change. */
+        if (zone->next_change <= now || zone->signconf_needs_writing) {
+            overdue[noverdue++] = zone;
+        } else {
+            task = enforce_task(engine, zone->name);
+            task->due_date = zone->next_change;
+            (void)schedule_task(engine->taskq, task, 1, 0);
+        }
+    }
+    /* Most overdue first, spread out to at most rate zones per second. */
+    qsort(overdue, noverdue, sizeof(struct dbw_zone *), compare_next_change);
+    catchup_start(overdue, noverdue);
+    for (size_t z = 0; z < noverdue; z++) {
+        task = enforce_task(engine, overdue[z]->name);
+        if (rate > 0) task->due_date = now + z / rate;
+        (void)schedule_task(engine->taskq, task, 1, 0);
+    }
+    ods_log_info("[%s] %zu of %zu zones need enforcement after start, "
+        "others are scheduled at their next change", module_str,
+        noverdue, db->zones->n);
+    free(overdue);
+    dbw_free(db);
+}
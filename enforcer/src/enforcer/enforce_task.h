@@ -43,10 +43,25 @@ extern time_t enforce_task_perform(task_type* task, char const *owner, void *con
 /* Schedule enforce tasks for *now* for zone. */
 extern void enforce_task_flush_zone(engine_type *engine, char const *zonename);
 
-/* Schedule enforce tasks for *now* for ALL zones of policy. */
+/* Schedule one enforce task for *now* for ALL zones of policy. The zones
+ * are enforced in batches sharing a database read, policy computations and
+ * commit. */
 extern void enforce_task_flush_policy(engine_type *engine, struct dbw_policy *policy);
 
 /* Schedule enforce tasks for *now* for ALL zones. */
 extern void enforce_task_flush_all(engine_type *engine, db_connection_t *dbconn);
 
+/* Schedule enforce tasks for ALL zones at their next change. Zones that
+ * are overdue or never enforced are scheduled now, but no more than the
+ * configured StartupRate per second. */
+extern void enforce_task_schedule_all(engine_type *engine, db_connection_t *dbconn);
+
+/* Take zone off the catch-up started by enforce_task_schedule_all(),
+ * once it got enforced by any task or was deleted. */
+extern void enforce_task_catchup_done(char const *zonename);
+
+/* Progress of the catch-up started by enforce_task_schedule_all().
+ * Returns non-zero while zones are still pending. */
+extern int enforce_task_catchup_progress(size_t *done, size_t *total);
+
 #endif
@@ -41,6 +41,7 @@
 
 #include "config.h"
 
+#include <stdlib.h>
 #include <time.h>
 
 #include "libhsm.h"
@@ -55,6 +56,7 @@
 #include "db/dbw.h"
 
 #include "enforcer/enforcer.h"
+#include "enforcer/keystate_counts.h"
 
 #undef DEBUG_ENFORCER_LOGIC
 
@@ -169,37 +171,6 @@ match(struct dbw_key *key, int algorithm, int same_algorithm,
     return 1;
 }
 
-/**
- * Test if a key exist with certain states.
- *
- * \return A positive value if a key exists, zero if a key does not exists.
- */
-static int
-exists(struct dbw_zone *zone, int algorithm, int same_algorithm,
-    const enum dbw_keystate_state mask[4])
-{
-    for (size_t k = 0; k < zone->key_count; k++) {
-        struct dbw_key *key = zone->key[k];
-        if (match(key, algorithm, same_algorithm, mask)) return 1;
-    }
-    return 0;
-}
-
-static int
-exists_with_ds_state(struct dbw_zone *zone, int algorithm, int same_algorithm,
-    const enum dbw_keystate_state mask[4], int ds_state)
-{
-    for (size_t k = 0; k < zone->key_count; k++) {
-        struct dbw_key *key = zone->key[k];
-        if (match(key, algorithm, same_algorithm, mask)) {
-            if ((key->ds_at_parent == ds_state)
-             || ( key->ds_at_parent > ds_state && key->ds_at_parent <= DBW_DS_AT_PARENT_SEEN))
-                return 1;
-        }
-    }
-    return 0;
-}
-
 /**
  * Test if a key is a potential successor.
  *
@@ -316,10 +287,14 @@ first_of_dependency_chain(struct dbw_key *P, enum dbw_keystate_type type)
  * \return A positive value if a key exists, zero if a key does not exists
  */
 static int
-exists_with_successor(struct dbw_zone *zone, int algorithm, int same_algorithm,
-    const enum dbw_keystate_state pmask[4],
+exists_with_successor(struct dbw_zone *zone, struct keystate_counts *counts,
+    int algorithm, int same_algorithm, const enum dbw_keystate_state pmask[4],
     const enum dbw_keystate_state smask[4], enum dbw_keystate_type type)
 {
+    /* Without both a P and an S there is no need to walk the chains. */
+    if (!keystate_counts_exists(counts, algorithm, 1, pmask)
+        || !keystate_counts_exists(counts, algorithm, 1, smask))
+        return 0;
     /* try all keys */
     for (size_t k = 0; k < zone->key_count; k++) {
         struct dbw_key *P = zone->key[k];
@@ -334,51 +309,6 @@ exists_with_successor(struct dbw_zone *zone, int algorithm, int same_algorithm,
     return 0;
 }
 
-/**
- * Test if keys are in a good unsigned state. For example when we have a key
- * with a rumoured DS and omnipresent DNSKEY, every other key may not have
- * its DS other than rumoured or hidden.
- *
- * \return A positive value if keys are in a good unsigned state, zero if keys
- * are not.
- */
-static int
-unsignedOk(struct dbw_zone *zone, int algorithm, const enum dbw_keystate_state mask[4],
-    enum dbw_keystate_type type)
-{
-    /* collect the amount of keys in each state */
-    for (size_t k = 0; k < zone->key_count; k++) {
-        struct dbw_key *key = zone->key[k];
-        if (key->algorithm != algorithm) continue;
-
-    enum dbw_keystate_state cmp_mask[4];
-    memcpy(cmp_mask, mask, 4 * sizeof(enum dbw_keystate_state));
-    cmp_mask[type] = getState(key, type);
-
-    if (cmp_mask[type] == HIDDEN || cmp_mask[type] == NA) continue;
-
-    cmp_mask[DBW_DS] = NA;
-    if  (!exists_with_ds_state(zone, algorithm, 1, cmp_mask, key->ds_at_parent)) return 0;
-    }
-
-   return 1;
-}
-
-/* Check if ALL DS records for this algorithm are hidden
- *
- * \return 0 if !HIDDEN DS is found, 1 if no such DS where found */
-static int
-all_DS_hidden(struct dbw_zone *zone, int algorithm)
-{
-    for (size_t k = 0; k < zone->key_count; k++) {
-        struct dbw_key *key = zone->key[k];
-        if (key->algorithm != algorithm) continue;
-        enum dbw_keystate_state state = getState(key, DBW_DS);
-        if (state != HIDDEN && state != NA) return 0; /*Test failed. Found DS.*/
-    }
-    return 1; /*No such DS where found.*/
-}
-
 /**
  * Checks for existence of DS.
  *
@@ -386,7 +316,7 @@ all_DS_hidden(struct dbw_zone *zone, int algorithm)
  * apply
  */
 static int
-rule1(struct dbw_zone *zone, int algorithm)
+rule1(struct dbw_zone *zone, struct keystate_counts *counts, int algorithm)
 {
     static const enum dbw_keystate_state mask[2][4] = {
         { OMNIPRESENT, NA, NA, NA },/* a good key state.  */
@@ -395,9 +325,9 @@ rule1(struct dbw_zone *zone, int algorithm)
     /* Return positive value if any of the masks are found.  */
 #ifdef DEBUG_ENFORCER_LOGIC
     ods_log_error("DEBUG rule1");
-    ods_log_error("%d %d", exists(zone, algorithm, 0, mask[0]), exists(zone, algorithm, 0, mask[1]));
+    ods_log_error("%d %d", keystate_counts_exists(counts, algorithm, 0, mask[0]), keystate_counts_exists(counts, algorithm, 0, mask[1]));
 #endif
-    return (exists(zone, algorithm, 0, mask[0]) || exists(zone, algorithm, 0, mask[1]));
+    return (keystate_counts_exists(counts, algorithm, 0, mask[0]) || keystate_counts_exists(counts, algorithm, 0, mask[1]));
 }
 
 /**
@@ -407,7 +337,7 @@ rule1(struct dbw_zone *zone, int algorithm)
  * apply
  */
 static int
-rule2(struct dbw_zone *zone, int algorithm)
+rule2(struct dbw_zone *zone, struct keystate_counts *counts, int algorithm)
 {
     static const enum dbw_keystate_state  mask[8][4] = {
         { OMNIPRESENT, NA, OMNIPRESENT, OMNIPRESENT },/*good key state.*/
@@ -422,21 +352,21 @@ rule2(struct dbw_zone *zone, int algorithm)
     /* Return positive value if any of the masks are found.  */
 #ifdef DEBUG_ENFORCER_LOGIC
         ods_log_error("DEBUG rule2");
-        ods_log_error("%d %d %d %d %d %d %d", exists(zone, algorithm, 1, mask[0])
-            , exists_with_successor(zone, algorithm, 1, mask[2], mask[1], DBW_DS)
-            , exists_with_successor(zone, algorithm, 1, mask[5], mask[3], DBW_DNSKEY)
-            , exists_with_successor(zone, algorithm, 1, mask[5], mask[4], DBW_DNSKEY)
-            , exists_with_successor(zone, algorithm, 1, mask[6], mask[3], DBW_DNSKEY)
-            , exists_with_successor(zone, algorithm, 1, mask[6], mask[4], DBW_DNSKEY)
-            , unsignedOk(zone, algorithm, mask[7], DBW_DS));
+        ods_log_error("%d %d %d %d %d %d %d", keystate_counts_exists(counts, algorithm, 1, mask[0])
+            , exists_with_successor(zone, counts, algorithm, 1, mask[2], mask[1], DBW_DS)
+            , exists_with_successor(zone, counts, algorithm, 1, mask[5], mask[3], DBW_DNSKEY)
+            , exists_with_successor(zone, counts, algorithm, 1, mask[5], mask[4], DBW_DNSKEY)
+            , exists_with_successor(zone, counts, algorithm, 1, mask[6], mask[3], DBW_DNSKEY)
+            , exists_with_successor(zone, counts, algorithm, 1, mask[6], mask[4], DBW_DNSKEY)
+            , keystate_counts_unsigned_ok(counts, algorithm, mask[7], DBW_DS));
 #endif
-    return (exists(zone, algorithm, 1, mask[0])
-        || exists_with_successor(zone, algorithm, 1, mask[2], mask[1], DBW_DS)
-        || exists_with_successor(zone, algorithm, 1, mask[5], mask[3], DBW_DNSKEY)
-        || exists_with_successor(zone, algorithm, 1, mask[5], mask[4], DBW_DNSKEY)
-        || exists_with_successor(zone, algorithm, 1, mask[6], mask[3], DBW_DNSKEY)
-        || exists_with_successor(zone, algorithm, 1, mask[6], mask[4], DBW_DNSKEY)
-        || unsignedOk(zone, algorithm, mask[7], DBW_DS));
+    return (keystate_counts_exists(counts, algorithm, 1, mask[0])
+        || exists_with_successor(zone, counts, algorithm, 1, mask[2], mask[1], DBW_DS)
+        || exists_with_successor(zone, counts, algorithm, 1, mask[5], mask[3], DBW_DNSKEY)
+        || exists_with_successor(zone, counts, algorithm, 1, mask[5], mask[4], DBW_DNSKEY)
+        || exists_with_successor(zone, counts, algorithm, 1, mask[6], mask[3], DBW_DNSKEY)
+        || exists_with_successor(zone, counts, algorithm, 1, mask[6], mask[4], DBW_DNSKEY)
+        || keystate_counts_unsigned_ok(counts, algorithm, mask[7], DBW_DS));
 }
 
 /**
@@ -446,7 +376,7 @@ rule2(struct dbw_zone *zone, int algorithm)
  * apply
  */
 static int
-rule3(struct dbw_zone *zone, int algorithm)
+rule3(struct dbw_zone *zone, struct keystate_counts *counts, int algorithm)
 {
     static const enum dbw_keystate_state  mask[6][4] = {
         { NA, OMNIPRESENT, OMNIPRESENT, NA },/* good key state. */
@@ -458,18 +388,18 @@ rule3(struct dbw_zone *zone, int algorithm)
     };
 #ifdef DEBUG_ENFORCER_LOGIC
         ods_log_error("DEBUG rule3");
-        ods_log_error("%d %d %d %d %d", exists(zone, algorithm, 1, mask[0])
-        , exists_with_successor(zone, algorithm, 1, mask[2], mask[1], DBW_DNSKEY)
-        , exists_with_successor(zone, algorithm, 1, mask[4], mask[3], DBW_RRSIG)
-        , unsignedOk(zone, algorithm, mask[5], DBW_DNSKEY)
-        , all_DS_hidden(zone, algorithm));
+        ods_log_error("%d %d %d %d %d", keystate_counts_exists(counts, algorithm, 1, mask[0])
+        , exists_with_successor(zone, counts, algorithm, 1, mask[2], mask[1], DBW_DNSKEY)
+        , exists_with_successor(zone, counts, algorithm, 1, mask[4], mask[3], DBW_RRSIG)
+        , keystate_counts_unsigned_ok(counts, algorithm, mask[5], DBW_DNSKEY)
+        , keystate_counts_all_ds_hidden(counts, algorithm));
 #endif
     /* Return positive value if any of the masks are found. */
-    return (exists(zone, algorithm, 1, mask[0])
-        || exists_with_successor(zone, algorithm, 1, mask[2], mask[1], DBW_DNSKEY)
-        || exists_with_successor(zone, algorithm, 1, mask[4], mask[3], DBW_RRSIG)
-        || unsignedOk(zone, algorithm, mask[5], DBW_DNSKEY)
-        || all_DS_hidden(zone, algorithm));
+    return (keystate_counts_exists(counts, algorithm, 1, mask[0])
+        || exists_with_successor(zone, counts, algorithm, 1, mask[2], mask[1], DBW_DNSKEY)
+        || exists_with_successor(zone, counts, algorithm, 1, mask[4], mask[3], DBW_RRSIG)
+        || keystate_counts_unsigned_ok(counts, algorithm, mask[5], DBW_DNSKEY)
+        || keystate_counts_all_ds_hidden(counts, algorithm));
 }
 
 /**
@@ -478,7 +408,8 @@ rule3(struct dbw_zone *zone, int algorithm)
  * \return A positive value if the transition is allowed, zero if it is not.
  */
 static int
-dnssecApproval(struct dbw_zone *zone, struct dbw_key *key, enum dbw_keystate_type type,
+dnssecApproval(struct dbw_zone *zone, struct keystate_counts *counts,
+    struct dbw_key *key, enum dbw_keystate_type type,
     enum dbw_keystate_state next_state, int allow_unsigned)
 {
     /* Check if DNSSEC state will be invalid by the transition by checking that
@@ -500,20 +431,22 @@ dnssecApproval(struct dbw_zone *zone, struct dbw_key *key, enum dbw_keystate_typ
     int after_change = 0;
 
     /* set flag for each rule */
-    before_change |= ( rule1(zone, key->algorithm) << 0 );
-    before_change |= ( rule2(zone, key->algorithm) << 1 );
-    before_change |= ( rule3(zone, key->algorithm) << 2 );
+    before_change |= ( rule1(zone, counts, key->algorithm) << 0 );
+    before_change |= ( rule2(zone, counts, key->algorithm) << 1 );
+    before_change |= ( rule3(zone, counts, key->algorithm) << 2 );
 
     /* safe current state, apply change and test again.*/
     struct dbw_keystate *keystate = dbw_get_keystate(key, type);
     int current_state = keystate->state;
     keystate->state = next_state;
+    keystate_counts_update(counts, key);
         /* if we make the rules more sophisticated by using the timing information
          * as well, we also need to set last_change to now here.  */
-        after_change |= ( rule1(zone, key->algorithm) << 0 );
-        after_change |= ( rule2(zone, key->algorithm) << 1 );
-        after_change |= ( rule3(zone, key->algorithm) << 2 );
+        after_change |= ( rule1(zone, counts, key->algorithm) << 0 );
+        after_change |= ( rule2(zone, counts, key->algorithm) << 1 );
+        after_change |= ( rule3(zone, counts, key->algorithm) << 2 );
     keystate->state = current_state; /* restore */
+    keystate_counts_update(counts, key);
 
     /* before => after (implication)
      * If one of the rules isn't satisfied in the before situation we allow
@@ -577,7 +510,8 @@ minTransitionTime(const struct dbw_policy *policy, enum dbw_keystate_type type,
  * a negative value if an error occurred.
  */
 static int
-policyApproval(struct dbw_zone *zone, struct dbw_key *key, enum dbw_keystate_type type,
+policyApproval(struct dbw_zone *zone, struct keystate_counts *counts,
+    struct dbw_key *key, enum dbw_keystate_type type,
     enum dbw_keystate_state next_state)
 {
     static const enum dbw_keystate_state mask[14][4] = {
@@ -633,9 +567,9 @@ policyApproval(struct dbw_zone *zone, struct dbw_key *key, enum dbw_keystate_typ
         }
         /* We might be doing an algorithm rollover so we check if there are
          * no other good KSK available and ignore the minimize flag if so. */
-        return !exists(zone, key->algorithm, 1, mask[6])
-            && !exists_with_successor(zone, key->algorithm, 1, mask[8], mask[7], DBW_DS)
-            && !exists_with_successor(zone, key->algorithm, 1, mask[11], mask[9], DBW_DNSKEY);
+        return !keystate_counts_exists(counts, key->algorithm, 1, mask[6])
+            && !exists_with_successor(zone, counts, key->algorithm, 1, mask[8], mask[7], DBW_DS)
+            && !exists_with_successor(zone, counts, key->algorithm, 1, mask[11], mask[9], DBW_DNSKEY);
 
     case DBW_RRSIGDNSKEY:
         /* The only time not to introduce RRSIG DNSKEY is when the DNSKEY is
@@ -650,9 +584,9 @@ policyApproval(struct dbw_zone *zone, struct dbw_key *key, enum dbw_keystate_typ
         if (ks_dnskey->state == OMNIPRESENT) return 1;
         /* We might be doing an algorithm rollover so we check if there are
          * no other good ZSK available and ignore the minimize flag if so. */
-        return !exists(zone, key->algorithm, 1, mask[0])
-            && !exists_with_successor(zone, key->algorithm, 1, mask[2], mask[1], DBW_DNSKEY)
-            && !exists_with_successor(zone, key->algorithm, 1, mask[4], mask[3], DBW_RRSIG);
+        return !keystate_counts_exists(counts, key->algorithm, 1, mask[0])
+            && !exists_with_successor(zone, counts, key->algorithm, 1, mask[2], mask[1], DBW_DNSKEY)
+            && !exists_with_successor(zone, counts, key->algorithm, 1, mask[4], mask[3], DBW_RRSIG);
 
     default:
         ods_log_assert(0);
@@ -973,6 +907,7 @@ updateZone(struct dbw_db *db, struct dbw_zone *zone, const time_t now,
          module_str, scmd, zone->name, policy->name);
     track_ttls(zone, now);
     generate_missing_keystates(db, zone, now);
+    struct keystate_counts *counts = keystate_counts_create(zone);
 
     int stable = 0;
     while (!stable) {
@@ -985,6 +920,8 @@ updateZone(struct dbw_db *db, struct dbw_zone *zone, const time_t now,
                 time_t returntime_keystate;
                 struct dbw_keystate *keystate = key->keystate[s];
                 enum dbw_keystate_state next_state = getDesiredState(key->introducing, keystate->state, keystate);
+                /* getDesiredState() may reset the DS at parent. */
+                keystate_counts_update(counts, key);
                 if (next_state == keystate->state) continue;
                 if (is_ds_waiting_for_user(keystate, next_state)) continue;
 
@@ -997,11 +934,11 @@ updateZone(struct dbw_db *db, struct dbw_zone *zone, const time_t now,
                     dbw_keystate_state_txt[next_state]);
 
                 /* Check if policy prevents transition. */
-                if (!policyApproval(zone, key, keystate->type, next_state)) continue;
+                if (!policyApproval(zone, counts, key, keystate->type, next_state)) continue;
                 ods_log_verbose("[%s] %s Policy says we can (1/3)", module_str, scmd);
 
                 /* Check if DNSSEC state prevents transition.  */
-                if (!dnssecApproval(zone, key, keystate->type, next_state, allow_unsigned)) continue;
+                if (!dnssecApproval(zone, counts, key, keystate->type, next_state, allow_unsigned)) continue;
                 ods_log_verbose("[%s] %s DNSSEC says we can (2/3)", module_str, scmd);
 
                 returntime_keystate = minTransitionTime(policy, keystate->type, next_state,
@@ -1014,8 +951,8 @@ updateZone(struct dbw_db *db, struct dbw_zone *zone, const time_t now,
                     {NA, UNRETENTIVE, OMNIPRESENT, NA},
                     {NA, RUMOURED,    OMNIPRESENT, NA}
                 };
-                int zsk_out = exists(zone, key->algorithm, 1, mask[0]);
-                int zsk_in  = exists(zone, key->algorithm, 1, mask[1]);
+                int zsk_out = keystate_counts_exists(counts, key->algorithm, 1, mask[0]);
+                int zsk_in  = keystate_counts_exists(counts, key->algorithm, 1, mask[1]);
 
                 if (keystate->type == DBW_RRSIG
                     && getstate(key, DBW_DNSKEY)->state == OMNIPRESENT
@@ -1066,6 +1003,7 @@ updateZone(struct dbw_db *db, struct dbw_zone *zone, const time_t now,
                 keystate->state = next_state;
                 keystate->last_change = now;
                 keystate->ttl = getZoneTTL(zone, keystate->type, now);
+                keystate_counts_update(counts, key);
                 /* we don't want DELETED or INSERTED to be marked UPDATE */
                 dbw_mark_dirty((struct dbrow *)keystate);
                 stable = 0; /* There have been changes. Keep processing */
@@ -1080,6 +1018,7 @@ updateZone(struct dbw_db *db, struct dbw_zone *zone, const time_t now,
             }
         }
     }
+    keystate_counts_free(counts);
     return returntime_zone;
 }
 
@@ -1094,6 +1033,60 @@ hsmkey_in_use_by_zone(const struct dbw_hsmkey *hsmkey, const struct dbw_zone *zo
     return 0;
 }
 
+/**
+ * Results of the policy wide computations of updatePolicy() which are the
+ * same for every zone of the policy. Used when enforcing many zones of one
+ * policy in a row.
+ */
+struct enforcer_policy_cache {
+    struct dbw_policy *policy;
+    int *too_short;             /* per policykey, -1 when not known yet */
+    struct reusable **reusable; /* per policykey, NULL when not known yet */
+    size_t *reusable_count;
+};
+
+struct reusable {
+    struct dbw_hsmkey *hsmkey;
+    size_t index;
+};
+
+struct enforcer_policy_cache *
+enforcer_policy_cache_create(struct dbw_policy *policy)
+{
+    struct enforcer_policy_cache *cache;
+    size_t n = policy->policykey_count;
+    CHECKALLOC(cache = calloc(1, sizeof(struct enforcer_policy_cache)));
+    cache->policy = policy;
+    CHECKALLOC(cache->too_short = malloc((n + 1) * sizeof(int)));
+    CHECKALLOC(cache->reusable = calloc(n + 1, sizeof(struct reusable *)));
+    CHECKALLOC(cache->reusable_count = calloc(n + 1, sizeof(size_t)));
+    for (size_t pk = 0; pk < n; pk++) cache->too_short[pk] = -1;
+    return cache;
+}
+
+/* Forget the reusable keys, the set of hsmkeys of the policy changed. */
+static void
+enforcer_policy_cache_invalidate(struct enforcer_policy_cache *cache)
+{
+    if (!cache) return;
+    for (size_t pk = 0; pk < cache->policy->policykey_count; pk++) {
+        free(cache->reusable[pk]);
+        cache->reusable[pk] = NULL;
+        cache->reusable_count[pk] = 0;
+    }
+}
+
+void
+enforcer_policy_cache_free(struct enforcer_policy_cache *cache)
+{
+    if (!cache) return;
+    enforcer_policy_cache_invalidate(cache);
+    free(cache->too_short);
+    free(cache->reusable);
+    free(cache->reusable_count);
+    free(cache);
+}
+
 /**
  * Get a reusable HSMkey for this policy key. NULL of no such key exists
  */
@@ -1116,6 +1109,49 @@ getLastReusableKey(const struct dbw_zone *zone, const struct dbw_policykey *pkey
     return newest;
 }
 
+static int
+compare_reusable(const void *a, const void *b)
+{
+    const struct reusable *ra = a;
+    const struct reusable *rb = b;
+    /* Newest first, on equal inception the first in the policy wins. */
+    if (ra->hsmkey->inception != rb->hsmkey->inception)
+        return ra->hsmkey->inception < rb->hsmkey->inception ? 1 : -1;
+    return (ra->index > rb->index) - (ra->index < rb->index);
+}
+
+/**
+ * Same as getLastReusableKey() but the candidate keys of the policy key
+ * are collected and sorted only once for all zones of the policy.
+ */
+static struct dbw_hsmkey *
+getLastReusableKeyCached(struct enforcer_policy_cache *cache,
+    const struct dbw_zone *zone, size_t pk)
+{
+    const struct dbw_policykey *pkey = cache->policy->policykey[pk];
+    if (!cache->reusable[pk]) {
+        struct reusable *list;
+        size_t n = 0;
+        CHECKALLOC(list = malloc((cache->policy->hsmkey_count + 1) * sizeof(struct reusable)));
+        for (size_t h = 0; h < (size_t)cache->policy->hsmkey_count; h++) {
+            struct dbw_hsmkey *hkey = cache->policy->hsmkey[h];
+            if (hkey->state == DBW_HSMKEY_UNUSED) continue;
+            if (~hkey->role & pkey->role) continue;
+            list[n].hsmkey = hkey;
+            list[n].index = h;
+            n++;
+        }
+        qsort(list, n, sizeof(struct reusable), compare_reusable);
+        cache->reusable[pk] = list;
+        cache->reusable_count[pk] = n;
+    }
+    for (size_t r = 0; r < cache->reusable_count[pk]; r++) {
+        struct dbw_hsmkey *hkey = cache->reusable[pk][r].hsmkey;
+        if (!hsmkey_in_use_by_zone(hkey, zone)) return hkey;
+    }
+    return NULL;
+}
+
 
 static int
 key_matches_pkey(const struct dbw_key *key, const struct dbw_policykey *pkey)
@@ -1274,7 +1310,8 @@ lifetime_too_short(struct dbw_policy *policy, struct dbw_policykey *pkey)
  * @return time_t
  * */
 static time_t
-updatePolicy(engine_type *engine, struct dbw_db *db, struct dbw_zone *zone, const time_t now, int *allow_unsigned, int *zone_updated, int mockup)
+updatePolicy(engine_type *engine, struct dbw_db *db, struct dbw_zone *zone, const time_t now, int *allow_unsigned, int *zone_updated, int mockup,
+    struct enforcer_policy_cache *cache)
 {
     static const char *scmd = "updatePolicy";
     struct dbw_policy *policy = zone->policy;
@@ -1334,7 +1371,15 @@ updatePolicy(engine_type *engine, struct dbw_db *db, struct dbw_zone *zone, cons
         /* Sanity check for unreasonable short key lifetime.
          * This would produce silly output and give the signer lots of useless
          * work to do otherwise. */
-        if (lifetime_too_short(policy, pkey)) {
+        int too_short;
+        if (!cache) {
+            too_short = lifetime_too_short(policy, pkey);
+        } else {
+            if (cache->too_short[pk] == -1)
+                cache->too_short[pk] = lifetime_too_short(policy, pkey);
+            too_short = cache->too_short[pk];
+        }
+        if (too_short) {
             setnextroll(zone, pkey->role, now);
             *zone_updated = 1;
             continue;
@@ -1343,9 +1388,15 @@ updatePolicy(engine_type *engine, struct dbw_db *db, struct dbw_zone *zone, cons
         /* Get a new key, either a existing/shared key if the policy is set to
          * share keys or create a new key. */
         struct dbw_hsmkey *hkey = NULL;
-        if (policy->keys_shared)
-            hkey = getLastReusableKey(zone, pkey);
+        if (policy->keys_shared) {
+            if (cache)
+                hkey = getLastReusableKeyCached(cache, zone, pk);
+            else
+                hkey = getLastReusableKey(zone, pkey);
+        }
         if (!hkey) {
+            /* Either way the keys of the policy change. */
+            enforcer_policy_cache_invalidate(cache);
             if (!mockup) {
                 hkey = hsm_key_factory_get_key(engine, db, pkey, zone);
             } else {
@@ -1381,7 +1432,7 @@ updatePolicy(engine_type *engine, struct dbw_db *db, struct dbw_zone *zone, cons
             if (err) {
                 /* TODO: better log error */
                 ods_log_error("[%s] %s: error keytag", module_str, scmd);
-                hsm_key_factory_release_key(hkey, NULL);
+                hsm_key_factory_return_key(db, hkey);
                 return now + 60;
             }
         } else {
@@ -1392,7 +1443,7 @@ updatePolicy(engine_type *engine, struct dbw_db *db, struct dbw_zone *zone, cons
         if (!key) {
             ods_log_error("[%s] %s: error new key", module_str, scmd);
             if (!mockup)
-                hsm_key_factory_release_key(hkey, NULL);
+                hsm_key_factory_return_key(db, hkey);
             return now + 60;
         }
         key->algorithm = pkey->algorithm;
@@ -1532,7 +1583,7 @@ set_key_flags(struct dbw_zone *zone)
 
 static time_t
 _update(engine_type *engine, struct dbw_db *db, struct dbw_zone *zone, time_t now,
-    int *zone_updated, int mockup)
+    int *zone_updated, int mockup, struct enforcer_policy_cache *cache)
 {
     ods_log_info("[%s] update zone: %s", module_str, zone->name);
 
@@ -1559,7 +1610,7 @@ _update(engine_type *engine, struct dbw_db *db, struct dbw_zone *zone, time_t no
     /* Update policy.*/
     int allow_unsigned = 0;
     time_t policy_return_time = updatePolicy(engine, db, zone, now,
-        &allow_unsigned, zone_updated, mockup);
+        &allow_unsigned, zone_updated, mockup, cache);
     if (allow_unsigned) {
         ods_log_info("[%s] No keys configured for %s, zone will become"
            " unsigned eventually", module_str, zone->name);
@@ -1603,12 +1654,19 @@ time_t
 update(engine_type *engine, struct dbw_db *db, struct dbw_zone *zone, time_t now,
     int *zone_updated)
 {
-    return _update(engine, db, zone, now, zone_updated, 0);
+    return _update(engine, db, zone, now, zone_updated, 0, NULL);
+}
+
+time_t
+update_cached(engine_type *engine, struct dbw_db *db, struct dbw_zone *zone,
+    time_t now, int *zone_updated, struct enforcer_policy_cache *cache)
+{
+    return _update(engine, db, zone, now, zone_updated, 0, cache);
 }
 
 time_t
 update_mockup(engine_type *engine, struct dbw_db *db, struct dbw_zone *zone, time_t now,
     int *zone_updated)
 {
-    return _update(engine, db, zone, now, zone_updated, 1);
+    return _update(engine, db, zone, now, zone_updated, 1, NULL);
 }
@@ -53,4 +53,26 @@ update(engine_type *engine, struct dbw_db *db, struct dbw_zone *zone, time_t now
  */
 extern time_t
 update_mockup(engine_type *engine, struct dbw_db *db, struct dbw_zone *zone, time_t now, int *zone_updated);
+
+/**
+ * Policy wide state shared by consecutive update_cached() calls for
+ * zones of the same policy, see enforce_task_flush_policy(). Only valid as
+ * long as the dbw_db the policy was fetched from.
+ */
+struct enforcer_policy_cache;
+
+extern struct enforcer_policy_cache *
+enforcer_policy_cache_create(struct dbw_policy *policy);
+
+extern void
+enforcer_policy_cache_free(struct enforcer_policy_cache *cache);
+
+/**
+ * same as update() but reuses the policy computations in cache. cache
+ * MUST belong to the policy of zone.
+ */
+extern time_t
+update_cached(engine_type *engine, struct dbw_db *db, struct dbw_zone *zone,
+    time_t now, int *zone_updated, struct enforcer_policy_cache *cache);
+
 #endif /* _ENFORCER_ENFORCER_H_ */
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2018 NLNet Labs.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "status.h"
+#include "log.h"
+
+#include "enforcer/keystate_counts.h"
+
+struct keystate_tuple {
+    unsigned int algorithm;
+    unsigned int ds_at_parent;
+    unsigned int state[4];
+};
+
+struct keystate_count {
+    struct keystate_tuple tuple;
+    size_t count;
+};
+
+struct keystate_counts {
+    size_t key_count;
+    struct keystate_tuple *key;     /* as last counted, by key->scratch */
+    size_t entry_count;
+    size_t entry_size;
+    struct keystate_count *entry;   /* distinct tuples, count > 0 */
+};
+
+static void
+tuple_of_key(struct dbw_key *key, struct keystate_tuple *tuple)
+{
+    tuple->algorithm = key->algorithm;
+    tuple->ds_at_parent = key->ds_at_parent;
+    for (int t = 0; t < 4; t++) tuple->state[t] = DBW_NA;
+    for (size_t s = 0; s < key->keystate_count; s++) {
+        struct dbw_keystate *keystate = key->keystate[s];
+        if (keystate->type < 4) tuple->state[keystate->type] = keystate->state;
+    }
+}
+
+static void
+count_tuple(struct keystate_counts *counts, const struct keystate_tuple *tuple,
+    int delta)
+{
+    size_t e;
+    for (e = 0; e < counts->entry_count; e++) {
+        if (!memcmp(&counts->entry[e].tuple, tuple, sizeof(struct keystate_tuple)))
+            break;
+    }
+    if (e == counts->entry_count) {
+        ods_log_assert(delta > 0);
+        if (counts->entry_count == counts->entry_size) {
+            counts->entry_size = counts->entry_size ? 2 * counts->entry_size : 8;
+            CHECKALLOC(counts->entry = realloc(counts->entry,
+                counts->entry_size * sizeof(struct keystate_count)));
+        }
+        counts->entry[e].tuple = *tuple;
+        counts->entry[e].count = 0;
+        counts->entry_count++;
+    }
+    counts->entry[e].count += delta;
+    if (counts->entry[e].count == 0)
+        counts->entry[e] = counts->entry[--counts->entry_count];
+}
+
+struct keystate_counts *
+keystate_counts_create(struct dbw_zone *zone)
+{
+    struct keystate_counts *counts;
+    CHECKALLOC(counts = calloc(1, sizeof(struct keystate_counts)));
+    counts->key_count = zone->key_count;
+    CHECKALLOC(counts->key = calloc(zone->key_count + 1, sizeof(struct keystate_tuple)));
+    for (size_t k = 0; k < zone->key_count; k++) {
+        struct dbw_key *key = zone->key[k];
+        key->scratch = k;
+        tuple_of_key(key, &counts->key[k]);
+        count_tuple(counts, &counts->key[k], 1);
+    }
+    return counts;
+}
+
+void
+keystate_counts_free(struct keystate_counts *counts)
+{
+    if (!counts) return;
+    free(counts->key);
+    free(counts->entry);
+    free(counts);
+}
+
+void
+keystate_counts_update(struct keystate_counts *counts, struct dbw_key *key)
+{
+    struct keystate_tuple tuple;
+    struct keystate_tuple *old = &counts->key[key->scratch];
+    ods_log_assert(key->scratch >= 0 && (size_t)key->scratch < counts->key_count);
+    tuple_of_key(key, &tuple);
+    if (!memcmp(old, &tuple, sizeof(struct keystate_tuple))) return;
+    count_tuple(counts, old, -1);
+    count_tuple(counts, &tuple, 1);
+    *old = tuple;
+}
+
+static int
+tuple_match(const struct keystate_tuple *tuple, int algorithm,
+    int same_algorithm, const enum dbw_keystate_state mask[4])
+{
+    if (same_algorithm && tuple->algorithm != (unsigned int)algorithm) return 0;
+    for (int i = 0; i < 4; i++) {
+        if (mask[i] != DBW_NA && tuple->state[i] != mask[i]) return 0;
+    }
+    return 1;
+}
+
+int
+keystate_counts_exists(const struct keystate_counts *counts, int algorithm,
+    int same_algorithm, const enum dbw_keystate_state mask[4])
+{
+    for (size_t e = 0; e < counts->entry_count; e++) {
+        if (tuple_match(&counts->entry[e].tuple, algorithm, same_algorithm, mask))
+            return 1;
+    }
+    return 0;
+}
+
+int
+keystate_counts_exists_with_ds_state(const struct keystate_counts *counts,
+    int algorithm, const enum dbw_keystate_state mask[4], int ds_state)
+{
+    for (size_t e = 0; e < counts->entry_count; e++) {
+        const struct keystate_tuple *tuple = &counts->entry[e].tuple;
+        if (!tuple_match(tuple, algorithm, 1, mask)) continue;
+        if (tuple->ds_at_parent == (unsigned int)ds_state
+            || (tuple->ds_at_parent > (unsigned int)ds_state
+                && tuple->ds_at_parent <= DBW_DS_AT_PARENT_SEEN))
+            return 1;
+    }
+    return 0;
+}
+
+int
+keystate_counts_unsigned_ok(const struct keystate_counts *counts, int algorithm,
+    const enum dbw_keystate_state mask[4], enum dbw_keystate_type type)
+{
+    enum dbw_keystate_state cmp_mask[4];
+    for (size_t e = 0; e < counts->entry_count; e++) {
+        const struct keystate_tuple *tuple = &counts->entry[e].tuple;
+        if (tuple->algorithm != (unsigned int)algorithm) continue;
+        memcpy(cmp_mask, mask, 4 * sizeof(enum dbw_keystate_state));
+        cmp_mask[type] = tuple->state[type];
+        if (cmp_mask[type] == DBW_HIDDEN || cmp_mask[type] == DBW_NA) continue;
+        cmp_mask[DBW_DS] = DBW_NA;
+        if (!keystate_counts_exists_with_ds_state(counts, algorithm, cmp_mask,
+                tuple->ds_at_parent))
+            return 0;
+    }
+    return 1;
+}
+
+int
+keystate_counts_all_ds_hidden(const struct keystate_counts *counts, int algorithm)
+{
+    for (size_t e = 0; e < counts->entry_count; e++) {
+        const struct keystate_tuple *tuple = &counts->entry[e].tuple;
+        if (tuple->algorithm != (unsigned int)algorithm) continue;
+        if (tuple->state[DBW_DS] != DBW_HIDDEN && tuple->state[DBW_DS] != DBW_NA)
+            return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2018 NLNet Labs.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Aggregated key states of a zone.
+ *
+ * The DNSSEC rules of the enforcer only ask whether some key of an
+ * algorithm with a certain combination of states exists. Instead of
+ * scanning all keys of the zone for every question the keys are counted
+ * per distinct (algorithm, DS at parent, DS, RRSIG, DNSKEY, RRSIGDNSKEY)
+ * combination. Questions then only visit the distinct combinations and
+ * a state change of a key is a matter of moving one count.
+ */
+
+#ifndef _ENFORCER_KEYSTATE_COUNTS_H_
+#define _ENFORCER_KEYSTATE_COUNTS_H_
+
+#include "db/dbw.h"
+
+struct keystate_counts;
+
+/**
+ * Count the keys of zone. All keys must have their four key states. The
+ * scratch field of the keys is used to find them back, it must be left
+ * alone while the counts are in use.
+ */
+extern struct keystate_counts *keystate_counts_create(struct dbw_zone *zone);
+
+extern void keystate_counts_free(struct keystate_counts *counts);
+
+/**
+ * Recount key after its states or ds_at_parent changed.
+ */
+extern void keystate_counts_update(struct keystate_counts *counts,
+    struct dbw_key *key);
+
+/**
+ * Is there a key with states mask, NA in mask matches any state. When
+ * same_algorithm is set the key must also be of algorithm.
+ */
+extern int keystate_counts_exists(const struct keystate_counts *counts,
+    int algorithm, int same_algorithm, const enum dbw_keystate_state mask[4]);
+
+/**
+ * Is there a key of algorithm with states mask whose DS is ds_state or
+ * further along up to DBW_DS_AT_PARENT_SEEN.
+ */
+extern int keystate_counts_exists_with_ds_state(
+    const struct keystate_counts *counts, int algorithm,
+    const enum dbw_keystate_state mask[4], int ds_state);
+
+/**
+ * Are the keys of algorithm in a good unsigned state: every key with
+ * type not hidden is matched by a key with mask (type replaced by its
+ * state) in the same DS situation.
+ */
+extern int keystate_counts_unsigned_ok(const struct keystate_counts *counts,
+    int algorithm, const enum dbw_keystate_state mask[4],
+    enum dbw_keystate_type type);
+
+/**
+ * Are all DS records of algorithm hidden.
+ */
+extern int keystate_counts_all_ds_hidden(const struct keystate_counts *counts,
+    int algorithm);
+
+#endif /* _ENFORCER_KEYSTATE_COUNTS_H_ */
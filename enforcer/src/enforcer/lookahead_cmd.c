@@ -92,7 +92,7 @@ printdebugkey_fmt(int sockfd, char const *fmt, struct dbw_key *key, char const
 }
 
 static void
-printdebugkey(int sockfd, struct dbw_key *key, char *tchange, int step)
+printdebugkey(int sockfd, struct dbw_key *key, const char *tchange, int step)
 {
     printdebugkey_fmt(sockfd, "%-5d %-13s %-12s %-12s %-12s %-12s %-21s %d %4d    %s\n", key, tchange, step);
 }
@@ -100,15 +100,14 @@ printdebugkey(int sockfd, struct dbw_key *key, char *tchange, int step)
 static void
 perform_keystate_list(int sockfd, int step, struct dbw_zone *zone,
     void (printheader)(int sockfd),
-    void (printkey)(int sockfd, struct dbw_key *key, char* tchange, int step), time_t now)
+    void (printkey)(int sockfd, struct dbw_key *key, const char* tchange, int step), time_t now)
 {
+    char buf[26];
     if (printheader) (*printheader)(sockfd);
     for (size_t k = 0; k < zone->key_count; k++) {
         struct dbw_key *key = zone->key[k];
         if (key->dirty == DBW_DELETE) continue;
-        char* tchange = map_keytime(key, now); /* allocs */
-            (*printkey)(sockfd, key, tchange, step);
-        free(tchange);
+        (*printkey)(sockfd, key, map_keytime(key, now, buf), step);
     }
 }
 
@@ -0,0 +1,552 @@
+/*
+ * Copyright (c) 2017 Stichting NLnet Labs
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <getopt.h>
+#include "config.h"
+
+#include "cmdhandler.h"
+#include "daemon/enforcercommands.h"
+#include "daemon/engine.h"
+#include "file.h"
+#include "log.h"
+#include "str.h"
+#include "clientpipe.h"
+#include "duration.h"
+#include "enforcer/enforcer.h"
+
+#include "enforcer/simulate_cmd.h"
+
+static const char *module_str = "simulate_cmd";
+
+#define MAX_ARGS 10
+/* Maximum number of enforce steps a zone may take without advancing the
+ * clock before we push it forward a minute, as the real scheduler would. */
+#define SIMULATE_MAX_SAMETIME 32
+#define SIMULATE_MAX_YEARS 50
+#define SIMULATE_TOP_DAYS 5
+
+static void
+usage(int sockfd)
+{
+    client_printf(sockfd,
+        "simulate\n"
+        "	[--zone <zonename>]	aka -z\n"
+        "	[--policy <policy>]	aka -p\n"
+        "	[--years <n>]		aka -y\n"
+        "	[--timeline]		aka -t\n");
+}
+
+static void
+help(int sockfd)
+{
+    client_printf(sockfd,
+        "Fast-forward the enforcer for all zones, without touching the database\n"
+        "or the HSM, and report rollovers, key generation demand and DS\n"
+        "submissions per month. DS changes are assumed to be confirmed\n"
+        "immediately.\n"
+        "\nOptions:\n"
+        "zone		Limit the simulation to this zone.\n"
+        "policy		Limit the simulation to zones of this policy.\n"
+        "years		Number of years to simulate, default 2.\n"
+        "timeline	Show every key event per zone, implied by --zone.\n"
+        "\n"
+    );
+}
+
+struct simulate_event {
+    time_t when;
+    struct dbw_zone *zone;
+};
+
+/** Binary min-heap of zones ordered by their next change. */
+struct simulate_queue {
+    struct simulate_event *ev;
+    size_t n;
+};
+
+static void
+queue_push(struct simulate_queue *q, time_t when, struct dbw_zone *zone)
+{
+    size_t i = q->n++;
+    while (i > 0) {
+        size_t p = (i - 1) / 2;
+        if (q->ev[p].when <= when) break;
+        q->ev[i] = q->ev[p];
+        i = p;
+    }
+    q->ev[i].when = when;
+    q->ev[i].zone = zone;
+}
+
+static struct simulate_event
+queue_pop(struct simulate_queue *q)
+{
+    struct simulate_event top = q->ev[0];
+    struct simulate_event last = q->ev[--q->n];
+    size_t i = 0;
+    for (;;) {
+        size_t c = 2*i + 1;
+        if (c >= q->n) break;
+        if (c+1 < q->n && q->ev[c+1].when < q->ev[c].when) c++;
+        if (last.when <= q->ev[c].when) break;
+        q->ev[i] = q->ev[c];
+        i = c;
+    }
+    if (q->n) q->ev[i] = last;
+    return top;
+}
+
+struct simulate_month {
+    int introduced[4]; /* indexed by key role */
+    int demand;
+    int generate;
+    int ds_submit;
+    int ds_retract;
+    int signconf;
+};
+
+struct simulate_state {
+    int sockfd;
+    int timeline;
+    time_t start;
+    int year0, month0;
+    int nmonths;
+    struct simulate_month *month;
+    int ndays;
+    int *ds_day;
+    /* Highest ID in use per table, new rows get IDs above these. */
+    int key_id, keystate_id, keydependency_id, hsmkey_id;
+    long steps;
+    /* Whether each key, by ID, was introducing after its zone's last step.
+     * Kept here since the enforcer uses key->scratch itself. */
+    char *introducing;
+    int nintroducing;
+};
+
+static int
+max_id(struct dbw_list *list)
+{
+    int id = 0;
+    for (size_t i = 0; i < list->n; i++) {
+        if (list->set[i]->id > id) id = list->set[i]->id;
+    }
+    return id;
+}
+
+static void
+set_introducing(struct simulate_state *st, struct dbw_key *key)
+{
+    if (key->id >= st->nintroducing) {
+        int n = key->id * 2 + 64;
+        CHECKALLOC(st->introducing = realloc(st->introducing, n));
+        memset(st->introducing + st->nintroducing, 0, n - st->nintroducing);
+        st->nintroducing = n;
+    }
+    st->introducing[key->id] = key->introducing;
+}
+
+static int
+was_introducing(struct simulate_state *st, struct dbw_key *key)
+{
+    return key->id < st->nintroducing && st->introducing[key->id];
+}
+
+static struct simulate_month *
+month_of(struct simulate_state *st, time_t t)
+{
+    struct tm tm;
+    if (!localtime_r(&t, &tm)) return &st->month[0];
+    int m = (tm.tm_year - st->year0) * 12 + tm.tm_mon - st->month0;
+    if (m < 0) m = 0;
+    if (m >= st->nmonths) m = st->nmonths - 1;
+    return &st->month[m];
+}
+
+static void
+event(struct simulate_state *st, struct dbw_zone *zone, time_t t,
+    char const *what, struct dbw_key *key)
+{
+    if (!st->timeline) return;
+    char tbuf[32];
+    struct tm tm;
+    if (!localtime_r(&t, &tm) || !strftime(tbuf, sizeof(tbuf), "%Y-%m-%d %H:%M", &tm))
+        tbuf[0] = 0;
+    if (key) {
+        client_printf(st->sockfd, "%s %s: %s %s\n", tbuf, zone->name, what,
+            dbw_enum2txt(dbw_key_role_txt, key->role));
+    } else {
+        client_printf(st->sockfd, "%s %s: %s\n", tbuf, zone->name, what);
+    }
+}
+
+/** Remove ptr from an array keeping the order of the remaining items. */
+static void
+unlink_ptr(void **set, int *count, void *ptr)
+{
+    for (int i = 0; i < *count; i++) {
+        if (set[i] != ptr) continue;
+        memmove(&set[i], &set[i+1], (*count - i - 1) * sizeof(void *));
+        (*count)--;
+        return;
+    }
+}
+
+/**
+ * Same purpose as the scrub after a look-ahead step, but only for the rows
+ * of a single zone. Deleted rows are unlinked from their parents but stay in
+ * the global lists until the snapshot is freed, new rows get an ID. This
+ * keeps each step proportional to the size of the zone rather than of the
+ * database.
+ */
+static void
+scrub_zone(struct simulate_state *st, struct dbw_zone *zone, time_t now)
+{
+    for (int d = 0; d < zone->keydependency_count;) {
+        struct dbw_keydependency *dep = zone->keydependency[d];
+        if (dep->dirty != DBW_DELETE) {
+            d++;
+            continue;
+        }
+        unlink_ptr((void **)dep->fromkey->from_keydependency,
+            &dep->fromkey->from_keydependency_count, dep);
+        unlink_ptr((void **)dep->tokey->to_keydependency,
+            &dep->tokey->to_keydependency_count, dep);
+        unlink_ptr((void **)zone->keydependency, &zone->keydependency_count, dep);
+    }
+    for (int k = 0; k < zone->key_count;) {
+        struct dbw_key *key = zone->key[k];
+        if (key->dirty != DBW_DELETE) {
+            k++;
+            continue;
+        }
+        struct dbw_hsmkey *hsmkey = key->hsmkey;
+        event(st, zone, now, "purge", key);
+        unlink_ptr((void **)hsmkey->key, &hsmkey->key_count, key);
+        if (hsmkey->dirty == DBW_DELETE) {
+            unlink_ptr((void **)hsmkey->policy->hsmkey,
+                &hsmkey->policy->hsmkey_count, hsmkey);
+        }
+        unlink_ptr((void **)zone->key, &zone->key_count, key);
+    }
+    for (int k = 0; k < zone->key_count; k++) {
+        struct dbw_key *key = zone->key[k];
+        if (key->dirty == DBW_INSERT) {
+            struct simulate_month *m = month_of(st, now);
+            struct dbw_hsmkey *hsmkey = key->hsmkey;
+            if (hsmkey->dirty == DBW_INSERT) {
+                struct dbw_policy *policy = hsmkey->policy;
+                hsmkey->id = ++st->hsmkey_id;
+                hsmkey->dirty = DBW_CLEAN;
+                m->demand++;
+                /* policy->scratch holds the pregenerated keys left */
+                if (policy->scratch > 0)
+                    policy->scratch--;
+                else
+                    m->generate++;
+            }
+            key->id = ++st->key_id;
+            key->hsmkey_id = hsmkey->id;
+            key->dirty = DBW_CLEAN;
+            m->introduced[key->role & DBW_CSK]++;
+            event(st, zone, now, "introduce", key);
+        } else if (was_introducing(st, key) && !key->introducing) {
+            event(st, zone, now, "retire", key);
+        }
+        set_introducing(st, key);
+        for (int s = 0; s < key->keystate_count; s++) {
+            struct dbw_keystate *keystate = key->keystate[s];
+            if (keystate->dirty != DBW_INSERT) continue;
+            keystate->id = ++st->keystate_id;
+            keystate->key_id = key->id;
+            keystate->dirty = DBW_CLEAN;
+        }
+    }
+    for (int d = 0; d < zone->keydependency_count; d++) {
+        struct dbw_keydependency *dep = zone->keydependency[d];
+        if (dep->dirty != DBW_INSERT) continue;
+        dep->id = ++st->keydependency_id;
+        dep->fromkey_id = dep->fromkey->id;
+        dep->tokey_id = dep->tokey->id;
+        dep->dirty = DBW_CLEAN;
+    }
+}
+
+/**
+ * Play the parent: every pending DS change is acknowledged right away.
+ * return 1 if anything changed and the zone must be enforced again.
+ */
+static int
+ds_exchange(struct simulate_state *st, struct dbw_zone *zone, time_t now)
+{
+    int changed = 0;
+    for (int k = 0; k < zone->key_count; k++) {
+        struct dbw_key *key = zone->key[k];
+        switch (key->ds_at_parent) {
+            case DBW_DS_AT_PARENT_SUBMIT:
+                key->ds_at_parent = DBW_DS_AT_PARENT_SUBMITTED;
+                month_of(st, now)->ds_submit++;
+                if (now >= st->start && (now - st->start) / 86400 < st->ndays)
+                    st->ds_day[(now - st->start) / 86400]++;
+                event(st, zone, now, "submit DS of", key);
+                break;
+            case DBW_DS_AT_PARENT_RETRACT:
+                key->ds_at_parent = DBW_DS_AT_PARENT_RETRACTED;
+                month_of(st, now)->ds_retract++;
+                event(st, zone, now, "retract DS of", key);
+                break;
+            case DBW_DS_AT_PARENT_SUBMITTED:
+                key->ds_at_parent = DBW_DS_AT_PARENT_SEEN;
+                break;
+            case DBW_DS_AT_PARENT_RETRACTED:
+                key->ds_at_parent = DBW_DS_AT_PARENT_UNSUBMITTED;
+                break;
+            default:
+                continue;
+        }
+        changed = 1;
+    }
+    return changed;
+}
+
+static void
+report(struct simulate_state *st, int nzones, int pool)
+{
+    int sockfd = st->sockfd;
+    char tbuf[32];
+    struct tm tm;
+    time_t end = st->start;
+
+    client_printf(sockfd, "\nSimulated %d zone(s) in %ld enforce steps, "
+        "%d pregenerated key(s) available.\n\n", nzones, st->steps, pool);
+    client_printf(sockfd,
+        "Month:   New KSK: New ZSK: New CSK: Keys used: To generate: "
+        "DS submit: DS retract: Signconf:\n");
+    for (int i = 0; i < st->nmonths; i++) {
+        struct simulate_month *m = &st->month[i];
+        int year = st->year0 + 1900 + (st->month0 + i) / 12;
+        int mon = (st->month0 + i) % 12 + 1;
+        client_printf(sockfd, "%04d-%02d %8d %8d %8d %10d %12d %10d %11d %9d\n",
+            year, mon, m->introduced[DBW_KSK], m->introduced[DBW_ZSK],
+            m->introduced[DBW_CSK], m->demand, m->generate, m->ds_submit,
+            m->ds_retract, m->signconf);
+    }
+
+    client_printf(sockfd, "\nBusiest days for DS submissions:\n");
+    for (int n = 0; n < SIMULATE_TOP_DAYS; n++) {
+        int best = -1;
+        for (int d = 0; d < st->ndays; d++) {
+            if (st->ds_day[d] > 0 && (best == -1 || st->ds_day[d] > st->ds_day[best]))
+                best = d;
+        }
+        if (best == -1) break;
+        end = st->start + (time_t)best * 86400;
+        if (!localtime_r(&end, &tm) || !strftime(tbuf, sizeof(tbuf), "%Y-%m-%d", &tm))
+            tbuf[0] = 0;
+        client_printf(sockfd, "%s %d\n", tbuf, st->ds_day[best]);
+        st->ds_day[best] = -st->ds_day[best]; /* exclude from next round */
+    }
+    for (int d = 0; d < st->ndays; d++) {
+        if (st->ds_day[d] < 0) st->ds_day[d] = -st->ds_day[d];
+    }
+}
+
+/**
+ * Handle the 'simulate' command.
+ *
+ */
+static int
+run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
+{
+    int argc = 0;
+    char const *argv[MAX_ARGS];
+    int long_index = 0, opt = 0;
+    char const *zonename = NULL;
+    char const *policyname = NULL;
+    int years = 2;
+    int timeline = 0;
+    db_connection_t* dbconn = getconnectioncontext(context);
+    engine_type* engine = getglobalcontext(context);
+
+    static struct option long_options[] = {
+        {"zone", required_argument, 0, 'z'},
+        {"policy", required_argument, 0, 'p'},
+        {"years", required_argument, 0, 'y'},
+        {"timeline", no_argument, 0, 't'},
+        {0, 0, 0, 0}
+    };
+
+    ods_log_debug("[%s] %s command", module_str, simulate_funcblock.cmdname);
+    if (!cmd) return -1;
+    argc = ods_str_explode(cmd, MAX_ARGS, argv);
+    if (argc == -1) {
+        client_printf_err(sockfd, "too many arguments\n");
+        return -1;
+    }
+
+    optind = 0;
+    while ((opt = getopt_long(argc, (char* const*)argv, "z:p:y:t", long_options, &long_index)) != -1) {
+        switch (opt) {
+            case 'z':
+                zonename = optarg;
+                break;
+            case 'p':
+                policyname = optarg;
+                break;
+            case 'y':
+                years = atoi(optarg);
+                break;
+            case 't':
+                timeline = 1;
+                break;
+            default:
+                client_printf_err(sockfd, "unknown arguments\n");
+                ods_log_error("[%s] unknown arguments for %s command",
+                    module_str, simulate_funcblock.cmdname);
+                return -1;
+        }
+    }
+    if (years < 1 || years > SIMULATE_MAX_YEARS) {
+        client_printf_err(sockfd, "--years must be between 1 and %d\n",
+            SIMULATE_MAX_YEARS);
+        return -1;
+    }
+    if (zonename) timeline = 1;
+
+    struct dbw_db *db = dbw_fetch(dbconn);
+    if (!db) return 1;
+    if (zonename && !dbw_get_zone(db, zonename)) {
+        client_printf_err(sockfd, "Could not find zone %s in database\n", zonename);
+        dbw_free(db);
+        return 1;
+    }
+    if (policyname && !dbw_get_policy(db, policyname)) {
+        client_printf_err(sockfd, "Could not find policy %s in database\n", policyname);
+        dbw_free(db);
+        return 1;
+    }
+
+    struct simulate_state st;
+    struct simulate_queue queue;
+    struct tm tm;
+    memset(&st, 0, sizeof(st));
+    st.sockfd = sockfd;
+    st.timeline = timeline;
+    st.start = time_now();
+    localtime_r(&st.start, &tm);
+    st.year0 = tm.tm_year;
+    st.month0 = tm.tm_mon;
+    st.nmonths = years * 12 + 1;
+    st.ndays = years * 366 + 1;
+    st.key_id = max_id(db->keys);
+    st.keystate_id = max_id(db->keystates);
+    st.keydependency_id = max_id(db->keydependencies);
+    st.hsmkey_id = max_id(db->hsmkeys);
+    st.month = calloc(st.nmonths, sizeof(struct simulate_month));
+    st.ds_day = calloc(st.ndays, sizeof(int));
+    queue.n = 0;
+    queue.ev = calloc(db->zones->n + 1, sizeof(struct simulate_event));
+    if (!st.month || !st.ds_day || !queue.ev) {
+        client_printf_err(sockfd, "memory allocation failed\n");
+        free(st.month);
+        free(st.ds_day);
+        free(queue.ev);
+        dbw_free(db);
+        return 1;
+    }
+    localtime_r(&st.start, &tm);
+    tm.tm_year += years;
+    time_t end = mktime(&tm);
+
+    int pool = 0;
+    for (size_t p = 0; p < db->policies->n; p++) {
+        struct dbw_policy *policy = (struct dbw_policy *)db->policies->set[p];
+        policy->scratch = 0;
+        if (policyname && strcmp(policy->name, policyname)) continue;
+        for (int h = 0; h < policy->hsmkey_count; h++) {
+            if (policy->hsmkey[h]->state == DBW_HSMKEY_UNUSED)
+                policy->scratch++;
+        }
+        pool += policy->scratch;
+    }
+
+    int nzones = 0;
+    for (size_t z = 0; z < db->zones->n; z++) {
+        struct dbw_zone *zone = (struct dbw_zone *)db->zones->set[z];
+        if (zonename && strcmp(zone->name, zonename)) continue;
+        if (policyname && strcmp(zone->policy->name, policyname)) continue;
+        if (zone->policy->passthrough) continue;
+        for (int k = 0; k < zone->key_count; k++)
+            set_introducing(&st, zone->key[k]);
+        zone->scratch = 0;
+        time_t t = zone->next_change;
+        if (t < st.start) t = st.start;
+        queue_push(&queue, t, zone);
+        nzones++;
+    }
+
+    while (queue.n) {
+        struct simulate_event ev = queue_pop(&queue);
+        struct dbw_zone *zone = ev.zone;
+        time_t now = ev.when;
+        if (now > end) break;
+
+        int zone_updated = 0;
+        time_t t_next = update_mockup(engine, db, zone, now, &zone_updated);
+        st.steps++;
+        scrub_zone(&st, zone, now);
+        if (ds_exchange(&st, zone, now)) t_next = now;
+        if (zone->signconf_needs_writing) {
+            zone->signconf_needs_writing = 0;
+            month_of(&st, now)->signconf++;
+        }
+        zone->next_change = t_next;
+        if (t_next == -1) continue; /* nothing to be done ever */
+        if (t_next <= now) {
+            t_next = now;
+            if (++zone->scratch >= SIMULATE_MAX_SAMETIME) {
+                t_next = now + 60;
+                zone->scratch = 0;
+            }
+        } else {
+            zone->scratch = 0;
+        }
+        queue_push(&queue, t_next, zone);
+    }
+
+    report(&st, nzones, pool);
+    free(st.introducing);
+    free(st.month);
+    free(st.ds_day);
+    free(queue.ev);
+    /* Nothing in the snapshot is ever committed. */
+    dbw_free(db);
+    return 0;
+}
+
+struct cmd_func_block simulate_funcblock = {
+    "simulate", &usage, &help, NULL, &run
+};
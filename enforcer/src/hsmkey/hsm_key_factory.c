@@ -42,13 +42,19 @@
 
 #include "hsmkey/hsm_key_factory.h"
 
-/* List of database ID's of recently assigned non-shared hsmkeys. So we can
- * avoid races assigning the same key twice. This avoids backoffs.
- * For shared keys this problem isn't as pronounced since they will generally
- * not need a completely new key */
-#define RU_COUNT 8
-static int ru_nonshared_keys[RU_COUNT];
-static int ru_index;
+/* Database ID's of unused hsmkeys per policy key and repository, in the
+ * order they are handed out. A pool is refilled from the caller's view of
+ * the database when it runs dry and every key is claimed in the database
+ * before it is used, so concurrent enforcers never get the same key whatever
+ * their view of the database. */
+struct key_pool {
+    int policykey_id;
+    char *repository;
+    int *hsmkey_id;
+    size_t count;   /* ids in the pool */
+    size_t first;   /* next id to hand out */
+    struct key_pool *next;
+};
 
 struct __hsm_key_factory_task {
     engine_type* engine;
@@ -68,14 +74,17 @@ struct generate_request {
 static pthread_once_t __hsm_key_factory_once = PTHREAD_ONCE_INIT;
 static pthread_mutex_t* __hsm_key_factory_lock = NULL;
 static struct generate_request *genq = NULL;
+static struct key_pool *pools = NULL;
+/* Ids of the keys claimed by this process that no commit settled yet. The
+ * reclaim sweep leaves these alone, they may be about to get their key. */
+static int *claims = NULL;
+static size_t claim_count = 0;
 
 static void hsm_key_factory_init(void)
 {
     pthread_mutexattr_t attr;
-    for (int i = 0; i < RU_COUNT; i++)
-        ru_nonshared_keys[i] = -1;
-    ru_index = 0;
     genq = NULL;
+    pools = NULL;
 
     if (!__hsm_key_factory_lock) {
         if (!(__hsm_key_factory_lock = calloc(1, sizeof(pthread_mutex_t)))
@@ -96,6 +105,16 @@ static void hsm_key_factory_init(void)
 
 void hsm_key_factory_deinit(void)
 {
+    free(claims);
+    claims = NULL;
+    claim_count = 0;
+    while (pools) {
+        struct key_pool *pool = pools;
+        pools = pool->next;
+        free(pool->repository);
+        free(pool->hsmkey_id);
+        free(pool);
+    }
     if (__hsm_key_factory_lock) {
         (void)pthread_mutex_destroy(__hsm_key_factory_lock);
         free(__hsm_key_factory_lock);
@@ -167,6 +186,38 @@ genq_exists(const char *zonename)
     return exists;
 }
 
+/* Remember a claim in progress. Factory lock must be held. */
+static int
+claim_add(int id)
+{
+    int *ids = realloc(claims, (claim_count + 1) * sizeof (int));
+    if (!ids) return 1;
+    claims = ids;
+    claims[claim_count++] = id;
+    return 0;
+}
+
+/* Forget a claim in progress. Factory lock must be held. */
+static void
+claim_del(int id)
+{
+    for (size_t c = 0; c < claim_count; c++) {
+        if (claims[c] != id) continue;
+        claims[c] = claims[--claim_count];
+        return;
+    }
+}
+
+/* 1 if a claim on id is in progress. Factory lock must be held. */
+static int
+claim_has(int id)
+{
+    for (size_t c = 0; c < claim_count; c++) {
+        if (claims[c] == id) return 1;
+    }
+    return 0;
+}
+
 /* 1 if hsmkey and policykey match AND hsmkey is unused. */
 static int
 hsmkey_matches_policykey(struct dbw_hsmkey *hsmkey, struct dbw_policykey *policykey)
@@ -322,6 +373,44 @@ unassigned_key_count(struct dbw_policykey *pkey)
     return count;
 }
 
+/* Put keys back that are claimed but that no key refers to. A claim is
+ * written as soon as a key is allocated, a crash or a commit that failed
+ * half way leaves it behind. */
+static void
+reclaim_keys(struct dbw_db *db)
+{
+    int reclaimed = 0;
+    pthread_once(&__hsm_key_factory_once, hsm_key_factory_init);
+    for (size_t h = 0; h < db->hsmkeys->n; h++) {
+        struct dbw_hsmkey *hsmkey = (struct dbw_hsmkey *)db->hsmkeys->set[h];
+        if (hsmkey->state != DBW_HSMKEY_PRIVATE
+            && hsmkey->state != DBW_HSMKEY_SHARED)
+        {
+            continue;
+        }
+        if (hsmkey->key_count > 0) continue;
+        /* Our view may be old, ask the database whether it is still unused
+         * while no claim can settle. */
+        (void) pthread_mutex_lock(__hsm_key_factory_lock);
+            if (!claim_has(hsmkey->id)
+                && dbw_hsmkey_key_count(db, hsmkey) == 0
+                && !dbw_hsmkey_swap_state(db, hsmkey, hsmkey->state, DBW_HSMKEY_UNUSED))
+            {
+                ods_log_info("[hsm_key_factory_reclaim] key %s was claimed "
+                    "but never used, made available again", hsmkey->locator);
+                reclaimed++;
+            }
+        (void) pthread_mutex_unlock(__hsm_key_factory_lock);
+    }
+    if (reclaimed) {
+        /* Let the pools find them at their next refill. */
+        (void) pthread_mutex_lock(__hsm_key_factory_lock);
+            for (struct key_pool *pool = pools; pool; pool = pool->next)
+                pool->first = pool->count;
+        (void) pthread_mutex_unlock(__hsm_key_factory_lock);
+    }
+}
+
 static time_t
 generate_cb(task_type* task, char const *owner, void *userdata,
     void *context)
@@ -331,6 +420,8 @@ generate_cb(task_type* task, char const *owner, void *userdata,
     if (!db) return schedule_DEFER;
     engine_type* engine = userdata;
 
+    reclaim_keys(db);
+
     int duration_time = engine->config->automatic_keygen_duration;
 
     while (genq) {
@@ -409,13 +500,69 @@ hsm_key_factory_schedule(engine_type *engine, int id, int count)
     schedule_generate(engine);
 }
 
-static int
-in_lru(int id)
+void
+hsm_key_factory_schedule_reclaim(engine_type *engine)
+{
+    schedule_generate(engine);
+}
+
+/* Pool of policykey, created if needed. Factory lock must be held. */
+static struct key_pool *
+pool_get(struct dbw_policykey *pkey)
 {
-    for (int i = 0; i < RU_COUNT; i++) {
-        if (ru_nonshared_keys[i] == id) return 1;
+    struct key_pool *pool;
+    for (pool = pools; pool; pool = pool->next) {
+        if (pool->policykey_id == pkey->id
+            && !strcmp(pool->repository, pkey->repository))
+        {
+            return pool;
+        }
     }
-    return 0;
+    if (!(pool = calloc(1, sizeof (struct key_pool)))) return NULL;
+    if (!(pool->repository = strdup(pkey->repository))) {
+        free(pool);
+        return NULL;
+    }
+    pool->policykey_id = pkey->id;
+    pool->next = pools;
+    pools = pool;
+    return pool;
+}
+
+/* Refill pool with the unused keys of pkey. Factory lock must be held. */
+static void
+pool_fill(struct key_pool *pool, struct dbw_policykey *pkey)
+{
+    struct dbw_policy *policy = pkey->policy;
+    int *ids = realloc(pool->hsmkey_id, (policy->hsmkey_count + 1) * sizeof (int));
+    if (!ids) return;
+    pool->hsmkey_id = ids;
+    pool->count = 0;
+    pool->first = 0;
+    for (size_t h = 0; h < policy->hsmkey_count; h++) {
+        struct dbw_hsmkey *hsmkey = policy->hsmkey[h];
+        if (hsmkey->id && hsmkey_matches_policykey(hsmkey, pkey))
+            ids[pool->count++] = hsmkey->id;
+    }
+}
+
+/* Take the next key id from the pool of pkey, 0 if there is none. The pool
+ * is refilled once if *refill is set. */
+static int
+pool_take(struct dbw_policykey *pkey, int *refill)
+{
+    int id = 0;
+    pthread_once(&__hsm_key_factory_once, hsm_key_factory_init);
+    (void) pthread_mutex_lock(__hsm_key_factory_lock);
+        struct key_pool *pool = pool_get(pkey);
+        if (pool && pool->first == pool->count && *refill) {
+            pool_fill(pool, pkey);
+            *refill = 0;
+        }
+        if (pool && pool->first < pool->count)
+            id = pool->hsmkey_id[pool->first++];
+    (void) pthread_mutex_unlock(__hsm_key_factory_lock);
+    return id;
 }
 
 struct dbw_hsmkey *
@@ -423,36 +570,50 @@ hsm_key_factory_get_key(engine_type *engine, struct dbw_db *db,
     struct dbw_policykey *pkey, struct dbw_zone *zone)
 {
     struct dbw_policy *policy = pkey->policy;
+    int state = policy->keys_shared? DBW_HSMKEY_SHARED : DBW_HSMKEY_PRIVATE;
+    struct dbw_hsmkey *hkey = NULL;
+    int refill = 1;
+    int error = 0;
+    int id;
     ods_log_debug("[hsm_key_factory_get_key] get %s key",
         (policy->keys_shared ?  "shared" : "private"));
 
-    /* Get a list of unused HSM keys matching our requirements */
-    pthread_once(&__hsm_key_factory_once, hsm_key_factory_init);
-    (void) pthread_mutex_lock(__hsm_key_factory_lock);
-        struct dbw_hsmkey *hkey = NULL;
-        for (size_t h = 0; h < policy->hsmkey_count; h++) {
-            struct dbw_hsmkey *hsmkey = policy->hsmkey[h];
-            if (hsmkey->state != DBW_HSMKEY_UNUSED) continue;
-            if (hsmkey->bits != pkey->bits) continue;
-            if (hsmkey->algorithm != pkey->algorithm) continue;
-            if (hsmkey->role != pkey->role) continue;
-            if (hsmkey->is_revoked != 0) continue;
-            if (strcmp(hsmkey->repository, pkey->repository)) continue;
-            /* we have found an available hsmkey */
-            /* did anyone else grab it? */
-            if (!policy->keys_shared && in_lru(hsmkey->id)) {
-                continue;
+    while (!hkey && !error && (id = pool_take(pkey, &refill))) {
+        struct dbw_hsmkey *hsmkey = dbw_get_hsmkey_by_id(db, id);
+        /* Taken or gone as far as we can tell, drop it from the pool. */
+        if (!hsmkey || !hsmkey_matches_policykey(hsmkey, pkey)) continue;
+        /* Claim the key now, rather than when db is committed. The claim
+         * is known to be in progress before it shows in the database. */
+        (void) pthread_mutex_lock(__hsm_key_factory_lock);
+            if (claim_add(id)) {
+                (void) pthread_mutex_unlock(__hsm_key_factory_lock);
+                error = 1;
+                break;
             }
-            hkey = hsmkey;
-            ru_nonshared_keys[(++ru_index) % RU_COUNT] = hsmkey->id;
-            break;
+        (void) pthread_mutex_unlock(__hsm_key_factory_lock);
+        switch (dbw_hsmkey_swap_state(db, hsmkey, DBW_HSMKEY_UNUSED, state)) {
+            case 0:
+                hkey = hsmkey;
+                hkey->scratch = state;
+                break;
+            case 1:
+                ods_log_debug("[hsm_key_factory_get_key] key %s already "
+                    "taken", hsmkey->locator);
+                break;
+            default:
+                ods_log_error("[hsm_key_factory_get_key] unable to claim "
+                    "key %s", hsmkey->locator);
+                error = 1;
         }
-        /* Slowly clear out the list when no key is found. */
-        if (!hkey) ru_nonshared_keys[(++ru_index) % RU_COUNT] = -1;
-    (void) pthread_mutex_unlock(__hsm_key_factory_lock);
-     /* If there are no keys returned in the list we schedule generation and
+        if (!hkey) {
+            (void) pthread_mutex_lock(__hsm_key_factory_lock);
+                claim_del(id);
+            (void) pthread_mutex_unlock(__hsm_key_factory_lock);
+        }
+    }
+     /* If there are no keys available we schedule generation and
       * return NULL */
-    if (!hkey) {
+    if (!hkey && !error) {
         ods_log_warning("[hsm_key_factory_get_key] no keys available");
         if (!engine->config->manual_keygen) {
             if (!policy->keys_shared) {
@@ -462,10 +623,7 @@ hsm_key_factory_get_key(engine_type *engine, struct dbw_db *db,
             }
             schedule_generate(engine);
         }
-    } else {
-         /*Update the state of the returned HSM key*/
-        hkey->state = policy->keys_shared? DBW_HSMKEY_SHARED : DBW_HSMKEY_PRIVATE;
-        dbw_mark_dirty((struct dbrow *)hkey);
+    } else if (hkey) {
         ods_log_debug("[hsm_key_factory_get_key] key allocated");
     }
     if (!engine->config->manual_keygen)
@@ -473,6 +631,63 @@ hsm_key_factory_get_key(engine_type *engine, struct dbw_db *db,
     return hkey;
 }
 
+/* 1 if hsmkey was claimed through db and the claim is not settled. */
+static int
+claimed(struct dbw_hsmkey *hsmkey)
+{
+    return hsmkey->scratch == DBW_HSMKEY_PRIVATE
+        || hsmkey->scratch == DBW_HSMKEY_SHARED;
+}
+
+/* Settle the claim on hsmkey. */
+static void
+settle_key(struct dbw_hsmkey *hsmkey)
+{
+    (void) pthread_mutex_lock(__hsm_key_factory_lock);
+        claim_del(hsmkey->id);
+    (void) pthread_mutex_unlock(__hsm_key_factory_lock);
+    hsmkey->scratch = 0;
+}
+
+void
+hsm_key_factory_return_key(struct dbw_db *db, struct dbw_hsmkey *hsmkey)
+{
+    if (!claimed(hsmkey)) {
+        hsm_key_factory_release_key(hsmkey, NULL);
+        return;
+    }
+    /* Released again, it may be gone from the HSM already. */
+    if (hsmkey->state != DBW_HSMKEY_DELETE) {
+        /* The pool picks it up again when it is refilled. */
+        if (dbw_hsmkey_swap_state(db, hsmkey, hsmkey->scratch, DBW_HSMKEY_UNUSED)) {
+            /* Left to the reclaim sweep. */
+            ods_log_error("[hsm_key_factory_return_keys] unable to return "
+                "key %s", hsmkey->locator);
+        }
+    }
+    settle_key(hsmkey);
+}
+
+void
+hsm_key_factory_return_keys(struct dbw_db *db)
+{
+    for (size_t h = 0; h < db->hsmkeys->n; h++) {
+        struct dbw_hsmkey *hsmkey = (struct dbw_hsmkey *)db->hsmkeys->set[h];
+        if (claimed(hsmkey))
+            hsm_key_factory_return_key(db, hsmkey);
+    }
+}
+
+void
+hsm_key_factory_settle_keys(struct dbw_db *db)
+{
+    for (size_t h = 0; h < db->hsmkeys->n; h++) {
+        struct dbw_hsmkey *hsmkey = (struct dbw_hsmkey *)db->hsmkeys->set[h];
+        if (claimed(hsmkey))
+            settle_key(hsmkey);
+    }
+}
+
 void
 hsm_key_factory_release_key_mockup(struct dbw_hsmkey *hsmkey, struct dbw_key *key, int mockup)
 {
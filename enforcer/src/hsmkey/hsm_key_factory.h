@@ -39,6 +39,15 @@ extern void hsm_key_factory_deinit(void);
 extern void
 hsm_key_factory_schedule(engine_type *engine, int id, int count);
 
+/**
+ * Schedule the key factory to put back HSM keys that are claimed but that no
+ * key refers to, as left behind by a crash or a partially written commit.
+ * The key factory task does so every time it runs.
+ * \param[in] engine an engine_type.
+ */
+extern void
+hsm_key_factory_schedule_reclaim(engine_type *engine);
+
 /**
  * Allocate a private or shared HSM key for the policy key provided. This will
  * also schedule a task for generating more keys if needed.
@@ -54,6 +63,36 @@ extern struct dbw_hsmkey *
 hsm_key_factory_get_key(engine_type *engine, struct dbw_db *db,
     struct dbw_policykey *pkey, struct dbw_zone *zone);
 
+/**
+ * Give back a HSM key allocated in db that will not be used after all. A key
+ * that was not claimed through db, such as a reused shared key, is released
+ * instead.
+ * \param[in] db the database the key was allocated in.
+ * \param[in] hsmkey the key.
+ */
+extern void
+hsm_key_factory_return_key(struct dbw_db *db, struct dbw_hsmkey *hsmkey);
+
+/**
+ * Give back the HSM keys allocated in db, when dbw_commit() returned
+ * DBW_COMMIT_STALE and none of its changes were written. Keys are claimed in
+ * the database as soon as they are allocated. After any other failure key
+ * rows may already refer to them and they must not be returned, the reclaim
+ * sweep of the key factory puts back those that ended up unused.
+ * \param[in] db the database the keys were allocated in.
+ */
+extern void
+hsm_key_factory_return_keys(struct dbw_db *db);
+
+/**
+ * Mark the claims on HSM keys allocated in db as settled, once db was
+ * committed or its commit failed. Until then the reclaim sweep leaves them
+ * alone.
+ * \param[in] db the database the keys were allocated in.
+ */
+extern void
+hsm_key_factory_settle_keys(struct dbw_db *db);
+
 /**
  * Release a key, if its not used anymore it will be marked DELETE.
  * \param[in] key
@@ -60,14 +60,13 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
     engine_type* engine = getglobalcontext(context);
     (void) cmd;
 
-    struct dbw_db *db = dbw_fetch(dbconn);
+    struct dbw_db *db = dbw_fetch_hsmkeys(dbconn, DBW_HSMKEY_UNUSED);
     if (!db) return 1;
 
     for (size_t p = 0; p < db->policies->n; p++) {
         struct dbw_policy *policy = (struct dbw_policy *)db->policies->set[p];
         for (size_t hk = 0; hk < policy->hsmkey_count; hk++) {
             struct dbw_hsmkey *hsmkey = policy->hsmkey[hk];
-            if (hsmkey->state != DBW_HSMKEY_UNUSED) continue;
             client_printf(sockfd, "%s;%s;%s;%d;%d;%s\n", hsmkey->locator,
                     hsmkey->repository, policy->name, hsmkey->bits,
                     hsmkey->algorithm, dbw_enum2txt(dbw_key_role_txt, hsmkey->role));
@@ -148,19 +148,30 @@ print_ds_from_id(int sockfd, struct dbw_key *key, int bind_style, int print_sha1
     return 0;
 }
 
+struct keystate_export_arg {
+    int sockfd;
+    int role;
+    const char *keystate;
+    const char *cka_id;
+    int bind_style;
+    int print_sha1;
+};
+
 static int
-perform_keystate_export(int sockfd, struct dbw_zone *zone, int role,
-    const char *keystate, const struct dbw_hsmkey *hsmkey, int bind_style,
-    int print_sha1)
+perform_keystate_export(struct dbw_db *db, struct dbw_zone *zone, void *arg)
 {
-    int keys_exported = 0;
+    struct keystate_export_arg *export_arg = (struct keystate_export_arg *)arg;
+    int role = export_arg->role;
+    const char *keystate = export_arg->keystate;
+    const char *cka_id = export_arg->cka_id;
+    (void)db;
+
     for (size_t k = 0; k < zone->key_count; k++) {
         struct dbw_key *key = zone->key[k];
-        if (role != -1 && key->role != role) continue;
         if (keystate && strcasecmp(map_keystate(key), keystate)) continue;
-        if (hsmkey && key->hsmkey != hsmkey) continue;
+        if (cka_id && strcmp(key->hsmkey->locator, cka_id)) continue;
         /* Don't export keys in stable DS states unless explicitly asked. */
-        if (role == -1 && !keystate && !hsmkey &&
+        if (role == -1 && !keystate && !cka_id &&
               key->ds_at_parent != DBW_DS_AT_PARENT_SUBMIT &&
               key->ds_at_parent != DBW_DS_AT_PARENT_SUBMITTED &&
               key->ds_at_parent != DBW_DS_AT_PARENT_RETRACT   &&
@@ -168,14 +179,15 @@ perform_keystate_export(int sockfd, struct dbw_zone *zone, int role,
         {
             continue;
         }
-        if (print_ds_from_id(sockfd, key, bind_style, print_sha1)) {
+        if (print_ds_from_id(export_arg->sockfd, key, export_arg->bind_style,
+                export_arg->print_sha1))
+        {
             ods_log_error("[%s] Error in print_ds_from_id", module_str);
-            client_printf_err(sockfd, "Error in print_ds_from_id \n");
-            return 1;
+            client_printf_err(export_arg->sockfd, "Error in print_ds_from_id \n");
+            return 0;
         }
-        keys_exported++;
     }
-    return !keys_exported;
+    return 0;
 }
 
 static void
@@ -218,8 +230,6 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
     const char* keytype = NULL;
     const char* keystate = NULL;
     const char* cka_id = NULL;
-    zone_db_t * zone = NULL;
-    struct dbw_hsmkey *hsmkey = NULL;
     int all = 0;
     int ds = 0;
     int bsha1 = 0;
@@ -311,24 +321,22 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
         return -1;
     }
 
-    struct dbw_db *db = dbw_fetch(dbconn);
-    if (!db) return -1;
-
-    if (cka_id && !(hsmkey = dbw_get_hsmkey(db, cka_id))) {
-        ods_log_error("[%s] CKA_ID %s can not be found!", module_str, cka_id);
-        client_printf_err(sockfd, "CKA_ID %s can not be found!\n", cka_id);
-        return -1;
+    if (cka_id) {
+        hsm_key_t *hsmkey = hsm_key_new_get_by_locator(dbconn, cka_id);
+        if (!hsmkey) {
+            ods_log_error("[%s] CKA_ID %s can not be found!", module_str, cka_id);
+            client_printf_err(sockfd, "CKA_ID %s can not be found!\n", cka_id);
+            return -1;
+        }
+        hsm_key_free(hsmkey);
     }
 
-    int r = 0;
-    int exports = 0;
-    for (size_t z = 0; z < db->zones->n; z++) {
-        struct dbw_zone *zone = (struct dbw_zone *)db->zones->set[z];
-        if (zonename && strcmp(zonename, zone->name)) continue;
-        r |= perform_keystate_export(sockfd, zone, keytype_int, keystate, hsmkey, ds, bsha1);
-        exports++;
-    }
-    dbw_free(db);
+    struct dbw_filter filter = {zonename, NULL, keytype_int == -1 ? 0 : keytype_int};
+    struct keystate_export_arg arg = {sockfd, keytype_int, keystate, cka_id,
+        ds, bsha1};
+    int exports = dbw_foreach_zone(dbconn, &filter,
+        DBW_F_KEY|DBW_F_KEYSTATE|DBW_F_HSMKEY, perform_keystate_export, &arg);
+    if (exports == -1) return 1;
     if (zonename && !exports) {
         ods_log_error("[%s] Unknown zone: %s", module_str, zonename);
         client_printf_err(sockfd, "Unknown zone: %s\n", zonename);
@@ -130,88 +130,85 @@ map_keystate(struct dbw_key *key)
     }
 }
 
-/** Time of next transition. Caller responsible for freeing ret
- * @param zone: zone key belongs to
+/** Time of next transition.
  * @param key: key to evaluate
- * @return: human readable transition time/event */
-char*
-map_keytime(const struct dbw_key *key, time_t now)
+ * @param now: current time
+ * @param buf: scratch space of at least 26 bytes
+ * @return: human readable transition time/event, either buf or a constant */
+const char*
+map_keytime(const struct dbw_key *key, time_t now, char *buf)
 {
-	char ct[26];
 	struct tm srtm;
 	time_t t;
 
 	switch(key->ds_at_parent) {
 		case KEY_DATA_DS_AT_PARENT_SUBMIT:
-			return strdup("waiting for ds-submit");
+			return "waiting for ds-submit";
 		case KEY_DATA_DS_AT_PARENT_SUBMITTED:
-			return strdup("waiting for ds-seen");
+			return "waiting for ds-seen";
 		case KEY_DATA_DS_AT_PARENT_RETRACT:
-			return strdup("waiting for ds-retract");
+			return "waiting for ds-retract";
 		case KEY_DATA_DS_AT_PARENT_RETRACTED:
-			return strdup("waiting for ds-gone");
+			return "waiting for ds-gone";
                 default:
 			break;
 	}
 	if (key->zone->next_change < 0)
-		return strdup("-");
+		return "-";
 	else if (key->zone->next_change < now)
-		return strdup("now");
+		return "now";
 
 	t = (time_t)key->zone->next_change;
 	localtime_r(&t, &srtm);
-	strftime(ct, 26, "%Y-%m-%d %H:%M:%S", &srtm);
-	return strdup(ct);
+	strftime(buf, 26, "%Y-%m-%d %H:%M:%S", &srtm);
+	return buf;
 }
 
-static void
-print_sorted_keys(int sockfd, int keyrole, const char *keystate, struct dbw_zone *zone, void (printkey)(int sockfd, struct dbw_key *key, char *tchange))
+struct keystate_list_arg {
+    int sockfd;
+    const char *keystate;
+    time_t now;
+    void (*printkey)(int sockfd, struct dbw_key *key, const char *tchange);
+};
+
+static int
+print_sorted_keys(struct dbw_db *db, struct dbw_zone *zone, void *arg)
 {
+    struct keystate_list_arg *list_arg = (struct keystate_list_arg *)arg;
+    char buf[26];
+    (void)db;
+
     sort_keys((const struct dbw_key **)zone->key, zone->key_count);
     for (size_t k = 0; k < zone->key_count; k++) {
         struct dbw_key *key = zone->key[k];
-        if (keyrole && key->role != keyrole) continue;
-        if (keystate && strcasecmp(map_keystate(key), keystate)) continue;
-        char* tchange = map_keytime(key, time_now()); /* allocs */
-        (*printkey)(sockfd, key, tchange);
-        free(tchange);
+        if (list_arg->keystate && strcasecmp(map_keystate(key), list_arg->keystate))
+            continue;
+        (*list_arg->printkey)(list_arg->sockfd, key,
+            map_keytime(key, list_arg->now, buf));
     }
-
+    return 0;
 }
 
 static int
 perform_keystate_list(int sockfd, db_connection_t *dbconn, const char* zonename,
-    int keyrole, const char* keystate, void (printheader)(int sockfd),
-    void (printkey)(int sockfd, struct dbw_key *key, char* tchange))
+    const char *policyname, int keyrole, const char* keystate,
+    void (printheader)(int sockfd),
+    void (printkey)(int sockfd, struct dbw_key *key, const char* tchange))
 {
-    struct dbw_db *db = dbw_fetch(dbconn);
-    if (!db) {
+    struct dbw_filter filter = {zonename, policyname, keyrole};
+    struct keystate_list_arg arg = {sockfd, keystate, time_now(), printkey};
+    int zones;
+
+    if (printheader) (*printheader)(sockfd);
+    zones = dbw_foreach_zone(dbconn, &filter,
+        DBW_F_KEY|DBW_F_KEYSTATE|DBW_F_HSMKEY, print_sorted_keys, &arg);
+    if (zones == -1) {
         client_printf_err(sockfd, "Unable to get list of keys, memory "
             "allocation or database error!\n");
         return 1;
     }
-    if (printheader) (*printheader)(sockfd);
-
-    if (zonename) {
-        struct dbw_zone *zone = dbw_get_zone(db, zonename);
-        if (zone)
-            print_sorted_keys(sockfd, keyrole, keystate, zone, printkey);
-        else
-            client_printf_err(sockfd, "Unable to get zone %s from database!\n", zonename);
-    }
-    else {
-        sort_policies((const struct dbw_policy **)db->policies->set, db->policies->n);
-
-        for (size_t i = 0; i < db->policies->n; i++) {
-            struct dbw_policy *policy = (struct dbw_policy *) db->policies->set[i];
-            sort_zones((const struct dbw_zone **)policy->zone, policy->zone_count);
-            for (size_t z = 0; z < policy->zone_count; z++) {
-                struct dbw_zone *zone = policy->zone[z];
-                print_sorted_keys(sockfd, keyrole, keystate, zone, printkey);
-            }
-        }
-    }
-    dbw_free(db);
+    if (zonename && !zones)
+        client_printf_err(sockfd, "Unable to get zone %s from database!\n", zonename);
     return 0;
 }
 
@@ -225,6 +222,7 @@ usage(int sockfd)
 		"	[--full]				aka -f\n"
 		"	[--parsable]				aka -p\n"
 		"	[--zone]				aka -z  \n"
+		"	[--policy]				aka -P  \n"
                 "	[--keytype]				aka -t  \n"
 		"	[--keystate | --all]			aka -k | -a  \n"
 	);
@@ -241,6 +239,7 @@ help(int sockfd)
 		"full		print information about the keystate and keytags\n"
 		"parsable	output machine parsable list\n"
 		"zone		limit the output to the specific zone\n"
+		"policy		limit the output to the zones of the specific policy\n"
 		"keytype	limit the output to the given type, can be ZSK, KSK, or CSK\n"
 		"keystate	limit the output to the given state\n"
 		"all		print keys in all states (including generate) \n\n");
@@ -255,7 +254,7 @@ printcompatheader(int sockfd)
 }
 
 static void
-printcompatkey(int sockfd, struct dbw_key * key, char* tchange)
+printcompatkey(int sockfd, struct dbw_key * key, const char* tchange)
 {
     client_printf(sockfd,
         "%-31s %-8s %-9s %s\n",
@@ -275,7 +274,7 @@ printverboseheader(int sockfd)
 }
 
 static void
-printverbosekey(int sockfd, struct dbw_key * key, char* tchange)
+printverbosekey(int sockfd, struct dbw_key * key, const char* tchange)
 {
     (void)tchange;
     client_printf(sockfd,
@@ -311,7 +310,7 @@ printFullkey(int sockfd, zone_db_t* zone, key_data_t* key, char* tchange, hsm_ke
 }
 
 static void
-printverboseparsablekey(int sockfd, zone_db_t* zone, struct dbw_key* key, char* tchange, hsm_key_t* hsmkey) {
+printverboseparsablekey(int sockfd, struct dbw_key* key, const char* tchange) {
     client_printf(sockfd,
         "%s;%s;%s;%s;%d;%d;%s;%s;%d\n",
         key->zone->name,
@@ -350,13 +349,13 @@ printdebugkey_fmt(int sockfd, char const *fmt, struct dbw_key *key, char const
 }
 
 static void
-printdebugkey(int sockfd, struct dbw_key *key, char *tchange)
+printdebugkey(int sockfd, struct dbw_key *key, const char *tchange)
 {
     printdebugkey_fmt(sockfd, "%-31s %-13s %-12s %-12s %-12s %-12s %d %4d    %s\n", key, tchange);
 }
 
 static void
-printdebugparsablekey(int sockfd, struct dbw_key *key, char *tchange)
+printdebugparsablekey(int sockfd, struct dbw_key *key, const char *tchange)
 {
     printdebugkey_fmt(sockfd, "%s;%s;%s;%s;%s;%s;%d;%d;%s\n", key, tchange);
 }
@@ -364,7 +363,7 @@ printdebugparsablekey(int sockfd, struct dbw_key *key, char *tchange)
 static int
 run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
 {
-    #define NARGV 12
+    #define NARGV 14
     const char *argv[NARGV];
     int success, argIndex;
     int argc = 0, bVerbose = 0, bDebug = 0, bFull = 0, bParsable = 0, bAll = 0;
@@ -372,6 +371,7 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
     const char* keytype = NULL;
     const char* keystate = NULL;
     const char* zonename = NULL;
+    const char* policyname = NULL;
     db_connection_t* dbconn = getconnectioncontext(context);
 
     static struct option long_options[] = {
@@ -380,6 +380,7 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
         {"full", no_argument, 0, 'f'},
         {"parsable", no_argument, 0, 'p'},
         {"zone", required_argument, 0, 'z'},
+        {"policy", required_argument, 0, 'P'},
         {"keytype", required_argument, 0, 't'},
         {"keystate", required_argument, 0, 'e'},
         {"all", no_argument, 0, 'a'},
@@ -397,7 +398,7 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
         return -1;
     }
     optind = 0;
-    while ((opt = getopt_long(argc, (char* const*)argv, "vdfpz:t:e:a", long_options, &long_index) ) != -1) {
+    while ((opt = getopt_long(argc, (char* const*)argv, "vdfpz:P:t:e:a", long_options, &long_index) ) != -1) {
         switch (opt) {
             case 'v':
                 bVerbose = 1;
@@ -414,6 +415,9 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
             case 'z':
                 zonename = optarg;
                 break;
+            case 'P':
+                policyname = optarg;
+                break;
             case 't':
                 keytype = optarg;
                 break;
@@ -452,27 +456,27 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
     }
 
     if (bFull) {
-        success = perform_keystate_list(sockfd, dbconn, zonename, keytype, keystate, NULL, &printFullkey);
+        success = perform_keystate_list(sockfd, dbconn, zonename, policyname, keytype, keystate, NULL, &printFullkey);
     } else if (bDebug) {
         if (bParsable) {
-            success = perform_keystate_list(sockfd, dbconn, zonename, keyrole,
+            success = perform_keystate_list(sockfd, dbconn, zonename, policyname, keyrole,
                 keystate, NULL, &printdebugparsablekey);
         } else {
-            success = perform_keystate_list(sockfd, dbconn, zonename, keyrole,
+            success = perform_keystate_list(sockfd, dbconn, zonename, policyname, keyrole,
                 keystate, &printdebugheader, &printdebugkey);
         }
     } else if (bVerbose) {
         if (bParsable) {
-            success = perform_keystate_list(sockfd, dbconn, zonename, keyrole,
+            success = perform_keystate_list(sockfd, dbconn, zonename, policyname, keyrole,
                 keystate, NULL, &printverboseparsablekey);
         } else {
-            success = perform_keystate_list(sockfd, dbconn, zonename, keyrole,
+            success = perform_keystate_list(sockfd, dbconn, zonename, policyname, keyrole,
                 keystate, &printverboseheader, &printverbosekey);
         }
     } else {
         if (bParsable)
             client_printf_err(sockfd, "-p option only available in combination with -v and -d.\n");
-        success = perform_keystate_list(sockfd, dbconn, zonename, keyrole,
+        success = perform_keystate_list(sockfd, dbconn, zonename, policyname, keyrole,
             keystate, &printcompatheader, &printcompatkey);
     }
     return success;
@@ -37,7 +37,7 @@ extern struct cmd_func_block key_list_funcblock;
 extern const char*
 map_keystate(struct dbw_key *key);
 
-extern char*
-map_keytime(const struct dbw_key *key, time_t now);
+extern const char*
+map_keytime(const struct dbw_key *key, time_t now, char *buf);
 
 #endif /* _KEYSTATE_LIST_CMD_H_ */
@@ -44,55 +44,63 @@
 static const char *module_str = "rollover_list_cmd";
 
 /**
- * Time of next transition. Caller responsible for freeing ret
+ * Time of next transition.
  * \param zone: zone key belongs to
  * \param key: key to evaluate
- * \return: human readable transition time/event
+ * \param buf: scratch space of at least 26 bytes
+ * \return: human readable transition time/event, either buf or a constant
  */
-static char*
-map_keytime(const struct dbw_zone *zone, const struct dbw_key *key)
+static const char*
+map_keytime(const struct dbw_zone *zone, const struct dbw_key *key, char *buf)
 {
     time_t t = 0;
-    char ct[26];
     struct tm srtm;
 
     switch(key->ds_at_parent) {
         case KEY_DATA_DS_AT_PARENT_SUBMIT:
-            return strdup("waiting for ds-submit");
+            return "waiting for ds-submit";
         case KEY_DATA_DS_AT_PARENT_SUBMITTED:
-            return strdup("waiting for ds-seen");
+            return "waiting for ds-seen";
         case KEY_DATA_DS_AT_PARENT_RETRACT:
-            return strdup("waiting for ds-retract");
+            return "waiting for ds-retract";
         case KEY_DATA_DS_AT_PARENT_RETRACTED:
-            return strdup("waiting for ds-gone");
+            return "waiting for ds-gone";
     }
 
     switch (key->role) {
         case KEY_DATA_ROLE_KSK: t = zone->next_ksk_roll; break;
         case KEY_DATA_ROLE_ZSK: t = zone->next_zsk_roll; break;
         case KEY_DATA_ROLE_CSK: t = zone->next_csk_roll; break;
-        default: return strdup("No roll scheduled");
+        default: return "No roll scheduled";
     }
 
     localtime_r(&t, &srtm);
-    strftime(ct, 26, "%Y-%m-%d %H:%M:%S", &srtm);
-    return strdup(ct);
+    strftime(buf, 26, "%Y-%m-%d %H:%M:%S", &srtm);
+    return buf;
 }
 
-static void
-print_key(int sockfd, const char* fmt, const struct dbw_key *key)
+static const char *fmt = "%-31s %-8s %-30s\n";
+
+static int
+print_keys(struct dbw_db *db, struct dbw_zone *zone, void *arg)
 {
+    int sockfd = *(int *)arg;
     const char *role;
-    switch (key->role) {
-        case KEY_DATA_ROLE_KSK: role = "KSK"; break;
-        case KEY_DATA_ROLE_ZSK: role = "ZSK"; break;
-        case KEY_DATA_ROLE_CSK: role = "CSK"; break;
-        default:
-            assert(0);
+    char buf[26];
+    (void)db;
+
+    for (size_t k = 0; k < zone->key_count; k++) {
+        struct dbw_key *key = zone->key[k];
+        switch (key->role) {
+            case KEY_DATA_ROLE_KSK: role = "KSK"; break;
+            case KEY_DATA_ROLE_ZSK: role = "ZSK"; break;
+            case KEY_DATA_ROLE_CSK: role = "CSK"; break;
+            default:
+                assert(0);
+        }
+        client_printf(sockfd, fmt, zone->name, role, map_keytime(zone, key, buf));
     }
-    char *tchange = map_keytime(key->zone, key);
-    client_printf(sockfd, fmt, key->zone->name, role, tchange);
-    free(tchange);
+    return 0;
 }
 
 /**
@@ -107,32 +115,16 @@ static int
 perform_rollover_list(int sockfd, const char *listed_zone,
     db_connection_t *dbconn)
 {
-    struct dbw_list *keys;
-    const char* fmt = "%-31s %-8s %-30s\n";
+    struct dbw_filter filter = {listed_zone, NULL, 0};
 
-    struct dbw_db *db = dbw_fetch(dbconn);
-    /*struct dbw_list *policies = dbw_policies_all_filtered(dbconn, NULL, listed_zone, 0);*/
+    client_printf(sockfd, "Keys:\n");
+    client_printf(sockfd, fmt, "Zone:", "Keytype:", "Rollover expected:");
 
-    if (!db) {
+    if (dbw_foreach_zone(dbconn, &filter, DBW_F_KEY, print_keys, &sockfd) == -1) {
         ods_log_error("[%s] error enumerating rollovers", module_str);
         client_printf(sockfd, "error enumerating rollovers\n");
         return 1;
     }
-    client_printf(sockfd, "Keys:\n");
-    client_printf(sockfd, fmt, "Zone:", "Keytype:", "Rollover expected:");
-
-    for (size_t p = 0; p < db->policies->n; p++) {
-        struct dbw_policy *policy = (struct dbw_policy *)db->policies->set[p];
-        for (size_t z = 0; z < policy->zone_count; z++) {
-            struct dbw_zone *zone = policy->zone[z];
-            if (listed_zone && strcmp(listed_zone, zone->name)) continue;
-            for (size_t k = 0; k < zone->key_count; k++) {
-                struct dbw_key *key = zone->key[k];
-                print_key(sockfd, fmt, key);
-            }
-        }
-    }
-    dbw_free(db);
     return 0;
 }
 
@@ -262,8 +262,9 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
     zone->signconf_path = strdup(signconf);
     zone->next_change = suspend?-1:0;
 
-    /* This should yield a single policy w/o zones */
-    struct dbw_db *db = dbw_fetch(dbconn);
+    /* Only the policies are needed, adding a zone must not cost more as
+     * more zones exist. */
+    struct dbw_db *db = dbw_fetch_filtered(dbconn, DBW_F_POLICY);
     if (!db) {
         client_printf_err(sockfd, "Error reading database\n");
         dbw_zone_free((struct dbrow *)zone);
@@ -303,7 +304,7 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
 
     if (snprintf(path_input, PATH_MAX, "%s/%s", engine->config->working_dir_enforcer,
         OPENDNSSEC_ENFORCER_ZONELIST) >= (int)sizeof(path_input)
-        || zonelist_update_add(sockfd, path_input, zone, policy_name, 0) != ZONELIST_UPDATE_OK)
+        || zonelist_journal_add(sockfd, dbconn, path_input, zone, policy_name) != ZONELIST_UPDATE_OK)
     {
         ods_log_error("[%s] internal zonelist update failed", module_str);
         client_printf_err(sockfd, "Unable to update the internal zonelist %s,"
@@ -37,6 +37,7 @@
 #include "clientpipe.h"
 #include "db/dbw.h"
 #include "hsmkey/hsm_key_factory.h"
+#include "enforcer/enforce_task.h"
 #include "keystate/zonelist_update.h"
 #include "keystate/zonelist_export.h"
 
@@ -69,7 +70,7 @@ help(int sockfd)
 }
 
 static int
-delete_zone(struct dbw_zone *zone)
+delete_zone(struct dbw_db *db, struct dbw_zone *zone, int partial)
 {
     /*
      * Get key data for the zone and for each key data get the key state
@@ -90,7 +91,10 @@ delete_zone(struct dbw_zone *zone)
             to_dep->dirty = DBW_DELETE;
         }
         struct dbw_hsmkey *hsmkey = key->hsmkey;
-        hsm_key_factory_release_key(hsmkey, key);
+        /* A single zone fetch does not hold the keys of other zones
+         * sharing this hsmkey, ask the database. */
+        if (!partial || dbw_hsmkey_key_count(db, hsmkey) == hsmkey->key_count)
+            hsm_key_factory_release_key(hsmkey, key);
         key->dirty = DBW_DELETE;
     }
     zone->dirty = DBW_DELETE;
@@ -154,7 +158,8 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
        return -1;
     }
 
-    struct dbw_db *db = dbw_fetch(dbconn);
+    struct dbw_db *db = all ? dbw_fetch(dbconn)
+        : dbw_fetch_zone_by_name(dbconn, zonename, DBW_F_ALL);
     if (!db) {
         client_printf(sockfd, "Error reading database.\n");
         return 1;
@@ -163,7 +168,7 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
     for (size_t z = 0; z < db->zones->n; z++) {
         struct dbw_zone *zone = (struct dbw_zone *)db->zones->set[z];
         if (!all && strcmp(zonename, zone->name)) continue;
-        if (delete_zone(zone)) {
+        if (delete_zone(db, zone, !all)) {
             client_printf(sockfd, "Error deleting zone %s.\n", zone->name);
             dbw_free(db);
             ret = 1;
@@ -179,6 +184,7 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
 
         /* Delete all 'zone' related tasks */
         schedule_purge_owner(engine->taskq, TASK_CLASS_ENFORCER, zone->name);
+        enforce_task_catchup_done(zone->name);
         ods_log_info("[%s] zone %s deleted", module_str, zone->name);
         client_printf(sockfd, "Deleted zone %s successfully\n", zone->name);
     }
@@ -207,7 +213,8 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
     }
 
     if (snprintf(path, sizeof(path), "%s/%s", engine->config->working_dir_enforcer, OPENDNSSEC_ENFORCER_ZONELIST) >= (int)sizeof(path)
-        || zonelist_export(sockfd, dbconn, path, 0) != ZONELIST_EXPORT_OK)
+        || (all ? zonelist_export(sockfd, dbconn, path, 0) != ZONELIST_EXPORT_OK
+            : zonelist_journal_delete(sockfd, dbconn, path, zonename) != ZONELIST_UPDATE_OK))
     {
         ods_log_error("[%s] internal zonelist update failed", module_str);
         client_printf_err(sockfd, "Unable to update the internal zonelist %s, updates will not reach the Signer!\n", path);
@@ -43,8 +43,10 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
 
-int zonelist_export(int sockfd, db_connection_t* dbconn, const char* filename, int comment) {
+static int zonelist_export_file(int sockfd, db_connection_t* dbconn, const char* filename, int comment) {
     xmlDocPtr doc;
     xmlNodePtr root = NULL, node, node2, node3, node4;
     char path[PATH_MAX];
@@ -171,3 +173,29 @@ int zonelist_export(int sockfd, db_connection_t* dbconn, const char* filename, i
 
     return ZONELIST_EXPORT_OK;
 }
+
+int zonelist_export(int sockfd, db_connection_t* dbconn, const char* filename, int comment) {
+    char path[PATH_MAX];
+    int journalfd = -1;
+    int ret;
+
+    /* Single zone changes since the last export may be journaled next to
+     * the file. Hold the journal while exporting, no change committed
+     * meanwhile is lost and the export holds all of them afterwards. */
+    if (filename && snprintf(path, sizeof(path), "%s.journal", filename) < (int)sizeof(path)) {
+        journalfd = open(path, O_RDWR);
+    }
+    if (journalfd != -1 && flock(journalfd, LOCK_EX)) {
+        close(journalfd);
+        journalfd = -1;
+    }
+    ret = zonelist_export_file(sockfd, dbconn, filename, comment);
+    if (journalfd != -1) {
+        if (ret == ZONELIST_EXPORT_OK && ftruncate(journalfd, 0)) {
+            ods_log_error("[zonelist_export] unable to truncate %s: %s", path, strerror(errno));
+        }
+        (void)flock(journalfd, LOCK_UN);
+        close(journalfd);
+    }
+    return ret;
+}
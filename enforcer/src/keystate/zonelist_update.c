@@ -26,6 +26,8 @@
  *
  */
 
+#include "config.h"
+
 #include "log.h"
 #include "str.h"
 #include "utils/kc_helper.h"
@@ -33,13 +35,22 @@
 #include "clientpipe.h"
 
 #include "keystate/zonelist_update.h"
+#include "keystate/zonelist_export.h"
 
 #include <libxml/parser.h>
 #include <libxml/tree.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+/* journal is compacted into the zonelist once it outgrows both */
+#define ZONELIST_JOURNAL_MIN 65536
 
 static int zonelist_update(int add, int sockfd, const char* filename,
         const struct dbw_zone *zone, const char *policyname, int comment)
@@ -231,3 +242,99 @@ int zonelist_update_delete(int sockfd, const char* filename,
 {
     return zonelist_update(0, sockfd, filename, zone, policyname, comment);
 }
+
+/* Fields are separated by tabs and entries by newlines, anything else can
+ * only be written with a full export. */
+static int journal_safe(const char* str)
+{
+    return str && !strpbrk(str, "\t\n");
+}
+
+static int zonelist_journal(int sockfd, db_connection_t* dbconn,
+        const char* filename, const char* entry)
+{
+    char path[PATH_MAX];
+    struct stat jst, zst;
+    ssize_t len = strlen(entry);
+    int fd, compact;
+
+    if (access(filename, F_OK)) {
+        /* nothing to journal against yet, write it in full */
+        return zonelist_export(sockfd, dbconn, filename, 0) == ZONELIST_EXPORT_OK
+            ? ZONELIST_UPDATE_OK : ZONELIST_UPDATE_ERR_FILE;
+    }
+    if (snprintf(path, sizeof(path), "%s.journal", filename) >= (int)sizeof(path)) {
+        client_printf_err(sockfd, "Unable to write zonelist journal, path to long!\n");
+        return ZONELIST_UPDATE_ERR_MEMORY;
+    }
+    if ((fd = open(path, O_WRONLY|O_APPEND|O_CREAT, 0644)) == -1) {
+        client_printf_err(sockfd, "Unable to open zonelist journal %s: %s\n", path, strerror(errno));
+        return ZONELIST_UPDATE_ERR_FILE;
+    }
+    if (flock(fd, LOCK_EX) || write(fd, entry, len) != len || fstat(fd, &jst)) {
+        client_printf_err(sockfd, "Unable to write zonelist journal %s: %s\n", path, strerror(errno));
+        close(fd);
+        return ZONELIST_UPDATE_ERR_FILE;
+    }
+    compact = jst.st_size > ZONELIST_JOURNAL_MIN
+        && (stat(filename, &zst) || jst.st_size > zst.st_size);
+    close(fd);
+
+    /* keeps the cost of compaction proportional to the entries journaled */
+    if (compact && zonelist_export(sockfd, dbconn, filename, 0) != ZONELIST_EXPORT_OK) {
+        ods_log_warning("[zonelist_journal] unable to compact %s, journal kept", path);
+    }
+    return ZONELIST_UPDATE_OK;
+}
+
+int zonelist_journal_add(int sockfd, db_connection_t* dbconn,
+        const char* filename, const struct dbw_zone* zone, const char *policyname)
+{
+    char* entry;
+    int ret;
+
+    if (!dbconn || !filename || !zone) {
+        return ZONELIST_UPDATE_ERR_ARGS;
+    }
+    if (!journal_safe(zone->name) || !journal_safe(policyname)
+        || !journal_safe(zone->signconf_path)
+        || !journal_safe(zone->input_adapter_type) || !journal_safe(zone->input_adapter_uri)
+        || !journal_safe(zone->output_adapter_type) || !journal_safe(zone->output_adapter_uri))
+    {
+        return zonelist_export(sockfd, dbconn, filename, 0) == ZONELIST_EXPORT_OK
+            ? ZONELIST_UPDATE_OK : ZONELIST_UPDATE_ERR_FILE;
+    }
+    if (asprintf(&entry, "add\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n", zone->name,
+        policyname, zone->signconf_path, zone->input_adapter_type,
+        zone->input_adapter_uri, zone->output_adapter_type,
+        zone->output_adapter_uri) < 0)
+    {
+        client_printf_err(sockfd, "Unable to write zonelist journal, memory allocation error!\n");
+        return ZONELIST_UPDATE_ERR_MEMORY;
+    }
+    ret = zonelist_journal(sockfd, dbconn, filename, entry);
+    free(entry);
+    return ret;
+}
+
+int zonelist_journal_delete(int sockfd, db_connection_t* dbconn,
+        const char* filename, const char* zonename)
+{
+    char* entry;
+    int ret;
+
+    if (!dbconn || !filename || !zonename) {
+        return ZONELIST_UPDATE_ERR_ARGS;
+    }
+    if (!journal_safe(zonename)) {
+        return zonelist_export(sockfd, dbconn, filename, 0) == ZONELIST_EXPORT_OK
+            ? ZONELIST_UPDATE_OK : ZONELIST_UPDATE_ERR_FILE;
+    }
+    if (asprintf(&entry, "delete\t%s\n", zonename) < 0) {
+        client_printf_err(sockfd, "Unable to write zonelist journal, memory allocation error!\n");
+        return ZONELIST_UPDATE_ERR_MEMORY;
+    }
+    ret = zonelist_journal(sockfd, dbconn, filename, entry);
+    free(entry);
+    return ret;
+}
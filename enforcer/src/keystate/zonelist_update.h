@@ -77,4 +77,31 @@ extern int zonelist_update_add(int sockfd, const char* filename,
  */
 extern int zonelist_update_delete(int sockfd, const char* filename,
        const struct dbw_zone* zone, const char *policyname, int comment);
+
+/**
+ * Record the addition of a zone in the journal next to a zonelist,
+ * without reading or rewriting the zonelist itself. The zone must be
+ * committed to the database already. Once the journal outgrows the
+ * zonelist both are compacted by a full export from the database.
+ * \param[in] sockfd socket fd.
+ * \param[in] dbconn database connection, used when compacting.
+ * \param[in] filename the zonelist filename the journal belongs to.
+ * \param[in] zone the zone added.
+ * \param[in] policyname name of the policy of the zone.
+ * \return ZONELIST_UPDATE_ERR_* on error otherwise ZONELIST_UPDATE_OK.
+ */
+extern int zonelist_journal_add(int sockfd, db_connection_t* dbconn,
+       const char* filename, const struct dbw_zone* zone, const char *policyname);
+
+/**
+ * Record the removal of a zone in the journal next to a zonelist, see
+ * zonelist_journal_add().
+ * \param[in] sockfd socket fd.
+ * \param[in] dbconn database connection, used when compacting.
+ * \param[in] filename the zonelist filename the journal belongs to.
+ * \param[in] zonename name of the zone removed.
+ * \return ZONELIST_UPDATE_ERR_* on error otherwise ZONELIST_UPDATE_OK.
+ */
+extern int zonelist_journal_delete(int sockfd, db_connection_t* dbconn,
+       const char* filename, const char* zonename);
 #endif /* _KEYSTATE_ZONELIST_UPDATE_H_ */
@@ -78,6 +78,9 @@ usage(char* argv0, FILE* out)
     fprintf(out, "\nSupported options:\n");
     fprintf(out, " -h | --help             Show this help and exit.\n");
     fprintf(out, " -V | --version          Show version and exit.\n");
+    fprintf(out, " -f | --file <file>      Run the commands in file, one per line,\n"
+        "    |    over a single connection. Stop at the first failing\n"
+        "    |    command. Use - for stdin.\n");
     fprintf(out, " -s | --socket <file>    Daemon socketfile \n"
         "    |    (default %s).\n", OPENDNSSEC_ENFORCER_SOCKETFILE);
 
@@ -186,10 +189,11 @@ extract_msg(char* buf, int *pos, int buflen, int *exitcode, int sockfd)
  * \param cmd: command to exec, NULL for interactive mode.
  * \param servsock_filename: name of pipe to connect to daemon. Must 
  *        not be NULL.
+ * \param batch: commands to run one per line, NULL otherwise.
  * \return exit code for client
  */
 static int
-interface_start(const char* cmd, const char* servsock_filename)
+interface_start(const char* cmd, const char* servsock_filename, FILE* batch)
 {
     struct sockaddr_un servaddr;
     fd_set rset;
@@ -248,8 +252,21 @@ interface_start(const char* cmd, const char* servsock_filename)
     /* If we have a cmd send it to the daemon, otherwise display a
      * prompt */
     if (cmd) client_stdin(sockfd, cmd, strlen(cmd)+1);
+
+    userbuf[0] = 0;
     do {
-        if (!cmd) {
+        if (batch) {
+            /* One command per line, skip blank lines and comments */
+            if (!fgets(userbuf, ODS_SE_MAXLINE, batch)) break;
+            ods_str_trim(userbuf, 0);
+            if (userbuf[0] == '\0' || userbuf[0] == '#') continue;
+            if (strcmp(userbuf, "exit") == 0 || strcmp(userbuf, "quit") == 0)
+                break;
+            if (!client_stdin(sockfd, userbuf, strlen(userbuf))) {
+                error = 205;
+                break;
+            }
+        } else if (!cmd) {
 #ifdef HAVE_READLINE
             char *icmd_ptr;
             if ((icmd_ptr = readline(PROMPT)) == NULL) { /* eof */
@@ -327,7 +344,7 @@ interface_start(const char* cmd, const char* servsock_filename)
                     error = 208;
                     break;
                 } else if (r == 1) {
-                    if (cmd) 
+                    if (cmd || batch)
                         error = exitcode;
                     else if (strlen(userbuf) != 0)
                         /* we are interactive so print response.
@@ -375,9 +392,12 @@ main(int argc, char* argv[])
     char* argv0;
     char* cmd = NULL;
     char const *socketfile = OPENDNSSEC_ENFORCER_SOCKETFILE;
+    char const *batchfile = NULL;
+    FILE* batch = NULL;
     int error, c, options_index = 0;
     static struct option long_options[] = {
         {"help", no_argument, 0, 'h'},
+        {"file", required_argument, 0, 'f'},
         {"socket", required_argument, 0, 's'},
         {"version", no_argument, 0, 'V'},
         { 0, 0, 0, 0}
@@ -394,12 +414,15 @@ main(int argc, char* argv[])
      * to stop parsing when an unknown command is found not starting 
      * with '-'. This is important for us, else switches inside commands
      * would be consumed by getopt. */
-    while ((c=getopt_long(argc, argv, "+hVs:",
+    while ((c=getopt_long(argc, argv, "+hVf:s:",
         long_options, &options_index)) != -1) {
         switch (c) {
             case 'h':
                 usage(argv0, stdout);
                 exit(0);
+            case 'f':
+                batchfile = optarg;
+                break;
             case 's':
                 socketfile = optarg;
                 printf("sock set to %s\n", socketfile);
@@ -420,9 +443,22 @@ main(int argc, char* argv[])
         fprintf(stderr, "Enforcer socket file not set.\n");
         return 101;
     }
+    if (batchfile) {
+        if (argc != 0) {
+            fprintf(stderr, "--file can not be combined with a command\n");
+            return 100;
+        }
+        batch = strcmp(batchfile, "-") ? fopen(batchfile, "r") : stdin;
+        if (!batch) {
+            fprintf(stderr, "Unable to open %s: %s\n", batchfile,
+                strerror(errno));
+            return 102;
+        }
+    }
     if (argc != 0) 
         cmd = ods_strcat_delim(argc, argv, ' ');
-    error = interface_start(cmd, socketfile);
+    error = interface_start(cmd, socketfile, batch);
+    if (batch && batch != stdin) fclose(batch);
     free(cmd);
     return error;
 }
@@ -133,6 +133,8 @@ perform_policy_resalt(task_type* task, char const *policyname, void *userdata,
     policy->denial_salt = strdup(salthex);
     policy->denial_salt_last_change = now;
     dbw_mark_dirty((struct dbrow *)policy);
+    /* Zones pick up the new salt gradually, each as its staggered signconf
+     * task comes due. resalt_task_schedule catches up after a restart. */
 
     if (policy->denial_resalt <= 0)
         resalt_time = -1;
@@ -142,7 +144,8 @@ perform_policy_resalt(task_type* task, char const *policyname, void *userdata,
     if (r) {
         ods_log_error("[%s] unable to update DB", module_str);
     } else {
-        signconf_task_flush_policy(engine, dbconn, policy->name);
+        signconf_task_stagger_policy(engine, policy,
+            policy->denial_resalt > 0 ? policy->denial_resalt / 2 : 0);
         ods_log_debug("[%s] policy %s resalted successfully", module_str, policyname);
     }
     dbw_free(db);
@@ -199,6 +202,9 @@ resalt_task_schedule(engine_type *engine, db_connection_t *dbconn)
         time_t resalt_time = policy->denial_salt_last_change + policy->denial_resalt;
         task = policy_resalt_task(policy->name, engine, resalt_time);
         status |= schedule_task(engine->taskq, task, 1, 0);
+        /* Zones still waiting for the last salt when we were stopped. */
+        signconf_task_stagger_policy(engine, policy,
+            policy->denial_resalt > 0 ? policy->denial_resalt / 2 : 0);
     }
     dbw_free(db);
     return status;
@@ -102,6 +102,54 @@ signconf_task_flush_policy(engine_type *engine, db_connection_t *dbconn,
     dbw_free(db);
 }
 
+void
+signconf_task_stagger_policy(engine_type *engine, struct dbw_policy *policy,
+    time_t window)
+{
+    int concurrency = engine->config->resalt_concurrency;
+    size_t batches, pending = 0;
+    time_t step, now = time_now();
+    task_type* task;
+    char *stale;
+
+    /* Zones record which salt their signconf carries, those with the
+     * current one are done. The signconf task forces the write, so
+     * nothing is marked in the database until a zone's slot comes due. */
+    CHECKALLOC(stale = calloc(policy->zone_count + 1, 1));
+    for (size_t z = 0; z < (size_t)policy->zone_count; z++) {
+        struct dbw_zone *zone = policy->zone[z];
+        if (zone->denial_salt_published < policy->denial_salt_last_change) {
+            stale[z] = 1;
+            pending++;
+        }
+    }
+    /* After a restart only what is left of the window remains */
+    window -= now - policy->denial_salt_last_change;
+    if (window < 0) window = 0;
+    if (concurrency <= 0 || pending <= (size_t)concurrency) {
+        batches = 1;
+    } else {
+        batches = (pending + concurrency - 1) / concurrency;
+    }
+    step = window / (time_t)batches;
+    if (step < 1) step = 1;
+    for (size_t z = 0, n = 0; z < (size_t)policy->zone_count; z++) {
+        struct dbw_zone *zone = policy->zone[z];
+        if (!stale[z]) continue;
+        task = task_create(strdup(zone->name), TASK_CLASS_ENFORCER,
+            TASK_TYPE_SIGNCONF, perform, NULL, NULL,
+            now + (batches > 1 ? (time_t)(n / concurrency) * step : 0));
+        (void) schedule_task(engine->taskq, task, 1, 0);
+        n++;
+    }
+    free(stale);
+    if (batches > 1) {
+        ods_log_info("[%s] signconf of %zu zones of policy %s staggered in "
+            "%zu steps of %ld seconds", module_str, pending,
+            policy->name, batches, (long)step);
+    }
+}
+
 void
 signconf_task_flush_all(engine_type *engine, db_connection_t *dbconn)
 {
@@ -39,6 +39,13 @@ extern void signconf_task_flush_zone(engine_type *engine, db_connection_t *dbcon
 extern void signconf_task_flush_policy(engine_type *engine, db_connection_t *dbconn,
     char const *policyname);
 
+/* Schedule signconf tasks for the zones of policy whose signconf does not
+ * carry the last salt yet, at most ResaltConcurrency zones at a time with
+ * the steps spread evenly over what is left of window seconds since the
+ * salt changed. */
+extern void signconf_task_stagger_policy(engine_type *engine,
+    struct dbw_policy *policy, time_t window);
+
 extern void signconf_task_flush_all(engine_type *engine, db_connection_t *dbconn);
 
 #endif
@@ -302,6 +302,7 @@ signconf_xml_export(int sockfd, struct dbw_zone *zone, int force)
     }
 
     zone->signconf_needs_writing = 0;
+    zone->denial_salt_published = policy->denial_salt_last_change;
     dbw_mark_dirty((struct dbrow *)zone);
 
     return SIGNCONF_EXPORT_OK;
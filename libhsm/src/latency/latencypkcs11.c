@@ -0,0 +1,454 @@
+/*
+ * Copyright (c) 2018 NLNet Labs.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Latency injecting PKCS#11 test module.
+ *
+ * This is a drop-in PKCS#11 library that forwards every call to a real
+ * (software) PKCS#11 library, by default SoftHSMv2, while behaving like a
+ * remote network HSM.  It can be configured as the Module of a
+ * Repository in conf.xml, so that ods-hsmspeed, the signertest and both
+ * daemons can be benchmarked under realistic HSM behaviour.
+ *
+ * The behaviour is controlled through environment variables, all of
+ * them optional:
+ *
+ *   PKCS11LATENCY_MODULE         the wrapped PKCS#11 library
+ *   PKCS11LATENCY_DELAY          latency added to every call, in usec
+ *   PKCS11LATENCY_SIGNDELAY      additional latency of a sign, in usec
+ *   PKCS11LATENCY_KEYGENDELAY    additional latency of a key generation
+ *   PKCS11LATENCY_JITTER         maximum random deviation of the above
+ *   PKCS11LATENCY_MAXSESSIONS    number of sessions that may be open
+ *   PKCS11LATENCY_MAXCONCURRENT  calls processed at the same time, any
+ *                                further calls queue up
+ *   PKCS11LATENCY_FAILURERATE    fraction (0.0 - 1.0) of sign and key
+ *                                generation calls failing with
+ *                                CKR_DEVICE_ERROR
+ *   PKCS11LATENCY_SEED           seed for reproducible jitter and failures
+ */
+
+#define _GNU_SOURCE
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <syslog.h>
+
+#include "pkcs11.h"
+
+#ifndef PKCS11LATENCY_DEFAULT_MODULE
+#define PKCS11LATENCY_DEFAULT_MODULE "libsofthsm2.so"
+#endif
+
+static CK_FUNCTION_LIST definition;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+
+static void* libraryReference = NULL;
+static CK_FUNCTION_LIST_PTR libraryTable = NULL;
+
+static struct configuration_struct {
+    long delay;
+    long signdelay;
+    long keygendelay;
+    long jitter;
+    long maxsessions;
+    long maxconcurrent;
+    double failurerate;
+    unsigned int seed;
+} configuration;
+
+static struct statistics_struct {
+    long sessions;
+    long concurrent;
+    unsigned long calls;
+    unsigned long queued;
+    unsigned long failures;
+    unsigned long refusedsessions;
+} statistics;
+
+static long
+getenvlong(const char* name, long defaultvalue)
+{
+    const char* value = getenv(name);
+    char* end;
+    long result;
+    if (value == NULL || *value == '\0')
+        return defaultvalue;
+    result = strtol(value, &end, 10);
+    if (*end != '\0' || result < 0) {
+        syslog(LOG_DAEMON|LOG_ERR, "pkcs11latency: ignoring bad value for %s", name);
+        return defaultvalue;
+    }
+    return result;
+}
+
+static void
+configure(void)
+{
+    const char* value;
+    configuration.delay = getenvlong("PKCS11LATENCY_DELAY", 0);
+    configuration.signdelay = getenvlong("PKCS11LATENCY_SIGNDELAY", 0);
+    configuration.keygendelay = getenvlong("PKCS11LATENCY_KEYGENDELAY", 0);
+    configuration.jitter = getenvlong("PKCS11LATENCY_JITTER", 0);
+    configuration.maxsessions = getenvlong("PKCS11LATENCY_MAXSESSIONS", 0);
+    configuration.maxconcurrent = getenvlong("PKCS11LATENCY_MAXCONCURRENT", 0);
+    configuration.seed = getenvlong("PKCS11LATENCY_SEED", time(NULL));
+    configuration.failurerate = 0.0;
+    if ((value = getenv("PKCS11LATENCY_FAILURERATE")) != NULL) {
+        configuration.failurerate = strtod(value, NULL);
+        if (configuration.failurerate < 0.0 || configuration.failurerate > 1.0) {
+            syslog(LOG_DAEMON|LOG_ERR, "pkcs11latency: ignoring bad value for PKCS11LATENCY_FAILURERATE");
+            configuration.failurerate = 0.0;
+        }
+    }
+}
+
+/* Must be called with the lock held, as rand_r state is shared. */
+static long
+randomjitter(void)
+{
+    if (configuration.jitter <= 0)
+        return 0;
+    return (long)(rand_r(&configuration.seed) % (2 * configuration.jitter + 1)) - configuration.jitter;
+}
+
+/* Must be called with the lock held. */
+static int
+randomfailure(void)
+{
+    if (configuration.failurerate <= 0.0)
+        return 0;
+    return rand_r(&configuration.seed) < configuration.failurerate * ((double)RAND_MAX + 1.0);
+}
+
+static void
+sleepmicroseconds(long usec)
+{
+    struct timespec duration;
+    if (usec <= 0)
+        return;
+    duration.tv_sec = usec / 1000000;
+    duration.tv_nsec = (usec % 1000000) * 1000;
+    while (nanosleep(&duration, &duration) < 0 && errno == EINTR)
+        ;
+}
+
+/**
+ * Claim one of the concurrent processing slots of the simulated HSM and
+ * wait for the configured latency.  Returns CKR_DEVICE_ERROR when a
+ * failure should be injected, in which case the call must not be
+ * forwarded.  A successful enter must always be followed by a leave.
+ */
+static CK_RV
+enter(long extradelay, int mayfail)
+{
+    long delay;
+    int fail;
+    pthread_mutex_lock(&lock);
+    if (configuration.maxconcurrent > 0 && statistics.concurrent >= configuration.maxconcurrent) {
+        statistics.queued++;
+        while (statistics.concurrent >= configuration.maxconcurrent)
+            pthread_cond_wait(&cond, &lock);
+    }
+    statistics.concurrent++;
+    statistics.calls++;
+    delay = configuration.delay + extradelay + randomjitter();
+    fail = (mayfail ? randomfailure() : 0);
+    if (fail)
+        statistics.failures++;
+    pthread_mutex_unlock(&lock);
+    sleepmicroseconds(delay);
+    return (fail ? CKR_DEVICE_ERROR : CKR_OK);
+}
+
+static CK_RV
+leave(CK_RV status)
+{
+    pthread_mutex_lock(&lock);
+    statistics.concurrent--;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&lock);
+    return status;
+}
+
+static CK_RV
+Finalize(void *args)
+{
+    CK_RV status;
+    pthread_mutex_lock(&lock);
+    status = libraryTable->C_Finalize(args);
+    syslog(LOG_DAEMON|LOG_INFO, "pkcs11latency: %lu calls, %lu queued, %lu failures injected, %lu sessions refused",
+           statistics.calls, statistics.queued, statistics.failures, statistics.refusedsessions);
+    statistics.sessions = 0;
+    pthread_mutex_unlock(&lock);
+    return status;
+}
+
+static CK_RV
+GetTokenInfo(CK_SLOT_ID slot_id, CK_TOKEN_INFO* info)
+{
+    CK_RV status;
+    enter(0, 0);
+    status = libraryTable->C_GetTokenInfo(slot_id, info);
+    if (status == CKR_OK && configuration.maxsessions > 0) {
+        info->ulMaxSessionCount = configuration.maxsessions;
+        info->ulMaxRwSessionCount = configuration.maxsessions;
+    }
+    return leave(status);
+}
+
+static CK_RV
+OpenSession(CK_SLOT_ID slot_id, CK_FLAGS flags, void *application, CK_NOTIFY notify, CK_SESSION_HANDLE *session)
+{
+    CK_RV status;
+    pthread_mutex_lock(&lock);
+    if (configuration.maxsessions > 0 && statistics.sessions >= configuration.maxsessions) {
+        statistics.refusedsessions++;
+        pthread_mutex_unlock(&lock);
+        return CKR_SESSION_COUNT;
+    }
+    statistics.sessions++;
+    pthread_mutex_unlock(&lock);
+    enter(0, 0);
+    status = libraryTable->C_OpenSession(slot_id, flags, application, notify, session);
+    if (status != CKR_OK) {
+        pthread_mutex_lock(&lock);
+        statistics.sessions--;
+        pthread_mutex_unlock(&lock);
+    }
+    return leave(status);
+}
+
+static CK_RV
+CloseSession(CK_SESSION_HANDLE session)
+{
+    CK_RV status;
+    enter(0, 0);
+    status = libraryTable->C_CloseSession(session);
+    if (status == CKR_OK) {
+        pthread_mutex_lock(&lock);
+        statistics.sessions--;
+        pthread_mutex_unlock(&lock);
+    }
+    return leave(status);
+}
+
+static CK_RV
+CloseAllSessions(CK_SLOT_ID slot_id)
+{
+    CK_RV status;
+    enter(0, 0);
+    status = libraryTable->C_CloseAllSessions(slot_id);
+    if (status == CKR_OK) {
+        pthread_mutex_lock(&lock);
+        statistics.sessions = 0;
+        pthread_mutex_unlock(&lock);
+    }
+    return leave(status);
+}
+
+static CK_RV
+GetSessionInfo(CK_SESSION_HANDLE session, CK_SESSION_INFO *info)
+{
+    enter(0, 0);
+    return leave(libraryTable->C_GetSessionInfo(session, info));
+}
+
+static CK_RV
+Login(CK_SESSION_HANDLE session, unsigned long user_type, unsigned char *pin, unsigned long pin_len)
+{
+    enter(0, 0);
+    return leave(libraryTable->C_Login(session, user_type, pin, pin_len));
+}
+
+static CK_RV
+Logout(CK_SESSION_HANDLE session)
+{
+    enter(0, 0);
+    return leave(libraryTable->C_Logout(session));
+}
+
+static CK_RV
+DestroyObject(CK_SESSION_HANDLE session, CK_OBJECT_HANDLE object)
+{
+    enter(0, 0);
+    return leave(libraryTable->C_DestroyObject(session, object));
+}
+
+static CK_RV
+GetAttributeValue(CK_SESSION_HANDLE session, CK_OBJECT_HANDLE object, CK_ATTRIBUTE* templ, unsigned long count)
+{
+    enter(0, 0);
+    return leave(libraryTable->C_GetAttributeValue(session, object, templ, count));
+}
+
+static CK_RV
+FindObjectsInit(CK_SESSION_HANDLE session, CK_ATTRIBUTE* templ, unsigned long count)
+{
+    enter(0, 0);
+    return leave(libraryTable->C_FindObjectsInit(session, templ, count));
+}
+
+static CK_RV
+FindObjects(CK_SESSION_HANDLE session, CK_OBJECT_HANDLE* object, unsigned long max_object_count, unsigned long *object_count)
+{
+    enter(0, 0);
+    return leave(libraryTable->C_FindObjects(session, object, max_object_count, object_count));
+}
+
+static CK_RV
+FindObjectsFinal(CK_SESSION_HANDLE session)
+{
+    enter(0, 0);
+    return leave(libraryTable->C_FindObjectsFinal(session));
+}
+
+static CK_RV
+DigestInit(CK_SESSION_HANDLE session, CK_MECHANISM* mechanism_ptr)
+{
+    enter(0, 0);
+    return leave(libraryTable->C_DigestInit(session, mechanism_ptr));
+}
+
+static CK_RV
+Digest(CK_SESSION_HANDLE session, unsigned char *data_ptr, unsigned long data_len, unsigned char *digest, unsigned long *digest_len)
+{
+    enter(0, 0);
+    return leave(libraryTable->C_Digest(session, data_ptr, data_len, digest, digest_len));
+}
+
+/* Failures are injected at the start of a sign operation, so the wrapped
+ * library never has a pending operation on the session afterwards.
+ */
+static CK_RV
+SignInit(CK_SESSION_HANDLE session, CK_MECHANISM* mechanism_ptr, CK_OBJECT_HANDLE key)
+{
+    if (enter(0, 1) != CKR_OK)
+        return leave(CKR_DEVICE_ERROR);
+    return leave(libraryTable->C_SignInit(session, mechanism_ptr, key));
+}
+
+static CK_RV
+Sign(CK_SESSION_HANDLE session, unsigned char *data_ptr, unsigned long data_len, unsigned char *signature, unsigned long *signature_len)
+{
+    enter(configuration.signdelay, 0);
+    return leave(libraryTable->C_Sign(session, data_ptr, data_len, signature, signature_len));
+}
+
+static CK_RV
+GenerateKey(CK_SESSION_HANDLE session, CK_MECHANISM* mechanism_ptr,
+        CK_ATTRIBUTE* templ, unsigned long count, CK_OBJECT_HANDLE* key)
+{
+    if (enter(configuration.keygendelay, 1) != CKR_OK)
+        return leave(CKR_DEVICE_ERROR);
+    return leave(libraryTable->C_GenerateKey(session, mechanism_ptr, templ, count, key));
+}
+
+static CK_RV
+GenerateKeyPair(CK_SESSION_HANDLE session, CK_MECHANISM* mechanism_ptr,
+        CK_ATTRIBUTE* public_key_template, unsigned long public_key_attribute_count,
+        CK_ATTRIBUTE* private_key_template, unsigned long private_key_attribute_count,
+        CK_OBJECT_HANDLE* public_key, CK_OBJECT_HANDLE* private_key)
+{
+    if (enter(configuration.keygendelay, 1) != CKR_OK)
+        return leave(CKR_DEVICE_ERROR);
+    return leave(libraryTable->C_GenerateKeyPair(session, mechanism_ptr, public_key_template, public_key_attribute_count, private_key_template, private_key_attribute_count, public_key, private_key));
+}
+
+static CK_RV
+GenerateRandom(CK_SESSION_HANDLE session, unsigned char *random_data, unsigned long random_len)
+{
+    enter(0, 0);
+    return leave(libraryTable->C_GenerateRandom(session, random_data, random_len));
+}
+
+static CK_RV
+GetFunctionList(CK_FUNCTION_LIST_PTR_PTR function_list)
+{
+    CK_RV status = CKR_OK;
+    CK_C_GetFunctionList libraryFunction;
+    const char* libraryPath;
+    pthread_mutex_lock(&lock);
+    if (libraryTable == NULL) {
+        configure();
+        libraryPath = getenv("PKCS11LATENCY_MODULE");
+        if (libraryPath == NULL || *libraryPath == '\0')
+            libraryPath = PKCS11LATENCY_DEFAULT_MODULE;
+        if (libraryReference == NULL)
+            libraryReference = dlopen(libraryPath, RTLD_NOW|RTLD_LOCAL);
+        if (libraryReference == NULL) {
+            syslog(LOG_DAEMON|LOG_ERR, "pkcs11latency: library %s not found", libraryPath);
+            status = CKR_GENERAL_ERROR;
+        } else if ((libraryFunction = (CK_C_GetFunctionList) dlsym(libraryReference, "C_GetFunctionList")) == NULL) {
+            syslog(LOG_DAEMON|LOG_ERR, "pkcs11latency: library %s unsuitable", libraryPath);
+            status = CKR_GENERAL_ERROR;
+        } else if ((status = libraryFunction(&libraryTable)) != CKR_OK) {
+            syslog(LOG_DAEMON|LOG_ERR, "pkcs11latency: library %s faulty", libraryPath);
+            libraryTable = NULL;
+        } else {
+            /* everything not overridden below is forwarded unchanged */
+            definition = *libraryTable;
+            definition.C_Finalize            = Finalize;
+            definition.C_GetFunctionList     = GetFunctionList;
+            definition.C_GetTokenInfo        = GetTokenInfo;
+            definition.C_OpenSession         = OpenSession;
+            definition.C_CloseSession        = CloseSession;
+            definition.C_CloseAllSessions    = CloseAllSessions;
+            definition.C_GetSessionInfo      = GetSessionInfo;
+            definition.C_Login               = Login;
+            definition.C_Logout              = Logout;
+            definition.C_DestroyObject       = DestroyObject;
+            definition.C_GetAttributeValue   = GetAttributeValue;
+            definition.C_FindObjectsInit     = FindObjectsInit;
+            definition.C_FindObjects         = FindObjects;
+            definition.C_FindObjectsFinal    = FindObjectsFinal;
+            definition.C_DigestInit          = DigestInit;
+            definition.C_Digest              = Digest;
+            definition.C_SignInit            = SignInit;
+            definition.C_Sign                = Sign;
+            definition.C_GenerateKey         = GenerateKey;
+            definition.C_GenerateKeyPair     = GenerateKeyPair;
+            definition.C_GenerateRandom      = GenerateRandom;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    if (status == CKR_OK)
+        *function_list = &definition;
+    return status;
+}
+
+CK_RV
+C_GetFunctionList(CK_FUNCTION_LIST_PTR_PTR function_list)
+{
+    return GetFunctionList(function_list);
+}
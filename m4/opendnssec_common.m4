@@ -80,6 +80,15 @@ AC_DEFINE_UNQUOTED(ODS_SE_CLI,           ["$OPENDNSSEC_SIGNER_CLI"],         [Pa
 AC_DEFINE_UNQUOTED(ODS_SE_MAXLINE,       [1024],                             [Maximum line length that the OpenDNSSEC signer client can handle])
 AC_DEFINE_UNQUOTED(ODS_SE_MAX_BACKOFF,   [3600],                             [Number of seconds the OpenDNSSEC signer engine should backoff when a task failed])
 AC_DEFINE_UNQUOTED(ODS_SE_WORKERTHREADS, [4],                                [Default number of worker threads for the OpenDNSSEC signer engine])
+AC_DEFINE_UNQUOTED(ODS_SE_COALESCEWINDOW, [100],                             [Default milliseconds the OpenDNSSEC signer engine collects pushed changes before signing them])
+AC_DEFINE_UNQUOTED(ODS_SE_MEMORYBUDGET,  [0],                                [Default megabytes of zone data the OpenDNSSEC signer engine keeps in memory, zero for unlimited])
+AC_DEFINE_UNQUOTED(ODS_SE_INSTANCES,     [1],                                [Default number of OpenDNSSEC signer engine instances the zones are partitioned over])
+AC_DEFINE_UNQUOTED(ODS_SE_HTTPPORT,      [8000],                             [Default port of the HTTP interface of the first OpenDNSSEC signer engine instance, the other instances use the ports following it])
+AC_DEFINE_UNQUOTED(ODS_SE_EVICTINTERVAL, [60],                               [Number of seconds between the OpenDNSSEC signer engine checking its memory budget])
+AC_DEFINE_UNQUOTED(ODS_SE_MASSCONCURRENCY, [0],                              [Default maximum number of zones in flight during a mass operation of the OpenDNSSEC signer engine, zero for the number of signer threads])
+AC_DEFINE_UNQUOTED(ODS_SE_MASSTIMEOUT,   [3600],                             [Number of seconds a zone of a mass operation may take before the OpenDNSSEC signer engine continues with the next])
+AC_DEFINE_UNQUOTED(ODS_SE_NOTIFYCONCURRENCY, [0],                            [Default maximum number of notify commands running at the same time in the OpenDNSSEC signer engine, zero for the number of signer threads])
+AC_DEFINE_UNQUOTED(ODS_SE_REFRESHRATE,   [50],                               [Default maximum number of zone transfer requests over UDP per second to one master from the OpenDNSSEC signer engine, zero for no pacing])
 AC_DEFINE_UNQUOTED(ODS_SE_STOP_RESPONSE, ["Engine shut down."],              [Shutdown message for the OpenDNSSEC signer client])
 AC_DEFINE_UNQUOTED(ODS_SE_FILE_MAGIC_V3, [";OpenDNSSEC-backup-v3"],          [File magic for storing backups from the OpenDNSSEC signer engine])
 AC_DEFINE_UNQUOTED(ODS_SE_FILE_MAGIC_V2, [";ODSSE2"],                        [File magic for storing backups from the OpenDNSSEC signer engine])
@@ -102,6 +111,8 @@ AC_DEFINE_UNQUOTED(OPENDNSSEC_ENFORCER_ZONELIST,   "$OPENDNSSEC_ENFORCER_ZONELIS
 AC_DEFINE(OPENDNSSEC_ENFORCER_WORKERTHREADS, 4, [Number of worker threads for the enforcer])
 OPENDNSSEC_ENFORCER_KASPCHECK=$OPENDNSSEC_BIN_DIR/ods-kaspcheck
 AC_DEFINE_UNQUOTED(ODS_EN_VERBOSITY,     [3],                                [Default verbosity])
+AC_DEFINE_UNQUOTED(ODS_EN_STARTUPRATE,   [100],                              [Default number of overdue zones the enforcer catches up on per second after start])
+AC_DEFINE_UNQUOTED(ODS_EN_RESALTCONCURRENCY, [100],                          [Default number of zones of a policy that change NSEC3 salt at the same time])
 
 AC_DEFINE_UNQUOTED(ODS_EN_CONTROL,    ["$OPENDNSSEC_ENFORCER_CONTROL enforcer "],    [Path to the OpenDNSSEC ods-control binary])
 AC_DEFINE_UNQUOTED(ODS_EN_NOTIFY,    ["$OPENDNSSEC_ENFORCER_CONTROL enforcer notify"],    [Command to send a SIGHUP to the ods-enforcerd process])
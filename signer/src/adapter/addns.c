@@ -48,6 +48,7 @@
 #include <ldns/ldns.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 static const char* adapter_str = "adapter";
 static ods_status addns_read_pkt(FILE* fd, zone_type* zone, names_view_type view);
@@ -513,6 +514,174 @@ dnsout_create(void)
 }
 
 
+/**
+ * Parsed configurations, by the content of their file.  All adapters
+ * whose file has the same content share one and do not change it.
+ * They are kept until shutdown: transfers and notifies in progress may
+ * still refer to the ACLs of a configuration that was replaced.
+ *
+ */
+#define ADDNS_SHARED_BUCKETS 256
+
+struct addns_shared {
+    struct addns_shared* next;
+    uint32_t hash;
+    size_t size;
+    char* content;
+    addns_config_type config;
+};
+
+static struct addns_shared* addns_shared_table[ADDNS_SHARED_BUCKETS];
+static pthread_mutex_t addns_shared_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/**
+ * Read the content of a file.
+ *
+ */
+static char*
+addns_read_content(const char* filename, size_t* size)
+{
+    FILE* fd = NULL;
+    char* content = NULL;
+    size_t len = 0;
+    size_t alloc = 0;
+    size_t n = 0;
+    fd = ods_fopen(filename, NULL, "r");
+    if (!fd) {
+        return NULL;
+    }
+    do {
+        if (len == alloc) {
+            alloc = alloc ? alloc * 2 : 4096;
+            CHECKALLOC(content = (char*) realloc(content, alloc));
+        }
+        n = fread(content + len, 1, alloc - len, fd);
+        len += n;
+    } while (n > 0);
+    if (ferror(fd)) {
+        free(content);
+        content = NULL;
+    }
+    ods_fclose(fd);
+    *size = len;
+    return content;
+}
+
+
+/**
+ * Free a parsed configuration.
+ *
+ */
+static void
+addns_shared_free(struct addns_shared* shared)
+{
+    acl_cleanup(shared->config.request_xfr);
+    acl_cleanup(shared->config.allow_notify);
+    acl_cleanup(shared->config.provide_xfr);
+    acl_cleanup(shared->config.do_notify);
+    tsig_cleanup(shared->config.tsig);
+    free(shared->content);
+    free(shared);
+}
+
+
+/**
+ * Look up a parsed configuration by content, with addns_shared_lock held.
+ *
+ */
+static struct addns_shared*
+addns_shared_lookup(struct addns_shared* bucket, uint32_t hash,
+    const char* content, size_t size)
+{
+    struct addns_shared* shared = NULL;
+    for (shared = bucket; shared; shared = shared->next) {
+        if (shared->hash == hash && shared->size == size &&
+            memcmp(shared->content, content, size) == 0) {
+            return shared;
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * Get the parsed configuration of a file.  The file is only validated
+ * and parsed if no file with the same content was parsed before, which
+ * is done without holding the lock so that other adapters are not held
+ * up by it.
+ *
+ */
+static ods_status
+addns_config_get(const char* filename, addns_config_type** config)
+{
+    const char* rngfile = ODS_SE_RNGDIR "/addns.rng";
+    struct addns_shared* shared = NULL;
+    struct addns_shared* known = NULL;
+    struct addns_shared** bucket = NULL;
+    ods_status status = ODS_STATUS_OK;
+    char* content = NULL;
+    size_t size = 0;
+    size_t i = 0;
+    uint32_t hash = 2166136261U;
+    content = addns_read_content(filename, &size);
+    if (!content) {
+        ods_log_error("[%s] unable to read dns adapter: failed to open "
+            "file %s", adapter_str, filename);
+        return ODS_STATUS_FOPEN_ERR;
+    }
+    for (i = 0; i < size; i++) {
+        hash ^= (uint32_t) (unsigned char) content[i];
+        hash *= 16777619U;
+    }
+    bucket = &addns_shared_table[hash % ADDNS_SHARED_BUCKETS];
+    pthread_mutex_lock(&addns_shared_lock);
+    known = addns_shared_lookup(*bucket, hash, content, size);
+    pthread_mutex_unlock(&addns_shared_lock);
+    if (known) {
+        free(content);
+        ods_log_debug("[%s] dns adapter file %s has known content, "
+            "not parsed again", adapter_str, filename);
+        *config = &known->config;
+        return ODS_STATUS_OK;
+    }
+    /* validate what was hashed, the file may have changed since */
+    status = parse_memory_check(filename, content, size, rngfile);
+    if (status != ODS_STATUS_OK) {
+        free(content);
+        ods_log_error("[%s] unable to read dns adapter: parse error in "
+            "file %s (%s)", adapter_str, filename, ods_status2str(status));
+        return status;
+    }
+    CHECKALLOC(shared = (struct addns_shared*) calloc(1, sizeof(struct addns_shared)));
+    status = parse_addns(filename, content, size, &shared->config);
+    if (status != ODS_STATUS_OK) {
+        free(content);
+        free(shared);
+        ods_log_error("[%s] unable to read dns adapter: parse error in "
+            "file %s (%s)", adapter_str, filename, ods_status2str(status));
+        return status;
+    }
+    shared->hash = hash;
+    shared->size = size;
+    shared->content = content;
+    /* another adapter may have parsed the same content meanwhile */
+    pthread_mutex_lock(&addns_shared_lock);
+    known = addns_shared_lookup(*bucket, hash, content, size);
+    if (!known) {
+        shared->next = *bucket;
+        *bucket = shared;
+    }
+    pthread_mutex_unlock(&addns_shared_lock);
+    if (known) {
+        addns_shared_free(shared);
+        shared = known;
+    }
+    *config = &shared->config;
+    return ODS_STATUS_OK;
+}
+
+
 /**
  * Read DNS input adapter.
  *
@@ -520,30 +689,20 @@ dnsout_create(void)
 static ods_status
 dnsin_read(dnsin_type* addns, const char* filename)
 {
-    const char* rngfile = ODS_SE_RNGDIR "/addns.rng";
+    addns_config_type* config = NULL;
     ods_status status = ODS_STATUS_OK;
-    FILE* fd = NULL;
     if (!filename || !addns) {
         return ODS_STATUS_ASSERT_ERR;
     }
     ods_log_debug("[%s] read dnsin file %s", adapter_str, filename);
-    status = parse_file_check(filename, rngfile);
+    status = addns_config_get(filename, &config);
     if (status != ODS_STATUS_OK) {
-        ods_log_error("[%s] unable to read dnsin: parse error in "
-            "file %s (%s)", adapter_str, filename, ods_status2str(status));
         return status;
     }
-    fd = ods_fopen(filename, NULL, "r");
-    if (fd) {
-        addns->tsig = parse_addns_tsig(filename);
-        addns->request_xfr = parse_addns_request_xfr(filename, addns->tsig);
-        addns->allow_notify = parse_addns_allow_notify(filename, addns->tsig);
-        ods_fclose(fd);
-        return ODS_STATUS_OK;
-    }
-    ods_log_error("[%s] unable to read dnsout: failed to open file %s",
-        adapter_str, filename);
-    return ODS_STATUS_ERR;
+    addns->tsig = config->tsig;
+    addns->request_xfr = config->request_xfr;
+    addns->allow_notify = config->allow_notify;
+    return ODS_STATUS_OK;
 }
 
 
@@ -579,30 +738,20 @@ dnsin_update(dnsin_type** addns, const char* filename, time_t* last_mod)
 static ods_status
 dnsout_read(dnsout_type* addns, const char* filename)
 {
-    const char* rngfile = ODS_SE_RNGDIR "/addns.rng";
+    addns_config_type* config = NULL;
     ods_status status = ODS_STATUS_OK;
-    FILE* fd = NULL;
     if (!filename || !addns) {
         return ODS_STATUS_ASSERT_ERR;
     }
     ods_log_debug("[%s] read dnsout file %s", adapter_str, filename);
-    status = parse_file_check(filename, rngfile);
+    status = addns_config_get(filename, &config);
     if (status != ODS_STATUS_OK) {
-        ods_log_error("[%s] unable to read dnsout: parse error in "
-            "file %s (%s)", adapter_str, filename, ods_status2str(status));
         return status;
     }
-    fd = ods_fopen(filename, NULL, "r");
-    if (fd) {
-        addns->tsig = parse_addns_tsig(filename);
-        addns->provide_xfr = parse_addns_provide_xfr(filename, addns->tsig);
-        addns->do_notify = parse_addns_do_notify(filename, addns->tsig);
-        ods_fclose(fd);
-        return ODS_STATUS_OK;
-    }
-    ods_log_error("[%s] unable to read dnsout: failed to open file %s",
-        adapter_str, filename);
-    return ODS_STATUS_ERR;
+    addns->tsig = config->tsig;
+    addns->provide_xfr = config->provide_xfr;
+    addns->do_notify = config->do_notify;
+    return ODS_STATUS_OK;
 }
 
 
@@ -654,7 +803,6 @@ dnsout_send_notify(zone_type* z, names_view_type view)
     ods_log_assert(z->name);
     names_viewlookupone(view, NULL, LDNS_RR_TYPE_SOA, NULL, &soa);
     ods_log_assert(soa);
-    soa = ldns_rr_clone(soa);
     notify_enable(z->notify, soa);
 }
 
@@ -766,9 +914,7 @@ dnsin_cleanup(dnsin_type* addns)
     if (!addns) {
         return;
     }
-    acl_cleanup(addns->request_xfr);
-    acl_cleanup(addns->allow_notify);
-    tsig_cleanup(addns->tsig);
+    /* the ACLs and TSIG credentials are shared */
     free(addns);
 }
 
@@ -783,8 +929,27 @@ dnsout_cleanup(dnsout_type* addns)
     if (!addns) {
         return;
     }
-    acl_cleanup(addns->provide_xfr);
-    acl_cleanup(addns->do_notify);
-    tsig_cleanup(addns->tsig);
+    /* the ACLs and TSIG credentials are shared */
     free(addns);
 }
+
+
+/**
+ * Clean up the parsed configurations of the DNS adapters.
+ *
+ */
+void
+addns_config_cleanup(void)
+{
+    struct addns_shared* shared = NULL;
+    size_t i = 0;
+    pthread_mutex_lock(&addns_shared_lock);
+    for (i = 0; i < ADDNS_SHARED_BUCKETS; i++) {
+        while (addns_shared_table[i]) {
+            shared = addns_shared_table[i];
+            addns_shared_table[i] = shared->next;
+            addns_shared_free(shared);
+        }
+    }
+    pthread_mutex_unlock(&addns_shared_lock);
+}
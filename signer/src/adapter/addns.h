@@ -148,4 +148,11 @@ void dnsin_cleanup(dnsin_type* addns);
  */
 void dnsout_cleanup(dnsout_type* addns);
 
+/**
+ * Clean up the parsed configurations shared by the DNS adapters, once
+ * no adapter uses them anymore.
+ *
+ */
+void addns_config_cleanup(void);
+
 #endif /* ADAPTER_ADDNS_H */
@@ -225,12 +225,14 @@ getxfr(zone_type* zone, const char* suffix, time_t* serial)
         if(names_iterate(&iter,&record)) {
             names_recordlookupone(record, LDNS_RR_TYPE_SOA, NULL, &rr);
             soa1 = ldns_rr2str(rr);
+            ldns_rr_free(rr);
         } else
             soa1 = NULL;
         soa2 = NULL;
         while(names_advance(&iter,&record)) {
             names_recordlookupone(record, LDNS_RR_TYPE_SOA, NULL, &rr);
             soa2 = ldns_rr2str(rr);
+            ldns_rr_free(rr);
         }
         names_end(&iter);
         free(apex);
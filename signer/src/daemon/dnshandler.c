@@ -60,8 +60,14 @@ dnshandler_create(listener_type* interfaces)
     dnsh->query = NULL;
     dnsh->started = 0;
     dnsh->tcp_accept_handlers = NULL;
+    dnsh->instance = 0;
+    dnsh->instances = 1;
+    dnsh->relaybase = NULL;
     /* setup */
     CHECKALLOC(dnsh->socklist = (socklist_type*) malloc(sizeof(socklist_type)));
+    dnsh->socklist->relay = -1;
+    dnsh->socklist->instances = 0;
+    dnsh->socklist->relaynames = NULL;
     dnsh->netio = netio_create();
     dnsh->query = query_create();
     dnsh->xfrhandler.fd = -1;
@@ -80,11 +86,23 @@ dnshandler_listen(dnshandler_type* dnshandler)
 {
     ods_status status = ODS_STATUS_OK;
     ods_log_assert(dnshandler);
-    status = sock_listen(dnshandler->socklist, dnshandler->interfaces);
+    status = sock_listen(dnshandler->socklist, dnshandler->interfaces,
+        dnshandler->instances > 1);
     if (status != ODS_STATUS_OK) {
         ods_log_error("[%s] unable to start: sock_listen() "
             "failed (%s)", dnsh_str, ods_status2str(status));
         dnshandler->thread_id = 0;
+        return status;
+    }
+    if (dnshandler->instances > 1) {
+        status = sock_relay_listen(dnshandler->socklist,
+            dnshandler->relaybase, dnshandler->instance,
+            dnshandler->instances);
+        if (status != ODS_STATUS_OK) {
+            ods_log_error("[%s] unable to start: sock_relay_listen() "
+                "failed (%s)", dnsh_str, ods_status2str(status));
+            dnshandler->thread_id = 0;
+        }
     }
     return status;
 }
@@ -142,6 +160,25 @@ dnshandler_start(dnshandler_type* dnshandler)
             (unsigned) handler->fd);
         netio_add_handler(dnshandler->netio, handler);
     }
+    /* relay */
+    if (dnshandler->socklist->relay != -1) {
+        struct relay_data* data = NULL;
+        netio_handler_type* handler = NULL;
+        CHECKALLOC(data = (struct relay_data*) malloc(sizeof(struct relay_data)));
+        data->query = dnshandler->query;
+        data->engine = dnshandler->engine;
+        data->socklist = dnshandler->socklist;
+        CHECKALLOC(handler = (netio_handler_type*) malloc(sizeof(netio_handler_type)));
+        handler->fd = dnshandler->socklist->relay;
+        handler->timeout = NULL;
+        handler->user_data = data;
+        handler->event_types = NETIO_EVENT_READ;
+        handler->event_handler = sock_handle_relay;
+        handler->free_handler = 1;
+        ods_log_debug("[%s] add relay network handler fd %u", dnsh_str,
+            (unsigned) handler->fd);
+        netio_add_handler(dnshandler->netio, handler);
+    }
     /* service */
     while (dnshandler->need_to_exit == 0) {
         ods_log_deeebug("[%s] netio dispatch", dnsh_str);
@@ -218,6 +255,17 @@ dnshandler_cleanup(dnshandler_type* dnshandler)
             freeaddrinfo((void*)dnshandler->socklist->tcp[i].addr);
         }  
     }
+    if (dnshandler->socklist->relay != -1) {
+        close(dnshandler->socklist->relay);
+        (void)unlink(dnshandler->socklist->relaynames[dnshandler->instance]);
+    }
+    if (dnshandler->socklist->relaynames) {
+        for (i = 0; i < (size_t) dnshandler->socklist->instances; i++) {
+            free(dnshandler->socklist->relaynames[i]);
+        }
+        free(dnshandler->socklist->relaynames);
+    }
+    free((void*)dnshandler->relaybase);
     free(dnshandler->tcp_accept_handlers);
     free(dnshandler->socklist);
     listener_cleanup(dnshandler->interfaces);
@@ -56,6 +56,10 @@ struct dnshandler_struct {
     netio_type* netio;
     query_type* query;
     netio_handler_type xfrhandler;
+    /* Partitioning over signer instances */
+    int instance;
+    int instances;
+    const char* relaybase;
     unsigned need_to_exit;
     unsigned started;
     netio_handler_type *tcp_accept_handlers;
@@ -48,6 +48,7 @@
 #include "signercommands.h"
 #include "confparser.h"
 #include "views/httpd.h"
+#include "views/proto.h"
 
 #include <errno.h>
 #include <libxml/parser.h>
@@ -83,10 +84,13 @@ engine_create(void)
     engine->uid = -1;
     engine->gid = -1;
     engine->daemonize = 0;
+    engine->instance = 0;
     engine->need_to_exit = 0;
     engine->need_to_reload = 0;
     pthread_mutex_init(&engine->signal_lock, NULL);
     pthread_cond_init(&engine->signal_cond, NULL);
+    engine->massop = massop_create();
+    engine->notifyexec = NULL;
     engine->zonelist = zonelist_create();
     if (!engine->zonelist) {
         engine_cleanup(engine);
@@ -102,6 +106,8 @@ engine_create(void)
     schedule_registertask(engine->taskq, TASK_CLASS_SIGNER, TASK_FORCEREAD, do_forcereadzone);
     schedule_registertask(engine->taskq, TASK_CLASS_SIGNER, TASK_SIGN, do_signzone);
     schedule_registertask(engine->taskq, TASK_CLASS_SIGNER, TASK_WRITE, do_writezone);
+    schedule_registertask(engine->taskq, TASK_CLASS_SIGNER, TASK_PROPAGATE, do_propagatezone);
+    schedule_registertask(engine->taskq, TASK_CLASS_SIGNER, TASK_SIGNPUSHED, do_signpushed);
     return engine;
 }
 
@@ -113,12 +119,19 @@ engine_start_cmdhandler(engine_type* engine)
 
     struct http_listener_struct listenerconfig;
     struct httpd* httpd;
+    char port[8];
+    if (engine->config->signer_http_port <= 0) {
+        return;
+    }
     listenerconfig.count = 0;
     listenerconfig.interfaces = NULL;
+    /* each instance serves its own zones on the next port */
+    snprintf(port, sizeof(port), "%d",
+        engine->config->signer_http_port + engine->instance);
     /* IPv4 addesses needs be placed first */
-    http_listener_push(&listenerconfig, "0.0.0.0", AF_INET, "8000", NULL, NULL);
+    http_listener_push(&listenerconfig, "0.0.0.0", AF_INET, port, NULL, NULL);
     //http_listener_push(&listenerconfig, "::0", AF_INET6, "8000", NULL, NULL);
-    httpd = httpd_create(&listenerconfig, engine->zonelist);
+    httpd = httpd_create(&listenerconfig, engine);
     httpd_start(httpd);
 }
 
@@ -160,6 +173,9 @@ engine_start_xfrhandler(engine_type* engine)
     }
     ods_log_debug("[%s] start xfrhandler", engine_str);
     engine->xfrhandler->engine = engine;
+    /* the packet writer runs before transfers come in */
+    engine->xfrhandler->dump->started = 1;
+    janitor_thread_create(&engine->xfrhandler->dump->thread_id, handlerthreadclass, (janitor_runfn_t)xfrdump_start, engine->xfrhandler->dump);
     /* This might be the wrong place to mark the xfrhandler started but
      * if its isn't done here we might try to shutdown and stop it before
      * it has marked itself started
@@ -181,10 +197,50 @@ engine_stop_xfrhandler(engine_type* engine)
     	janitor_thread_join(engine->xfrhandler->thread_id);
     	engine->xfrhandler->started = 0;
     }
+    if (engine->xfrhandler->dump->started) {
+        ods_log_debug("[%s] join xfrhandler packet writer", engine_str);
+        xfrdump_stop(engine->xfrhandler->dump);
+        janitor_thread_join(engine->xfrhandler->dump->thread_id);
+        engine->xfrhandler->dump->started = 0;
+    }
     engine->xfrhandler->engine = NULL;
 }
 
 
+/**
+ * Start/stop the executor of the notify command.
+ *
+ */
+static void
+engine_start_notifyexec(engine_type* engine)
+{
+    int concurrency;
+    if (!engine || !engine->config || !engine->config->notify_command) {
+        return;
+    }
+    concurrency = engine->config->signer_notify_concurrency;
+    if (concurrency <= 0) {
+        concurrency = engine->config->num_signer_threads;
+    }
+    ods_log_debug("[%s] start notify executor", engine_str);
+    engine->notifyexec = notifyexec_create(concurrency);
+    engine->notifyexec->started = 1;
+    janitor_thread_create(&engine->notifyexec->thread_id, handlerthreadclass, (janitor_runfn_t)notifyexec_start, engine->notifyexec);
+}
+static void
+engine_stop_notifyexec(engine_type* engine)
+{
+    if (!engine || !engine->notifyexec || !engine->notifyexec->started) {
+        return;
+    }
+    ods_log_debug("[%s] stop notify executor", engine_str);
+    notifyexec_stop(engine->notifyexec);
+    ods_log_debug("[%s] join notify executor", engine_str);
+    janitor_thread_join(engine->notifyexec->thread_id);
+    engine->notifyexec->started = 0;
+}
+
+
 /**
  * Drop privileges.
  *
@@ -268,6 +324,8 @@ engine_start_workers(engine_type* engine)
         engine->workers[threadCount]->need_to_exit = 0;
         janitor_thread_create(&engine->workers[threadCount]->thread_id, workerthreadclass, (janitor_runfn_t)drudge, engine->workers[threadCount]);
     }
+    /* idle views are brought up to date by the workers */
+    zonelist_propagation(schedule_propagate, engine);
 }
 
 static void
@@ -278,6 +336,7 @@ engine_stop_threads(engine_type* engine)
     ods_log_assert(engine);
     ods_log_assert(engine->config);
     ods_log_debug("[%s] stop workers and drudgers", engine_str);
+    zonelist_propagation(NULL, NULL);
     numTotalWorkers = engine->config->num_worker_threads_signer + engine->config->num_signer_threads;
     for (i=0; i < numTotalWorkers; i++) {
         engine->workers[i]->need_to_exit = 1;
@@ -342,6 +401,7 @@ engine_setup_initialize(engine_type* engine, int* fdptr)
         ods_log_error("Failed to setup transfer handler");
         return ODS_STATUS_XFRHANDLER_ERR;
     }
+    engine->xfrhandler->refresh_rate = engine->config->signer_refresh_rate;
     if (engine->dnshandler) {
         if (socketpair(AF_UNIX, SOCK_DGRAM, 0, sockets) == -1) {
             ods_log_error("Failed to setup dns handler");
@@ -349,6 +409,13 @@ engine_setup_initialize(engine_type* engine, int* fdptr)
         }
         engine->xfrhandler->dnshandler.fd = sockets[0];
         engine->dnshandler->xfrhandler.fd = sockets[1];
+        engine->dnshandler->instance = engine->instance;
+        engine->dnshandler->instances = engine->config->signer_instances;
+        if (engine->config->signer_instances > 1) {
+            /* relay sockets are named after the configured socket */
+            engine->dnshandler->relaybase = parse_conf_clisock_filename(
+                engine->config->cfg_filename, 0);
+        }
         status = dnshandler_listen(engine->dnshandler);
         if (status != ODS_STATUS_OK) {
             ods_log_error("[%s] setup: unable to listen to sockets (%s)",
@@ -364,6 +431,10 @@ engine_setup_initialize(engine_type* engine, int* fdptr)
     /* remove the chown stuff: piddir? */
     ods_chown(engine->config->pid_filename_signer, engine->uid, engine->gid, 1);
     ods_chown(engine->config->clisock_filename_signer, engine->uid, engine->gid, 0);
+    if (engine->dnshandler && engine->dnshandler->socklist->relay != -1) {
+        ods_chown(engine->dnshandler->socklist->relaynames[engine->instance],
+            engine->uid, engine->gid, 0);
+    }
     ods_chown(engine->config->working_dir_signer, engine->uid, engine->gid, 0);
     if (engine->config->log_filename && !engine->config->use_syslog) {
         ods_chown(engine->config->log_filename, engine->uid, engine->gid, 0);
@@ -474,6 +545,7 @@ engine_setup_netwstart(engine_type* engine)
 {
     engine_start_dnshandler(engine);
     engine_start_xfrhandler(engine);
+    engine_start_notifyexec(engine);
     tsig_handler_init();
     return ODS_STATUS_OK;
 }
@@ -496,6 +568,8 @@ engine_setup_finish(engine_type* engine, int fd)
 static void
 engine_run(engine_type* engine)
 {
+    struct timespec deadline;
+    time_t now, lastevict = 0;
     if (!engine) {
         return;
     }
@@ -506,15 +580,35 @@ engine_run(engine_type* engine)
          * to sleep indefinitely and want to wake up on signal. This
          * is to make sure we never mis the signal. */
         pthread_mutex_lock(&engine->signal_lock);
-        if (!engine->need_to_exit && !engine->need_to_reload) {
+        if (!engine->need_to_exit && !engine->need_to_reload && !massop_ready(engine->massop)) {
             /* TODO: this silly. We should be handling the commandhandler
              * connections. No reason to spawn that as a thread.
              * Also it would be easier to wake up the command hander
              * as signals will reach it if it is the main thread! */
             ods_log_debug("[%s] taking a break", engine_str);
-            pthread_cond_wait(&engine->signal_cond, &engine->signal_lock);
+            if (engine->config->signer_memory_budget > 0 || massop_active(engine->massop)) {
+                /* wake up regularly to keep within the memory budget and
+                 * to notice stalled zones of a mass operation */
+                clock_gettime(CLOCK_REALTIME, &deadline);
+                deadline.tv_sec += ODS_SE_EVICTINTERVAL;
+                pthread_cond_timedwait(&engine->signal_cond, &engine->signal_lock, &deadline);
+            } else {
+                pthread_cond_wait(&engine->signal_cond, &engine->signal_lock);
+            }
         }
         pthread_mutex_unlock(&engine->signal_lock);
+        now = time_now();
+        /* other wake-ups, such as zones of a mass operation finishing,
+         * don't warrant a sweep over all zones */
+        if (engine->config->signer_memory_budget > 0 && !engine->need_to_exit && !engine->need_to_reload
+            && (now < lastevict || now >= lastevict + ODS_SE_EVICTINTERVAL)) {
+            lastevict = now;
+            zonelist_evictzones(engine->zonelist, engine->taskq, (size_t)engine->config->signer_memory_budget * 1024 * 1024);
+        }
+        if (massop_active(engine->massop) && !engine->need_to_exit && !engine->need_to_reload) {
+            (void) massop_expire(engine->massop, now, ODS_SE_MASSTIMEOUT);
+            massop_dispatch(engine);
+        }
     }
     ods_log_debug("[%s] signer halted", engine_str);
     engine_stop_threads(engine);
@@ -535,7 +629,10 @@ set_notify_ns(zone_type* zone, const char* cmd)
     ods_log_assert(zone);
     ods_log_assert(zone->name);
     ods_log_assert(zone->adoutbound);
-    if (zone->adoutbound->type == ADAPTER_FILE) {
+    if (strstr(cmd, "%zones")) {
+        /* batched, the notify executor fills in the zone names */
+        CHECKALLOC(str2 = strdup(cmd));
+    } else if (zone->adoutbound->type == ADAPTER_FILE) {
         str = ods_replace(cmd, "%zonefile", zone->adoutbound->configstr);
         if (!str) {
             ods_log_error("[%s] unable to set notify ns: replace zonefile failed",
@@ -740,6 +837,26 @@ engine_setup_config(engine_type* engine, const char* cfgfile, int cmdline_verbos
         ods_log_error("[%s] cfgfile %s has errors", engine_str, cfgfile);
         return ODS_STATUS_PARSE_ERR;
     }
+    /* instances */
+    if (engine->instance >= engine->config->signer_instances) {
+        ods_log_error("[%s] instance %d out of range, cfgfile %s configures "
+            "%d instances", engine_str, engine->instance, cfgfile,
+            engine->config->signer_instances);
+        return ODS_STATUS_CFG_ERR;
+    }
+    if (engine->instance > 0) {
+        const char* file;
+        file = engine->config->pid_filename_signer;
+        engine->config->pid_filename_signer = util_instance_file(file,
+            engine->instance);
+        free((void*)file);
+        file = engine->config->clisock_filename_signer;
+        engine->config->clisock_filename_signer = util_instance_file(file,
+            engine->instance);
+        free((void*)file);
+    }
+    engine->zonelist->instance = engine->instance;
+    engine->zonelist->instances = engine->config->signer_instances;
     /* check pidfile */
     if (!util_check_pidfile(engine->config->pid_filename_signer)) {
         exit(1);
@@ -802,6 +919,7 @@ engine_start(engine_type* engine)
     cmdhandler_stop(engine->cmdhandler);
     engine_stop_xfrhandler(engine);
     engine_stop_dnshandler(engine);
+    engine_stop_notifyexec(engine);
 
     if (engine && engine->config) {
         if (engine->config->pid_filename_signer) {
@@ -839,6 +957,10 @@ engine_cleanup(engine_type* engine)
             free(engine->workers);
         }
         zonelist_cleanup(engine->zonelist);
+        names_recordcleanup();
+        addns_config_cleanup();
+        massop_cleanup(engine->massop);
+        notifyexec_cleanup(engine->notifyexec);
         schedule_cleanup(engine->taskq);
         if(engine->cmdhandler)
             cmdhandler_cleanup(engine->cmdhandler);
@@ -40,6 +40,8 @@ typedef struct engine_struct engine_type;
 #include "cfg.h"
 #include "cmdhandler.h"
 #include "daemon/dnshandler.h"
+#include "daemon/massop.h"
+#include "daemon/notifyexec.h"
 #include "daemon/xfrhandler.h"
 #include "scheduler/worker.h"
 #include "scheduler/schedule.h"
@@ -59,6 +61,7 @@ struct engine_struct {
     gid_t gid;
 
     int daemonize;
+    int instance; /* which of the Signer/Instances engines this is */
     int need_to_exit;
     int need_to_reload;
 
@@ -69,6 +72,8 @@ struct engine_struct {
     zonelist_type* zonelist;
     dnshandler_type* dnshandler;
     xfrhandler_type* xfrhandler;
+    massop_type* massop;
+    notifyexec_type* notifyexec;
     edns_data_type edns;
 };
 
@@ -0,0 +1,407 @@
+/*
+ * Copyright (c) 2018 NLNet Labs.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Rate controlled mass operations on all zones.
+ *
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "daemon/engine.h"
+#include "daemon/massop.h"
+#include "duration.h"
+#include "log.h"
+#include "status.h"
+#include "signer/zone.h"
+
+static const char* massop_str = "massop";
+
+static const char* massop_kindstr[] = { "none", "sign", "flush",
+    "retransfer" };
+
+struct massop_entry {
+    char* name;
+    time_t urgency;
+};
+
+static int
+massop_compare(const void* a, const void* b)
+{
+    const struct massop_entry* x = a;
+    const struct massop_entry* y = b;
+    if (x->urgency != y->urgency) {
+        return (x->urgency < y->urgency ? -1 : 1);
+    }
+    return strcmp(x->name, y->name);
+}
+
+static void
+massop_clear(massop_type* massop)
+{
+    size_t i;
+    for (i = massop->next; i < massop->npending; i++) {
+        free(massop->pending[i]);
+    }
+    free(massop->pending);
+    massop->pending = NULL;
+    massop->npending = massop->next = 0;
+    if (massop->inflight) {
+        for (i = 0; i < (size_t) massop->concurrency; i++) {
+            free(massop->inflight[i]);
+        }
+    }
+    free(massop->inflight);
+    free(massop->dispatched);
+    massop->inflight = NULL;
+    massop->dispatched = NULL;
+    massop->ninflight = 0;
+}
+
+massop_type*
+massop_create(void)
+{
+    massop_type* massop;
+    CHECKALLOC(massop = (massop_type*) calloc(1, sizeof(massop_type)));
+    pthread_mutex_init(&massop->lock, NULL);
+    massop->kind = MASSOP_NONE;
+    return massop;
+}
+
+int
+massop_start(massop_type* massop, massop_kind kind, char** names,
+    time_t* urgency, size_t count, int concurrency)
+{
+    struct massop_entry* entries;
+    size_t i;
+    pthread_mutex_lock(&massop->lock);
+    if (massop->next < massop->npending || massop->ninflight > 0) {
+        pthread_mutex_unlock(&massop->lock);
+        return 1;
+    }
+    massop_clear(massop);
+    if (concurrency < 1) {
+        concurrency = 1;
+    }
+    /* most urgent first, names keep the order stable */
+    CHECKALLOC(entries = (struct massop_entry*) malloc((count ? count : 1) * sizeof(struct massop_entry)));
+    for (i = 0; i < count; i++) {
+        entries[i].name = names[i];
+        entries[i].urgency = urgency[i];
+    }
+    qsort(entries, count, sizeof(struct massop_entry), massop_compare);
+    for (i = 0; i < count; i++) {
+        names[i] = entries[i].name;
+    }
+    free(entries);
+    massop->kind = kind;
+    massop->concurrency = concurrency;
+    massop->pending = names;
+    massop->npending = count;
+    massop->next = 0;
+    CHECKALLOC(massop->inflight = (char**) calloc(concurrency, sizeof(char*)));
+    CHECKALLOC(massop->dispatched = (time_t*) calloc(concurrency, sizeof(time_t)));
+    massop->ninflight = 0;
+    massop->done = 0;
+    massop->failed = 0;
+    massop->started = time_now();
+    massop->cancelled = 0;
+    pthread_mutex_unlock(&massop->lock);
+    return 0;
+}
+
+char*
+massop_next(massop_type* massop, time_t now, massop_kind* kind)
+{
+    char* name = NULL;
+    size_t i;
+    pthread_mutex_lock(&massop->lock);
+    if (massop->next < massop->npending &&
+        massop->ninflight < (size_t) massop->concurrency) {
+        for (i = 0; massop->inflight[i]; i++)
+            ;
+        massop->inflight[i] = massop->pending[massop->next];
+        massop->pending[massop->next++] = NULL;
+        massop->dispatched[i] = now;
+        massop->ninflight++;
+        CHECKALLOC(name = strdup(massop->inflight[i]));
+        *kind = massop->kind;
+    }
+    pthread_mutex_unlock(&massop->lock);
+    return name;
+}
+
+int
+massop_finished(massop_type* massop, const char* name, int failed)
+{
+    size_t i;
+    int freed = 0;
+    pthread_mutex_lock(&massop->lock);
+    for (i = 0; massop->inflight && i < (size_t) massop->concurrency; i++) {
+        if (massop->inflight[i] && !strcmp(massop->inflight[i], name)) {
+            free(massop->inflight[i]);
+            massop->inflight[i] = NULL;
+            massop->ninflight--;
+            massop->done++;
+            if (failed) {
+                massop->failed++;
+            }
+            freed = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&massop->lock);
+    return freed;
+}
+
+int
+massop_expire(massop_type* massop, time_t now, time_t timeout)
+{
+    size_t i;
+    int freed = 0;
+    pthread_mutex_lock(&massop->lock);
+    for (i = 0; massop->inflight && i < (size_t) massop->concurrency; i++) {
+        if (massop->inflight[i] && now - massop->dispatched[i] >= timeout) {
+            ods_log_warning("[%s] zone %s did not finish %s within %ld "
+                "seconds, continuing with the next zone", massop_str,
+                massop->inflight[i], massop_kindstr[massop->kind],
+                (long) timeout);
+            free(massop->inflight[i]);
+            massop->inflight[i] = NULL;
+            massop->ninflight--;
+            massop->done++;
+            massop->failed++;
+            freed++;
+        }
+    }
+    pthread_mutex_unlock(&massop->lock);
+    return freed;
+}
+
+long
+massop_cancel(massop_type* massop)
+{
+    long dropped = -1;
+    size_t i;
+    pthread_mutex_lock(&massop->lock);
+    if (massop->next < massop->npending || massop->ninflight > 0) {
+        dropped = (long) (massop->npending - massop->next);
+        for (i = massop->next; i < massop->npending; i++) {
+            free(massop->pending[i]);
+            massop->pending[i] = NULL;
+        }
+        massop->npending = massop->next;
+        massop->cancelled = 1;
+    }
+    pthread_mutex_unlock(&massop->lock);
+    return dropped;
+}
+
+int
+massop_ready(massop_type* massop)
+{
+    int ready;
+    pthread_mutex_lock(&massop->lock);
+    ready = (massop->next < massop->npending &&
+        massop->ninflight < (size_t) massop->concurrency);
+    pthread_mutex_unlock(&massop->lock);
+    return ready;
+}
+
+int
+massop_active(massop_type* massop)
+{
+    int active;
+    pthread_mutex_lock(&massop->lock);
+    active = (massop->next < massop->npending || massop->ninflight > 0);
+    pthread_mutex_unlock(&massop->lock);
+    return active;
+}
+
+char*
+massop_describe(massop_type* massop, time_t now)
+{
+    char buf[ODS_SE_MAXLINE];
+    const char* state;
+    pthread_mutex_lock(&massop->lock);
+    if (massop->kind == MASSOP_NONE) {
+        pthread_mutex_unlock(&massop->lock);
+        return NULL;
+    }
+    if (massop->next < massop->npending || massop->ninflight > 0) {
+        state = (massop->cancelled ? "cancelled, finishing" : "running");
+    } else {
+        state = (massop->cancelled ? "cancelled" : "finished");
+    }
+    (void) snprintf(buf, sizeof(buf), "Mass %s %s for %ld seconds: %lu "
+        "done (%lu failed), %lu in progress, %lu pending, at most %d at "
+        "a time.\n", massop_kindstr[massop->kind], state,
+        (long) (now - massop->started), (unsigned long) massop->done,
+        (unsigned long) massop->failed, (unsigned long) massop->ninflight,
+        (unsigned long) (massop->npending - massop->next),
+        massop->concurrency);
+    pthread_mutex_unlock(&massop->lock);
+    return strdup(buf);
+}
+
+int
+massop_startall(engine_type* engine, massop_kind kind)
+{
+    ldns_rbnode_t* node;
+    zone_type* zone;
+    char** names;
+    time_t* urgency;
+    size_t count = 0, i;
+    int concurrency, error;
+
+    if (massop_active(engine->massop)) {
+        return 1;
+    }
+    concurrency = engine->config->signer_mass_concurrency;
+    if (concurrency <= 0) {
+        concurrency = engine->config->num_signer_threads;
+    }
+    pthread_mutex_lock(&engine->zonelist->zl_lock);
+    CHECKALLOC(names = (char**) malloc((engine->zonelist->zones->count + 1) * sizeof(char*)));
+    CHECKALLOC(urgency = (time_t*) malloc((engine->zonelist->zones->count + 1) * sizeof(time_t)));
+    for (node = ldns_rbtree_first(engine->zonelist->zones); node != LDNS_RBTREE_NULL && node != NULL; node = ldns_rbtree_next(node)) {
+        zone = (zone_type*) node->data;
+        if (zone->zl_status == ZONE_ZL_ADDED) {
+            continue;
+        }
+        if (kind == MASSOP_RETRANSFER && zone->adinbound->type != ADAPTER_DNS) {
+            continue;
+        }
+        CHECKALLOC(names[count] = strdup(zone->name));
+        /* the next resign is due before the signatures expire, zones
+         * without any scheduled work have never been signed */
+        urgency[count] = schedule_nextdue(engine->taskq, zone->name);
+        if (urgency[count] < 0) {
+            urgency[count] = 0;
+        }
+        count++;
+    }
+    pthread_mutex_unlock(&engine->zonelist->zl_lock);
+    error = massop_start(engine->massop, kind, names, urgency, count,
+        concurrency);
+    free(urgency);
+    if (error) {
+        for (i = 0; i < count; i++) {
+            free(names[i]);
+        }
+        free(names);
+        return error;
+    }
+    ods_log_info("[%s] mass %s of %lu zones started, at most %d at a time",
+        massop_str, massop_kindstr[kind], (unsigned long) count, concurrency);
+    massop_dispatch(engine);
+    return 0;
+}
+
+void
+massop_dispatch(engine_type* engine)
+{
+    zone_type* zone;
+    char* name;
+    massop_kind kind;
+    int ndispatched = 0, nretransfer = 0, skipped;
+
+    while ((name = massop_next(engine->massop, time_now(), &kind)) != NULL) {
+        skipped = 0;
+        pthread_mutex_lock(&engine->zonelist->zl_lock);
+        zone = zonelist_lookup_zone_by_name(engine->zonelist, name,
+            LDNS_RR_CLASS_IN);
+        if (!zone || zone->zl_status == ZONE_ZL_ADDED) {
+            /* removed from the zone list meanwhile */
+            skipped = 1;
+        } else if (kind == MASSOP_SIGN) {
+            schedule_scheduletask(engine->taskq, TASK_FORCEREAD, zone->name, zone, &zone->zone_lock, schedule_IMMEDIATELY);
+        } else if (kind == MASSOP_FLUSH) {
+            if (schedule_flush_owner(engine->taskq, zone->name) == 0) {
+                skipped = 1;
+            }
+        } else if (kind == MASSOP_RETRANSFER) {
+            zone->xfrd->serial_retransfer = 1;
+            xfrd_set_timer_now(zone->xfrd);
+            nretransfer++;
+        }
+        pthread_mutex_unlock(&engine->zonelist->zl_lock);
+        if (skipped) {
+            ods_log_verbose("[%s] zone %s has nothing to %s", massop_str,
+                name, massop_kindstr[kind]);
+            (void) massop_finished(engine->massop, name, 0);
+        } else {
+            ods_log_debug("[%s] zone %s dispatched for %s", massop_str,
+                name, massop_kindstr[kind]);
+            ndispatched++;
+        }
+        free(name);
+    }
+    if (nretransfer) {
+        dnshandler_fwd_notify(engine->dnshandler,
+            (uint8_t*) ODS_SE_NOTIFY_CMD, strlen(ODS_SE_NOTIFY_CMD));
+    }
+    if (ndispatched) {
+        engine_wakeup_workers(engine);
+    }
+}
+
+void
+massop_zonedone(engine_type* engine, const char* name, int failed)
+{
+    /* tasks run holding their zone lock, leave dispatching the next
+     * zones to the main thread so that no other zone is locked here */
+    if (massop_finished(engine->massop, name, failed)) {
+        pthread_mutex_lock(&engine->signal_lock);
+        pthread_cond_signal(&engine->signal_cond);
+        pthread_mutex_unlock(&engine->signal_lock);
+    }
+}
+
+void
+massop_transferdone(engine_type* engine, const char* name, int failed)
+{
+    massop_kind kind;
+    pthread_mutex_lock(&engine->massop->lock);
+    kind = engine->massop->kind;
+    pthread_mutex_unlock(&engine->massop->lock);
+    if (kind == MASSOP_RETRANSFER) {
+        massop_zonedone(engine, name, failed);
+    }
+}
+
+void
+massop_cleanup(massop_type* massop)
+{
+    if (!massop) {
+        return;
+    }
+    massop_clear(massop);
+    pthread_mutex_destroy(&massop->lock);
+    free(massop);
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2018 NLNet Labs.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Rate controlled mass operations on all zones.
+ *
+ */
+
+#ifndef DAEMON_MASSOP_H
+#define DAEMON_MASSOP_H
+
+#include "config.h"
+#include <time.h>
+
+typedef struct massop_struct massop_type;
+
+#include "locks.h"
+#include "engine.h"
+
+enum massop_kind_enum {
+    MASSOP_NONE = 0,
+    MASSOP_SIGN,       /* re-read and re-sign */
+    MASSOP_FLUSH,      /* execute the scheduled tasks of the zone */
+    MASSOP_RETRANSFER  /* retransfer from the master */
+};
+typedef enum massop_kind_enum massop_kind;
+
+/**
+ * A mass operation walks over a list of zones, most urgent first, and
+ * keeps at most concurrency of them in flight.  A zone is in flight
+ * from the moment it is dispatched until its signed output is written,
+ * its processing failed, or it took longer than ODS_SE_MASSTIMEOUT.
+ *
+ */
+struct massop_struct {
+    pthread_mutex_t lock;
+    massop_kind kind;
+    int concurrency;
+    char** pending; /* zone names, most urgent first */
+    size_t npending;
+    size_t next; /* first pending zone not yet dispatched */
+    char** inflight; /* concurrency slots, NULL when free */
+    time_t* dispatched;
+    size_t ninflight;
+    size_t done;
+    size_t failed;
+    time_t started;
+    int cancelled;
+};
+
+/**
+ * Create mass operation state, no operation is running.
+ * \return massop_type* created state
+ *
+ */
+extern massop_type* massop_create(void);
+
+/**
+ * Start a mass operation.  Takes ownership of the zone names.
+ * \param[in] massop mass operation state
+ * \param[in] kind what to do with each zone
+ * \param[in] names zone names
+ * \param[in] urgency per zone, when its signatures need attention
+ * \param[in] count number of zones
+ * \param[in] concurrency maximum number of zones in flight
+ * \return int 0 on success, 1 if an operation is still running
+ *
+ */
+extern int massop_start(massop_type* massop, massop_kind kind, char** names,
+    time_t* urgency, size_t count, int concurrency);
+
+/**
+ * Take the next zone to dispatch, if a slot is free.
+ * \param[in] massop mass operation state
+ * \param[in] now current time
+ * \param[out] kind what to do with the zone
+ * \return char* zone name to free by the caller, NULL if nothing to do
+ *
+ */
+extern char* massop_next(massop_type* massop, time_t now, massop_kind* kind);
+
+/**
+ * Mark a zone of the mass operation as finished.
+ * \param[in] massop mass operation state
+ * \param[in] name zone name
+ * \param[in] failed whether the zone failed
+ * \return int 1 if a slot was freed
+ *
+ */
+extern int massop_finished(massop_type* massop, const char* name, int failed);
+
+/**
+ * Free the slots of zones that take too long.
+ * \param[in] massop mass operation state
+ * \param[in] now current time
+ * \param[in] timeout seconds a zone may be in flight
+ * \return int number of freed slots
+ *
+ */
+extern int massop_expire(massop_type* massop, time_t now, time_t timeout);
+
+/**
+ * Cancel the mass operation.  Zones in flight are finished normally.
+ * \param[in] massop mass operation state
+ * \return long number of zones that will no longer be dispatched, or -1
+ *         if no operation was running
+ *
+ */
+extern long massop_cancel(massop_type* massop);
+
+/**
+ * Whether a zone of the mass operation can be dispatched.
+ * \param[in] massop mass operation state
+ * \return int 1 if a slot is free and zones are pending
+ *
+ */
+extern int massop_ready(massop_type* massop);
+
+/**
+ * Whether a mass operation is running.
+ * \param[in] massop mass operation state
+ * \return int 1 if running
+ *
+ */
+extern int massop_active(massop_type* massop);
+
+/**
+ * Describe the progress of the mass operation.
+ * \param[in] massop mass operation state
+ * \param[in] now current time
+ * \return char* allocated description, NULL if no operation ever ran
+ *
+ */
+extern char* massop_describe(massop_type* massop, time_t now);
+
+/**
+ * Start a mass operation on all zones of the engine.
+ * \param[in] engine engine
+ * \param[in] kind what to do with each zone
+ * \return int 0 on success, 1 if an operation is still running
+ *
+ */
+extern int massop_startall(engine_type* engine, massop_kind kind);
+
+/**
+ * Dispatch zones of the mass operation while slots are free.
+ * \param[in] engine engine
+ *
+ */
+extern void massop_dispatch(engine_type* engine);
+
+/**
+ * A zone finished processing, have the main thread dispatch the next
+ * zone of the mass operation if it was part of it.
+ * \param[in] engine engine
+ * \param[in] name zone name
+ * \param[in] failed whether processing failed
+ *
+ */
+extern void massop_zonedone(engine_type* engine, const char* name, int failed);
+
+/**
+ * A transfer of a zone ended without new data to sign, because it failed
+ * or the zone did not change.  Ends the zone's part in a retransfer.
+ * \param[in] engine signer engine
+ * \param[in] name zone name
+ * \param[in] failed whether the transfer failed
+ *
+ */
+extern void massop_transferdone(engine_type* engine, const char* name,
+    int failed);
+
+/**
+ * Clean up mass operation state.
+ * \param[in] massop mass operation state
+ *
+ */
+extern void massop_cleanup(massop_type* massop);
+
+#endif /* DAEMON_MASSOP_H */
@@ -0,0 +1,521 @@
+/*
+ * Copyright (c) 2018 NLNet Labs.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Asynchronous execution of the NotifyCommand.
+ *
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "daemon/notifyexec.h"
+#include "duration.h"
+#include "log.h"
+#include "status.h"
+
+extern char** environ;
+
+static const char* notifyexec_str = "notify";
+
+/* how often running commands are checked for completion, in ms */
+#define NOTIFYEXEC_POLL 20
+
+struct notifyexec_zone {
+    ldns_rbnode_t node;
+    char* name;
+    char** argv; /* command of the queued notification */
+    int queued;
+    int running;
+    struct notifyexec_zone* prev;
+    struct notifyexec_zone* next;
+};
+
+static int
+notifyexec_compare(const void* a, const void* b)
+{
+    return strcmp((const char*) a, (const char*) b);
+}
+
+static char**
+notifyexec_argvdup(char** argv)
+{
+    char** copy;
+    size_t i, n;
+    for (n = 0; argv[n]; n++)
+        ;
+    CHECKALLOC(copy = (char**) calloc(n + 1, sizeof(char*)));
+    for (i = 0; i < n; i++) {
+        CHECKALLOC(copy[i] = strdup(argv[i]));
+    }
+    return copy;
+}
+
+static void
+notifyexec_argvfree(char** argv)
+{
+    size_t i;
+    if (argv) {
+        for (i = 0; argv[i]; i++) {
+            free(argv[i]);
+        }
+        free(argv);
+    }
+}
+
+static int
+notifyexec_argveq(char** a, char** b)
+{
+    size_t i;
+    for (i = 0; a[i] && b[i]; i++) {
+        if (strcmp(a[i], b[i])) {
+            return 0;
+        }
+    }
+    return a[i] == b[i];
+}
+
+/* a command with the %zones placeholder takes all queued zones at once */
+static int
+notifyexec_batched(char** argv)
+{
+    size_t i;
+    for (i = 0; argv[i]; i++) {
+        if (!strcmp(argv[i], "%zones")) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void
+notifyexec_unlink(notifyexec_type* notifyexec, struct notifyexec_zone* z)
+{
+    if (z->prev) {
+        z->prev->next = z->next;
+    } else {
+        notifyexec->first = z->next;
+    }
+    if (z->next) {
+        z->next->prev = z->prev;
+    } else {
+        notifyexec->last = z->prev;
+    }
+    z->prev = z->next = NULL;
+    z->queued = 0;
+    notifyexec->nqueued--;
+}
+
+static void
+notifyexec_zonefree(struct notifyexec_zone* z)
+{
+    notifyexec_argvfree(z->argv);
+    free(z->name);
+    free(z);
+}
+
+notifyexec_type*
+notifyexec_create(int concurrency)
+{
+    notifyexec_type* notifyexec;
+    if (concurrency < 1) {
+        concurrency = 1;
+    }
+    CHECKALLOC(notifyexec = (notifyexec_type*) calloc(1, sizeof(notifyexec_type)));
+    pthread_mutex_init(&notifyexec->lock, NULL);
+    pthread_cond_init(&notifyexec->cond, NULL);
+    notifyexec->concurrency = concurrency;
+    CHECKALLOC(notifyexec->zones = ldns_rbtree_create(notifyexec_compare));
+    CHECKALLOC(notifyexec->running = (notifyexec_job_type**) calloc(concurrency, sizeof(notifyexec_job_type*)));
+    return notifyexec;
+}
+
+void
+notifyexec_enqueue(notifyexec_type* notifyexec, const char* zone, char** argv)
+{
+    struct notifyexec_zone* z;
+    ldns_rbnode_t* node;
+    if (!notifyexec || !zone || !argv || !argv[0]) {
+        return;
+    }
+    pthread_mutex_lock(&notifyexec->lock);
+    node = ldns_rbtree_search(notifyexec->zones, zone);
+    if (node && node != LDNS_RBTREE_NULL) {
+        z = (struct notifyexec_zone*) node;
+        notifyexec_argvfree(z->argv);
+        z->argv = notifyexec_argvdup(argv);
+        if (z->queued) {
+            ods_log_debug("[%s] notify for zone %s already queued",
+                notifyexec_str, zone);
+            pthread_mutex_unlock(&notifyexec->lock);
+            return;
+        }
+    } else {
+        CHECKALLOC(z = (struct notifyexec_zone*) calloc(1, sizeof(struct notifyexec_zone)));
+        CHECKALLOC(z->name = strdup(zone));
+        z->argv = notifyexec_argvdup(argv);
+        z->node.key = z->name;
+        z->node.data = z;
+        ldns_rbtree_insert(notifyexec->zones, &z->node);
+    }
+    z->queued = 1;
+    z->prev = notifyexec->last;
+    if (notifyexec->last) {
+        notifyexec->last->next = z;
+    } else {
+        notifyexec->first = z;
+    }
+    notifyexec->last = z;
+    notifyexec->nqueued++;
+    pthread_cond_signal(&notifyexec->cond);
+    pthread_mutex_unlock(&notifyexec->lock);
+}
+
+notifyexec_job_type*
+notifyexec_take(notifyexec_type* notifyexec, time_t now)
+{
+    notifyexec_job_type* job;
+    struct notifyexec_zone* z;
+    struct notifyexec_zone* next;
+    struct notifyexec_zone** batch;
+    char** cmd;
+    size_t i, j, k, n, argc, nholders;
+    pthread_mutex_lock(&notifyexec->lock);
+    if (notifyexec->nrunning >= (size_t) notifyexec->concurrency) {
+        pthread_mutex_unlock(&notifyexec->lock);
+        return NULL;
+    }
+    /* a zone whose command still runs waits for it to finish */
+    for (z = notifyexec->first; z && z->running; z = z->next)
+        ;
+    if (!z) {
+        pthread_mutex_unlock(&notifyexec->lock);
+        return NULL;
+    }
+    CHECKALLOC(job = (notifyexec_job_type*) calloc(1, sizeof(notifyexec_job_type)));
+    job->pid = -1;
+    job->started = now;
+    cmd = z->argv;
+    z->argv = NULL;
+    n = 1;
+    CHECKALLOC(batch = (struct notifyexec_zone**) malloc(NOTIFYEXEC_MAXBATCH * sizeof(struct notifyexec_zone*)));
+    batch[0] = z;
+    if (notifyexec_batched(cmd)) {
+        for (next = z->next; next && n < NOTIFYEXEC_MAXBATCH; next = next->next) {
+            if (!next->running && notifyexec_argveq(cmd, next->argv)) {
+                batch[n++] = next;
+            }
+        }
+        for (argc = 0, nholders = 0; cmd[argc]; argc++) {
+            if (!strcmp(cmd[argc], "%zones")) {
+                nholders++;
+            }
+        }
+        CHECKALLOC(job->argv = (char**) calloc(argc - nholders + nholders * n + 1, sizeof(char*)));
+        for (i = 0, k = 0; i < argc; i++) {
+            if (strcmp(cmd[i], "%zones")) {
+                CHECKALLOC(job->argv[k++] = strdup(cmd[i]));
+                continue;
+            }
+            for (j = 0; j < n; j++) {
+                CHECKALLOC(job->argv[k++] = strdup(batch[j]->name));
+            }
+        }
+        notifyexec_argvfree(cmd);
+    } else {
+        job->argv = cmd;
+    }
+    CHECKALLOC(job->zones = (char**) calloc(n, sizeof(char*)));
+    job->nzones = n;
+    for (i = 0; i < n; i++) {
+        CHECKALLOC(job->zones[i] = strdup(batch[i]->name));
+        if (batch[i]->argv) {
+            notifyexec_argvfree(batch[i]->argv);
+            batch[i]->argv = NULL;
+        }
+        notifyexec_unlink(notifyexec, batch[i]);
+        batch[i]->running = 1;
+    }
+    free(batch);
+    for (i = 0; notifyexec->running[i]; i++)
+        ;
+    notifyexec->running[i] = job;
+    notifyexec->nrunning++;
+    pthread_mutex_unlock(&notifyexec->lock);
+    return job;
+}
+
+void
+notifyexec_finish(notifyexec_type* notifyexec, notifyexec_job_type* job)
+{
+    struct notifyexec_zone* z;
+    ldns_rbnode_t* node;
+    size_t i;
+    pthread_mutex_lock(&notifyexec->lock);
+    for (i = 0; i < job->nzones; i++) {
+        node = ldns_rbtree_search(notifyexec->zones, job->zones[i]);
+        if (node && node != LDNS_RBTREE_NULL) {
+            z = (struct notifyexec_zone*) node;
+            z->running = 0;
+            if (!z->queued) {
+                (void) ldns_rbtree_delete(notifyexec->zones, z->name);
+                notifyexec_zonefree(z);
+            }
+        }
+        free(job->zones[i]);
+    }
+    for (i = 0; i < (size_t) notifyexec->concurrency; i++) {
+        if (notifyexec->running[i] == job) {
+            notifyexec->running[i] = NULL;
+            notifyexec->nrunning--;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&notifyexec->lock);
+    free(job->zones);
+    notifyexec_argvfree(job->argv);
+    free(job);
+}
+
+#ifndef HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP
+static void
+notifyexec_closefrom(int fd)
+{
+#ifdef HAVE_CLOSEFROM
+    closefrom(fd);
+#else
+    int fdlimit = sysconf(_SC_OPEN_MAX);
+    while (fd < fdlimit) {
+        close(fd++);
+    }
+#endif
+}
+#endif
+
+/**
+ * Start the command with stdin, stdout and stderr on /dev/null and
+ * none of the other descriptors of the signer.  The signer threads
+ * block all signals, the command starts with the default signal mask
+ * and dispositions.
+ *
+ */
+static pid_t
+notifyexec_spawn(char** argv)
+{
+    pid_t pid = -1;
+    sigset_t sigset;
+#ifdef HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    int err;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, 1, 2);
+    posix_spawn_file_actions_addclosefrom_np(&actions, 3);
+    posix_spawnattr_init(&attr);
+    sigemptyset(&sigset);
+    posix_spawnattr_setsigmask(&attr, &sigset);
+    sigaddset(&sigset, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attr, &sigset);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+    err = posix_spawnp(&pid, argv[0], &actions, &attr, argv, environ);
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    if (err) {
+        errno = err;
+        return -1;
+    }
+#else
+    int fd;
+    switch ((pid = fork())) {
+        case -1:
+            break;
+        case 0:
+            if ((fd = open("/dev/null", O_RDWR)) != -1) {
+                dup2(fd, 0);
+                dup2(fd, 1);
+                dup2(fd, 2);
+            }
+            notifyexec_closefrom(3);
+            signal(SIGPIPE, SIG_DFL);
+            sigemptyset(&sigset);
+            sigprocmask(SIG_SETMASK, &sigset, NULL);
+            execvp(argv[0], argv);
+            _exit(127);
+        default:
+            break;
+    }
+#endif
+    return pid;
+}
+
+static void
+notifyexec_log(notifyexec_job_type* job, int status)
+{
+    char what[64];
+    if (job->nzones == 1) {
+        snprintf(what, sizeof(what), "zone %s", job->zones[0]);
+    } else {
+        snprintf(what, sizeof(what), "%lu zones", (unsigned long) job->nzones);
+    }
+    if (!WIFEXITED(status)) {
+        ods_log_error("[%s] notify nameserver failed for %s: notify command "
+            "did not terminate normally", notifyexec_str, what);
+    } else if (WEXITSTATUS(status) != 0) {
+        ods_log_error("[%s] notify nameserver failed for %s: notify command "
+            "exited with status %d", notifyexec_str, what,
+            WEXITSTATUS(status));
+    } else {
+        ods_log_verbose("[%s] notify nameserver ok for %s (%ld seconds)",
+            notifyexec_str, what, (long) (time_now() - job->started));
+    }
+}
+
+/* reap the commands that finished, only the executor thread does this */
+static void
+notifyexec_reap(notifyexec_type* notifyexec)
+{
+    notifyexec_job_type* job;
+    pid_t wpid;
+    size_t i;
+    int status;
+    for (i = 0; i < (size_t) notifyexec->concurrency; i++) {
+        pthread_mutex_lock(&notifyexec->lock);
+        job = notifyexec->running[i];
+        pthread_mutex_unlock(&notifyexec->lock);
+        if (!job) {
+            continue;
+        }
+        while ((wpid = waitpid(job->pid, &status, WNOHANG)) == -1 &&
+            errno == EINTR)
+            ;
+        if (wpid == 0) {
+            continue;
+        }
+        if (wpid == -1) {
+            ods_log_error("[%s] notify nameserver failed: waitpid() failed "
+                "(%s)", notifyexec_str, strerror(errno));
+        } else {
+            notifyexec_log(job, status);
+        }
+        notifyexec_finish(notifyexec, job);
+    }
+}
+
+void
+notifyexec_start(notifyexec_type* notifyexec)
+{
+    notifyexec_job_type* job;
+    struct timespec deadline;
+    ods_log_debug("[%s] start notify executor, at most %d commands at a "
+        "time", notifyexec_str, notifyexec->concurrency);
+    for (;;) {
+        notifyexec_reap(notifyexec);
+        while (!notifyexec->need_to_exit &&
+            (job = notifyexec_take(notifyexec, time_now()))) {
+            ods_log_debug("[%s] run notify command %s for %lu zone(s)",
+                notifyexec_str, job->argv[0], (unsigned long) job->nzones);
+            if ((job->pid = notifyexec_spawn(job->argv)) == -1) {
+                ods_log_error("[%s] notify nameserver failed: unable to "
+                    "start %s (%s)", notifyexec_str, job->argv[0],
+                    strerror(errno));
+                notifyexec_finish(notifyexec, job);
+            }
+        }
+        pthread_mutex_lock(&notifyexec->lock);
+        if (notifyexec->need_to_exit) {
+            pthread_mutex_unlock(&notifyexec->lock);
+            break;
+        }
+        if (notifyexec->nrunning > 0) {
+            /* no SIGCHLD reaches this thread, poll the commands */
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += NOTIFYEXEC_POLL * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&notifyexec->cond, &notifyexec->lock,
+                &deadline);
+        } else if (notifyexec->nqueued == 0) {
+            pthread_cond_wait(&notifyexec->cond, &notifyexec->lock);
+        }
+        pthread_mutex_unlock(&notifyexec->lock);
+    }
+    if (notifyexec->nqueued > 0) {
+        ods_log_warning("[%s] dropping %lu queued notify commands on "
+            "shutdown", notifyexec_str, (unsigned long) notifyexec->nqueued);
+    }
+    ods_log_debug("[%s] notify executor stopped", notifyexec_str);
+}
+
+void
+notifyexec_stop(notifyexec_type* notifyexec)
+{
+    if (!notifyexec) {
+        return;
+    }
+    pthread_mutex_lock(&notifyexec->lock);
+    notifyexec->need_to_exit = 1;
+    pthread_cond_signal(&notifyexec->cond);
+    pthread_mutex_unlock(&notifyexec->lock);
+}
+
+static void
+notifyexec_zonenode_free(ldns_rbnode_t* node, void* arg)
+{
+    (void) arg;
+    notifyexec_zonefree((struct notifyexec_zone*) node);
+}
+
+void
+notifyexec_cleanup(notifyexec_type* notifyexec)
+{
+    size_t i;
+    if (!notifyexec) {
+        return;
+    }
+    for (i = 0; i < (size_t) notifyexec->concurrency; i++) {
+        if (notifyexec->running[i]) {
+            notifyexec_finish(notifyexec, notifyexec->running[i]);
+        }
+    }
+    ldns_traverse_postorder(notifyexec->zones, notifyexec_zonenode_free, NULL);
+    ldns_rbtree_free(notifyexec->zones);
+    free(notifyexec->running);
+    pthread_mutex_destroy(&notifyexec->lock);
+    pthread_cond_destroy(&notifyexec->cond);
+    free(notifyexec);
+}
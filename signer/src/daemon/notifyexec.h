@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2018 NLNet Labs.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Asynchronous execution of the NotifyCommand.
+ *
+ */
+
+#ifndef DAEMON_NOTIFYEXEC_H
+#define DAEMON_NOTIFYEXEC_H
+
+#include "config.h"
+#include <sys/types.h>
+#include <time.h>
+#include <ldns/ldns.h>
+
+typedef struct notifyexec_struct notifyexec_type;
+
+#include "janitor.h"
+#include "locks.h"
+
+/* maximum number of zone names passed to one batched invocation */
+#define NOTIFYEXEC_MAXBATCH 256
+
+/**
+ * One invocation of the notify command, for one zone or for a batch of
+ * zones if the command contains the %zones placeholder.
+ *
+ */
+typedef struct notifyexec_job_struct notifyexec_job_type;
+struct notifyexec_job_struct {
+    char** argv;
+    char** zones;
+    size_t nzones;
+    pid_t pid;
+    time_t started;
+};
+
+/**
+ * Notify commands are queued per zone.  A zone queued again before its
+ * command was started is only notified once, with the latest command.
+ * A zone queued while its command runs is notified again once that
+ * command finished, so the nameserver always sees the latest output.
+ *
+ */
+struct notifyexec_struct {
+    janitor_thread_t thread_id;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int concurrency;
+    ldns_rbtree_t* zones; /* queued or running zones by name */
+    struct notifyexec_zone* first; /* queued zones, oldest first */
+    struct notifyexec_zone* last;
+    size_t nqueued;
+    notifyexec_job_type** running; /* concurrency slots, NULL when free */
+    size_t nrunning;
+    unsigned need_to_exit : 1;
+    unsigned started : 1;
+};
+
+/**
+ * Create notify executor, nothing is run before its thread is started.
+ * \param[in] concurrency maximum number of commands running at once
+ * \return notifyexec_type* created executor
+ *
+ */
+extern notifyexec_type* notifyexec_create(int concurrency);
+
+/**
+ * Queue the notify command of a zone.  The arguments are copied.
+ * \param[in] notifyexec executor
+ * \param[in] zone zone name
+ * \param[in] argv command and arguments, NULL terminated
+ *
+ */
+extern void notifyexec_enqueue(notifyexec_type* notifyexec, const char* zone,
+    char** argv);
+
+/**
+ * Take the next command to run, if a slot is free.  Batched commands
+ * are combined with the other queued zones having the same command.
+ * \param[in] notifyexec executor
+ * \param[in] now current time
+ * \return notifyexec_job_type* job, NULL if nothing to do
+ *
+ */
+extern notifyexec_job_type* notifyexec_take(notifyexec_type* notifyexec,
+    time_t now);
+
+/**
+ * A job finished, free its slot and the job.
+ * \param[in] notifyexec executor
+ * \param[in] job job returned by notifyexec_take
+ *
+ */
+extern void notifyexec_finish(notifyexec_type* notifyexec,
+    notifyexec_job_type* job);
+
+/**
+ * Run the executor, the body of its thread.
+ * \param[in] notifyexec executor
+ *
+ */
+extern void notifyexec_start(notifyexec_type* notifyexec);
+
+/**
+ * Have the executor thread exit.  Queued commands are dropped, running
+ * commands are left to finish on their own.
+ * \param[in] notifyexec executor
+ *
+ */
+extern void notifyexec_stop(notifyexec_type* notifyexec);
+
+/**
+ * Clean up notify executor.
+ * \param[in] notifyexec executor
+ *
+ */
+extern void notifyexec_cleanup(notifyexec_type* notifyexec);
+
+#endif /* DAEMON_NOTIFYEXEC_H */
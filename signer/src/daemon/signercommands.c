@@ -77,8 +77,9 @@ cmdhandler_handle_cmd_help(int sockfd, cmdhandler_ctx_type* context, char *cmd)
                                     "(re-)sign.\n"
         "                            If a serial is given, that serial is used "
                                     "in the output zone.\n"
-        "sign --all                  Read all zones and schedule all for "
-                                    "immediate (re-)sign.\n"
+        "sign --all                  Read all zones and (re-)sign them, "
+                                    "most urgent first,\n"
+        "                            at most MassConcurrency at a time.\n"
     );
     client_printf(sockfd, "%s", buf);
 
@@ -88,8 +89,10 @@ cmdhandler_handle_cmd_help(int sockfd, cmdhandler_ctx_type* context, char *cmd)
         "                            All signatures will be regenerated "
                                     "on the next re-sign.\n"
         "queue                       Show the current task queue.\n"
-        "flush                       Execute all scheduled tasks "
-                                    "immediately.\n"
+        "flush                       Execute all scheduled tasks, "
+                                    "most urgent zones first.\n"
+        "cancel                      Cancel a running sign --all, flush "
+                                    "or retransfer --all.\n"
     );
     client_printf(sockfd, "%s", buf);
 
@@ -99,11 +102,15 @@ cmdhandler_handle_cmd_help(int sockfd, cmdhandler_ctx_type* context, char *cmd)
         "update [--all]              Update zone list and all signer "
                                     "configurations.\n"
         "retransfer <zone>           Retransfer the zone from the master.\n"
+        "retransfer --all            Retransfer all zones from their "
+                                    "masters, most urgent first.\n"
         "start                       Start the engine.\n"
         "running                     Check if the engine is running.\n"
         "reload                      Reload the engine.\n"
         "stop                        Stop the engine.\n"
         "verbosity <nr>              Set verbosity.\n"
+        "memory [<zone>]             Show the memory used by the zones, "
+                                    "per view for a single zone.\n"
     );
     client_printf(sockfd, "%s", buf);
     return 0;
@@ -142,12 +149,91 @@ cmdhandler_handle_cmd_zones(int sockfd, cmdhandler_ctx_type* context, char *cmd)
         }
         (void)snprintf(buf, ODS_SE_MAXLINE, "- %s\n", zone->name);
         client_printf(sockfd, "%s", buf);
+        if (zone->stats && zone->stats->push_count) {
+            pthread_mutex_lock(&zone->stats->stats_lock);
+            client_printf(sockfd, "  pushed changes: %u, latency last %u max %u avg %u (msec)\n",
+                (unsigned) zone->stats->push_count,
+                (unsigned) zone->stats->push_latency_last,
+                (unsigned) zone->stats->push_latency_max,
+                (unsigned) (zone->stats->push_latency_total / zone->stats->push_count));
+            pthread_mutex_unlock(&zone->stats->stats_lock);
+        }
         node = ldns_rbtree_next(node);
     }
     pthread_mutex_unlock(&engine->zonelist->zl_lock);
     return 0;
 }
 
+static void
+printmemory(int sockfd, zone_type* zone, int perview)
+{
+    int i, measured, evicted;
+    size_t total;
+    struct stats_memory memory[STATS_NVIEWS];
+    time_t when;
+    measured = zonelist_zonememory(zone, &evicted);
+    pthread_mutex_lock(&zone->stats->stats_lock);
+    memcpy(memory, zone->stats->mem_views, sizeof(memory));
+    total = stats_memory(zone->stats);
+    when = zone->stats->mem_time;
+    pthread_mutex_unlock(&zone->stats->stats_lock);
+    client_printf(sockfd, "%-30s %9lu kbytes%s%s\n", zone->name,
+        (unsigned long) (total / 1024), (evicted ? " (evicted)" : ""),
+        (measured ? "" : (when ? " (in use, earlier measurement)" : " (in use, not measured)")));
+    if (!perview)
+        return;
+    client_printf(sockfd, "  %-10s %9s %9s %10s %10s %9s\n", "view", "records",
+        "indices", "recordsets", "signatures", "changelog");
+    for (i = 0; i < STATS_NVIEWS; i++) {
+        if (!memory[i].view)
+            continue;
+        client_printf(sockfd, "  %-10s %9lu %9lu %10lu %10lu %9lu\n", memory[i].view,
+            (unsigned long) memory[i].records,
+            (unsigned long) (memory[i].indices / 1024),
+            (unsigned long) (memory[i].recordsets / 1024),
+            (unsigned long) (memory[i].signatures / 1024),
+            (unsigned long) (memory[i].changelog / 1024));
+    }
+}
+
+/**
+ * Handle the 'memory' command.
+ *
+ */
+static int
+cmdhandler_handle_cmd_memory(int sockfd, cmdhandler_ctx_type* context, char *cmd)
+{
+    engine_type* engine;
+    ldns_rbnode_t* node;
+    zone_type* zone;
+    const char* zonename;
+    size_t total = 0;
+    engine = getglobalcontext(context);
+    zonename = cmdargument(cmd, NULL, NULL);
+    pthread_mutex_lock(&engine->zonelist->zl_lock);
+    if (zonename) {
+        zone = zonelist_lookup_zone_by_name(engine->zonelist, zonename, LDNS_RR_CLASS_IN);
+        if (!zone) {
+            client_printf(sockfd, "Error: Zone %s not found.\n", zonename);
+        } else {
+            printmemory(sockfd, zone, 1);
+            client_printf(sockfd, "sizes in kbytes\n");
+        }
+    } else {
+        for (node = ldns_rbtree_first(engine->zonelist->zones); node != LDNS_RBTREE_NULL; node = ldns_rbtree_next(node)) {
+            zone = (zone_type*) node->data;
+            printmemory(sockfd, zone, 0);
+            pthread_mutex_lock(&zone->stats->stats_lock);
+            total += stats_memory(zone->stats);
+            pthread_mutex_unlock(&zone->stats->stats_lock);
+        }
+        client_printf(sockfd, "%-30s %9lu kbytes in %lu zones\n", "total",
+            (unsigned long) (total / 1024), (unsigned long) engine->zonelist->zones->count);
+    }
+    pthread_mutex_unlock(&engine->zonelist->zl_lock);
+    return 0;
+}
+
 void
 command_update(engine_type* engine, ods_status* zonelistchangestatus, int* addedptr, int* removedptr, int* updatedptr)
 {
@@ -265,6 +351,17 @@ cmdhandler_handle_cmd_retransfer(int sockfd, cmdhandler_ctx_type* context, char
     zone_type* zone = NULL;
     engine = getglobalcontext(context);
     ods_log_assert(engine->taskq);
+    if (cmdargument(cmd, "--all", NULL)) {
+        if (massop_startall(engine, MASSOP_RETRANSFER)) {
+            client_printf(sockfd, "Error: A mass operation is still "
+                "running, see queue or use cancel.\n");
+            return 1;
+        }
+        client_printf(sockfd, "All zones being re-transfered, most urgent "
+            "first.\n");
+        ods_log_verbose("[%s] all zones being re-transfered", cmdh_str);
+        return 0;
+    }
     /* look up zone */
     pthread_mutex_lock(&engine->zonelist->zl_lock);
     zone = zonelist_lookup_zone_by_name(engine->zonelist, cmdargument(cmd, NULL, ""),
@@ -324,7 +421,6 @@ forceread(engine_type* engine, zone_type *zone, int force_serial, uint32_t seria
 static int
 cmdhandler_handle_cmd_sign(int sockfd, cmdhandler_ctx_type* context, char *cmd)
 {
-    ldns_rbnode_t* node;
     engine_type* engine;
     zone_type *zone = NULL;
     ods_status status = ODS_STATUS_OK;
@@ -333,14 +429,13 @@ cmdhandler_handle_cmd_sign(int sockfd, cmdhandler_ctx_type* context, char *cmd)
     engine = getglobalcontext(context);
     ods_log_assert(engine->taskq);
     if (cmdargument(cmd, "--all", NULL)) {
-        pthread_mutex_lock(&engine->zonelist->zl_lock);
-        for (node = ldns_rbtree_first(engine->zonelist->zones); node != LDNS_RBTREE_NULL && node != NULL; node = ldns_rbtree_next(node)) {
-            zone = (zone_type*) node->data;
-            forceread(engine, zone, 0, 0, sockfd);
+        if (massop_startall(engine, MASSOP_SIGN)) {
+            client_printf(sockfd, "Error: A mass operation is still "
+                "running, see queue or use cancel.\n");
+            return 1;
         }
-        pthread_mutex_unlock(&engine->zonelist->zl_lock);
-        engine_wakeup_workers(engine);
-        client_printf(sockfd, "All zones scheduled for immediate re-sign.\n");
+        client_printf(sockfd, "All zones scheduled for re-sign, most urgent "
+            "first.\n");
     } else {
         char* delim1 = strchr(cmdargument(cmd, NULL, ""), ' ');
         char* delim2 = NULL;
@@ -416,6 +511,11 @@ cmdhandler_handle_cmd_queue(int sockfd, cmdhandler_ctx_type* context, char *cmd)
     ldns_rbnode_t* node = LDNS_RBTREE_NULL;
     task_type* task = NULL;
     engine = getglobalcontext(context);
+    /* progress of the mass operation */
+    if ((taskdesc = massop_describe(engine->massop, time_now())) != NULL) {
+        client_printf(sockfd, "%s", taskdesc);
+        free(taskdesc);
+    }
     if (!engine->taskq || !engine->taskq->tasks) {
         (void)snprintf(buf, ODS_SE_MAXLINE, "There are no tasks scheduled.\n");
         client_printf(sockfd, "%s", buf);
@@ -461,11 +561,41 @@ cmdhandler_handle_cmd_flush(int sockfd, cmdhandler_ctx_type* context, char *cmd)
     char buf[ODS_SE_MAXLINE];
     engine = getglobalcontext(context);
     ods_log_assert(engine->taskq);
-    schedule_flush(engine->taskq);
-    engine_wakeup_workers(engine);
-    (void)snprintf(buf, ODS_SE_MAXLINE, "All tasks scheduled immediately.\n");
+    if (massop_startall(engine, MASSOP_FLUSH)) {
+        (void)snprintf(buf, ODS_SE_MAXLINE, "Error: A mass operation is "
+            "still running, see queue or use cancel.\n");
+        client_printf(sockfd, "%s", buf);
+        return 1;
+    }
+    (void)snprintf(buf, ODS_SE_MAXLINE, "All tasks scheduled, most urgent "
+        "zones first.\n");
+    client_printf(sockfd, "%s", buf);
+    ods_log_verbose("[%s] all tasks scheduled", cmdh_str);
+    return 0;
+}
+
+
+/**
+ * Handle the 'cancel' command.
+ *
+ */
+static int
+cmdhandler_handle_cmd_cancel(int sockfd, cmdhandler_ctx_type* context, char *cmd)
+{
+    engine_type* engine;
+    char buf[ODS_SE_MAXLINE];
+    long dropped;
+    engine = getglobalcontext(context);
+    dropped = massop_cancel(engine->massop);
+    if (dropped < 0) {
+        (void)snprintf(buf, ODS_SE_MAXLINE, "No mass operation running.\n");
+    } else {
+        (void)snprintf(buf, ODS_SE_MAXLINE, "Mass operation cancelled, %ld "
+            "zones skipped, zones in progress will finish.\n", dropped);
+        ods_log_verbose("[%s] mass operation cancelled, %ld zones skipped",
+            cmdh_str, dropped);
+    }
     client_printf(sockfd, "%s", buf);
-    ods_log_verbose("[%s] all tasks scheduled immediately", cmdh_str);
     return 0;
 }
 
@@ -614,6 +744,7 @@ struct cmd_func_block zonesCmdDef = { "zones", NULL, NULL, NULL, &cmdhandler_han
 struct cmd_func_block signCmdDef = { "sign", NULL, NULL, NULL, &cmdhandler_handle_cmd_sign };
 struct cmd_func_block queueCmdDef = { "queue", NULL, NULL, NULL, &cmdhandler_handle_cmd_queue };
 struct cmd_func_block flushCmdDef = { "flush", NULL, NULL, NULL, &cmdhandler_handle_cmd_flush };
+struct cmd_func_block cancelCmdDef = { "cancel", NULL, NULL, NULL, &cmdhandler_handle_cmd_cancel };
 struct cmd_func_block updateCmdDef = { "update", NULL, NULL, NULL, &cmdhandler_handle_cmd_update };
 struct cmd_func_block stopCmdDef = { "stop", NULL, NULL, NULL, &cmdhandler_handle_cmd_stop };
 struct cmd_func_block startCmdDef = { "start", NULL, NULL, NULL, &cmdhandler_handle_cmd_start };
@@ -621,6 +752,7 @@ struct cmd_func_block reloadCmdDef = { "reload", NULL, NULL, NULL, &cmdhandler_h
 struct cmd_func_block retransferCmdDef = { "retransfer", NULL, NULL, NULL, &cmdhandler_handle_cmd_retransfer };
 struct cmd_func_block runningCmdDef = { "running", NULL, NULL, NULL, &cmdhandler_handle_cmd_running };
 struct cmd_func_block verbosityCmdDef = { "verbosity", NULL, NULL, NULL, &cmdhandler_handle_cmd_verbosity };
+struct cmd_func_block memoryCmdDef = { "memory", NULL, NULL, NULL, &cmdhandler_handle_cmd_memory };
 struct cmd_func_block timeleapCmdDef = { "time leap", NULL, NULL, NULL, &cmdhandler_handle_cmd_timeleap };
 
 struct cmd_func_block* signcommands[] = {
@@ -629,6 +761,7 @@ struct cmd_func_block* signcommands[] = {
     &signCmdDef,
     &queueCmdDef,
     &flushCmdDef,
+    &cancelCmdDef,
     &updateCmdDef,
     &stopCmdDef,
     &startCmdDef,
@@ -636,6 +769,7 @@ struct cmd_func_block* signcommands[] = {
     &retransferCmdDef,
     &runningCmdDef,
     &verbosityCmdDef,
+    &memoryCmdDef,
     &timeleapCmdDef,
     NULL
 };
@@ -210,13 +210,13 @@ rrset_sign(signconf_type* signconf, names_view_type view, recordset_type record,
     struct rrsigkeymatching* matchedsignatures;
     names_recordlookupall(record, rrtype, NULL, &rrset, &signatures);
     rrsigkeymatching(signconf, signatures, &matchedsignatures, &nmatchedsignatures);
-    free(signatures);
 
     /* Transmogrify rrset */
     if (ldns_rr_list_rr_count(rrset) <= 0) {
         /* Empty RRset, no signatures needed */
-        if(rrset) ldns_rr_list_free(rrset);
+        if(rrset) ldns_rr_list_deep_free(rrset);
         free(matchedsignatures);
+        names_recordfreesignatures(signatures);
         return 0;
     }
 
@@ -234,13 +234,15 @@ rrset_sign(signconf_type* signconf, names_view_type view, recordset_type record,
 
     /* Skip delegation, glue and occluded RRsets */
     if (dstatus != LDNS_RR_TYPE_SOA) {
-        if(rrset) ldns_rr_list_free(rrset);
+        if(rrset) ldns_rr_list_deep_free(rrset);
         free(matchedsignatures);
+        names_recordfreesignatures(signatures);
         return 0;
     }
     if (delegpt != LDNS_RR_TYPE_SOA && rrtype != LDNS_RR_TYPE_DS) {
-        if(rrset) ldns_rr_list_free(rrset);
+        if(rrset) ldns_rr_list_deep_free(rrset);
         free(matchedsignatures);
+        names_recordfreesignatures(signatures);
         return 0;
     }
     
@@ -322,12 +324,13 @@ rrset_sign(signconf_type* signconf, names_view_type view, recordset_type record,
             rrsig = lhsm_sign(ctx, rrset, matchedsignatures[i].key, inception, expiration);
             if (rrsig == NULL) {
                 ods_log_crit("unable to sign RRset[%i]: lhsm_sign() failed", rrtype);
-                if(rrset) ldns_rr_list_free(rrset);
+                if(rrset) ldns_rr_list_deep_free(rrset);
                 free(matchedsignatures);
+                names_recordfreesignatures(signatures);
                 return ODS_STATUS_HSM_ERR;
             }
             /* Add signature */
-            names_recordaddsignature(record, rrtype, rrsig, strdup(matchedsignatures[i].key->locator), matchedsignatures[i].key->flags);
+            names_recordaddsignature(record, rrtype, rrsig, matchedsignatures[i].key->locator, matchedsignatures[i].key->flags);
             newsigs++;
         }
         /* Add signatures for DNSKEY if have been configured to be added explicitjy */
@@ -340,8 +343,9 @@ rrset_sign(signconf_type* signconf, names_view_type view, recordset_type record,
                     ods_log_error("unable to publish dnskeys for zone %s: error decoding literal dnskey", signconf->name);
                     if(apex)
                         ldns_rdf_free(apex);
-                    if(rrset) ldns_rr_list_free(rrset);
+                    if(rrset) ldns_rr_list_deep_free(rrset);
                     free(matchedsignatures);
+                    names_recordfreesignatures(signatures);
                     return status;
                 }
                 /* Add signature */
@@ -354,8 +358,9 @@ rrset_sign(signconf_type* signconf, names_view_type view, recordset_type record,
     }
 
     /* RRset signing completed */
-    if(rrset) ldns_rr_list_free(rrset);
+    if(rrset) ldns_rr_list_deep_free(rrset);
     free(matchedsignatures);
+    names_recordfreesignatures(signatures);
     return 0;
 }
 
@@ -637,6 +642,7 @@ zone_update_serial(zone_type* zone, names_view_type view)
         serial = ldns_rdf2native_int32(ldns_rr_rdf(rr, 2));
         zone->inboundserial = malloc(sizeof(uint16_t));
         *(zone->inboundserial) = serial;
+        ldns_rr_free(rr);
         rr = NULL;
     }
     /* FIXME set min TTL from signconf */
@@ -656,7 +662,6 @@ zone_update_serial(zone_type* zone, names_view_type view)
         names_recordsetvalidfrom(d, serial);
     }
     names_recordlookupone(d, LDNS_RR_TYPE_SOA, NULL, &rr);
-    rr = ldns_rr_clone(rr);;
     names_recorddelall(d, LDNS_RR_TYPE_SOA);
     if(zone->outboundserial)
         free(zone->outboundserial);
@@ -85,15 +85,15 @@ worker_queue_domain(struct worker_context* context, fifoq_type* q, void* item, l
 
 
 /**
- * Queue zone for signing.
+ * Queue zone for signing, all domains that are unsigned or whose
+ * signatures expire before refreshtime.
  *
  */
 static void
-worker_queue_zone(struct worker_context* context, fifoq_type* q, names_view_type view, long* nsubtasks)
+worker_queue_zone(struct worker_context* context, fifoq_type* q, names_view_type view, time_t refreshtime, long* nsubtasks)
 {
     names_iterator iter;
     recordset_type record;
-    time_t refreshtime = context->clock_in + duration2time(context->zone->signconf->sig_refresh_interval);
     for(iter=names_viewiterator(view,names_iteratorexpiring,refreshtime); names_iterate(&iter,&record); names_advance(&iter,NULL)) {
         names_amend(view, record);
         worker_queue_domain(context, q, record, nsubtasks);
@@ -151,7 +151,7 @@ signdomain(struct worker_context* superior, hsm_ctx_t* ctx, recordset_type recor
         if(rrsigexpirationtime < expiration)
             expiration = rrsigexpirationtime;
     }
-    free(rrsigs);
+    names_recordfreesignatures(rrsigs);
     names_recordsetexpiry(record, expiration);
     logger_message(&names_logsigning,logger_noctx,logger_DEBUG,"signed %s expiration %ld\n",names_recordgetname(record),expiration);
     return ODS_STATUS_OK;
@@ -361,13 +361,13 @@ preparesign(names_view_type prepareview, int newserial)
     assert(!conflict);
 }
 
-time_t
-do_signzone(task_type* task, const char* zonename, void* zonearg, void *contextarg)
+/* A pushed sign only signs the domains that changed, leaving the
+ * signatures that are due for refresh to the scheduled resign. */
+static time_t
+signzone(task_type* task, zone_type* zone, struct worker_context* context, int pushed)
 {
-    struct worker_context* context = contextarg;
     engine_type* engine = context->engine;
     worker_type* worker = context->worker;
-    zone_type* zone = zonearg;
     ods_status status;
     time_t start = 0;
     time_t end = 0;
@@ -378,10 +378,15 @@ do_signzone(task_type* task, const char* zonename, void* zonearg, void *contexta
     recordset_type record;
     struct dual change;
     names_iterator iter;
+    time_t refreshtime;
     time_t returnscheduletime = schedule_SUCCESS;
 
     context->clock_in = time_now();
     context->zone = zone;
+    /* pushed changes from here on need another sign */
+    if (zone->stats) {
+        stats_push_signing(zone->stats);
+    }
     if (!zone->nextserial) {
         namedb_update_serial(zone);
     }
@@ -398,6 +403,7 @@ do_signzone(task_type* task, const char* zonename, void* zonearg, void *contexta
         ods_log_error("[%s] unable to sign zone %s: failed to increment serial", worker->name, task->owner);
         ods_log_crit("[%s] CRITICAL: failed to sign zone %s: %s",
                 worker->name, task->owner, ods_status2str(status));
+        massop_zonedone(engine, zone->name, 1);
         return schedule_DEFER; /* backoff */
     }
     conflict = names_viewcommit(prepareview);
@@ -445,15 +451,18 @@ do_signzone(task_type* task, const char* zonename, void* zonearg, void *contexta
         pthread_mutex_unlock(&engine->signal_lock);
         ods_log_crit("[%s] CRITICAL: failed to sign zone %s: %s",
                 worker->name, task->owner, ods_status2str(status));
+        massop_zonedone(engine, zone->name, 1);
         return schedule_DEFER; /* backoff */
     }
     /* prepare keys */
     status = zone_prepare_keys(zone);
     if (status == ODS_STATUS_OK) {
+        /* unsigned domains sort before any expiry */
+        refreshtime = (pushed ? 0 : context->clock_in + duration2time(zone->signconf->sig_refresh_interval));
         names_viewreset(signview);
         /* queue menial, hard signing work */
         if(context->signq) {
-            worker_queue_zone(context, worker->taskq->signq, signview, &nsubtasks);
+            worker_queue_zone(context, worker->taskq->signq, signview, refreshtime, &nsubtasks);
             ods_log_deeebug("[%s] wait until drudgers are finished "
                     "signing zone %s", worker->name, task->owner);
             /* sleep until work is done */
@@ -462,7 +471,6 @@ do_signzone(task_type* task, const char* zonename, void* zonearg, void *contexta
             names_iterator iter;
             hsm_ctx_t* ctx;
             recordset_type record;
-            time_t refreshtime = context->clock_in + duration2time(zone->signconf->sig_refresh_interval);
             ctx = hsm_create_context();
             for(iter=names_viewiterator(signview,names_iteratorexpiring,refreshtime); names_iterate(&iter,&record); names_advance(&iter,NULL)) {
                 names_amend(signview, record);
@@ -506,10 +514,24 @@ do_signzone(task_type* task, const char* zonename, void* zonearg, void *contexta
 
     if(returnscheduletime == schedule_SUCCESS) {
         schedule_scheduletask(engine->taskq, TASK_WRITE, zone->name, zone, &zone->zone_lock, schedule_PROMPTLY);
+    } else {
+        massop_zonedone(engine, zone->name, 1);
     }
     return returnscheduletime;
 }
 
+time_t
+do_signzone(task_type* task, const char* zonename, void* zonearg, void *contextarg)
+{
+    return signzone(task, zonearg, contextarg, 0);
+}
+
+time_t
+do_signpushed(task_type* task, const char* zonename, void* zonearg, void *contextarg)
+{
+    return signzone(task, zonearg, contextarg, 1);
+}
+
 time_t
 do_readzone(task_type* task, const char* zonename, void* zonearg, void *contextarg)
 {
@@ -581,6 +603,7 @@ do_forcereadzone(task_type* task, const char* zonename, void* zonearg, void *con
             /* other statuses is critical, and we know it is not ODS_STATUS_OK */
             ods_log_crit("CRITICAL: failed to sign zone %s: %s", task->owner, ods_status2str(status));
         }
+        massop_zonedone(engine, zone->name, 1);
         return schedule_SUCCESS;
     } else {
         schedule_unscheduletask(engine->taskq, TASK_SIGNCONF, zone->name);
@@ -633,6 +656,7 @@ do_purgezone(zone_type* zone)
     names_iterator iter;
      recordset_type record;
 
+    zonelist_pinviews(zone);
     baseview = zone->baseview;
     names_viewreset(baseview);
 
@@ -647,6 +671,7 @@ do_purgezone(zone_type* zone)
     if(names_viewcommit(baseview)) {
         ods_log_error("Unable to clean zone, retrying next pass");
     }
+    zonelist_unpinviews(zone);
 }
 
 void
@@ -657,6 +682,7 @@ do_outputstatefile(zone_type* zone)
     names_view_type baseview;
     char* filename;
 
+    zonelist_pinviews(zone);
     baseview = zone->baseview;
     names_viewreset(baseview);
     filename = ods_build_path(zone->name, ".state", 0, 1);
@@ -668,6 +694,7 @@ do_outputstatefile(zone_type* zone)
         }
     }
     free(filename);
+    zonelist_unpinviews(zone);
 }
 
 time_t
@@ -706,6 +733,9 @@ do_writezone(task_type* task, const char* zonename, void* zonearg, void *context
        relates to whether or not fast updates are enabled, so perhaps a fast
        updates enabled flag should be checked to make this more explicit? */
     tools_output(zone, engine);
+    if (zone->stats) {
+        stats_push_output(zone->stats, zone->name);
+    }
 
     if(zone->operatingconf->zonefile_freq > 0) {
         if(--(zone->operatingconf->zonefile_timer) <= 0) {
@@ -726,6 +756,37 @@ do_writezone(task_type* task, const char* zonename, void* zonearg, void *context
                 "zone %s", worker->name, task->owner);
         resign = context->clock_in + 3600;
     }
-    schedule_scheduletask(engine->taskq, TASK_SIGN, zone->name, zone, &zone->zone_lock, resign);
+    /* after a pushed sign the scheduled resign stays as it is */
+    schedule_rescheduletask(engine->taskq, TASK_SIGN, zone->name, zone, &zone->zone_lock, resign);
+    massop_zonedone(engine, zone->name, 0);
+    return schedule_SUCCESS;
+}
+
+time_t
+do_propagatezone(task_type* task, const char* zonename, void* zonearg, void *contextarg)
+{
+    zone_type* zone = zonearg;
+    zonelist_propagateviews(zone);
     return schedule_SUCCESS;
 }
+
+void
+schedule_propagate(void* arg, zone_type* zone)
+{
+    engine_type* engine = arg;
+    schedule_scheduletask(engine->taskq, TASK_PROPAGATE, zone->name, zone, &zone->zone_lock, schedule_IMMEDIATELY);
+}
+
+void
+schedule_signpushed(engine_type* engine, zone_type* zone)
+{
+    /* The first change starts the coalescing window, changes pushed
+     * before the sign starts are picked up by that same sign. */
+    if (zone->stats && !stats_push(zone->stats)) {
+        return;
+    }
+    ods_log_debug("sign pushed changes to zone %s in %d msec", zone->name,
+        engine->config->signer_coalesce_window);
+    schedule_unscheduletask(engine->taskq, TASK_SIGNPUSHED, zone->name);
+    schedule_scheduletask_in(engine->taskq, TASK_SIGNPUSHED, zone->name, zone, &zone->zone_lock, engine->config->signer_coalesce_window);
+}
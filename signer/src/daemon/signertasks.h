@@ -49,9 +49,19 @@ extern void drudge(worker_type* worker);
 extern time_t do_readsignconf(task_type* task, const char* zonename, void* zonearg, void *contextarg);
 extern time_t do_forcereadsignconf(task_type* task, const char* zonename, void* zonearg, void *contextarg);
 extern time_t do_signzone(task_type* task, const char* zonename, void* zonearg, void *contextarg);
+extern time_t do_signpushed(task_type* task, const char* zonename, void* zonearg, void *contextarg);
 extern time_t do_readzone(task_type* task, const char* zonename, void* zonearg, void *contextarg);
 extern time_t do_forcereadzone(task_type* task, const char* zonename, void* zonearg, void *contextarg);
 extern void do_purgezone(zone_type* zone);
 extern time_t do_writezone(task_type* task, const char* zonename, void* zonearg, void *contextarg);
+extern time_t do_propagatezone(task_type* task, const char* zonename, void* zonearg, void *contextarg);
+
+/* Apply commits to the idle views of a zone in the background, installed
+ * as propagation hook of the zone list. */
+extern void schedule_propagate(void* arg, zone_type* zone);
+
+/* Schedule signing, output and notify of changes pushed into the input
+ * view of zone, coalescing pushes within the configured window. */
+extern void schedule_signpushed(engine_type* engine, zone_type* zone);
 
 #endif /* SIGNERTASKS_H */
@@ -55,12 +55,12 @@ xfrhandler_create()
     CHECKALLOC(xfrh = (xfrhandler_type*) malloc(sizeof(xfrhandler_type)));
     xfrh->engine = NULL;
     xfrh->packet = NULL;
+    xfrh->dump = NULL;
     xfrh->netio = NULL;
     xfrh->tcp_set = NULL;
     xfrh->tcp_waiting_first = NULL;
-    xfrh->udp_waiting_first = NULL;
-    xfrh->udp_waiting_last = NULL;
-    xfrh->udp_use_num = 0;
+    xfrh->masters = NULL;
+    xfrh->refresh_rate = 0;
     xfrh->start_time = 0;
     xfrh->current_time = 0;
     xfrh->got_time = 0;
@@ -73,6 +73,7 @@ xfrhandler_create()
     /* setup */
     xfrh->netio = netio_create();
     xfrh->packet = buffer_create(PACKET_BUFFER_SIZE);
+    xfrh->dump = xfrdump_create();
     xfrh->tcp_set = tcp_set_create();
     xfrh->dnshandler.fd = -1;
     xfrh->dnshandler.user_data = (void*) xfrh;
@@ -80,6 +81,9 @@ xfrhandler_create()
     xfrh->dnshandler.event_types = NETIO_EVENT_READ;
     xfrh->dnshandler.event_handler = xfrhandler_handle_dns;
     xfrh->dnshandler.free_handler = 0;
+    /* shared udp sockets, opened on first use */
+    xfrh->udp_socks = NULL;
+    xfrh->udp_next = 0;
     return xfrh;
 }
 
@@ -182,8 +186,11 @@ xfrhandler_cleanup(xfrhandler_type* xfrhandler)
     if (!xfrhandler) {
         return;
     }
+    xfrd_masters_cleanup(xfrhandler);
+    xfrd_udp_sockets_cleanup(xfrhandler);
     netio_cleanup_shallow(xfrhandler->netio);
     buffer_cleanup(xfrhandler->packet);
+    xfrdump_cleanup(xfrhandler->dump);
     tcp_set_cleanup(xfrhandler->tcp_set);
     free(xfrhandler);
 }
@@ -43,6 +43,7 @@ typedef struct xfrhandler_struct xfrhandler_type;
 #include "wire/notify.h"
 #include "wire/tcpset.h"
 #include "wire/xfrd.h"
+#include "wire/xfrdump.h"
 #include "engine.h"
 
 /**
@@ -60,10 +61,12 @@ struct xfrhandler_struct {
     netio_type* netio;
     tcp_set_type* tcp_set;
     buffer_type* packet;
+    xfrdump_type* dump;
     xfrd_type* tcp_waiting_first;
-    xfrd_type* udp_waiting_first;
-    xfrd_type* udp_waiting_last;
-    size_t udp_use_num;
+    struct xfrd_master_struct* masters;
+    struct xfrd_udp_sock_struct* udp_socks;
+    size_t udp_next;
+    int refresh_rate; /* udp requests per second per master, 0 unpaced */
     notify_type* notify_waiting_first;
     notify_type* notify_waiting_last;
     int notify_udp_num;
@@ -53,9 +53,11 @@
     #include <readline/history.h>
 #endif
 
+#include "confparser.h"
 #include "file.h"
 #include "log.h"
 #include "str.h"
+#include "util.h"
 #include "clientpipe.h"
 
 static const char* PROMPT = "cmd> ";
@@ -76,8 +78,15 @@ usage(char* argv0, FILE* out)
     fprintf(out, "\nSupported options:\n");
     fprintf(out, " -h | --help             Show this help and exit.\n");
     fprintf(out, " -V | --version          Show version and exit.\n");
+    fprintf(out, " -f | --file <file>      Run the commands in file, one per line,\n"
+        "    |    over a single connection. Stop at the first failing\n"
+        "    |    command. Use - for stdin.\n");
     fprintf(out, " -s | --socket <file>    Daemon socketfile \n"
         "    |    (default %s).\n", ODS_SE_SOCKFILE);
+    fprintf(out, " -c | --config <cfgfile> Read the number of signer instances "
+        "from file\n"
+        "    |    (default %s).\n", ODS_SE_CFGFILE);
+    fprintf(out, " -i | --instance <n>     Talk to signer instance n only.\n");
 
     fprintf(out, "\nBSD licensed, see LICENSE in source package for "
                  "details.\n");
@@ -179,16 +188,40 @@ extract_msg(char* buf, int *pos, int buflen, int *exitcode, int sockfd)
     }
 }
 
+/**
+ * Find a running signer daemon.
+ *
+ * \return pid of a signer daemon, 0 if none is running
+ */
+static pid_t
+engine_pid(void)
+{
+    char line[80];
+    FILE *cmd2 = popen("pgrep ods-signerd","r");
+    if (!cmd2) {
+        return 0;
+    }
+    if (!fgets(line, 80, cmd2)) {
+        line[0] = '\0';
+    }
+    (void) pclose(cmd2);
+    return strtoul(line, NULL, 10);
+}
+
 /**
  * Start interface - Set up connection and handle communication
  *
  * \param cmd: command to exec, NULL for interactive mode.
  * \param servsock_filename: name of pipe to connect to daemon. Must 
  *        not be NULL.
+ * \param stopwait: on stop, 0 to not wait for the daemon, 1 to wait
+ *        for it and 2 to wait until no signer daemon is left.
+ * \param batch: commands to run one per line, NULL otherwise.
  * \return exit code for client
  */
 static int
-interface_start(const char* cmd, const char* servsock_filename)
+interface_start(const char* cmd, const char* servsock_filename, int stopwait,
+    FILE* batch)
 {
     struct sockaddr_un servaddr;
     fd_set rset;
@@ -251,7 +284,18 @@ interface_start(const char* cmd, const char* servsock_filename)
 
     userbuf[0] = 0;
     do {
-        if (!cmd) {
+        if (batch) {
+            /* One command per line, skip blank lines and comments */
+            if (!fgets(userbuf, ODS_SE_MAXLINE, batch)) break;
+            ods_str_trim(userbuf, 0);
+            if (userbuf[0] == '\0' || userbuf[0] == '#') continue;
+            if (strcmp(userbuf, "exit") == 0 || strcmp(userbuf, "quit") == 0)
+                break;
+            if (!client_stdin(sockfd, userbuf, strlen(userbuf))) {
+                error = 205;
+                break;
+            }
+        } else if (!cmd) {
 #ifdef HAVE_READLINE
             char *icmd_ptr;
             if ((icmd_ptr = readline(PROMPT)) == NULL) { /* eof */
@@ -329,7 +373,7 @@ interface_start(const char* cmd, const char* servsock_filename)
                     error = 208;
                     break;
                 } else if (r == 1) {
-                    if (cmd) 
+                    if (cmd || batch)
                         error = exitcode;
                     else if (strlen(userbuf) != 0)
                         /* we are interactive so print response.
@@ -344,28 +388,24 @@ interface_start(const char* cmd, const char* servsock_filename)
     } while (error == 0 && !cmd);
     close(sockfd);
 
-    if ((cmd && !strncmp(cmd, "stop", 4)) || 
-        (strlen(userbuf) != 0 && !strncmp(userbuf, "stop", 4))) {
-        char line[80];
-        FILE *cmd2 = popen("pgrep ods-signerd","r");
-        fgets(line, 80, cmd2);
-        (void) pclose(cmd2);
-        pid = strtoul(line, NULL, 10);
-        fprintf(stdout, "pid %d\n", pid);
-        time = 0;
+    if (stopwait && ((cmd && !strncmp(cmd, "stop", 4)) ||
+        (strlen(userbuf) != 0 && !strncmp(userbuf, "stop", 4)))) {
         error = 0;
-        while (pid > 0) {
-           if(kill(pid, 0) == 0){
-               sleep(1);
-               time += 1;
-               if (time>20) {
-                  printf("signer needs more time to stop...\n");
-                  time = 0;
-               }
-           }
-           else
-               break;
-       }
+        while ((pid = engine_pid()) > 0) {
+            fprintf(stdout, "pid %d\n", pid);
+            time = 0;
+            while (kill(pid, 0) == 0) {
+                sleep(1);
+                time += 1;
+                if (time>20) {
+                    printf("signer needs more time to stop...\n");
+                    time = 0;
+                }
+            }
+            if (stopwait < 2) {
+                break;
+            }
+        }
     }
 
 #ifdef HAVE_READLINE
@@ -375,16 +415,72 @@ interface_start(const char* cmd, const char* servsock_filename)
     return error;
     }
 
+/**
+ * Determine the signer instance a command is for.
+ *
+ * Commands naming a zone go to the instance owning it.  Starting the
+ * engine and help go to the first instance, which starts the others.
+ * \return instance index, or -1 if the command is for all instances
+ */
+static int
+command_instance(int argc, char* argv[], int instances)
+{
+    static const char* zonecmds[] = { "sign", "clear", "update",
+        "retransfer", "memory", NULL };
+    int i;
+    if (instances <= 1 || argc == 0) {
+        return 0;
+    }
+    if (!strcmp(argv[0], "start") || !strcmp(argv[0], "help")) {
+        return 0;
+    }
+    if (argc < 2 || argv[1][0] == '-') {
+        return -1;
+    }
+    for (i = 0; zonecmds[i]; i++) {
+        if (!strcmp(argv[0], zonecmds[i])) {
+            return util_instance_of(argv[1], instances);
+        }
+    }
+    return -1;
+}
+
+/**
+ * Run a command on a signer instance.
+ *
+ */
+static int
+instance_start(const char* cmd, const char* socketfile, int instance,
+    int stopwait, FILE* batch)
+{
+    char* instancefile = util_instance_file(socketfile, instance);
+    int error;
+    if (!instancefile) {
+        fprintf(stderr, "Out of memory.\n");
+        return 101;
+    }
+    error = interface_start(cmd, instancefile, stopwait, batch);
+    free(instancefile);
+    return error;
+}
+
 int
 main(int argc, char* argv[])
 {
     char* argv0;
     char* cmd = NULL;
     char const *socketfile = ODS_SE_SOCKFILE;
-    int error, c, options_index = 0;
+    char const *batchfile = NULL;
+    FILE* batch = NULL;
+    char const *cfgfile = ODS_SE_CFGFILE;
+    int instance = -1, instances = 1;
+    int error, status, i, c, options_index = 0;
     static struct option long_options[] = {
         {"help", no_argument, 0, 'h'},
+        {"file", required_argument, 0, 'f'},
         {"socket", required_argument, 0, 's'},
+        {"config", required_argument, 0, 'c'},
+        {"instance", required_argument, 0, 'i'},
         {"version", no_argument, 0, 'V'},
         { 0, 0, 0, 0}
     };
@@ -397,7 +493,7 @@ main(int argc, char* argv[])
     else
         ++argv0;
 
-    if (argc > 5) {
+    if (argc > 9) {
         fprintf(stderr,"error, too many arguments (%d)\n", argc);
         exit(1);
     }
@@ -406,16 +502,25 @@ main(int argc, char* argv[])
      * to stop parsing when an unknown command is found not starting 
      * with '-'. This is important for us, else switches inside commands
      * would be consumed by getopt. */
-    while ((c=getopt_long(argc, argv, "+hVs:",
+    while ((c=getopt_long(argc, argv, "+hVf:s:c:i:",
         long_options, &options_index)) != -1) {
         switch (c) {
             case 'h':
                 usage(argv0, stdout);
                 exit(1);
+            case 'f':
+                batchfile = optarg;
+                break;
             case 's':
                 socketfile = optarg;
                 printf("sock set to %s\n", socketfile);
                 break;
+            case 'c':
+                cfgfile = optarg;
+                break;
+            case 'i':
+                instance = atoi(optarg);
+                break;
             case 'V':
                 version(stdout);
                 exit(0);
@@ -432,9 +537,46 @@ main(int argc, char* argv[])
         fprintf(stderr, "Enforcer socket file not set.\n");
         return 101;
     }
+    if (access(cfgfile, R_OK) == 0) {
+        instances = parse_conf_signer_instances(cfgfile);
+    }
+    if (instance >= instances) {
+        fprintf(stderr, "No signer instance %d, %d configured.\n",
+            instance, instances);
+        return 1;
+    }
+    if (batchfile) {
+        if (argc != 0) {
+            fprintf(stderr, "--file can not be combined with a command\n");
+            return 1;
+        }
+        batch = strcmp(batchfile, "-") ? fopen(batchfile, "r") : stdin;
+        if (!batch) {
+            fprintf(stderr, "Unable to open %s: %s\n", batchfile,
+                strerror(errno));
+            return 1;
+        }
+    }
     if (argc != 0) 
         cmd = ods_strcat_delim(argc, argv, ' ');
-    error = interface_start(cmd, socketfile);
+    if (instance == -1) {
+        instance = command_instance(argc, argv, instances);
+    }
+    if (instance != -1 || !cmd) {
+        error = instance_start(cmd, socketfile, instance < 0 ? 0 : instance,
+            1, batch);
+    } else {
+        /* every instance, waiting for all of them when stopping */
+        error = 0;
+        for (i = 0; i < instances; i++) {
+            status = instance_start(cmd, socketfile, i,
+                i == instances - 1 ? 2 : 0, NULL);
+            if (status && !error) {
+                error = status;
+            }
+        }
+    }
+    if (batch && batch != stdin) fclose(batch);
     free(cmd);
     return error;
 }
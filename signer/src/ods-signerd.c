@@ -33,9 +33,14 @@
 #include "locks.h"
 #include "daemon/engine.h"
 
+#include <errno.h>
 #include <getopt.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <libxml/parser.h>
 #include "confparser.h"
 #include "logging.h"
@@ -62,6 +67,8 @@ usage(FILE* out)
     fprintf(out, " -1 | --single-run       Run once, then exit.\n");
     fprintf(out, " -h | --help             Show this help and exit.\n");
     fprintf(out, " -i | --info             Print configuration and exit.\n");
+    fprintf(out, "      --instance <n>     Run as instance n of the configured "
+                 "instances.\n");
     fprintf(out, " -v | --verbose          Increase verbosity.\n");
     fprintf(out, " -V | --version          Show version and exit.\n");
     fprintf(out, "\nBSD licensed, see LICENSE in source package for "
@@ -85,6 +92,93 @@ version(FILE* out)
     exit(0);
 }
 
+/**
+ * Start the other configured signer instances.  Each runs as its own
+ * daemon, serving the zones that hash to it.  Without daemonizing the
+ * instances stay children of this process, their pids are returned so
+ * they can be reaped with reap_instances().
+ *
+ */
+static pid_t*
+spawn_instances(int instances, char* argv0, int argc, char* argv[],
+    int daemonize)
+{
+    char instance[16];
+    char** args;
+    int i, status;
+    pid_t pid;
+    pid_t* pids = NULL;
+
+    if (!daemonize) {
+        CHECKALLOC(pids = (pid_t*) calloc(instances, sizeof(pid_t)));
+    }
+    CHECKALLOC(args = (char**) calloc(argc + 3, sizeof(char*)));
+    args[0] = argv0;
+    for (i = 1; i < argc; i++) {
+        args[i] = argv[i];
+    }
+    args[argc] = (char*) "--instance";
+    args[argc+1] = instance;
+    args[argc+2] = NULL;
+    for (i = 1; i < instances; i++) {
+        snprintf(instance, sizeof(instance), "%d", i);
+        switch ((pid = fork())) {
+            case -1:
+                fprintf(stderr, "Error: Unable to start signer instance %d: "
+                    "%s\n", i, strerror(errno));
+                exit(1);
+            case 0:
+                execv(argv0, args);
+                fprintf(stderr, "Error: Unable to start signer instance %d: "
+                    "%s\n", i, strerror(errno));
+                _exit(1);
+            default:
+                /* a daemonizing instance exits once it runs */
+                if (daemonize) {
+                    if (waitpid(pid, &status, 0) == -1 ||
+                        !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                        fprintf(stderr, "Error: Signer instance %d failed "
+                            "to start\n", i);
+                        exit(1);
+                    }
+                } else {
+                    pids[i] = pid;
+                }
+                break;
+        }
+    }
+    free(args);
+    return pids;
+}
+
+/**
+ * Stop the instances started without daemonizing and wait for them.
+ *
+ */
+static void
+reap_instances(pid_t* pids, int instances)
+{
+    int i, status;
+
+    if (!pids) {
+        return;
+    }
+    for (i = 1; i < instances; i++) {
+        (void) kill(pids[i], SIGTERM);
+    }
+    for (i = 1; i < instances; i++) {
+        status = 0;
+        while (waitpid(pids[i], &status, 0) == -1 && errno == EINTR) {
+            continue;
+        }
+        if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "Error: Signer instance %d exited with status "
+                "%d\n", i, WEXITSTATUS(status));
+        }
+    }
+    free(pids);
+}
+
 static void
 program_setup(const char* cfgfile, int cmdline_verbosity)
 {
@@ -124,6 +218,11 @@ main(int argc, char* argv[])
     int options_index = 0;
     int daemonize = 1;
     int cmdline_verbosity = 0;
+    int instance = -1;
+    int instances = 1;
+    pid_t* pids = NULL;
+    int all_argc = argc;
+    char** all_argv = argv;
     char *time_arg = NULL;
     const char* cfgfile = ODS_SE_CFGFILE;
     int linkfd;
@@ -135,6 +234,7 @@ main(int argc, char* argv[])
         {"verbose", no_argument, 0, 'v'},
         {"version", no_argument, 0, 'V'},
         {"set-time", required_argument, 0, 256},
+        {"instance", required_argument, 0, 257},
         { 0, 0, 0, 0}
     };
 
@@ -170,6 +270,13 @@ main(int argc, char* argv[])
             case 256:
                 time_arg = optarg;
                 break;
+            case 257:
+                instance = atoi(optarg);
+                if (instance < 0) {
+                    usage(stderr);
+                    exit(2);
+                }
+                break;
             default:
                 usage(stderr);
                 exit(2);
@@ -193,10 +300,21 @@ main(int argc, char* argv[])
     /* main stuff */
     fprintf(stdout, "OpenDNSSEC signer engine version %s\n", PACKAGE_VERSION);
 
+    /* the first instance starts the others */
+    if (instance == -1) {
+        instance = 0;
+        instances = parse_conf_signer_instances(cfgfile);
+        if (instances > 1) {
+            pids = spawn_instances(instances, argv0, all_argc, all_argv,
+                daemonize);
+        }
+    }
+
     ods_janitor_initialize(argv0);
     program_setup(cfgfile, cmdline_verbosity);
 
     engine = engine_create();
+    engine->instance = instance;
     if((status = engine_setup_preconfig(engine, cfgfile)) != ODS_STATUS_OK) {
         ods_fatal_exit("Unable to start signer daemon: %s", ods_status2str(status));
     }
@@ -222,6 +340,7 @@ main(int argc, char* argv[])
     engine_cleanup(engine);
     engine = NULL;
     program_teardown();
+    reap_instances(pids, instances);
 
     free(argv0);
     return returncode;
@@ -45,8 +45,8 @@ static const char* parser_str = "parser";
  *
  */
 static acl_type*
-parse_addns_remote(const char* filename,
-    tsig_type* tsig, char* expr)
+parse_addns_remote(xmlXPathContextPtr xpathCtx, tsig_type* tsig,
+    char* expr)
 {
     acl_type* acl = NULL;
     acl_type* new_acl = NULL;
@@ -54,36 +54,17 @@ parse_addns_remote(const char* filename,
     char* address = NULL;
     char* port = NULL;
     char* key = NULL;
-    xmlDocPtr doc = NULL;
-    xmlXPathContextPtr xpathCtx = NULL;
     xmlXPathObjectPtr xpathObj = NULL;
     xmlNode* curNode = NULL;
     xmlChar* xexpr = NULL;
 
-    if (!filename || !expr) {
-        return NULL;
-    }
-    /* Load XML document */
-    doc = xmlParseFile(filename);
-    if (doc == NULL) {
-        ods_log_error("[%s] could not parse %s: xmlParseFile() failed",
-            parser_str, expr);
-        return NULL;
-    }
-    /* Create xpath evaluation context */
-    xpathCtx = xmlXPathNewContext(doc);
-    if(xpathCtx == NULL) {
-        xmlFreeDoc(doc);
-        ods_log_error("[%s] could not parse %s: xmlXPathNewContext() failed",
-            parser_str, expr);
+    if (!xpathCtx || !expr) {
         return NULL;
     }
     /* Evaluate xpath expression */
     xexpr = (xmlChar*) expr;
     xpathObj = xmlXPathEvalExpression(xexpr, xpathCtx);
     if(xpathObj == NULL) {
-        xmlXPathFreeContext(xpathCtx);
-        xmlFreeDoc(doc);
         ods_log_error("[%s] could not parse %s: xmlXPathEvalExpression() "
             "failed", parser_str, expr);
         return NULL;
@@ -128,10 +109,6 @@ parse_addns_remote(const char* filename,
         }
     }
     xmlXPathFreeObject(xpathObj);
-    xmlXPathFreeContext(xpathCtx);
-    if (doc) {
-        xmlFreeDoc(doc);
-    }
     return acl;
 }
 
@@ -141,44 +118,25 @@ parse_addns_remote(const char* filename,
  *
  */
 static acl_type*
-parse_addns_acl(const char* filename,
-    tsig_type* tsig, char* expr)
+parse_addns_acl(xmlXPathContextPtr xpathCtx, tsig_type* tsig,
+    char* expr)
 {
     acl_type* acl = NULL;
     acl_type* new_acl = NULL;
     int i = 0;
     char* prefix = NULL;
     char* key = NULL;
-    xmlDocPtr doc = NULL;
-    xmlXPathContextPtr xpathCtx = NULL;
     xmlXPathObjectPtr xpathObj = NULL;
     xmlNode* curNode = NULL;
     xmlChar* xexpr = NULL;
 
-    if (!filename || !expr) {
-        return NULL;
-    }
-    /* Load XML document */
-    doc = xmlParseFile(filename);
-    if (doc == NULL) {
-        ods_log_error("[%s] could not parse %s: xmlParseFile() failed",
-            parser_str, expr);
-        return NULL;
-    }
-    /* Create xpath evaluation context */
-    xpathCtx = xmlXPathNewContext(doc);
-    if(xpathCtx == NULL) {
-        xmlFreeDoc(doc);
-        ods_log_error("[%s] could not parse %s: xmlXPathNewContext() failed",
-            parser_str, expr);
+    if (!xpathCtx || !expr) {
         return NULL;
     }
     /* Evaluate xpath expression */
     xexpr = (xmlChar*) expr;
     xpathObj = xmlXPathEvalExpression(xexpr, xpathCtx);
     if(xpathObj == NULL) {
-        xmlXPathFreeContext(xpathCtx);
-        xmlFreeDoc(doc);
         ods_log_error("[%s] could not parse %s: xmlXPathEvalExpression() "
             "failed", parser_str, expr);
         return NULL;
@@ -217,10 +175,6 @@ parse_addns_acl(const char* filename,
         }
     }
     xmlXPathFreeObject(xpathObj);
-    xmlXPathFreeContext(xpathCtx);
-    if (doc) {
-        xmlFreeDoc(doc);
-    }
     return acl;
 }
 
@@ -230,8 +184,7 @@ parse_addns_acl(const char* filename,
  *
  */
 static tsig_type*
-parse_addns_tsig_static(const char* filename,
-    char* expr)
+parse_addns_tsig_static(xmlXPathContextPtr xpathCtx, char* expr)
 {
     tsig_type* tsig = NULL;
     tsig_type* new_tsig = NULL;
@@ -239,36 +192,17 @@ parse_addns_tsig_static(const char* filename,
     char* name = NULL;
     char* algo = NULL;
     char* secret = NULL;
-    xmlDocPtr doc = NULL;
-    xmlXPathContextPtr xpathCtx = NULL;
     xmlXPathObjectPtr xpathObj = NULL;
     xmlNode* curNode = NULL;
     xmlChar* xexpr = NULL;
 
-    if (!filename || !expr) {
-        return NULL;
-    }
-    /* Load XML document */
-    doc = xmlParseFile(filename);
-    if (doc == NULL) {
-        ods_log_error("[%s] could not parse %s: xmlParseFile() failed",
-            parser_str, expr);
-        return NULL;
-    }
-    /* Create xpath evaluation context */
-    xpathCtx = xmlXPathNewContext(doc);
-    if(xpathCtx == NULL) {
-        xmlFreeDoc(doc);
-        ods_log_error("[%s] could not parse %s: xmlXPathNewContext() failed",
-            parser_str, expr);
+    if (!xpathCtx || !expr) {
         return NULL;
     }
     /* Evaluate xpath expression */
     xexpr = (xmlChar*) expr;
     xpathObj = xmlXPathEvalExpression(xexpr, xpathCtx);
     if(xpathObj == NULL) {
-        xmlXPathFreeContext(xpathCtx);
-        xmlFreeDoc(doc);
         ods_log_error("[%s] could not parse %s: xmlXPathEvalExpression() "
             "failed", parser_str, expr);
         return NULL;
@@ -311,74 +245,49 @@ parse_addns_tsig_static(const char* filename,
         }
     }
     xmlXPathFreeObject(xpathObj);
-    xmlXPathFreeContext(xpathCtx);
-    if (doc) {
-        xmlFreeDoc(doc);
-    }
     return tsig;
 }
 
 
 /**
- * Parse <RequestTransfer/>.
+ * Parse DNS adapter configuration.
  *
  */
-acl_type*
-parse_addns_request_xfr(const char* filename,
-    tsig_type* tsig)
+ods_status
+parse_addns(const char* filename, const char* content, size_t size,
+    addns_config_type* config)
 {
-    return parse_addns_remote(filename, tsig,
+    xmlDocPtr doc = NULL;
+    xmlXPathContextPtr xpathCtx = NULL;
+    if (!filename || !content || !config) {
+        return ODS_STATUS_ASSERT_ERR;
+    }
+    /* Load XML document, once for all sections */
+    doc = xmlReadMemory(content, (int) size, filename, NULL, 0);
+    if (doc == NULL) {
+        ods_log_error("[%s] could not parse %s: xmlReadMemory() failed",
+            parser_str, filename);
+        return ODS_STATUS_XML_ERR;
+    }
+    /* Create xpath evaluation context */
+    xpathCtx = xmlXPathNewContext(doc);
+    if (xpathCtx == NULL) {
+        xmlFreeDoc(doc);
+        ods_log_error("[%s] could not parse %s: xmlXPathNewContext() failed",
+            parser_str, filename);
+        return ODS_STATUS_XML_ERR;
+    }
+    config->tsig = parse_addns_tsig_static(xpathCtx,
+        (char *)"//Adapter/DNS/TSIG");
+    config->request_xfr = parse_addns_remote(xpathCtx, config->tsig,
         (char *)"//Adapter/DNS/Inbound/RequestTransfer/Remote");
-}
-
-
-/**
- * Parse <AllowNotify/>.
- *
- */
-acl_type*
-parse_addns_allow_notify(const char* filename,
-    tsig_type* tsig)
-{
-    return parse_addns_acl(filename, tsig,
+    config->allow_notify = parse_addns_acl(xpathCtx, config->tsig,
         (char *)"//Adapter/DNS/Inbound/AllowNotify/Peer");
-}
-
-
-/**
- * Parse <ProvideTransfer/>.
- *
- */
-acl_type*
-parse_addns_provide_xfr(const char* filename,
-    tsig_type* tsig)
-{
-    return parse_addns_acl(filename, tsig,
+    config->provide_xfr = parse_addns_acl(xpathCtx, config->tsig,
         (char *)"//Adapter/DNS/Outbound/ProvideTransfer/Peer");
-}
-
-
-/**
- * Parse <Notify/>.
- *
- */
-acl_type*
-parse_addns_do_notify(const char* filename,
-    tsig_type* tsig)
-{
-    return parse_addns_remote(filename, tsig,
+    config->do_notify = parse_addns_remote(xpathCtx, config->tsig,
         (char *)"//Adapter/DNS/Outbound/Notify/Remote");
+    xmlXPathFreeContext(xpathCtx);
+    xmlFreeDoc(doc);
+    return ODS_STATUS_OK;
 }
-
-
-/**
- * Parse <TSIG/>.
- *
- */
-tsig_type*
-parse_addns_tsig(const char* filename)
-{
-    return parse_addns_tsig_static(filename,
-        (char *)"//Adapter/DNS/TSIG");
-}
-
@@ -32,6 +32,7 @@
 #ifndef PARSER_ADDNSPARSER_H
 #define PARSER_ADDNSPARSER_H
 
+#include "status.h"
 #include "wire/acl.h"
 #include "wire/tsig.h"
 
@@ -39,52 +40,29 @@
 #include <libxml/xmlreader.h>
 
 /**
- * Parse <RequestTransfer/>.
- * \param[in] allocator memory allocator
- * \param[in] filename filename
- * \param[in] tsig list of TSIGs
- * \return acl_type* ACL
+ * DNS adapter configuration, the TSIG credentials and the ACLs of the
+ * inbound and outbound sections.
  *
  */
-extern acl_type* parse_addns_request_xfr(const char* filename, tsig_type* tsig);
+typedef struct addns_config_struct addns_config_type;
+struct addns_config_struct {
+    tsig_type* tsig;
+    acl_type* request_xfr;
+    acl_type* allow_notify;
+    acl_type* provide_xfr;
+    acl_type* do_notify;
+};
 
 /**
- * Parse <AllowNotify/>.
- * \param[in] allocator memory allocator
- * \param[in] filename filename
- * \param[in] tsig list of TSIGs
- * \return acl_type* ACL
+ * Parse a DNS adapter configuration, all sections from one document.
+ * \param[in] filename filename, for reporting errors
+ * \param[in] content content of the file
+ * \param[in] size size of the content
+ * \param[out] config parsed configuration
+ * \return ods_status status
  *
  */
-extern acl_type* parse_addns_allow_notify(const char* filename, tsig_type* tsig);
-
-/**
- * Parse <ProvideTransfer/>.
- * \param[in] allocator memory allocator
- * \param[in] filename filename
- * \param[in] tsig list of TSIGs
- * \return acl_type* ACL
- *
- */
-extern acl_type* parse_addns_provide_xfr(const char* filename, tsig_type* tsig);
-
-/**
- * Parse <Notify/>.
- * \param[in] allocator memory allocator
- * \param[in] filename filename
- * \param[in] tsig list of TSIGs
- * \return acl_type* ACL
- *
- */
-extern acl_type* parse_addns_do_notify(const char* filename, tsig_type* tsig);
-
-/**
- * Parse <TSIG/>.
- * \param[in] allocator memory allocator
- * \param[in] filename filename
- * \return tsig_type* TSIG
- *
- */
-extern tsig_type* parse_addns_tsig(const char* filename);
+extern ods_status parse_addns(const char* filename, const char* content,
+    size_t size, addns_config_type* config);
 
 #endif /* PARSER_ADDNSPARSER_H */
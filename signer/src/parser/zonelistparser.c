@@ -39,6 +39,7 @@
 
 #include <libxml/xpath.h>
 #include <libxml/xmlreader.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -214,6 +215,14 @@ parse_zonelist_zones(void* zlist, const char* zlfile)
                 ret = xmlTextReaderRead(reader);
                 continue;
             }
+            if (!zonelist_owns((zonelist_type*) zlist, zone_name)) {
+                ods_log_deeebug("[%s] zone %s served by another instance, "
+                    "skipping", parser_str, zone_name);
+                free((void*) zone_name);
+                free((void*) tag_name);
+                ret = xmlTextReaderRead(reader);
+                continue;
+            }
             /* Expand this node to get the rest of the info */
             xmlTextReaderExpand(reader);
             doc = xmlTextReaderCurrentDoc(reader);
@@ -283,3 +292,110 @@ parse_zonelist_zones(void* zlist, const char* zlfile)
     }
     return ODS_STATUS_OK;
 }
+
+
+/**
+ * Create adapter from a journal entry.
+ *
+ */
+static adapter_type*
+zlp_journal_adapter(const char* type, const char* uri, unsigned inbound)
+{
+    if (!type || !uri) {
+        return NULL;
+    } else if (!strcmp(type, "File")) {
+        return adapter_create(uri, ADAPTER_FILE, inbound);
+    } else if (!strcmp(type, "DNS")) {
+        return adapter_create(uri, ADAPTER_DNS, inbound);
+    }
+    ods_log_error("[%s] unable to parse %s adapter: unknown type %s",
+        parser_str, inbound?"input":"output", type);
+    return NULL;
+}
+
+
+/**
+ * Parse the zonelist journal.
+ *
+ */
+ods_status
+parse_zonelist_journal(void* zlist, FILE* fd, const char* jfile)
+{
+    char* line = NULL;
+    size_t linesize = 0;
+    ssize_t len;
+    char* fields[8];
+    char* field;
+    char* save;
+    int nfields;
+    unsigned long lineno = 0;
+    zone_type* zone = NULL;
+    zone_type* new_zone = NULL;
+
+    if (!zlist || !fd) {
+        return ODS_STATUS_ASSERT_ERR;
+    }
+    while ((len = getline(&line, &linesize, fd)) > 0) {
+        lineno++;
+        if (line[len-1] != '\n') {
+            /* entry still being written, the next update will see it */
+            break;
+        }
+        line[len-1] = '\0';
+        nfields = 0;
+        for (field = strtok_r(line, "\t", &save); field;
+            field = strtok_r(NULL, "\t", &save)) {
+            if (nfields < 8) {
+                fields[nfields] = field;
+            }
+            nfields++;
+        }
+        if (nfields == 0) {
+            continue;
+        }
+        if ((strcmp(fields[0], "add") || nfields != 8) &&
+            (strcmp(fields[0], "delete") || nfields != 2)) {
+            ods_log_warning("[%s] skipping malformed entry at %s:%lu",
+                parser_str, jfile, lineno);
+            continue;
+        }
+        if (!zonelist_owns((zonelist_type*) zlist, fields[1])) {
+            continue;
+        }
+        /* later entries override what is known of the zone so far */
+        zone = zonelist_lookup_zone_by_name((zonelist_type*) zlist,
+            fields[1], LDNS_RR_CLASS_IN);
+        if (zone) {
+            zonelist_del_zone((zonelist_type*) zlist, zone);
+            zone_cleanup(zone);
+        }
+        if (!strcmp(fields[0], "delete")) {
+            ods_log_debug("[%s] zone %s deleted by journal", parser_str,
+                fields[1]);
+            continue;
+        }
+        new_zone = zone_create(fields[1], LDNS_RR_CLASS_IN);
+        if (!new_zone) {
+            ods_log_crit("[%s] unable to create zone %s", parser_str,
+                fields[1]);
+            free(line);
+            return ODS_STATUS_MALLOC_ERR;
+        }
+        new_zone->policy_name = strdup(fields[2]);
+        new_zone->signconf_filename = strdup(fields[3]);
+        new_zone->adinbound = zlp_journal_adapter(fields[4], fields[5], 1);
+        new_zone->adoutbound = zlp_journal_adapter(fields[6], fields[7], 0);
+        if (!new_zone->policy_name || !new_zone->signconf_filename ||
+            !new_zone->adinbound || !new_zone->adoutbound ||
+            zonelist_add_zone((zonelist_type*) zlist, new_zone) == NULL) {
+            ods_log_crit("[%s] unable to add zone %s", parser_str, fields[1]);
+            zone_cleanup(new_zone);
+            free(line);
+            return ODS_STATUS_ERR;
+        }
+        ods_log_debug("[%s] zone %s added by journal", parser_str,
+            new_zone->name);
+    }
+    free(line);
+    return ODS_STATUS_OK;
+}
@@ -37,6 +37,7 @@
 
 #include <libxml/xpath.h>
 #include <libxml/xmlreader.h>
+#include <stdio.h>
 
 /**
  * Parse the zonelist file.
@@ -47,4 +48,16 @@
  */
 extern ods_status parse_zonelist_zones(void* zlist, const char* zlfile);
 
+/**
+ * Apply the journal of single zone changes written by the enforcer since
+ * the zonelist file was last exported.
+ * \param[in] zlist zone list storage
+ * \param[in] fd opened journal
+ * \param[in] jfile journal file name
+ * \return ods_status status
+ *
+ */
+extern ods_status parse_zonelist_journal(void* zlist, FILE* fd,
+    const char* jfile);
+
 #endif /* PARSER_ZONELISTPARSER_H */
@@ -468,7 +468,8 @@ backup_read_namedb(FILE* in, zone_type* zone, names_view_type view)
         record = names_place(view, name);
         free(name);
         names_recordaddsignature(record, type_covered, rr, locator, flags);
-        locator = NULL; /* Locator is owned by rrset now */
+        free(locator); /* Locator is interned by the recordset */
+        locator = NULL;
     }
     if (result == ODS_STATUS_OK && status != LDNS_STATUS_OK) {
         ods_log_error("[%s] error reading RRSIG #%i (%s): %s",
@@ -572,7 +573,7 @@ upgraderecords(zone_type* zone, names_view_type view)
             if(rrsigexpirationtime < expiration)
                 expiration = rrsigexpirationtime;
         }
-        free(rrsigs);
+        names_recordfreesignatures(rrsigs);
         names_recordsetexpiry(record, expiration);
     }
     names_viewcommit(view);
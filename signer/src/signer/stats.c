@@ -29,6 +29,8 @@
  *
  */
 
+#include <string.h>
+
 #include "log.h"
 #include "signer/stats.h"
 
@@ -41,11 +43,36 @@ stats_create(void)
 {
     stats_type* stats = (stats_type*) malloc(sizeof(stats_type));
     stats_clear(stats);
+    memset(&stats->push_pending, 0, sizeof(struct timespec));
+    memset(&stats->push_signing, 0, sizeof(struct timespec));
+    stats->push_count = 0;
+    stats->push_latency_last = 0;
+    stats->push_latency_max = 0;
+    stats->push_latency_total = 0;
+    memset(stats->mem_views, 0, sizeof(stats->mem_views));
+    stats->mem_time = 0;
     pthread_mutex_init(&stats->stats_lock, NULL);
     return stats;
 }
 
 
+/**
+ * Total memory used by all views.
+ *
+ */
+size_t
+stats_memory(stats_type* stats)
+{
+    int i;
+    size_t total = 0;
+    for (i = 0; i < STATS_NVIEWS; i++) {
+        total += stats->mem_views[i].indices + stats->mem_views[i].recordsets +
+            stats->mem_views[i].signatures + stats->mem_views[i].changelog;
+    }
+    return total;
+}
+
+
 /**
  * Clear statistics.
  *
@@ -98,6 +125,73 @@ stats_log(stats_type* stats, const char* name, uint32_t serial,
 }
 
 
+/**
+ * Register a pushed change.
+ *
+ */
+int
+stats_push(stats_type* stats)
+{
+    int first;
+    pthread_mutex_lock(&stats->stats_lock);
+    first = (stats->push_pending.tv_sec == 0 && stats->push_pending.tv_nsec == 0);
+    if (first) {
+        clock_gettime(CLOCK_MONOTONIC, &stats->push_pending);
+    }
+    pthread_mutex_unlock(&stats->stats_lock);
+    return first;
+}
+
+
+/**
+ * Pushed changes are being signed.
+ *
+ */
+void
+stats_push_signing(stats_type* stats)
+{
+    pthread_mutex_lock(&stats->stats_lock);
+    if (stats->push_pending.tv_sec || stats->push_pending.tv_nsec) {
+        /* a failed sign may have left older changes behind */
+        if (stats->push_signing.tv_sec == 0 && stats->push_signing.tv_nsec == 0) {
+            stats->push_signing = stats->push_pending;
+        }
+        memset(&stats->push_pending, 0, sizeof(struct timespec));
+    }
+    pthread_mutex_unlock(&stats->stats_lock);
+}
+
+
+/**
+ * Pushed changes are output.
+ *
+ */
+void
+stats_push_output(stats_type* stats, const char* name)
+{
+    struct timespec now;
+    uint32_t latency;
+    pthread_mutex_lock(&stats->stats_lock);
+    if (stats->push_signing.tv_sec == 0 && stats->push_signing.tv_nsec == 0) {
+        pthread_mutex_unlock(&stats->stats_lock);
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    latency = (now.tv_sec - stats->push_signing.tv_sec) * 1000
+            + (now.tv_nsec - stats->push_signing.tv_nsec) / 1000000;
+    memset(&stats->push_signing, 0, sizeof(struct timespec));
+    stats->push_count++;
+    stats->push_latency_last = latency;
+    if (latency > stats->push_latency_max) {
+        stats->push_latency_max = latency;
+    }
+    stats->push_latency_total += latency;
+    pthread_mutex_unlock(&stats->stats_lock);
+    ods_log_verbose("[STATS] %s pushed changes output after %u(msec)",
+        name?name:"(null)", (unsigned) latency);
+}
+
+
 /**
  * Clean up statistics.
  *
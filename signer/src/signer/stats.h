@@ -44,6 +44,21 @@ typedef struct stats_struct stats_type;
 
 #include "locks.h"
 
+/* base, input, prepare, neighbour, sign, output and changes views */
+#define STATS_NVIEWS 7
+
+/**
+ * Memory used by the views of one kind, in bytes.
+ */
+struct stats_memory {
+    const char* view;
+    uint32_t    records;    /* recordsets in the primary index */
+    size_t      indices;    /* views, their indices and index nodes */
+    size_t      recordsets; /* recordsets and their records */
+    size_t      signatures; /* signatures of the recordsets */
+    size_t      changelog;  /* changes not yet incorporated by all views */
+};
+
 /**
  * Statistics structure.
  */
@@ -59,6 +74,16 @@ struct stats_struct {
     time_t      sig_time;
     time_t      start_time;
     time_t      end_time;
+    /* changes pushed over HTTP, kept over stats_clear() */
+    struct timespec push_pending; /* oldest push not yet signed */
+    struct timespec push_signing; /* oldest push in the running sign */
+    uint32_t    push_count;
+    uint32_t    push_latency_last; /* push to output, milliseconds */
+    uint32_t    push_latency_max;
+    uint64_t    push_latency_total;
+    /* memory of the views as last measured, kept over stats_clear() */
+    struct stats_memory mem_views[STATS_NVIEWS];
+    time_t      mem_time;
     pthread_mutex_t stats_lock;
 };
 
@@ -80,6 +105,37 @@ extern stats_type* stats_create(void);
 extern void stats_log(stats_type* stats, const char* name, uint32_t serial,
     ldns_rr_type nsec_type);
 
+/**
+ * Register a change pushed into the zone.
+ * \param[in] stats statistics
+ * \return 1 if no earlier push is waiting to be signed, 0 otherwise
+ *
+ */
+extern int stats_push(stats_type* stats);
+
+/**
+ * The pending pushed changes are being signed now.
+ * \param[in] stats statistics
+ *
+ */
+extern void stats_push_signing(stats_type* stats);
+
+/**
+ * The signed pushed changes have been output, record their latency.
+ * \param[in] stats statistics
+ * \param[in] name zone name
+ *
+ */
+extern void stats_push_output(stats_type* stats, const char* name);
+
+/**
+ * Total memory used by all views as last measured.
+ * \param[in] stats statistics
+ * \return size_t bytes
+ *
+ */
+extern size_t stats_memory(stats_type* stats);
+
 /**
  * Clear statistics.
  * \param[in] stats statistics to be cleared
@@ -31,7 +31,6 @@
 #include "config.h"
 #include <errno.h>
 #include <sys/types.h>
-#include <sys/wait.h>
 #include <unistd.h>
 #include "daemon/dnshandler.h"
 #include "adapter/adapter.h"
@@ -163,20 +162,6 @@ tools_input(zone_type* zone)
 }
 
 
-/**
- * Close file descriptors.
- *
- */
-static void
-ods_closeall(int fd)
-{
-    int fdlimit = sysconf(_SC_OPEN_MAX);
-    while (fd < fdlimit) {
-        close(fd++);
-    }
-}
-
-
 /**
  * Write zone to output adapter.
  *
@@ -199,48 +184,11 @@ tools_output(zone_type* zone, engine_type* engine)
             tools_str, zone->name, ods_status2str(status));
         return status;
     }
-    /* kick the nameserver */
-    if (zone->notify_ns) {
-	int pid_status;
-        pid_t pid, wpid;
+    /* kick the nameserver, the notify executor runs the command */
+    if (zone->notify_ns && engine->notifyexec) {
         ods_log_verbose("[%s] notify nameserver: %s", tools_str,
             zone->notify_ns);
-	/** fork */
-        switch ((pid = fork())) {
-            case -1: /* error */
-                ods_log_error("[%s] notify nameserver failed: unable to fork "
-                    "(%s)", tools_str, strerror(errno));
-                return ODS_STATUS_FORK_ERR;
-            case 0: /* child */
-                /** close fds */
-		ods_closeall(0);
-                /** execv */
-                execvp(zone->notify_ns, zone->notify_args);
-                /** error */
-                ods_log_error("[%s] notify nameserver failed: execv() failed "
-                    "(%s)", tools_str, strerror(errno));
-                exit(1);
-                break;
-            default: /* parent */
-                ods_log_debug("[%s] notify nameserver process forked",
-                    tools_str);
-                /** wait for completion  */
-                while((wpid = waitpid(pid, &pid_status, 0)) <= 0) {
-                    if (errno != EINTR) {
-                        break;
-                    }
-                }
-                if (wpid == -1) {
-                    ods_log_error("[%s] notify nameserver failed: waitpid() "
-                        "failed (%s)", tools_str, strerror(errno));
-                } else if (!WIFEXITED(pid_status)) {
-                    ods_log_error("[%s] notify nameserver failed: notify "
-                        "command did not terminate normally", tools_str);
-                } else {
-                    ods_log_verbose("[%s] notify nameserver ok", tools_str);
-                }
-                break;
-        }
+        notifyexec_enqueue(engine->notifyexec, zone->name, zone->notify_args);
     }
     /* log stats */
     if (zone->stats) {
@@ -42,6 +42,7 @@
 #include "daemon/signertasks.h"
 #include "daemon/metastorage.h"
 
+#include <fcntl.h>
 #include <ldns/ldns.h>
 
 static const char* zone_str = "zone";
@@ -76,6 +77,19 @@ zone_create(char* name, ldns_rr_class klass)
         free(zone);
         return NULL;
     }
+    if (pthread_mutex_init(&zone->views_lock, NULL)) {
+        (void)pthread_mutex_destroy(&zone->xfr_lock);
+        (void)pthread_mutex_destroy(&zone->zone_lock);
+        free(zone);
+        return NULL;
+    }
+    if (pthread_cond_init(&zone->views_cond, NULL)) {
+        (void)pthread_mutex_destroy(&zone->views_lock);
+        (void)pthread_mutex_destroy(&zone->xfr_lock);
+        (void)pthread_mutex_destroy(&zone->zone_lock);
+        free(zone);
+        return NULL;
+    }
 
     zone->name = strdup(name);
     if (!zone->name) {
@@ -471,6 +485,13 @@ zone_cleanup(zone_type* zone)
     if (!zone) {
         return;
     }
+    /* wait for the evictor still measuring the views and for views still
+     * in use, such as by a propagation that was already running */
+    pthread_mutex_lock(&zone->views_lock);
+    while (zone->viewsinuse > 0) {
+        pthread_cond_wait(&zone->views_cond, &zone->views_lock);
+    }
+    pthread_mutex_unlock(&zone->views_lock);
     pthread_mutex_lock(&zone->zone_lock);
     ldns_rdf_deep_free(zone->apex);
     adapter_cleanup(zone->adinbound);
@@ -492,6 +513,8 @@ zone_cleanup(zone_type* zone)
     zone->nextserial = NULL;
     zone->inboundserial = NULL;
     zone->outboundserial = NULL;
+    pthread_cond_destroy(&zone->views_cond);
+    pthread_mutex_destroy(&zone->views_lock);
     pthread_mutex_destroy(&zone->xfr_lock);
     pthread_mutex_destroy(&zone->zone_lock);
     free(zone);
@@ -500,14 +523,34 @@ zone_cleanup(zone_type* zone)
 void
 zone_start(zone_type* zone)
 {
-    char* filename;
     char* zoneapex;
     uint32_t serial;
     ldns_rr* rr;
-    int notrestored;
 
     zoneapex = ldns_rdf2str(zone->apex);
     metastorageget(zoneapex,zone);
+    free(zoneapex);
+    zone_loadviews(zone);
+
+    names_viewlookupone(zone->baseview, zone->apex, LDNS_RR_TYPE_SOA, NULL, &rr);
+    if(rr) {
+        serial = ldns_rdf2native_int32(ldns_rr_rdf(rr, SE_SOA_RDATA_SERIAL));
+        if(zone->inboundserial)
+            free(zone->inboundserial);
+        zone->inboundserial = malloc(sizeof(uint32_t));
+        *zone->inboundserial = serial;
+        ldns_rr_free(rr);
+    }
+}
+
+void
+zone_loadviews(zone_type* zone)
+{
+    char* filename;
+    char* zoneapex;
+    int notrestored;
+
+    zoneapex = ldns_rdf2str(zone->apex);
     zone->baseview = names_viewcreate(NULL, names_view_BASE[0], &names_view_BASE[1]);
     names_viewconfig(zone->baseview, &(zone->signconf));
     filename = ods_build_path(zone->name, ".state", 0, 1);
@@ -527,13 +570,31 @@ zone_start(zone_type* zone)
     zone->signview = zonelist_createresource(zone->baseview,    names_view_SIGN[0],    &names_view_SIGN[1],    1, 1);
     zone->outputview = zonelist_createresource(zone->baseview,  names_view_OUTPUT[0],  &names_view_OUTPUT[1],  1, 4);
     zone->changesview = zonelist_createresource(zone->baseview, names_view_CHANGES[0], &names_view_CHANGES[1], 1, 1);
+}
 
-    names_viewlookupone(zone->baseview, zone->apex, LDNS_RR_TYPE_SOA, NULL, &rr);
-    if(rr) {
-        serial = ldns_rdf2native_int32(ldns_rr_rdf(rr, SE_SOA_RDATA_SERIAL));
-        if(zone->inboundserial)
-            free(zone->inboundserial);
-        zone->inboundserial = malloc(sizeof(uint32_t));
-        *zone->inboundserial = serial;
-    }
+void
+zone_unloadviews(zone_type* zone)
+{
+    char* filename;
+
+    /* the state file is a journal, rewrite it so reloading does not need
+     * to replay all changes since it was created */
+    filename = ods_build_path(zone->name, ".state", 0, 1);
+    names_viewreset(zone->baseview);
+    names_viewpersist(zone->baseview, AT_FDCWD, filename);
+    free(filename);
+    zonelist_destroyresource(zone->inputview);
+    zonelist_destroyresource(zone->prepareview);
+    zonelist_destroyresource(zone->neighview);
+    zonelist_destroyresource(zone->signview);
+    zonelist_destroyresource(zone->outputview);
+    zonelist_destroyresource(zone->changesview);
+    names_viewdestroy(zone->baseview);
+    zone->inputview = NULL;
+    zone->prepareview = NULL;
+    zone->neighview = NULL;
+    zone->signview = NULL;
+    zone->outputview = NULL;
+    zone->changesview = NULL;
+    zone->baseview = NULL;
 }
@@ -96,6 +96,16 @@ struct zone_struct {
     names_viewfactory_type signview;
     names_viewfactory_type outputview;
     names_viewfactory_type changesview;
+    /* residency of the views, idle zones may be evicted to their state file */
+    pthread_mutex_t views_lock;
+    pthread_cond_t views_cond; /* signalled when no view is in use anymore */
+    int viewsinuse; /* number of views obtained */
+    int viewsevicted; /* views released, state is in the state file */
+    int viewsdirty; /* views obtained since the footprint was measured */
+    time_t viewsaccessed; /* last time a view was obtained or released */
+    size_t viewsfootprint; /* measured memory use of the views */
+    long viewscommits; /* commits seen when last propagated to idle views */
+    int viewspropagating; /* propagation to idle views is pending */
 
     uint32_t* nextserial;
     uint32_t* inboundserial;
@@ -245,6 +255,24 @@ extern void zone_cleanup(zone_type* zone);
  */
 extern void zone_start(zone_type* zone);
 
+/**
+ * Create the views of the zone from its state file, or recover it when
+ * there is no state file yet.
+ *
+ * \param[in] zone zone
+ *
+ */
+extern void zone_loadviews(zone_type* zone);
+
+/**
+ * Write the state of the zone to its state file and release its views.
+ * None of the views may be in use.
+ *
+ * \param[in] zone zone
+ *
+ */
+extern void zone_unloadviews(zone_type* zone);
+
 /**
  * recover from old-style backup file format.
  * @param zone the zone to cover
@@ -36,14 +36,24 @@
 #include "file.h"
 #include "log.h"
 #include "status.h"
+#include "util.h"
 #include "signer/zone.h"
 #include "signer/zonelist.h"
 
 #include <ldns/ldns.h>
+#include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <unistd.h>
 
 static const char* zl_str = "zonelist";
 
+/* called to have commits propagated to idle views in the background */
+static void (*propagatehook)(void* arg, zone_type* zone) = NULL;
+static void* propagatearg = NULL;
+
 
 /**
  * Compare two zones.
@@ -83,11 +93,27 @@ zonelist_create()
         return NULL;
     }
     zlist->last_modified = 0;
+    zlist->instance = 0;
+    zlist->instances = 1;
     pthread_mutex_init(&zlist->zl_lock, NULL);
     return zlist;
 }
 
 
+/**
+ * Whether a zone is served by this instance.
+ *
+ */
+int
+zonelist_owns(zonelist_type* zl, const char* name)
+{
+    if (!zl || zl->instances <= 1) {
+        return 1;
+    }
+    return util_instance_of(name, zl->instances) == zl->instance;
+}
+
+
 /**
  * Read a zonelist file.
  *
@@ -97,15 +123,32 @@ zonelist_read(zonelist_type* zl, const char* zlfile)
 {
     const char* rngfile = ODS_SE_RNGDIR "/zonelist.rng";
     ods_status status = ODS_STATUS_OK;
+    char jfile[PATH_MAX];
+    FILE* jfd = NULL;
     ods_log_assert(zlfile);
     ods_log_verbose("[%s] read file %s", zl_str, zlfile);
+    /* the enforcer journals single zone changes next to the file, hold
+     * it so that the file is not compacted while reading both */
+    if (snprintf(jfile, sizeof(jfile), "%s.journal", zlfile) < (int)sizeof(jfile)
+        && (jfd = fopen(jfile, "r")) != NULL) {
+        (void) flock(fileno(jfd), LOCK_SH);
+    }
     status = parse_file_check(zlfile, rngfile);
     if (status != ODS_STATUS_OK) {
         ods_log_error("[%s] unable to read file: parse error in %s", zl_str,
             zlfile);
-        return status;
+    } else {
+        status = parse_zonelist_zones((struct zonelist_struct*) zl, zlfile);
+    }
+    if (status == ODS_STATUS_OK && jfd) {
+        status = parse_zonelist_journal((struct zonelist_struct*) zl, jfd,
+            jfile);
     }
-    return parse_zonelist_zones((struct zonelist_struct*) zl, zlfile);
+    if (jfd) {
+        (void) flock(fileno(jfd), LOCK_UN);
+        fclose(jfd);
+    }
+    return status;
 }
 
 
@@ -140,7 +183,9 @@ void
 zonelist_zonedumpviews(zone_type* zone)
 {
     int i;
-    fprintf(stderr,"view:%10.10srecords  serial\n","");
+    if(zone->viewsevicted)
+        return;
+    fprintf(stderr,"view:%10.10srecords    kbytes  serial\n","");
     names_dumpviewinfo(stderr, zone->baseview);
     for(i=0; i<zone->prepareview->curviews; i++)
         names_dumpviewinfo(stderr, zone->prepareview->views[i]);
@@ -154,6 +199,32 @@ zonelist_zonedumpviews(zone_type* zone)
         names_dumpviewinfo(stderr, zone->changesview->views[i]);
 }
 
+void
+zonelist_pinviews(zone_type* zone)
+{
+    pthread_mutex_lock(&zone->views_lock);
+    if(zone->viewsevicted) {
+        ods_log_debug("[%s] reload zone %s from state file", zl_str, zone->name);
+        zone_loadviews(zone);
+        zone->viewsevicted = 0;
+    }
+    zone->viewsinuse += 1;
+    zone->viewsdirty = 1;
+    zone->viewsaccessed = time_now();
+    pthread_mutex_unlock(&zone->views_lock);
+}
+
+void
+zonelist_unpinviews(zone_type* zone)
+{
+    pthread_mutex_lock(&zone->views_lock);
+    zone->viewsinuse -= 1;
+    zone->viewsaccessed = time_now();
+    if(zone->viewsinuse == 0)
+        pthread_cond_broadcast(&zone->views_cond);
+    pthread_mutex_unlock(&zone->views_lock);
+}
+
 names_view_type
 zonelist_obtainresource(zonelist_type* zonelist, zone_type* zone, const char* name, size_t offset)
 {
@@ -168,6 +239,7 @@ zonelist_obtainresource(zonelist_type* zonelist, zone_type* zone, const char* na
         assert(zone);
     }
     if(zone != NULL) {
+        zonelist_pinviews(zone);
         viewfactory = *(names_viewfactory_type*)&(((char*)zone)[offset]);
         assert(viewfactory == zone->inputview || viewfactory == zone->prepareview || viewfactory == zone->neighview || viewfactory == zone->signview || viewfactory == zone->outputview || viewfactory == zone->changesview);
         if(viewfactory->maxviews > 0)
@@ -203,7 +275,8 @@ zonelist_obtainresource(zonelist_type* zonelist, zone_type* zone, const char* na
 void
 zonelist_releaseresource(zonelist_type* zonelist, zone_type* zone, const char* name, size_t offset, names_view_type view)
 {
-    int i;
+    int i, propagate;
+    long commits;
     struct ldns_rbnode_t* node;
     names_viewfactory_type viewfactory;
     if(zonelist != NULL && zone == NULL) {
@@ -219,6 +292,7 @@ zonelist_releaseresource(zonelist_type* zonelist, zone_type* zone, const char* n
     if(zone != NULL) {
         viewfactory = *(names_viewfactory_type*)&(((char*)zone)[offset]);
         assert(viewfactory == zone->inputview || viewfactory == zone->prepareview || viewfactory == zone->neighview || viewfactory == zone->signview || viewfactory == zone->outputview || viewfactory == zone->changesview);
+        commits = names_viewcommits(view);
         if(viewfactory->maxviews > 0)
             pthread_mutex_lock(&viewfactory->mutex);
         for(i=0; i<viewfactory->curviews; i++) {
@@ -234,9 +308,81 @@ zonelist_releaseresource(zonelist_type* zonelist, zone_type* zone, const char* n
         assert(view == NULL);
         if(viewfactory->maxviews > 0)
             pthread_mutex_unlock(&viewfactory->mutex);
+        pthread_mutex_lock(&zone->views_lock);
+        propagate = (propagatehook && commits != zone->viewscommits && !zone->viewspropagating);
+        if(propagate) {
+            zone->viewscommits = commits;
+            zone->viewspropagating = 1;
+        }
+        pthread_mutex_unlock(&zone->views_lock);
+        if(propagate)
+            propagatehook(propagatearg, zone);
+        zonelist_unpinviews(zone);
     }
 }
 
+void
+zonelist_propagation(void (*hook)(void* arg, zone_type* zone), void* arg)
+{
+    propagatehook = hook;
+    propagatearg = arg;
+}
+
+static void
+zonelist_propagateresource(names_viewfactory_type viewfactory)
+{
+    int i, j;
+    names_view_type view;
+    for(i=0; ; i++) {
+        pthread_mutex_lock(&viewfactory->mutex);
+        if(i >= viewfactory->curviews) {
+            pthread_mutex_unlock(&viewfactory->mutex);
+            break;
+        }
+        view = viewfactory->views[i];
+        viewfactory->views[i] = NULL;
+        pthread_mutex_unlock(&viewfactory->mutex);
+        if(view == NULL)
+            continue; /* in use, its user brings it up to date */
+        names_viewupdate(view);
+        pthread_mutex_lock(&viewfactory->mutex);
+        for(j=0; j<viewfactory->curviews; j++) {
+            if(viewfactory->views[j] == NULL) {
+                viewfactory->views[j] = view;
+                pthread_cond_broadcast(&viewfactory->cond);
+                break;
+            }
+        }
+        pthread_mutex_unlock(&viewfactory->mutex);
+    }
+}
+
+void
+zonelist_propagateviews(zone_type* zone)
+{
+    pthread_mutex_lock(&zone->views_lock);
+    zone->viewspropagating = 0;
+    if(zone->viewsevicted || !zone->baseview) {
+        /* reloading brings all views up to date anyway */
+        pthread_mutex_unlock(&zone->views_lock);
+        return;
+    }
+    zone->viewsinuse += 1;
+    zone->viewsdirty = 1;
+    pthread_mutex_unlock(&zone->views_lock);
+    zonelist_propagateresource(zone->inputview);
+    zonelist_propagateresource(zone->prepareview);
+    zonelist_propagateresource(zone->neighview);
+    zonelist_propagateresource(zone->signview);
+    zonelist_propagateresource(zone->outputview);
+    zonelist_propagateresource(zone->changesview);
+    pthread_mutex_lock(&zone->views_lock);
+    zone->viewsinuse -= 1;
+    if(zone->viewsinuse == 0)
+        pthread_cond_broadcast(&zone->views_cond);
+    pthread_mutex_unlock(&zone->views_lock);
+}
+
 
 names_viewfactory_type
 zonelist_createresource(names_view_type base, const char* viewname, const char** keynames, int mincount, int maxcount)
@@ -279,9 +425,188 @@ zonelist_destroyresource(names_viewfactory_type viewfactory)
         pthread_mutex_destroy(&viewfactory->mutex);
         pthread_cond_destroy(&viewfactory->cond);
     }
+    free(viewfactory->views);
     free(viewfactory);
 }
 
+static void
+zonelist_memoryresource(names_viewfactory_type viewfactory, struct stats_memory* memory)
+{
+    int i;
+    memory->view = viewfactory->viewname;
+    memory->indices += sizeof(struct names_viewfactory_struct) + sizeof(names_view_type) * viewfactory->maxviews;
+    for(i=0; i<viewfactory->curviews; i++)
+        if(viewfactory->views[i])
+            names_viewmemory(viewfactory->views[i], memory);
+}
+
+/* Must be called with the views lock held while no view is in use. */
+static void
+zonelist_measureviews(zone_type* zone)
+{
+    struct stats_memory memory[STATS_NVIEWS];
+    memset(memory, 0, sizeof(memory));
+    memory[0].view = "base";
+    names_viewmemory(zone->baseview, &memory[0]);
+    zonelist_memoryresource(zone->inputview,   &memory[1]);
+    zonelist_memoryresource(zone->prepareview, &memory[2]);
+    zonelist_memoryresource(zone->neighview,   &memory[3]);
+    zonelist_memoryresource(zone->signview,    &memory[4]);
+    zonelist_memoryresource(zone->outputview,  &memory[5]);
+    zonelist_memoryresource(zone->changesview, &memory[6]);
+    pthread_mutex_lock(&zone->stats->stats_lock);
+    memcpy(zone->stats->mem_views, memory, sizeof(memory));
+    zone->stats->mem_time = time_now();
+    zone->viewsfootprint = stats_memory(zone->stats);
+    pthread_mutex_unlock(&zone->stats->stats_lock);
+    zone->viewsdirty = 0;
+}
+
+static void
+zonelist_forgetviews(zone_type* zone)
+{
+    pthread_mutex_lock(&zone->stats->stats_lock);
+    memset(zone->stats->mem_views, 0, sizeof(zone->stats->mem_views));
+    zone->stats->mem_time = time_now();
+    pthread_mutex_unlock(&zone->stats->stats_lock);
+}
+
+int
+zonelist_zonememory(zone_type* zone, int* evicted)
+{
+    int measured = 0;
+    pthread_mutex_lock(&zone->views_lock);
+    if(evicted)
+        *evicted = zone->viewsevicted;
+    if(zone->viewsevicted || !zone->baseview) {
+        measured = 1;
+    } else if(zone->viewsinuse == 0) {
+        if(zone->viewsdirty)
+            zonelist_measureviews(zone);
+        measured = 1;
+    }
+    pthread_mutex_unlock(&zone->views_lock);
+    return measured;
+}
+
+struct evictcandidate {
+    ldns_rdf* apex;
+    ldns_rr_class klass;
+    time_t accessed;
+    int duesoon;
+};
+
+static int
+evictorder(const void* a, const void* b)
+{
+    const struct evictcandidate* x = a;
+    const struct evictcandidate* y = b;
+    if(x->duesoon != y->duesoon)
+        return x->duesoon - y->duesoon;
+    if(x->accessed != y->accessed)
+        return (x->accessed < y->accessed ? -1 : 1);
+    return 0;
+}
+
+/**
+ * Find the zone of a candidate again and take its views lock.  The zone list
+ * lock is only held for the lookup, a zone being deleted meanwhile waits in
+ * zone_cleanup() for the views lock to be released.
+ *
+ */
+static zone_type*
+evictlock(zonelist_type* zl, struct evictcandidate* candidate, int wait)
+{
+    zone_type key;
+    ldns_rbnode_t* node;
+    zone_type* zone = NULL;
+    key.apex = candidate->apex;
+    key.klass = candidate->klass;
+    pthread_mutex_lock(&zl->zl_lock);
+    node = ldns_rbtree_search(zl->zones, &key);
+    if(node && node != LDNS_RBTREE_NULL) {
+        zone = (zone_type*) node->data;
+        if(wait)
+            pthread_mutex_lock(&zone->views_lock);
+        else if(pthread_mutex_trylock(&zone->views_lock))
+            zone = NULL; /* being reloaded or evicted */
+    }
+    pthread_mutex_unlock(&zl->zl_lock);
+    return zone;
+}
+
+void
+zonelist_evictzones(zonelist_type* zl, schedule_type* taskq, size_t budget)
+{
+    ldns_rbnode_t* node;
+    zone_type* zone;
+    struct evictcandidate* candidates;
+    int i, nzones, ncandidates, nevicted, idle;
+    size_t resident;
+    time_t now, due;
+
+    now = time_now();
+    resident = 0;
+    nzones = nevicted = ncandidates = 0;
+    pthread_mutex_lock(&zl->zl_lock);
+    CHECKALLOC(candidates = malloc(sizeof(struct evictcandidate) * (zl->zones->count + 1)));
+    for(node = ldns_rbtree_first(zl->zones); node != LDNS_RBTREE_NULL; node = ldns_rbtree_next(node)) {
+        zone = (zone_type*) node->data;
+        CHECKALLOC(candidates[nzones].apex = ldns_rdf_clone(zone->apex));
+        candidates[nzones].klass = zone->klass;
+        ++nzones;
+    }
+    pthread_mutex_unlock(&zl->zl_lock);
+    /* measuring walks all records of a zone, do so without the zone list */
+    for(i=0; i<nzones; i++) {
+        idle = 0;
+        if((zone = evictlock(zl, &candidates[i], 0)) != NULL) {
+            if(!zone->viewsevicted && zone->baseview) {
+                if(zone->viewsinuse == 0 && zone->viewsdirty) {
+                    zonelist_measureviews(zone);
+                }
+                resident += zone->viewsfootprint;
+                if(zone->viewsinuse == 0) {
+                    /* a zone about to be worked on would be reloaded right away */
+                    due = schedule_nextdue(taskq, zone->name);
+                    candidates[i].accessed = zone->viewsaccessed;
+                    candidates[i].duesoon = (due >= 0 && due < now + ODS_SE_EVICTINTERVAL);
+                    idle = 1;
+                }
+            }
+            pthread_mutex_unlock(&zone->views_lock);
+        }
+        if(idle) {
+            candidates[ncandidates++] = candidates[i];
+        } else {
+            ldns_rdf_deep_free(candidates[i].apex);
+        }
+    }
+    if(resident > budget) {
+        qsort(candidates, ncandidates, sizeof(struct evictcandidate), evictorder);
+        for(i=0; i<ncandidates && resident > budget; i++) {
+            if((zone = evictlock(zl, &candidates[i], 1)) == NULL)
+                continue; /* deleted meanwhile */
+            if(zone->viewsinuse == 0 && !zone->viewsevicted) {
+                zone_unloadviews(zone);
+                zone->viewsevicted = 1;
+                resident -= zone->viewsfootprint;
+                zone->viewsfootprint = 0;
+                zone->viewsdirty = 1;
+                zonelist_forgetviews(zone);
+                ++nevicted;
+            }
+            pthread_mutex_unlock(&zone->views_lock);
+        }
+    }
+    for(i=0; i<ncandidates; i++)
+        ldns_rdf_deep_free(candidates[i].apex);
+    free(candidates);
+    if(nevicted > 0) {
+        ods_log_info("[%s] evicted %d idle zones to their state file, %lu bytes of zone data remain in memory", zl_str, nevicted, (unsigned long)resident);
+    }
+}
+
 void
 zonelist_zonevalidateviewfactory(names_viewfactory_type viewfactory)
 {
@@ -499,9 +824,11 @@ ods_status
 zonelist_update(zonelist_type* zl, const char* zlfile)
 {
     zonelist_type* new_zlist = NULL;
-    time_t st_mtime = 0;
+    time_t mtime = 0;
     ods_status status = ODS_STATUS_OK;
     char* datestamp = NULL;
+    char jfile[PATH_MAX];
+    time_t jmtime;
 
     ods_log_debug("[%s] update zone list", zl_str);
     if (!zl|| !zl->zones || !zlfile) {
@@ -511,8 +838,15 @@ zonelist_update(zonelist_type* zl, const char* zlfile)
     /* OPENDNSSEC-686: changes happening within one second will not be
      * seen
      */
-    st_mtime = ods_file_lastmodified(zlfile);
-    if (st_mtime <= zl->last_modified) {
+    mtime = ods_file_lastmodified(zlfile);
+    if (snprintf(jfile, sizeof(jfile), "%s.journal", zlfile) < (int)sizeof(jfile)
+        && access(jfile, F_OK) == 0) {
+        jmtime = ods_file_lastmodified(jfile);
+        if (jmtime > mtime) {
+            mtime = jmtime;
+        }
+    }
+    if (mtime <= zl->last_modified) {
         (void)time_datestamp(zl->last_modified, "%Y-%m-%d %T", &datestamp);
         ods_log_error("[%s] zonelist file %s is unchanged since %s",
             zl_str, zlfile, datestamp?datestamp:"Unknown");
@@ -521,13 +855,15 @@ zonelist_update(zonelist_type* zl, const char* zlfile)
     }
     /* create new zonelist */
     new_zlist = zonelist_create();
+    new_zlist->instance = zl->instance;
+    new_zlist->instances = zl->instances;
     /* read zonelist */
     status = zonelist_read(new_zlist, zlfile);
     if (status == ODS_STATUS_OK) {
         zl->just_removed = 0;
         zl->just_added = 0;
         zl->just_updated = 0;
-        new_zlist->last_modified = st_mtime;
+        new_zlist->last_modified = mtime;
         zonelist_merge(zl, new_zlist);
         (void)time_datestamp(zl->last_modified, "%Y-%m-%d %T", &datestamp);
         ods_log_error("[%s] file %s is modified since %s", zl_str, zlfile,
@@ -49,6 +49,8 @@ struct zonelist_struct {
     int just_added;
     int just_updated;
     int just_removed;
+    int instance;
+    int instances;
     pthread_mutex_t zl_lock;
 };
 
@@ -60,6 +62,16 @@ struct zonelist_struct {
  */
 extern zonelist_type* zonelist_create(void);
 
+/**
+ * Whether a zone is served by this signer instance.  With multiple
+ * instances the zones are partitioned over them by a hash of their name.
+ * \param[in] zl zone list
+ * \param[in] name zone name
+ * \return int 1 if this instance owns the zone, 0 otherwise
+ *
+ */
+extern int zonelist_owns(zonelist_type* zl, const char* name);
+
 /**
  * Lookup zone by name and class.
  * \param[in] zl zone list
@@ -168,6 +180,46 @@ names_viewfactory_type zonelist_createresource(names_view_type base, const char*
  */
 void zonelist_destroyresource(names_viewfactory_type viewfactory);
 
+/**
+ * Keeps the views of a zone in memory until unpinned, reloading them from
+ * the state file when the zone was evicted.  Obtaining a resource pins the
+ * zone implicitly, direct use of the base view must be pinned explicitly.
+ * @param zone the zone
+ */
+void zonelist_pinviews(zone_type* zone);
+void zonelist_unpinviews(zone_type* zone);
+
+/**
+ * Commits made through a view are applied to the other views of the zone
+ * when these are next obtained.  With a propagation hook installed, a
+ * release after a commit calls the hook so the commit can be applied to
+ * the idle views in the background by zonelist_propagateviews.
+ * @param hook called with arg and the zone, NULL to disable
+ * @param arg passed to the hook
+ */
+void zonelist_propagation(void (*hook)(void* arg, zone_type* zone), void* arg);
+void zonelist_propagateviews(zone_type* zone);
+
+/**
+ * Evicts idle zones to their state file, least recently used first and
+ * zones with tasks about to be due last, until the estimated memory used
+ * by the views of the zones that remain is within the budget.
+ * @param zonelist the zonelist
+ * @param taskq the schedule to look up when zones are next due
+ * @param budget the number of bytes zone views may use
+ */
+void zonelist_evictzones(zonelist_type* zonelist, schedule_type* taskq, size_t budget);
+
+/**
+ * Measures the memory used by the views of a zone, per kind of view, into
+ * the statistics of the zone.  Views that are in use are not measured and
+ * keep their previous measurement, evicted zones use no memory.
+ * @param zone the zone
+ * @param evicted if not NULL, set to whether the views of the zone are evicted
+ * @return whether the statistics reflect the current views
+ */
+int zonelist_zonememory(zone_type* zone, int* evicted);
+
 /**
  * Calls the provided callback function on all views created by the view
  * factory.  Should only be used in case it is certain no other threads are
@@ -41,6 +41,10 @@
 #include <sys/wait.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <limits.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
 #include "janitor.h"
 #include "logging.h"
@@ -54,8 +58,11 @@
 #include "daemon/metastorage.h"
 #include "views/httpd.h"
 #include "adapter/adutil.h"
+#include "adapter/addns.h"
+#include "parser/addnsparser.h"
 #include "settings.h"
 #include "cfg.h"
+#include "util.h"
 
 #include "comparezone.h"
 
@@ -376,6 +383,33 @@ reresignzone(zone_type* zone)
     worker_cleanup(context.worker);
 }
 
+static void
+pushsignzone(zone_type* zone)
+{
+    task_type* task;
+    struct worker_context context;
+    context.engine = engine;
+    context.worker = worker_create(strdup("mock"), NULL);
+    context.signq = NULL;
+    context.zone = zone;
+    context.clock_in = time_now();
+    task = task_create(strdup(zone->name), TASK_CLASS_SIGNER, TASK_SIGNPUSHED, do_signpushed, zone, NULL, 0);
+    task->callback(task, zone->name, zone, &context);
+    task_destroy(task);
+    worker_cleanup(context.worker);
+}
+
+static int
+countexpiring(names_view_type view, time_t refreshtime)
+{
+    int count = 0;
+    names_iterator iter;
+    recordset_type record;
+    for(iter=names_viewiterator(view,names_iteratorexpiring,refreshtime); names_iterate(&iter,&record); names_advance(&iter,NULL))
+        ++count;
+    return count;
+}
+
 static struct rpc*
 makecall(const char* zone, const char* delegation, ...)
 {
@@ -834,8 +868,11 @@ testSignFastRemove(void)
 void
 testSignFastInsert(void)
 {
-    int status;
+    int i, status;
     zone_type* zone;
+    names_view_type signview;
+    ldns_rdf* owner;
+    char* ownerstr;
     set_time_now(1537918509);
     logger_mark_performance("setup files");
     usefile("example.com.state", NULL);
@@ -858,13 +895,243 @@ testSignFastInsert(void)
     status = names_viewcommit(inputview);
     CU_ASSERT_EQUAL(status,0);
     zonelist_releaseresource(NULL, zone, NULL, offsetof(zone_type, inputview), inputview);
+    /* only the first of coalesced pushes needs to schedule a sign */
+    CU_ASSERT_EQUAL(stats_push(zone->stats), 1);
+    CU_ASSERT_EQUAL(stats_push(zone->stats), 0);
+
+    /* a failing change set does not take down the rest of the group */
+    struct rpc* rpcs[3];
+    struct httpd_change changes[3];
+    rpcs[0] = makecall(zone->name, "dominio.example.com.", "dominio.example.com. NS ns.domain.example.com.", NULL);
+    rpcs[1] = makecall(zone->name, "nowhere.example.com.", "nowhere.example.com. NS ns.domain.example.com.", NULL);
+    rpcs[1]->opc = RPC_CHANGE_NAME;
+    rpcs[2] = makecall(zone->name, "dominium.example.com.", "dominium.example.com. NS ns.domain.example.com.", NULL);
+    for (i = 0; i < 3; i++) {
+        changes[i].rpcs = &rpcs[i];
+        changes[i].count = 1;
+        changes[i].failed = 0;
+        changes[i].next = (i < 2 ? &changes[i+1] : NULL);
+    }
+    inputview = zonelist_obtainresource(NULL, zone, NULL, offsetof(zone_type, inputview));
+    CU_ASSERT_EQUAL(httpd_dispatchgroup(inputview, changes), 2);
+    CU_ASSERT_EQUAL(rpcs[0]->status, RPC_OK);
+    CU_ASSERT_EQUAL(rpcs[1]->status, RPC_ERR);
+    CU_ASSERT_EQUAL(rpcs[2]->status, RPC_OK);
+    CU_ASSERT_PTR_NOT_NULL(names_take(inputview, 0, "dominio.example.com."));
+    CU_ASSERT_PTR_NOT_NULL(names_take(inputview, 0, "dominium.example.com."));
+    zonelist_releaseresource(NULL, zone, NULL, offsetof(zone_type, inputview), inputview);
+    /* without a view nothing is committed */
+    changes[0].failed = 0;
+    changes[0].next = NULL;
+    CU_ASSERT_EQUAL(httpd_dispatchgroup(NULL, changes), 0);
+    CU_ASSERT_EQUAL(rpcs[0]->status, RPC_RESOURCE_NOT_FOUND);
+    for (i = 0; i < 3; i++)
+        rpc_destroy(rpcs[i]);
+
+    /* wire format owners are keyed by their presentation format */
+    inputview = zonelist_obtainresource(NULL, zone, NULL, offsetof(zone_type, inputview));
+    names_viewreset(inputview);
+    owner = ldns_dname_new_frm_str("w\\.i\\(r\\032d.example.com.");
+    ownerstr = ldns_rdf2str(owner);
+    CU_ASSERT_PTR_NULL(names_takeowner(inputview, 0, owner));
+    CU_ASSERT_PTR_NOT_NULL(names_placeowner(inputview, owner));
+    CU_ASSERT_PTR_NOT_NULL(names_take(inputview, 0, ownerstr));
+    CU_ASSERT_EQUAL(names_takeowner(inputview, 0, owner), names_take(inputview, 0, ownerstr));
+    free(ownerstr);
+    ldns_rdf_deep_free(owner);
+    names_viewreset(inputview);
+    zonelist_releaseresource(NULL, zone, NULL, offsetof(zone_type, inputview), inputview);
 
-    reresignzone(zone);
+    /* a pushed sign signs the changed domains only */
+    signview = zonelist_obtainresource(NULL, zone, NULL, offsetof(zone_type, signview));
+    names_viewreset(signview);
+    CU_ASSERT_NOT_EQUAL(countexpiring(signview, 0), 0);
+    zonelist_releaseresource(NULL, zone, NULL, offsetof(zone_type, signview), signview);
+    pushsignzone(zone);
+    signview = zonelist_obtainresource(NULL, zone, NULL, offsetof(zone_type, signview));
+    names_viewreset(signview);
+    CU_ASSERT_EQUAL(countexpiring(signview, 0), 0);
+    zonelist_releaseresource(NULL, zone, NULL, offsetof(zone_type, signview), signview);
     outputzone(zone);
+    CU_ASSERT_EQUAL(zone->stats->push_count, 1);
     disposezone(zone);
     CU_ASSERT_EQUAL((system("ldns-verify-zone -t 20180926013741 signed.zone")), 0);
 }
 
+static char*
+makepayload(int count, int wire)
+{
+    int i;
+    size_t len, pos;
+    char* payload;
+    len = 64 + (size_t)count * 96;
+    CHECKALLOC(payload = malloc(len));
+    pos = snprintf(payload, len, "{\"apiversion\": \"20171113\", \"entities\": [");
+    for(i=0; i<count; i++) {
+        if(wire) {
+            pos += snprintf(&payload[pos], len-pos, "%s{\"name\": \"n%d.example.com.\", \"type\": \"A\", \"ttl\": 600, \"class\": \"IN\", \"wire\": \"wAACAQ==\"}", (i?",":""), i);
+        } else {
+            pos += snprintf(&payload[pos], len-pos, "%s{\"name\": \"n%d.example.com.\", \"type\": \"A\", \"ttl\": \"600\", \"class\": \"IN\", \"rdata\": \"192.0.2.1\"}", (i?",":""), i);
+        }
+    }
+    snprintf(&payload[pos], len-pos, "]}");
+    return payload;
+}
+
+void
+testRpcDecode(void)
+{
+    int i;
+    const int count = 100000;
+    char* payload;
+    struct rpc* text;
+    struct rpc* wire;
+    const char* url = "/api/v1/changename/example.com/n0.example.com.";
+
+    payload = makepayload(count, 0);
+    logger_mark_performance("decode text records");
+    text = rpc_decode_json(url, payload, strlen(payload));
+    logger_mark_performance("decoded text records");
+    free(payload);
+
+    payload = makepayload(count, 1);
+    logger_mark_performance("decode wire records");
+    wire = rpc_decode_json(url, payload, strlen(payload));
+    logger_mark_performance("decoded wire records");
+    free(payload);
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(text);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(wire);
+    CU_ASSERT_EQUAL(text->rr_count, count);
+    CU_ASSERT_EQUAL(wire->rr_count, count);
+    for(i=0; i<count && i<wire->rr_count && i<text->rr_count; i++) {
+        if(ldns_rr_compare(text->rr[i], wire->rr[i]) || ldns_rr_ttl(text->rr[i]) != ldns_rr_ttl(wire->rr[i])) {
+            CU_FAIL("text and wire decoding differ");
+            break;
+        }
+    }
+    rpc_destroy(text);
+    rpc_destroy(wire);
+}
+
+/* Bytes of heap in use, or 0 where the C library cannot tell. */
+static size_t
+heapinuse(void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+void
+testRecordMemory(void)
+{
+    int i, j;
+    const int count = 10000;
+    char* name;
+    char* str;
+    size_t accounted, before, asldns, ascompact;
+    recordset_type* records;
+    recordset_type record;
+    ldns_rr** generated;
+    ldns_rr* rr;
+    ldns_rr_list* rrs;
+    struct signature_struct** rrsigs;
+    ldns_rdf* origin = NULL;
+    ldns_rdf* prev = NULL;
+
+    origin = ldns_rdf_new_frm_str(LDNS_RDF_TYPE_DNAME, "example.com.");
+    CHECKALLOC(records = malloc(sizeof(recordset_type) * count));
+    CHECKALLOC(generated = malloc(sizeof(ldns_rr*) * count * 3));
+
+    /* a generated zone, every name with an A and MX RRset and a signature */
+    before = heapinuse();
+    for(i=0; i<count; i++) {
+        asprintf(&str, "n%d.example.com. 3600 IN A 192.0.2.%d", i, i % 256);
+        ldns_rr_new_frm_str(&generated[3*i], str, 3600, origin, &prev);
+        free(str);
+        asprintf(&str, "n%d.example.com. 3600 IN MX 10 mail.example.com.", i);
+        ldns_rr_new_frm_str(&generated[3*i+1], str, 3600, origin, &prev);
+        free(str);
+        asprintf(&str, "n%d.example.com. 3600 IN RRSIG A 7 3 3600 20180525135557 20180525125459 55490 example.com. FV0gZ8FAaqlFnJ6jFuBj4DSImeftLaRdOXhjGxUZuZe29PkkuZP9u2cb9n4SSXRSn88rEHoSff8nPKwYKCOzOxlgHx7q4FZwmGrLrmV7Sfjp41O7DI4P8F/APVwfuc4d63uQq3C2opXgFv76L0CQ/+9mIOxthjL7hVy00UDPzWM=", i);
+        ldns_rr_new_frm_str(&generated[3*i+2], str, 3600, origin, &prev);
+        free(str);
+    }
+    asldns = heapinuse() - before;
+
+    /* the same zone in compact storage */
+    accounted = 0;
+    before = heapinuse();
+    for(i=0; i<count; i++) {
+        str = ldns_rdf2str(ldns_rr_owner(generated[3*i]));
+        name = str;
+        records[i] = names_recordcreate(&name);
+        free(str);
+        names_recordadddata(records[i], generated[3*i]);
+        names_recordadddata(records[i], generated[3*i+1]);
+        names_recordaddsignature(records[i], LDNS_RR_TYPE_A, ldns_rr_clone(generated[3*i+2]), "locateme", 0);
+        accounted += names_recordextend(records[i], NULL);
+    }
+    ascompact = heapinuse() - before;
+    logger_mark_performance("built records");
+
+    /* the accounting never claims more than is allocated, and the compact
+     * storage takes less than the ldns records did */
+    if(asldns > 0) {
+        CU_ASSERT(accounted <= ascompact);
+        CU_ASSERT(ascompact < asldns);
+    }
+    for(j=0; j<count*3; j++)
+        ldns_rr_free(generated[j]);
+    free(generated);
+
+    /* records must come out as they went in, comparing canonical */
+    ldns_rr_new_frm_str(&rr, "n1.example.com. 3600 IN MX 10 MAIL.Example.COM.", 3600, origin, &prev);
+    CU_ASSERT_EQUAL(names_recordhasdata(records[1], LDNS_RR_TYPE_MX, rr, 1), 1);
+    names_recordlookupall(records[1], LDNS_RR_TYPE_MX, NULL, &rrs, &rrsigs);
+    CU_ASSERT_EQUAL(ldns_rr_list_rr_count(rrs), 1);
+    CU_ASSERT_EQUAL(ldns_rr_compare(rr, ldns_rr_list_rr(rrs, 0)), 0);
+    ldns_rr_list_deep_free(rrs);
+    names_recordfreesignatures(rrsigs);
+    ldns_rr_free(rr);
+    names_recordlookupall(records[1], LDNS_RR_TYPE_RRSIG, NULL, NULL, &rrsigs);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(rrsigs[0]);
+    CU_ASSERT_STRING_EQUAL(rrsigs[0]->keylocator, "locateme");
+    CU_ASSERT_EQUAL(ldns_rr_get_type(rrsigs[0]->rr), LDNS_RR_TYPE_RRSIG);
+    CU_ASSERT_PTR_NULL(rrsigs[1]);
+    names_recordfreesignatures(rrsigs);
+
+    for(i=0; i<count; i++)
+        names_recorddispose(records[i]);
+    free(records);
+
+    /* records of one RRset with differing TTLs all get the lowest TTL */
+    record = names_recordcreatetemp("mixed.example.com.");
+    ldns_rr_new_frm_str(&rr, "mixed.example.com. 3600 IN A 192.0.2.1", 3600, origin, &prev);
+    names_recordadddata(record, rr);
+    ldns_rr_free(rr);
+    ldns_rr_new_frm_str(&rr, "mixed.example.com. 300 IN A 192.0.2.2", 3600, origin, &prev);
+    names_recordadddata(record, rr);
+    ldns_rr_free(rr);
+    ldns_rr_new_frm_str(&rr, "mixed.example.com. 7200 IN A 192.0.2.3", 3600, origin, &prev);
+    names_recordadddata(record, rr);
+    names_recordlookupall(record, LDNS_RR_TYPE_A, NULL, &rrs, NULL);
+    CU_ASSERT_EQUAL(ldns_rr_list_rr_count(rrs), 3);
+    for(j=0; j<(int)ldns_rr_list_rr_count(rrs); j++)
+        CU_ASSERT_EQUAL(ldns_rr_ttl(ldns_rr_list_rr(rrs, j)), 300);
+    ldns_rr_list_deep_free(rrs);
+    ldns_rr_set_ttl(rr, 300);
+    CU_ASSERT_EQUAL(names_recordhasdata(record, LDNS_RR_TYPE_A, rr, 1), 1);
+    ldns_rr_free(rr);
+    names_recorddispose(record);
+
+    ldns_rdf_deep_free(origin);
+    if(prev)
+        ldns_rdf_deep_free(prev);
+}
+
 void
 testSignFastChange(void)
 {
@@ -898,6 +1165,684 @@ testSignFastChange(void)
     CU_ASSERT_EQUAL((system("ldns-verify-zone -t 20180926013741 signed.zone")), 0);
 }
 
+void
+testEvictZone(void)
+{
+    zone_type* zone;
+    set_time_now(1537918509);
+    logger_mark_performance("setup files");
+    usefile("example.com.state", NULL);
+    usefile("signer.db", NULL);
+    usefile("zones.xml", "zones.xml.example");
+    usefile("unsigned.zone", "unsigned.zone.testing");
+    usefile("signconf.xml", "signconf.xml.nsec");
+    zonelist_update(engine->zonelist, engine->config->zonelist_filename_signer);
+    zone = zonelist_lookup_zone_by_name(engine->zonelist, "example.com", LDNS_RR_CLASS_IN);
+    signzone(zone);
+
+    /* with no memory budget at all every idle zone is evicted */
+    zonelist_evictzones(engine->zonelist, engine->taskq, 0);
+    CU_ASSERT_EQUAL(zone->viewsevicted, 1);
+    CU_ASSERT_PTR_NULL(zone->baseview);
+    logger_mark_performance("evicted zone");
+
+    /* obtaining a view reloads the zone transparently */
+    outputzone(zone);
+    CU_ASSERT_EQUAL(zone->viewsevicted, 0);
+    CU_ASSERT_PTR_NOT_NULL(zone->baseview);
+    logger_mark_performance("reloaded zone");
+    disposezone(zone);
+    CU_ASSERT_EQUAL((system("ldns-verify-zone -t 20180926013741 signed.zone")), 0);
+}
+
+void
+testMemoryAccounting(void)
+{
+    int i, evicted;
+    zone_type* zone;
+    names_view_type view;
+    names_iterator iter;
+    recordset_type record;
+    uint32_t count;
+    size_t recordsets, signatures, sigsize;
+    struct stats_memory* memory;
+    set_time_now(1537918509);
+    logger_mark_performance("setup files");
+    usefile("example.com.state", NULL);
+    usefile("signer.db", NULL);
+    usefile("zones.xml", "zones.xml.example");
+    usefile("unsigned.zone", "unsigned.zone.testing");
+    usefile("signconf.xml", "signconf.xml.nsec");
+    zonelist_update(engine->zonelist, engine->config->zonelist_filename_signer);
+    zone = zonelist_lookup_zone_by_name(engine->zonelist, "example.com", LDNS_RR_CLASS_IN);
+    signzone(zone);
+
+    /* the base view holds all recordsets and their signatures */
+    count = 0;
+    recordsets = signatures = 0;
+    for(iter=names_viewiterator(zone->baseview, NULL); names_iterate(&iter,&record); names_advance(&iter,NULL)) {
+        sigsize = 0;
+        recordsets += names_recordextend(record, &sigsize) - sigsize;
+        signatures += sigsize;
+        ++count;
+    }
+    CU_ASSERT_EQUAL(zonelist_zonememory(zone, NULL), 1);
+    memory = zone->stats->mem_views;
+    CU_ASSERT_STRING_EQUAL(memory[0].view, "base");
+    CU_ASSERT_EQUAL(memory[0].records, count);
+    CU_ASSERT_EQUAL(memory[0].recordsets, recordsets);
+    CU_ASSERT_EQUAL(memory[0].signatures, signatures);
+    CU_ASSERT(memory[0].signatures > 0);
+    CU_ASSERT(memory[0].indices > 0);
+    for(i=1; i<STATS_NVIEWS; i++) {
+        CU_ASSERT_PTR_NOT_NULL(memory[i].view);
+        CU_ASSERT_EQUAL(memory[i].recordsets, 0);
+        CU_ASSERT_EQUAL(memory[i].signatures, 0);
+    }
+    CU_ASSERT_EQUAL(stats_memory(zone->stats), zone->viewsfootprint);
+
+    /* views in use are not measured */
+    view = zonelist_obtainresource(NULL, zone, NULL, offsetof(zone_type, outputview));
+    CU_ASSERT_EQUAL(zonelist_zonememory(zone, NULL), 0);
+    zonelist_releaseresource(NULL, zone, NULL, offsetof(zone_type, outputview), view);
+    CU_ASSERT_EQUAL(zonelist_zonememory(zone, NULL), 1);
+    CU_ASSERT_EQUAL(zone->stats->mem_views[0].records, count);
+
+    /* an evicted zone takes no memory */
+    zonelist_evictzones(engine->zonelist, engine->taskq, 0);
+    CU_ASSERT_EQUAL(zonelist_zonememory(zone, &evicted), 1);
+    CU_ASSERT_EQUAL(evicted, 1);
+    CU_ASSERT_EQUAL(stats_memory(zone->stats), 0);
+    zonelist_pinviews(zone);
+    zonelist_unpinviews(zone);
+    disposezone(zone);
+}
+
+void
+testLazyIndex(void)
+{
+    int count;
+    zone_type* zone;
+    names_view_type view;
+    names_view_type signview;
+    struct stats_memory before, after;
+    set_time_now(1537918509);
+    logger_mark_performance("setup files");
+    usefile("example.com.state", NULL);
+    usefile("signer.db", NULL);
+    usefile("zones.xml", "zones.xml.example");
+    usefile("unsigned.zone", "unsigned.zone.testing");
+    usefile("signconf.xml", "signconf.xml.nsec");
+    zonelist_update(engine->zonelist, engine->config->zonelist_filename_signer);
+    zone = zonelist_lookup_zone_by_name(engine->zonelist, "example.com", LDNS_RR_CLASS_IN);
+    signzone(zone);
+
+    signview = zonelist_obtainresource(NULL, zone, NULL, offsetof(zone_type, signview));
+    count = countexpiring(signview, 2000000000);
+    CU_ASSERT(count > 0);
+
+    /* a new view only has its primary index until a search needs another */
+    view = names_viewcreate(zone->baseview, names_view_SIGN[0], &names_view_SIGN[1]);
+    memset(&before, 0, sizeof(before));
+    names_viewmemory(view, &before);
+    CU_ASSERT_EQUAL(countexpiring(view, 2000000000), count);
+    memset(&after, 0, sizeof(after));
+    names_viewmemory(view, &after);
+    CU_ASSERT_EQUAL(before.records, after.records);
+    CU_ASSERT(after.indices > before.indices);
+    names_viewdestroy(view);
+    zonelist_releaseresource(NULL, zone, NULL, offsetof(zone_type, signview), signview);
+    disposezone(zone);
+}
+
+void
+testPropagateViews(void)
+{
+    zone_type* zone;
+    names_view_type view;
+    set_time_now(1537918509);
+    logger_mark_performance("setup files");
+    usefile("example.com.state", NULL);
+    usefile("signer.db", NULL);
+    usefile("zones.xml", "zones.xml.example");
+    usefile("unsigned.zone", "unsigned.zone.testing");
+    usefile("signconf.xml", "signconf.xml.nsec");
+    zonelist_update(engine->zonelist, engine->config->zonelist_filename_signer);
+    zone = zonelist_lookup_zone_by_name(engine->zonelist, "example.com", LDNS_RR_CLASS_IN);
+    signzone(zone);
+
+    view = zonelist_obtainresource(NULL, zone, NULL, offsetof(zone_type, inputview));
+    names_viewreset(view);
+    CU_ASSERT_EQUAL(httpd_dispatch(view, makecall(zone->name, "propagated.example.com.", "propagated.example.com. A 192.0.2.1", NULL)), 0);
+    CU_ASSERT_EQUAL(names_viewcommit(view), 0);
+    zonelist_releaseresource(NULL, zone, NULL, offsetof(zone_type, inputview), view);
+
+    /* an idle view only sees the commit once it is brought up to date */
+    view = zonelist_obtainresource(NULL, zone, NULL, offsetof(zone_type, prepareview));
+    CU_ASSERT_PTR_NULL(names_take(view, 0, "propagated.example.com."));
+    zonelist_releaseresource(NULL, zone, NULL, offsetof(zone_type, prepareview), view);
+    zonelist_propagateviews(zone);
+    view = zonelist_obtainresource(NULL, zone, NULL, offsetof(zone_type, prepareview));
+    CU_ASSERT_PTR_NOT_NULL(names_take(view, 0, "propagated.example.com."));
+    zonelist_releaseresource(NULL, zone, NULL, offsetof(zone_type, prepareview), view);
+    disposezone(zone);
+}
+
+void
+testInstancePartition(void)
+{
+    zonelist_type* zonelists[2];
+    zone_type* zones[2];
+    char name[32];
+    FILE* fp;
+    int i, count;
+    fp = fopen("zones.xml", "w");
+    fprintf(fp, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<ZoneList>\n");
+    for (i = 0; i < 64; i++) {
+        fprintf(fp, "  <Zone name=\"zone%d.example\">\n"
+                    "    <Policy>default</Policy>\n"
+                    "    <SignerConfiguration>signconf.xml</SignerConfiguration>\n"
+                    "    <Adapters>\n"
+                    "      <Input><Adapter type=\"File\">unsigned.zone</Adapter></Input>\n"
+                    "      <Output><Adapter type=\"File\">signed.zone</Adapter></Output>\n"
+                    "    </Adapters>\n"
+                    "  </Zone>\n", i);
+    }
+    fprintf(fp, "</ZoneList>\n");
+    fclose(fp);
+
+    /* two instances reading the same zonelist split it between them */
+    for (i = 0; i < 2; i++) {
+        zonelists[i] = zonelist_create();
+        zonelists[i]->instance = i;
+        zonelists[i]->instances = 2;
+        CU_ASSERT_EQUAL(zonelist_update(zonelists[i], engine->config->zonelist_filename_signer), ODS_STATUS_OK);
+    }
+    CU_ASSERT_EQUAL(zonelists[0]->zones->count + zonelists[1]->zones->count, 64);
+    CU_ASSERT(zonelists[0]->zones->count > 0);
+    CU_ASSERT(zonelists[1]->zones->count > 0);
+    count = 0;
+    for (i = 0; i < 64; i++) {
+        snprintf(name, sizeof(name), "zone%d.example", i);
+        zones[0] = zonelist_lookup_zone_by_name(zonelists[0], name, LDNS_RR_CLASS_IN);
+        zones[1] = zonelist_lookup_zone_by_name(zonelists[1], name, LDNS_RR_CLASS_IN);
+        CU_ASSERT((zones[0] == NULL) != (zones[1] == NULL));
+        CU_ASSERT_PTR_NOT_NULL(zones[util_instance_of(name, 2)]);
+        count += (zones[0] != NULL);
+    }
+    CU_ASSERT_EQUAL(count, (int)zonelists[0]->zones->count);
+
+    /* queries name zones with a trailing dot and in any case */
+    CU_ASSERT_EQUAL(util_instance_of("Zone7.EXAMPLE.", 2), util_instance_of("zone7.example", 2));
+    CU_ASSERT_EQUAL(util_instance_of("zone7.example", 1), 0);
+    zonelist_cleanup(zonelists[0]);
+    zonelist_cleanup(zonelists[1]);
+}
+
+void
+testMassOperation(void)
+{
+    massop_type* massop;
+    massop_kind kind;
+    char** names;
+    time_t urgency[4] = { 300, 100, 0, 200 };
+    char* name;
+    char* desc;
+    massop = massop_create();
+    names = malloc(4 * sizeof(char*));
+    names[0] = strdup("late.example");
+    names[1] = strdup("soon.example");
+    names[2] = strdup("unsigned.example");
+    names[3] = strdup("later.example");
+    CU_ASSERT_PTR_NULL(massop_describe(massop, 0));
+    CU_ASSERT_EQUAL(massop_start(massop, MASSOP_SIGN, names, urgency, 4, 2), 0);
+    CU_ASSERT(massop_active(massop));
+
+    /* most urgent first, never more than two in flight */
+    name = massop_next(massop, 10, &kind);
+    CU_ASSERT_STRING_EQUAL(name, "unsigned.example");
+    CU_ASSERT_EQUAL(kind, MASSOP_SIGN);
+    free(name);
+    name = massop_next(massop, 10, &kind);
+    CU_ASSERT_STRING_EQUAL(name, "soon.example");
+    free(name);
+    CU_ASSERT(!massop_ready(massop));
+    CU_ASSERT_PTR_NULL(massop_next(massop, 10, &kind));
+
+    /* a second operation must wait for the first */
+    CU_ASSERT_EQUAL(massop_start(massop, MASSOP_FLUSH, NULL, NULL, 0, 2), 1);
+
+    /* finishing or stalling zones frees their slot */
+    CU_ASSERT_EQUAL(massop_finished(massop, "other.example", 0), 0);
+    CU_ASSERT_EQUAL(massop_finished(massop, "soon.example", 0), 1);
+    CU_ASSERT(massop_ready(massop));
+    name = massop_next(massop, 20, &kind);
+    CU_ASSERT_STRING_EQUAL(name, "later.example");
+    free(name);
+    CU_ASSERT_EQUAL(massop_expire(massop, 25, 10), 1);
+    desc = massop_describe(massop, 20);
+    CU_ASSERT_PTR_NOT_NULL(strstr(desc, "2 done (1 failed), 1 in progress, 1 pending"));
+    free(desc);
+
+    /* cancelling skips the pending zones, in flight ones finish */
+    CU_ASSERT_EQUAL(massop_cancel(massop), 1);
+    CU_ASSERT_PTR_NULL(massop_next(massop, 20, &kind));
+    CU_ASSERT(massop_active(massop));
+    CU_ASSERT_EQUAL(massop_finished(massop, "later.example", 0), 1);
+    CU_ASSERT(!massop_active(massop));
+    CU_ASSERT_EQUAL(massop_cancel(massop), -1);
+    desc = massop_describe(massop, 30);
+    CU_ASSERT_PTR_NOT_NULL(strstr(desc, "cancelled"));
+    free(desc);
+    massop_cleanup(massop);
+}
+
+void
+testZonelistJournal(void)
+{
+    zonelist_type* zonelist;
+    zone_type* zone;
+    FILE* fp;
+    char jfile[PATH_MAX];
+    int i;
+    fp = fopen("zones.xml", "w");
+    fprintf(fp, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<ZoneList>\n");
+    for (i = 0; i < 3; i++) {
+        fprintf(fp, "  <Zone name=\"zone%d.example\">\n"
+                    "    <Policy>default</Policy>\n"
+                    "    <SignerConfiguration>signconf.xml</SignerConfiguration>\n"
+                    "    <Adapters>\n"
+                    "      <Input><Adapter type=\"File\">unsigned.zone</Adapter></Input>\n"
+                    "      <Output><Adapter type=\"File\">signed.zone</Adapter></Output>\n"
+                    "    </Adapters>\n"
+                    "  </Zone>\n", i);
+    }
+    fprintf(fp, "</ZoneList>\n");
+    fclose(fp);
+
+    /* the journal adds, replaces and deletes zones of the file */
+    snprintf(jfile, sizeof(jfile), "%s.journal", engine->config->zonelist_filename_signer);
+    fp = fopen(jfile, "w");
+    fprintf(fp, "add\tzone3.example\tdefault\tsignconf.xml\tFile\tunsigned.zone\tFile\tsigned.zone\n");
+    fprintf(fp, "delete\tzone1.example\n");
+    fprintf(fp, "add\tzone2.example\tother\tsignconf.xml\tFile\tunsigned.zone\tDNS\taddns.xml\n");
+    fprintf(fp, "bogus\tzone0.example\n");
+    fprintf(fp, "delete\tzone0.example"); /* not completely written yet */
+    fclose(fp);
+
+    zonelist = zonelist_create();
+    CU_ASSERT_EQUAL(zonelist_update(zonelist, engine->config->zonelist_filename_signer), ODS_STATUS_OK);
+    CU_ASSERT_EQUAL(zonelist->zones->count, 3);
+    CU_ASSERT_PTR_NOT_NULL(zonelist_lookup_zone_by_name(zonelist, "zone0.example", LDNS_RR_CLASS_IN));
+    CU_ASSERT_PTR_NULL(zonelist_lookup_zone_by_name(zonelist, "zone1.example", LDNS_RR_CLASS_IN));
+    CU_ASSERT_PTR_NOT_NULL(zonelist_lookup_zone_by_name(zonelist, "zone3.example", LDNS_RR_CLASS_IN));
+    zone = zonelist_lookup_zone_by_name(zonelist, "zone2.example", LDNS_RR_CLASS_IN);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(zone);
+    CU_ASSERT_STRING_EQUAL(zone->policy_name, "other");
+    CU_ASSERT_EQUAL(zone->adoutbound->type, ADAPTER_DNS);
+    zonelist_cleanup(zonelist);
+    unlink(jfile);
+}
+
+void
+testNotifyExecutor(void)
+{
+    notifyexec_type* notifyexec;
+    notifyexec_job_type* job;
+    notifyexec_job_type* other;
+    char* reload[] = { "rndc", "reload", "a.example", NULL };
+    char* reload2[] = { "rndc", "reload", "b.example", NULL };
+    char* batch[] = { "reload-zones", "-q", "%zones", NULL };
+    notifyexec = notifyexec_create(1);
+
+    /* a burst for one zone runs the command once */
+    notifyexec_enqueue(notifyexec, "a.example", reload);
+    notifyexec_enqueue(notifyexec, "a.example", reload);
+    notifyexec_enqueue(notifyexec, "b.example", reload2);
+    CU_ASSERT_EQUAL(notifyexec->nqueued, 2);
+    job = notifyexec_take(notifyexec, 10);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(job);
+    CU_ASSERT_EQUAL(job->nzones, 1);
+    CU_ASSERT_STRING_EQUAL(job->zones[0], "a.example");
+    CU_ASSERT_STRING_EQUAL(job->argv[2], "a.example");
+    CU_ASSERT_PTR_NULL(job->argv[3]);
+    /* never more running than the concurrency */
+    CU_ASSERT_PTR_NULL(notifyexec_take(notifyexec, 10));
+    notifyexec_finish(notifyexec, job);
+
+    /* a zone queued while its command runs waits for it */
+    job = notifyexec_take(notifyexec, 20);
+    CU_ASSERT_STRING_EQUAL(job->zones[0], "b.example");
+    notifyexec_enqueue(notifyexec, "b.example", reload2);
+    CU_ASSERT_PTR_NULL(notifyexec_take(notifyexec, 20));
+    notifyexec_finish(notifyexec, job);
+    job = notifyexec_take(notifyexec, 30);
+    CU_ASSERT_STRING_EQUAL(job->zones[0], "b.example");
+    notifyexec_finish(notifyexec, job);
+    CU_ASSERT_EQUAL(notifyexec->nqueued, 0);
+    CU_ASSERT_PTR_NULL(notifyexec_take(notifyexec, 30));
+    notifyexec_cleanup(notifyexec);
+
+    /* batched commands take all queued zones at once */
+    notifyexec = notifyexec_create(2);
+    notifyexec_enqueue(notifyexec, "a.example", batch);
+    notifyexec_enqueue(notifyexec, "b.example", batch);
+    notifyexec_enqueue(notifyexec, "c.example", reload);
+    notifyexec_enqueue(notifyexec, "d.example", batch);
+    job = notifyexec_take(notifyexec, 40);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(job);
+    CU_ASSERT_EQUAL(job->nzones, 3);
+    CU_ASSERT_STRING_EQUAL(job->argv[0], "reload-zones");
+    CU_ASSERT_STRING_EQUAL(job->argv[1], "-q");
+    CU_ASSERT_STRING_EQUAL(job->argv[2], "a.example");
+    CU_ASSERT_STRING_EQUAL(job->argv[3], "b.example");
+    CU_ASSERT_STRING_EQUAL(job->argv[4], "d.example");
+    CU_ASSERT_PTR_NULL(job->argv[5]);
+    other = notifyexec_take(notifyexec, 40);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(other);
+    CU_ASSERT_STRING_EQUAL(other->zones[0], "c.example");
+    notifyexec_finish(notifyexec, other);
+    notifyexec_finish(notifyexec, job);
+    CU_ASSERT_EQUAL(notifyexec->nrunning, 0);
+    notifyexec_cleanup(notifyexec);
+}
+
+static void
+dumppacket(xfrdump_type* xfrdump, xfrd_type* xfrd, buffer_type* buffer,
+    const char* rrstr, int begin, int truncate)
+{
+    ldns_pkt* pkt;
+    ldns_rr* rr = NULL;
+    uint8_t* wire = NULL;
+    size_t len;
+    CHECKALLOC(pkt = ldns_pkt_new());
+    CU_ASSERT_EQUAL(ldns_rr_new_frm_str(&rr, rrstr, 0, NULL, NULL), LDNS_STATUS_OK);
+    ldns_pkt_push_rr(pkt, LDNS_SECTION_ANSWER, rr);
+    CU_ASSERT_EQUAL(ldns_pkt2wire(&wire, pkt, &len), LDNS_STATUS_OK);
+    buffer_clear(buffer);
+    buffer_write(buffer, wire, len);
+    buffer_flip(buffer);
+    xfrdump_enqueue(xfrdump, xfrd, buffer, begin, truncate);
+    free(wire);
+    ldns_pkt_free(pkt);
+}
+
+/* One character per line of the dump: '|' for a packet start, otherwise
+ * the first letter of the owner name. */
+static void
+dumpsummary(const char* filename, char* summary, size_t size)
+{
+    FILE* fp;
+    char line[1024];
+    size_t n = 0;
+    summary[0] = '\0';
+    CU_ASSERT_PTR_NOT_NULL_FATAL((fp = fopen(filename, "r")));
+    while (n + 1 < size && fgets(line, sizeof(line), fp)) {
+        if (!strncmp(line, ";;BEGINPACKET", 13)) {
+            summary[n++] = '|';
+        } else if (line[0] != '\n' && line[0] != ';') {
+            summary[n++] = line[0];
+        }
+    }
+    summary[n] = '\0';
+    fclose(fp);
+}
+
+void
+testTransferDump(void)
+{
+    xfrdump_type* xfrdump;
+    buffer_type* buffer;
+    zone_type zone;
+    xfrd_type xfrd;
+    char summary[64];
+    int i;
+    usefile("example.com.xfrd", NULL);
+    memset(&zone, 0, sizeof(zone));
+    memset(&xfrd, 0, sizeof(xfrd));
+    zone.name = "example.com";
+    xfrd.zone = &zone;
+    pthread_mutex_init(&xfrd.rw_lock, NULL);
+    buffer = buffer_create(PACKET_BUFFER_SIZE);
+    xfrdump = xfrdump_create();
+
+    /* without the writer thread packets are written in place */
+    dumppacket(xfrdump, &xfrd, buffer, "a.example.com. 600 IN A 192.0.2.1", 1, 1);
+    CU_ASSERT_EQUAL(xfrd.dump_pending, 0);
+    dumpsummary("example.com.xfrd", summary, sizeof(summary));
+    CU_ASSERT_STRING_EQUAL(summary, "|a");
+
+    xfrdump->started = 1;
+    janitor_thread_create(&xfrdump->thread_id, workerthreadclass, (janitor_runfn_t)xfrdump_start, xfrdump);
+
+    /* queued packets are appended in order, the flush waits for them */
+    dumppacket(xfrdump, &xfrd, buffer, "b.example.com. 600 IN A 192.0.2.2", 0, 0);
+    dumppacket(xfrdump, &xfrd, buffer, "c.example.com. 600 IN A 192.0.2.3", 1, 0);
+    for (i = 0; i < 2 * XFRDUMP_MAX_QUEUED; i++) {
+        dumppacket(xfrdump, &xfrd, buffer, "d.example.com. 600 IN A 192.0.2.4", 0, 0);
+    }
+    xfrdump_flush(xfrdump, &xfrd);
+    CU_ASSERT_EQUAL(xfrd.dump_pending, 0);
+    dumpsummary("example.com.xfrd", summary, sizeof(summary));
+    CU_ASSERT_NSTRING_EQUAL(summary, "|ab|cddd", 8);
+
+    /* a new transfer starts the file anew */
+    dumppacket(xfrdump, &xfrd, buffer, "e.example.com. 600 IN A 192.0.2.5", 1, 1);
+    dumppacket(xfrdump, &xfrd, buffer, "f.example.com. 600 IN A 192.0.2.6", 0, 0);
+    xfrdump_flush(xfrdump, &xfrd);
+    CU_ASSERT_EQUAL(xfrd.dump_pending, 0);
+    dumpsummary("example.com.xfrd", summary, sizeof(summary));
+    CU_ASSERT_STRING_EQUAL(summary, "|ef");
+
+    xfrdump_stop(xfrdump);
+    janitor_thread_join(xfrdump->thread_id);
+    xfrdump_cleanup(xfrdump);
+    buffer_cleanup(buffer);
+    pthread_mutex_destroy(&xfrd.rw_lock);
+    usefile("example.com.xfrd", NULL);
+}
+
+#define LATENCY_TASKS 400
+#define LATENCY_WORKERS 8
+
+#define LATENCY_ROUNDS 3
+#define LATENCY_BOUND 10000000 /* nanoseconds */
+
+static pthread_mutex_t latency_lock = PTHREAD_MUTEX_INITIALIZER;
+static int64_t latency_late[LATENCY_TASKS];
+static int latency_done;
+static int latency_early;
+
+static time_t
+latency_perform(task_type* task, char const *owner, void *userdata, void *context)
+{
+    int64_t late = time_now_ns() - *(int64_t*) userdata;
+    (void) task;
+    (void) owner;
+    (void) context;
+    pthread_mutex_lock(&latency_lock);
+    if (late < 0) {
+        latency_early++;
+    }
+    latency_late[latency_done++] = late;
+    pthread_mutex_unlock(&latency_lock);
+    /* keep the worker busy, other tasks fall due meanwhile */
+    usleep(2000);
+    return schedule_SUCCESS;
+}
+
+static int
+latency_compare(const void* a, const void* b)
+{
+    int64_t x = *(const int64_t*) a;
+    int64_t y = *(const int64_t*) b;
+    return (x > y) - (x < y);
+}
+
+/* Run all tasks once, returns the 95th percentile of how late they ran
+ * or -1 if they did not all run */
+static int64_t
+latency_round(schedule_type* schedule, int64_t* due)
+{
+    char owner[32];
+    int i, ms;
+    latency_done = 0;
+    /* tasks due within half a second, scheduled out of order */
+    for (i = 0; i < LATENCY_TASKS; i++) {
+        ms = 20 + (i * 7919) % 500;
+        snprintf(owner, sizeof(owner), "zone%d.example", i);
+        due[i] = time_now_ns() + (int64_t) ms * 1000000;
+        schedule_scheduletask_in(schedule, TASK_SIGN, owner, &due[i], NULL, ms);
+    }
+    for (i = 0; i < 5000 && latency_done < LATENCY_TASKS; i++) {
+        usleep(1000);
+    }
+    if (latency_done < LATENCY_TASKS)
+        return -1;
+    qsort(latency_late, LATENCY_TASKS, sizeof(int64_t), latency_compare);
+    return latency_late[LATENCY_TASKS * 95 / 100];
+}
+
+void
+testAddnsParse(void)
+{
+    const char* content =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<Adapter><DNS>\n"
+        "  <Inbound>\n"
+        "    <RequestTransfer><Remote><Address>192.0.2.1</Address><Port>5353</Port></Remote></RequestTransfer>\n"
+        "    <AllowNotify><Peer><Prefix>192.0.2.0/24</Prefix></Peer></AllowNotify>\n"
+        "  </Inbound>\n"
+        "  <Outbound>\n"
+        "    <ProvideTransfer><Peer><Prefix>2001:db8::/32</Prefix></Peer></ProvideTransfer>\n"
+        "    <Notify><Remote><Address>192.0.2.2</Address></Remote></Notify>\n"
+        "  </Outbound>\n"
+        "</DNS></Adapter>\n";
+    addns_config_type config;
+
+    /* all sections come from one document in memory */
+    memset(&config, 0, sizeof(config));
+    CU_ASSERT_EQUAL(parse_addns("addns.xml", content, strlen(content), &config), ODS_STATUS_OK);
+    CU_ASSERT_PTR_NULL(config.tsig);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(config.request_xfr);
+    CU_ASSERT_STRING_EQUAL(config.request_xfr->address, "192.0.2.1");
+    CU_ASSERT_EQUAL(config.request_xfr->port, 5353);
+    CU_ASSERT_PTR_NULL(config.request_xfr->next);
+    CU_ASSERT_PTR_NOT_NULL(config.allow_notify);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(config.provide_xfr);
+    CU_ASSERT_EQUAL(config.provide_xfr->family, AF_INET6);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(config.do_notify);
+    CU_ASSERT_STRING_EQUAL(config.do_notify->address, "192.0.2.2");
+    acl_cleanup(config.request_xfr);
+    acl_cleanup(config.allow_notify);
+    acl_cleanup(config.provide_xfr);
+    acl_cleanup(config.do_notify);
+
+    CU_ASSERT_EQUAL(parse_addns("addns.xml", "<Adapter>", 9, &config), ODS_STATUS_XML_ERR);
+}
+
+static void
+writeaddns(const char* filename, const char* address)
+{
+    FILE* fp;
+    fp = fopen(filename, "w");
+    fprintf(fp, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<Adapter><DNS>\n"
+        "  <Inbound>\n"
+        "    <RequestTransfer><Remote><Address>%s</Address></Remote></RequestTransfer>\n"
+        "  </Inbound>\n"
+        "  <Outbound>\n"
+        "    <ProvideTransfer><Peer><Prefix>192.0.2.0/24</Prefix></Peer></ProvideTransfer>\n"
+        "  </Outbound>\n"
+        "</DNS></Adapter>\n", address);
+    fclose(fp);
+}
+
+void
+testAddnsShared(void)
+{
+    dnsin_type* first;
+    dnsin_type* second;
+    acl_type* shared;
+    time_t last_mod = 0;
+
+    /* two adapters reading the same file share one configuration */
+    writeaddns("shared.addns.xml", "192.0.2.1");
+    first = dnsin_create();
+    second = dnsin_create();
+    CU_ASSERT_EQUAL(dnsin_update(&first, "shared.addns.xml", &last_mod), ODS_STATUS_OK);
+    CU_ASSERT_EQUAL(dnsin_update(&second, "shared.addns.xml", &last_mod), ODS_STATUS_OK);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(first->request_xfr);
+    CU_ASSERT(first->request_xfr == second->request_xfr);
+    CU_ASSERT(first->tsig == second->tsig);
+    CU_ASSERT_STRING_EQUAL(first->request_xfr->address, "192.0.2.1");
+    shared = first->request_xfr;
+
+    /* a changed file gives a new configuration, the old one stays valid */
+    writeaddns("shared.addns.xml", "192.0.2.2");
+    CU_ASSERT_EQUAL(dnsin_update(&second, "shared.addns.xml", &last_mod), ODS_STATUS_OK);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(second->request_xfr);
+    CU_ASSERT(second->request_xfr != shared);
+    CU_ASSERT_STRING_EQUAL(second->request_xfr->address, "192.0.2.2");
+    CU_ASSERT(first->request_xfr == shared);
+    CU_ASSERT_STRING_EQUAL(first->request_xfr->address, "192.0.2.1");
+
+    /* and reading it again shares that new one */
+    CU_ASSERT_EQUAL(dnsin_update(&first, "shared.addns.xml", &last_mod), ODS_STATUS_OK);
+    CU_ASSERT(first->request_xfr == second->request_xfr);
+    dnsin_cleanup(first);
+    dnsin_cleanup(second);
+    unlink("shared.addns.xml");
+}
+
+void
+testScheduleLatency(void)
+{
+    schedule_type* schedule;
+    worker_type* workers[LATENCY_WORKERS];
+    int64_t* due;
+    int64_t late;
+    int i, idle;
+    schedule = schedule_create();
+    schedule_registertask(schedule, TASK_CLASS_SIGNER, TASK_SIGN, latency_perform);
+    for (i = 0; i < LATENCY_WORKERS; i++) {
+        workers[i] = worker_create(strdup("latency"), schedule);
+        janitor_thread_create(&workers[i]->thread_id, workerthreadclass, (janitor_runfn_t)worker_start, workers[i]);
+    }
+    latency_early = 0;
+    due = malloc(LATENCY_TASKS * sizeof(int64_t));
+    /* idle workers wake up for a task when it falls due, rather than at
+     * their 60 second poll; a few stragglers or a round disturbed by a
+     * loaded machine do not count against that */
+    for (i = 0; i < LATENCY_ROUNDS; i++) {
+        late = latency_round(schedule, due);
+        if (late < LATENCY_BOUND)
+            break;
+    }
+    CU_ASSERT(late >= 0);
+    CU_ASSERT(late < LATENCY_BOUND);
+    /* no task ever runs before it is due */
+    CU_ASSERT_EQUAL(latency_early, 0);
+
+    /* only stop the workers once all of them are waiting */
+    do {
+        usleep(1000);
+        pthread_mutex_lock(&schedule->schedule_lock);
+        idle = schedule->num_waiting;
+        pthread_mutex_unlock(&schedule->schedule_lock);
+    } while (idle < LATENCY_WORKERS);
+    for (i = 0; i < LATENCY_WORKERS; i++) {
+        workers[i]->need_to_exit = 1;
+    }
+    schedule_release_all(schedule);
+    for (i = 0; i < LATENCY_WORKERS; i++) {
+        janitor_thread_join(workers[i]->thread_id);
+        worker_cleanup(workers[i]);
+    }
+    schedule_cleanup(schedule);
+    free(due);
+}
+
 void
 testDisposing(void)
 {
@@ -1009,6 +1954,20 @@ extern void testSignNL(void);
 extern void testSignFastRemove(void);
 extern void testSignFastInsert(void);
 extern void testSignFastChange(void);
+extern void testRpcDecode(void);
+extern void testRecordMemory(void);
+extern void testEvictZone(void);
+extern void testMemoryAccounting(void);
+extern void testLazyIndex(void);
+extern void testPropagateViews(void);
+extern void testInstancePartition(void);
+extern void testMassOperation(void);
+extern void testZonelistJournal(void);
+extern void testNotifyExecutor(void);
+extern void testAddnsParse(void);
+extern void testAddnsShared(void);
+extern void testTransferDump(void);
+extern void testScheduleLatency(void);
 extern void testDisposing(void);
 
 struct test_struct {
@@ -1033,6 +1992,20 @@ struct test_struct {
     { "signer", "testSignFastRemove",  "test fast updates deletes" },
     { "signer", "testSignFastInsert",  "test fast updates inserts" },
     { "signer", "testSignFastChange",  "test fast updates changes" },
+    { "signer", "testRpcDecode",       "test decoding of text and wire records" },
+    { "signer", "testRecordMemory",    "test compact storage of records" },
+    { "signer", "testEvictZone",       "test evicting and reloading an idle zone" },
+    { "signer", "testMemoryAccounting", "test memory accounting of zone views" },
+    { "signer", "testLazyIndex",       "test lazily built view indices" },
+    { "signer", "testPropagateViews",  "test bringing idle views up to date" },
+    { "signer", "testInstancePartition", "test partitioning zones over instances" },
+    { "signer", "testMassOperation", "test rate controlled mass operations" },
+    { "signer", "testZonelistJournal", "test zonelist journal" },
+    { "signer", "testNotifyExecutor", "test asynchronous coalesced notify commands" },
+    { "signer", "testAddnsParse",     "test parsing dns adapter configuration" },
+    { "signer", "testAddnsShared",    "test sharing dns adapter configuration" },
+    { "signer", "testTransferDump",    "test writing transfer packets in a thread" },
+    { "signer", "testScheduleLatency", "test sub-second task dispatch latency" },
     { "signer", "testDisposing",       "test dispose" },
     { "signer", "testBackup",          "test migration backup files" },
     { "signer", "-testSignNL",          "test NL signing" },
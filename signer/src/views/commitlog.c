@@ -58,6 +58,7 @@ struct names_commitlog_struct {
     } *views;
     names_table_type firstchangelog;
     names_table_type lastchangelog;
+    long ncommits;
     marshall_handle store;
     void (*storefn)(names_table_type, marshall_handle);
 };
@@ -107,6 +108,21 @@ names_commitlogdestroyall(names_commitlog_type commitlog, marshall_handle* store
     free(commitlog);
 }
 
+/* Changelogs are retained until every view has incorporated them. */
+size_t
+names_commitlogextend(names_commitlog_type commitlog, size_t valuesize)
+{
+    size_t size;
+    names_table_type changelog;
+    CHECK(pthread_mutex_lock(&commitlog->lock));
+    size = sizeof(struct names_commitlog_struct) + commitlog->nviews * sizeof(struct names_changelogchainentry);
+    for(changelog = commitlog->firstchangelog; changelog; changelog = changelog->next) {
+        size += names_tableextend(changelog, valuesize);
+    }
+    CHECK(pthread_mutex_unlock(&commitlog->lock));
+    return size;
+}
+
 int
 names_commitlogpoppush(names_commitlog_type logs, int viewid, names_table_type* commitlog, names_table_type* submitlog)
 {
@@ -167,6 +183,7 @@ names_commitlogpoppush(names_commitlog_type logs, int viewid, names_table_type*
         logs->views[viewid].nextchangelogptr = &((*logs->views[viewid].nextchangelogptr)->next);
         *commitlog = *submitlog;
         *submitlog = names_tablecreate2(*submitlog);
+        logs->ncommits += 1;
     } else {
         *commitlog = poppedlog;
     }
@@ -176,6 +193,16 @@ names_commitlogpoppush(names_commitlog_type logs, int viewid, names_table_type*
     return backlog;
 }
 
+long
+names_commitlogcommits(names_commitlog_type commitlog)
+{
+    long ncommits;
+    CHECK(pthread_mutex_lock(&commitlog->lock));
+    ncommits = commitlog->ncommits;
+    CHECK(pthread_mutex_unlock(&commitlog->lock));
+    return ncommits;
+}
+
 int
 names_commitlogsubscribe(names_view_type view, names_commitlog_type* commitlogptr)
 {
@@ -188,6 +215,7 @@ names_commitlogsubscribe(names_view_type view, names_commitlog_type* commitlogpt
         (*commitlogptr)->views = malloc(sizeof(struct names_changelogchainentry) * (*commitlogptr)->nviews);
         (*commitlogptr)->firstchangelog = NULL;
         (*commitlogptr)->lastchangelog = NULL;
+        (*commitlogptr)->ncommits = 0;
         (*commitlogptr)->store = NULL;
     } else {
         CHECK(pthread_mutex_lock(&(*commitlogptr)->lock));
@@ -54,30 +54,41 @@
 #include "utilities.h"
 #include "proto.h"
 #include "httpd.h"
+#include "daemon/signertasks.h"
 
-#define HTTPD_POOL_SIZE 1
+/* Concurrent requests for the same zone are group committed, so the
+ * pool size does not multiply the number of commits on a zone. */
+#define HTTPD_POOL_SIZE 4
 
 struct connection_info {
     size_t buflen;
     char *buf;
 };
 
+/* Changes waiting to be committed to the input view of one zone.  One of
+ * the requesting threads acts as leader and commits everything that is
+ * pending in one go, the others wait for their changes to be done. */
+struct httpd_commitqueue {
+    char* zone;
+    int leader;
+    int users; /* requests queued or waiting, the entry goes with the last */
+    pthread_cond_t cond;
+    struct httpd_change* pending;
+    UT_hash_handle hh;
+};
+
 static int
 deleterecordsets(names_view_type view, struct rpc *rpc)
 {
     int i;
-    char* owner;
     recordset_type record;
     /* Not a delegation. Remove any rrsets mentioned in the request. */
     for(i=0; i<rpc->rr_count; i++) {
         ldns_rr *rr = rpc->rr[i];
-        owner = ldns_rdf2str(ldns_rr_owner(rr));
-        record = names_take(view, 0, owner);
-        free(owner);
+        record = names_takeowner(view, 0, ldns_rr_owner(rr));
         if (!record) {
-            names_viewreset(view);
             rpc->status = RPC_ERR;
-            return 0;
+            return 1;
         }
         names_recorddelall(record, ldns_rr_get_type(rr));
     }
@@ -102,25 +113,23 @@ static int
 insertrecords(names_view_type view, struct rpc *rpc)
 {
     int i;
+    ldns_rdf* lastowner = NULL;
+    recordset_type record = NULL;
     /* now insert all rr's from rpc */
     for(i=0; i<rpc->rr_count; i++) {
-        ldns_rr *rr = ldns_rr_clone(rpc->rr[i]);
-        if (!rr) {
-            names_viewreset(view);
-            rpc->status = RPC_ERR;
-            return 0;
-        }
-        char* owner = ldns_rdf2str(ldns_rr_owner(rr));
-        /* this shouldn't be in the database anymore so we get a new object */
-        recordset_type record = names_place(view, owner);
-        free(owner);
-        if (!record) {
-            names_viewreset(view);
-            rpc->status = RPC_ERR;
-            return 0;
+        ldns_rr *rr = rpc->rr[i];
+        /* records of one name are usually grouped, only look up the
+         * name when the wire owner changes */
+        if (!lastowner || ldns_dname_compare(ldns_rr_owner(rr), lastowner)) {
+            /* this shouldn't be in the database anymore so we get a new object */
+            record = names_placeowner(view, ldns_rr_owner(rr));
+            if (!record) {
+                rpc->status = RPC_ERR;
+                return 1;
+            }
+            names_overwrite(view, &record);
+            lastowner = ldns_rr_owner(rpc->rr[i]);
         }
-
-        names_overwrite(view, &record);
         names_recordadddata(record, rr);
     }
 
@@ -128,30 +137,304 @@ insertrecords(names_view_type view, struct rpc *rpc)
     return 0;
 }
 
+static int
+applychange(names_view_type view, struct rpc *rpc)
+{
+    rpc->status = RPC_OK;
+    switch (rpc->opc) {
+        case RPC_CHANGE_DELEGATION:
+            if (deletedelegation(view, rpc) || insertrecords(view, rpc))
+                return 1;
+            return 0;
+        case RPC_CHANGE_NAME:
+            if (deleterecordsets(view, rpc) || insertrecords(view, rpc))
+                return 1;
+            return 0;
+        default:
+            rpc->status = RPC_ERR;
+            return 1;
+    }
+}
+
 int
 httpd_dispatch(names_view_type view, struct rpc *rpc)
 {
     if (!view) {
         rpc->status = RPC_RESOURCE_NOT_FOUND;
         return 1;
+    } else if (rpc->opc != RPC_CHANGE_DELEGATION && rpc->opc != RPC_CHANGE_NAME) {
+        rpc->status = RPC_ERR;
+        return 1;
     } else {
         names_viewreset(view);
-        switch (rpc->opc) {
-            case RPC_CHANGE_DELEGATION:
-                deletedelegation(view, rpc);
-                insertrecords(view, rpc);
-                names_viewcommit(view);
-                return 0;
-            case RPC_CHANGE_NAME:
-                deleterecordsets(view, rpc);
-                insertrecords(view, rpc);
-                names_viewcommit(view);
-                return 0;
-            default:
-                rpc->status = RPC_ERR;
-                return 1;
+        if (applychange(view, rpc)) {
+            names_viewreset(view);
         }
+        names_viewcommit(view);
+        return 0;
+    }
+}
+
+/* Apply the rpcs of one change set, on failure the change set is marked
+ * failed and its rpcs that did apply are aborted. */
+static int
+applychangeset(names_view_type view, struct httpd_change* change)
+{
+    int i;
+    for (i = 0; i < change->count; i++) {
+        if (applychange(view, change->rpcs[i]))
+            break;
     }
+    if (i == change->count)
+        return 0;
+    /* the failed rpc has its status set, abort the others */
+    change->failed = 1;
+    for (i = 0; i < change->count; i++) {
+        if (change->rpcs[i]->status == RPC_OK)
+            change->rpcs[i]->status = RPC_ERR;
+    }
+    return 1;
+}
+
+/* Commit the change sets from first up to last that did not fail.
+ * Returns the number of change sets that were committed. */
+static int
+commitchangesets(names_view_type view, struct httpd_change* first, struct httpd_change* last)
+{
+    int i, count = 0;
+    struct httpd_change* change;
+    for (change = first; change != last; change = change->next) {
+        if (!change->failed)
+            count++;
+    }
+    if (count == 0 || !names_viewcommit(view))
+        return count;
+    for (change = first; change != last; change = change->next) {
+        if (!change->failed) {
+            change->failed = 1;
+            for (i = 0; i < change->count; i++)
+                change->rpcs[i]->status = RPC_ERR;
+        }
+    }
+    return 0;
+}
+
+/* Apply all of the change sets in the list as one commit.  The rpcs within
+ * one change set are applied all or nothing.  The view does not support
+ * partial rollback, so when a change set fails the view is reset and the
+ * change sets before it are redone and committed on their own, after which
+ * the remaining change sets continue in a next commit.  Every change set
+ * is thereby applied at most twice.  Returns the number of change sets
+ * that were committed. */
+int
+httpd_dispatchgroup(names_view_type view, struct httpd_change* changes)
+{
+    int i, committed = 0;
+    struct httpd_change *change, *first, *redo;
+    if (!view) {
+        for (change = changes; change; change = change->next) {
+            change->failed = 1;
+            for (i = 0; i < change->count; i++)
+                change->rpcs[i]->status = RPC_RESOURCE_NOT_FOUND;
+        }
+        return 0;
+    }
+    names_viewreset(view);
+    first = changes;
+    for (change = changes; change; change = change->next) {
+        if (change->failed || !applychangeset(view, change))
+            continue;
+        names_viewreset(view);
+        for (redo = first; redo != change; redo = redo->next) {
+            if (!redo->failed)
+                (void) applychangeset(view, redo);
+        }
+        committed += commitchangesets(view, first, change);
+        first = change->next;
+    }
+    committed += commitchangesets(view, first, NULL);
+    return committed;
+}
+
+/* Commit the pending changes of a zone, called by the leader without
+ * holding the commit lock. */
+static void
+commitpending(struct httpd* httpd, const char* zonename, struct httpd_change* changes)
+{
+    int i;
+    zone_type* zone;
+    names_view_type view;
+    struct httpd_change* change;
+
+    pthread_mutex_lock(&httpd->zonelist->zl_lock);
+    zone = zonelist_lookup_zone_by_name(httpd->zonelist, zonename, LDNS_RR_CLASS_IN);
+    pthread_mutex_unlock(&httpd->zonelist->zl_lock);
+    if (!zone) {
+        for (change = changes; change; change = change->next) {
+            change->failed = 1;
+            for (i = 0; i < change->count; i++)
+                change->rpcs[i]->status = RPC_RESOURCE_NOT_FOUND;
+        }
+        return;
+    }
+    view = zonelist_obtainresource(NULL, zone, NULL, offsetof(zone_type, inputview));
+    if (httpd_dispatchgroup(view, changes)) {
+        /* Don't wait for the next resign, get the change out now */
+        schedule_signpushed(httpd->engine, zone);
+    }
+    if (view)
+        zonelist_releaseresource(NULL, zone, NULL, offsetof(zone_type, inputview), view);
+}
+
+/* Queue a change set for its zone and wait until it has been committed,
+ * possibly together with the change sets of concurrent requests. */
+static void
+groupcommit(struct httpd* httpd, struct httpd_change* change)
+{
+    const char* zonename = change->rpcs[0]->zone;
+    struct httpd_commitqueue* queue;
+    struct httpd_change** last;
+    struct httpd_change* pending;
+
+    change->next = NULL;
+    change->done = 0;
+    change->failed = 0;
+    pthread_mutex_lock(&httpd->commitlock);
+    HASH_FIND_STR(httpd->commitqueues, zonename, queue);
+    if (!queue) {
+        CHECKALLOC(queue = (struct httpd_commitqueue*) malloc(sizeof(struct httpd_commitqueue)));
+        queue->zone = strdup(zonename);
+        queue->leader = 0;
+        queue->users = 0;
+        queue->pending = NULL;
+        pthread_cond_init(&queue->cond, NULL);
+        HASH_ADD_KEYPTR(hh, httpd->commitqueues, queue->zone, strlen(queue->zone), queue);
+    }
+    queue->users++;
+    for (last = &queue->pending; *last; last = &(*last)->next)
+        ;
+    *last = change;
+    while (!change->done) {
+        if (queue->leader) {
+            pthread_cond_wait(&queue->cond, &httpd->commitlock);
+            continue;
+        }
+        queue->leader = 1;
+        pending = queue->pending;
+        queue->pending = NULL;
+        pthread_mutex_unlock(&httpd->commitlock);
+        commitpending(httpd, zonename, pending);
+        pthread_mutex_lock(&httpd->commitlock);
+        for (; pending; pending = pending->next)
+            pending->done = 1;
+        queue->leader = 0;
+        pthread_cond_broadcast(&queue->cond);
+    }
+    if (--queue->users == 0) {
+        HASH_DEL(httpd->commitqueues, queue);
+        pthread_cond_destroy(&queue->cond);
+        free(queue->zone);
+        free(queue);
+    }
+    pthread_mutex_unlock(&httpd->commitlock);
+}
+
+static int
+httpcode(enum rpc_status status)
+{
+    if (status == RPC_OK)
+        return MHD_HTTP_OK;
+    else if (status == RPC_RESOURCE_NOT_FOUND)
+        return MHD_HTTP_NOT_FOUND;
+    else
+        return MHD_HTTP_INTERNAL_SERVER_ERROR;
+}
+
+struct batchitem {
+    struct rpc *rpc;
+    int index; /* position in the request */
+};
+
+static int
+batchitem_compare(const void *a, const void *b)
+{
+    const struct batchitem *x = (const struct batchitem *) a;
+    const struct batchitem *y = (const struct batchitem *) b;
+    int c = strcmp(x->rpc->zone, y->rpc->zone);
+    if (c)
+        return c;
+    return x->index - y->index;
+}
+
+static int
+handle_batch(struct httpd* httpd, const char *url, const char *buf, size_t buflen,
+    struct MHD_Response **response, int *http_code)
+{
+    int i, ret, count, nchanges;
+    struct rpc **rpcs;
+    struct rpc **grouped;
+    struct batchitem *items;
+    struct httpd_change* changes;
+    enum rpc_status status;
+
+    count = rpc_decode_json_batch(url, buf, buflen, &rpcs);
+    if (count < 0) {
+        char *body = strdup("Can't parse\n");
+        *response = MHD_create_response_from_buffer(strlen(body),
+            (void*) body, MHD_RESPMEM_MUST_FREE);
+        *http_code = MHD_HTTP_BAD_REQUEST;
+        return 0;
+    }
+
+    /* Group the changes per zone, each zone is committed atomically.
+     * Within a zone the changes keep the order of the request. */
+    CHECKALLOC(items = (struct batchitem*) malloc(sizeof(struct batchitem) * (count ? count : 1)));
+    CHECKALLOC(grouped = (struct rpc**) malloc(sizeof(struct rpc*) * (count ? count : 1)));
+    CHECKALLOC(changes = (struct httpd_change*) malloc(sizeof(struct httpd_change) * (count ? count : 1)));
+    for (i = 0; i < count; i++) {
+        items[i].rpc = rpcs[i];
+        items[i].index = i;
+    }
+    qsort(items, count, sizeof(struct batchitem), batchitem_compare);
+    nchanges = 0;
+    for (i = 0; i < count; i++) {
+        grouped[i] = items[i].rpc;
+        if (i == 0 || strcmp(grouped[i]->zone, grouped[i-1]->zone)) {
+            changes[nchanges].rpcs = &grouped[i];
+            changes[nchanges].count = 0;
+            nchanges++;
+        }
+        changes[nchanges-1].count++;
+    }
+    for (i = 0; i < nchanges; i++) {
+        groupcommit(httpd, &changes[i]);
+    }
+
+    status = RPC_OK;
+    for (i = 0; i < count; i++) {
+        if (rpcs[i]->status == RPC_RESOURCE_NOT_FOUND && status == RPC_OK)
+            status = RPC_RESOURCE_NOT_FOUND;
+        else if (rpcs[i]->status == RPC_ERR)
+            status = RPC_ERR;
+    }
+    char *answer;
+    size_t answer_len;
+    /* results in the order of the request */
+    ret = rpc_encode_json_batch(rpcs, count, &answer, &answer_len);
+    for (i = 0; i < count; i++) {
+        rpc_destroy(rpcs[i]);
+    }
+    free(rpcs);
+    free(items);
+    free(grouped);
+    free(changes);
+    if (ret) {
+        return 1;
+    }
+    *response = MHD_create_response_from_buffer(answer_len,
+        (void*)answer, MHD_RESPMEM_MUST_FREE);
+    *http_code = httpcode(status);
+    return !(*response);
 }
 
 static int
@@ -160,8 +443,12 @@ handle_content(struct httpd* httpd, const char *url, const char *buf, size_t buf
 {
     /* DECODE (url, buf) HERE */
     int ret;
-    names_view_type view;
-    struct rpc *rpc = rpc_decode_json(url, buf, buflen);
+    struct httpd_change change;
+    struct rpc *rpc;
+    if (rpc_isbatch(url)) {
+        return handle_batch(httpd, url, buf, buflen, response, http_code);
+    }
+    rpc = rpc_decode_json(url, buf, buflen);
     if (!rpc) {
         char *body = strdup("Can't parse\n");
         *response = MHD_create_response_from_buffer(strlen(body),
@@ -171,13 +458,9 @@ handle_content(struct httpd* httpd, const char *url, const char *buf, size_t buf
     }
 
     /* PROCESS DB STUFF HERE */
-    view = zonelist_obtainresource(httpd->zonelist, NULL, rpc->zone, offsetof(zone_type, inputview));
-    ret = httpd_dispatch(view, rpc);
-    zonelist_releaseresource(httpd->zonelist, NULL, rpc->zone, offsetof(zone_type, inputview), view);
-    if (ret) {
-        /* Failed to apply to database, status is set by rpcproc_apply */
-        /* PASS */
-    }
+    change.rpcs = &rpc;
+    change.count = 1;
+    groupcommit(httpd, &change);
 
     /* ENCODE (...) HERE */
     char *answer;
@@ -192,16 +475,55 @@ handle_content(struct httpd* httpd, const char *url, const char *buf, size_t buf
 
     *response = MHD_create_response_from_buffer(answer_len,
         (void*)answer, MHD_RESPMEM_MUST_FREE);
-    if (rpc->status == RPC_OK)
-        *http_code = MHD_HTTP_OK;
-    else if (rpc->status == RPC_RESOURCE_NOT_FOUND)
-        *http_code = MHD_HTTP_NOT_FOUND;
-    else
-        *http_code = MHD_HTTP_INTERNAL_SERVER_ERROR;
+    *http_code = httpcode(rpc->status);
     rpc_destroy(rpc);
     return !(*response);
 }
 
+static void
+collectmemory(zone_type* zone, struct rpc_memory* memory)
+{
+    memory->zone = zone->name;
+    memory->measured = zonelist_zonememory(zone, &memory->evicted);
+    pthread_mutex_lock(&zone->stats->stats_lock);
+    memcpy(memory->views, zone->stats->mem_views, sizeof(memory->views));
+    pthread_mutex_unlock(&zone->stats->stats_lock);
+}
+
+static int
+handle_memory(struct httpd* httpd, const char *zonename,
+    struct MHD_Response **response, int *http_code)
+{
+    int ret, count = 0;
+    char *answer;
+    size_t answer_len;
+    zone_type* zone;
+    ldns_rbnode_t* node;
+    struct rpc_memory* memory;
+
+    pthread_mutex_lock(&httpd->zonelist->zl_lock);
+    CHECKALLOC(memory = (struct rpc_memory*) malloc(sizeof(struct rpc_memory) * (httpd->zonelist->zones->count + 1)));
+    if (zonename) {
+        zone = zonelist_lookup_zone_by_name(httpd->zonelist, zonename, LDNS_RR_CLASS_IN);
+        if (zone)
+            collectmemory(zone, &memory[count++]);
+    } else {
+        for (node = ldns_rbtree_first(httpd->zonelist->zones); node != LDNS_RBTREE_NULL; node = ldns_rbtree_next(node))
+            collectmemory((zone_type*) node->data, &memory[count++]);
+    }
+    /* zone names are only valid while holding the zonelist lock */
+    ret = rpc_encode_json_memory(memory, count, (zonename != NULL), &answer, &answer_len);
+    pthread_mutex_unlock(&httpd->zonelist->zl_lock);
+    free(memory);
+    if (ret) {
+        return 1;
+    }
+    *response = MHD_create_response_from_buffer(answer_len,
+        (void*)answer, MHD_RESPMEM_MUST_FREE);
+    *http_code = (zonename && count == 0 ? MHD_HTTP_NOT_FOUND : MHD_HTTP_OK);
+    return !(*response);
+}
+
 static int
 handle_connection(void *cls, struct MHD_Connection *connection,
     const char *url,
@@ -243,9 +565,20 @@ handle_connection(void *cls, struct MHD_Connection *connection,
                 (void*) body, MHD_RESPMEM_PERSISTENT);
         }
     } else if (!strcmp(method, "GET")) {
-        char *body  = strdup("I don't GET it\n");
-        response = MHD_create_response_from_buffer(strlen(body),
-            (void*) body, MHD_RESPMEM_MUST_FREE);
+        char *zonename;
+        if (rpc_ismemory(url, &zonename)) {
+            if (handle_memory(httpd, zonename, &response, &http_status_code)) {
+                const char *body = "some error?\n";
+                response = MHD_create_response_from_buffer(strlen(body),
+                    (void*) body, MHD_RESPMEM_PERSISTENT);
+                http_status_code = MHD_HTTP_INTERNAL_SERVER_ERROR;
+            }
+            free(zonename);
+        } else {
+            char *body  = strdup("I don't GET it\n");
+            response = MHD_create_response_from_buffer(strlen(body),
+                (void*) body, MHD_RESPMEM_MUST_FREE);
+        }
     } else {
         const char *body = "Who are you?\n";
         response = MHD_create_response_from_buffer(strlen(body),
@@ -273,11 +606,14 @@ handle_connection_done(void *cls, struct MHD_Connection *connection,
 }
 
 struct httpd *
-httpd_create(struct http_listener_struct* config, zonelist_type* zonelist)
+httpd_create(struct http_listener_struct* config, engine_type* engine)
 {
     struct httpd *httpd;
     CHECKALLOC(httpd = (struct httpd *) malloc(sizeof(struct httpd)));
-    httpd->zonelist = zonelist;
+    httpd->zonelist = engine->zonelist;
+    httpd->engine = engine;
+    httpd->commitqueues = NULL;
+    pthread_mutex_init(&httpd->commitlock, NULL);
     httpd->if_count = config->count;
     httpd->ifs = NULL;
     CHECKALLOC(httpd->ifs = (struct sockaddr_storage *) malloc(httpd->if_count * sizeof(struct sockaddr_storage)));
@@ -308,6 +644,14 @@ httpd_create(struct http_listener_struct* config, zonelist_type* zonelist)
 void
 httpd_destroy(struct httpd *httpd)
 {
+    struct httpd_commitqueue *queue, *tmp;
+    HASH_ITER(hh, httpd->commitqueues, queue, tmp) {
+        HASH_DEL(httpd->commitqueues, queue);
+        pthread_cond_destroy(&queue->cond);
+        free(queue->zone);
+        free(queue);
+    }
+    pthread_mutex_destroy(&httpd->commitlock);
     free(httpd->ifs);
     free(httpd);
 }
@@ -32,6 +32,7 @@
 #include <microhttpd.h>
 #include "proto.h"
 #include "wire/acl.h"
+#include "signer/stats.h"
 
 typedef struct http_interface_struct http_interface_type;
 struct http_interface_struct {
@@ -73,22 +74,49 @@ struct rpc {
 
 struct rpc *rpc_decode_json(const char *url, const char *buf, size_t buflen);
 int rpc_encode_json(struct rpc *rpc, char **buf, size_t *buflen);
+int rpc_isbatch(const char *url);
+int rpc_decode_json_batch(const char *url, const char *buf, size_t buflen, struct rpc ***rpcs);
+int rpc_encode_json_batch(struct rpc **rpcs, int count, char **buf, size_t *buflen);
 void rpc_destroy(struct rpc *rpc);
 
+/* Memory used by the views of a zone, as reported on GET /api/v1/memory */
+struct rpc_memory {
+    const char *zone;
+    int evicted;
+    int measured; /* false if views were in use and an earlier measurement is reported */
+    struct stats_memory views[STATS_NVIEWS];
+};
+
+int rpc_ismemory(const char *url, char **zone);
+int rpc_encode_json_memory(struct rpc_memory *zones, int count, int perview, char **buf, size_t *buflen);
+
+/* A set of rpcs on one zone to be committed all or nothing. */
+struct httpd_change {
+    struct rpc **rpcs;
+    int count;
+    int done;
+    int failed;
+    struct httpd_change *next;
+};
+
 struct httpd {
     struct MHD_Daemon *daemon;
     int if_count;
     struct sockaddr_storage *ifs;
     zonelist_type* zonelist;
+    engine_type* engine;
+    pthread_mutex_t commitlock;
+    struct httpd_commitqueue *commitqueues;
 };
 
 int rpcproc_apply(struct httpd*, struct rpc *rpc);
 
-struct httpd* httpd_create(struct http_listener_struct* config, zonelist_type* zonelist);
+struct httpd* httpd_create(struct http_listener_struct* config, engine_type* engine);
 void httpd_destroy(struct httpd *httpd);
 void httpd_start(struct httpd *httpd);
 void httpd_stop(struct httpd *httpd);
 int httpd_dispatch(names_view_type view, struct rpc *rpc);
+int httpd_dispatchgroup(names_view_type view, struct httpd_change* changes);
 
 http_interface_type* http_listener_push(http_listener_type* listener, char* address, int family, const char* port, char* user, char* pass);
 
@@ -105,6 +105,21 @@ marshallclose(marshall_handle h)
     free(h);
 }
 
+enum marshall_direction
+marshalldirection(marshall_handle h)
+{
+    switch(h->mode) {
+        case READ:
+            return marshall_READING;
+        case WRITE:
+        case PRINT:
+        case COUNT:
+            return marshall_WRITING;
+        default:
+            return marshall_INMEMORY;
+    }
+}
+
 int
 marshallself(marshall_handle h, void* member)
 {
@@ -330,9 +345,9 @@ marshallldnsrr(marshall_handle h, void* member)
 int
 marshallsigs(marshall_handle h, void* member)
 {
-    struct signatures_struct* signatures = (struct signatures_struct*)member;
+    struct signaturelist_struct* signatures = (struct signaturelist_struct*)member;
     int i, size;
-    size = marshalling(h, "sigs", &(signatures->sigs), &(signatures->nsigs), sizeof(struct signatures_struct), marshallself);
+    size = marshalling(h, "sigs", &(signatures->sigs), &(signatures->nsigs), sizeof(struct signature_struct), marshallself);
     for(i=0; i<signatures->nsigs; i++) {
         size += marshalling(h, "rr", &(signatures->sigs[i].rr), NULL, 0, marshallldnsrr);
         size += marshalling(h, "keylocator", &(signatures->sigs[i].keylocator), NULL, 0, marshallstring);
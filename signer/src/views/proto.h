@@ -49,16 +49,20 @@ extern const char* names_view_BACKUP[];
 
 extern logger_cls_type names_logcommitlog;
 
+/* A signature as handed out by names_recordlookupall, the rr is owned by
+ * the list, the key locator by the recordset.
+ */
 struct signature_struct {
     ldns_rr* rr;
     const char* keylocator;
     int keyflags;
 };
-struct signatures_struct {
+/* The signatures of an RRset as they are marshalled. */
+struct signaturelist_struct {
     int nsigs;
     struct signature_struct* sigs;
 };
-void signaturedispose(struct signatures_struct* sigs);
+struct signatures_struct;
 
 /*
  * Definitions relating to an iterator.  An iterator is a object handle that
@@ -169,10 +173,13 @@ int64_t names_recordgetexpiry(recordset_type);
 void names_recordsetexpiry(recordset_type, int64_t value);
 void names_recordaddsignature(recordset_type record, ldns_rr_type rrtype, ldns_rr* rrsig, const char* keylocator, int keyflags);
 int names_recordmarshall(recordset_type*, marshall_handle);
-size_t names_recordextend(recordset_type);
+size_t names_recordextend(recordset_type, size_t* signatures);
+/* Release the interned key locators, once no record refers to them. */
+void names_recordcleanup(void);
 
 void names_recordlookupone(recordset_type record, ldns_rr_type type, ldns_rr* template, ldns_rr** rr);
 void names_recordlookupall(recordset_type record, ldns_rr_type type, ldns_rr* template, ldns_rr_list** rrs, struct signature_struct*** rrsigs);
+void names_recordfreesignatures(struct signature_struct** rrsigs);
 
 struct dual {
     recordset_type src;
@@ -203,6 +210,7 @@ int names_tabledel(names_table_type table, char* name);
 void** names_tableput(names_table_type table, void* name);
 void names_tableconcat(names_table_type* list, names_table_type item);
 names_iterator names_tableitems(names_table_type table);
+size_t names_tableextend(names_table_type table, size_t valuesize);
 
 /* The changelog_ functions are also not to be used directly, they
  * extend the table functionality in combination with the views.
@@ -213,6 +221,8 @@ typedef struct names_commitlog_struct* names_commitlog_type;
 void names_commitlogdestroy(names_table_type changelog);
 void names_commitlogdestroyfull(names_table_type changelog);
 void names_commitlogdestroyall(names_commitlog_type views, marshall_handle* store);
+size_t names_commitlogextend(names_commitlog_type commitlog, size_t valuesize);
+long names_commitlogcommits(names_commitlog_type commitlog);
 int names_commitlogpoppush(names_commitlog_type, int viewid, names_table_type* previous, names_table_type* mychangelog);
 int names_commitlogsubscribe(names_view_type view, names_commitlog_type*);
 void names_commitlogunsubscribe(int viewid, names_commitlog_type commitlogptr);
@@ -227,6 +237,9 @@ void names_update(names_view_type view, recordset_type* record);
 void names_amend(names_view_type view, recordset_type record);
 void* names_place(names_view_type store, const char* name);
 void* names_take(names_view_type view, int index, const char* name);
+/* As names_place and names_take, for a wire format owner name */
+void* names_placeowner(names_view_type view, const ldns_rdf* owner);
+void* names_takeowner(names_view_type view, int index, const ldns_rdf* owner);
 void names_remove(names_view_type view, recordset_type record);
 names_view_type names_viewcreate(names_view_type base, const char* name, const char** keynames);
 void names_viewdestroy(names_view_type view);
@@ -250,6 +263,8 @@ names_iterator names_iteratoroutdated(names_index_type index, va_list ap);
 
 int names_viewcommit(names_view_type view);
 void names_viewreset(names_view_type view);
+int names_viewupdate(names_view_type view);
+long names_viewcommits(names_view_type view);
 int names_viewpersist(names_view_type view, int basefd, char* filename);
 int names_viewconfig(names_view_type view, signconf_type** signconf);
 int names_viewrestore(names_view_type view, const char* apex, int basefd, const char* filename);
@@ -262,6 +277,7 @@ int names_viewgetapex(names_view_type view, ldns_rdf** apexptr);
 
 void names_dumprecord(FILE*, recordset_type record);
 void names_dumpviewinfo(FILE*, names_view_type view);
+void names_viewmemory(names_view_type view, struct stats_memory* memory);
 void names_dumpviewfull(FILE*, names_view_type view);
 void names_dumpindex(FILE* fp, names_view_type view, int index);
 void names__dumpindex(FILE* fp, names_index_type index);
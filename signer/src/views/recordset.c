@@ -30,23 +30,47 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <pthread.h>
 #include <ldns/ldns.h>
 #include "uthash.h"
 #include "utilities.h"
 #include "logging.h"
 #include "proto.h"
 
-struct item {
-    ldns_rr* rr;
-};
+static const char* recordset_str = "recordset";
 
+/* Records are not kept as ldns_rr objects but as their uncompressed wire
+ * format rdata, each prefixed with its two octet length, back to back in
+ * one blob per RRset.  The owner is the name of the recordset and the TTL
+ * is shared by the RRset, records with differing TTLs are brought down to
+ * the lowest of them (RFC 2181 section 5.2).  An ldns_rr is only
+ * materialized when handed out, which is then owned by the caller.
+ */
 struct itemset {
     ldns_rr_type rrtype;
+    ldns_rr_class rrclass;
+    uint32_t ttl;
     int nitems;
-    struct item* items;
+    size_t rdatasize;
+    uint8_t* rdata;
     struct signatures_struct* signatures;
 };
 
+/* Signatures are kept likewise, the key locator is shared between all
+ * signatures made with the same key.
+ */
+struct signature {
+    uint32_t ttl;
+    int keyflags;
+    const char* keylocator;
+    uint8_t* rdata;
+};
+
+struct signatures_struct {
+    int nsigs;
+    struct signature* sigs;
+};
+
 struct recordset_struct {
     char* name;
     int revision;
@@ -61,14 +85,212 @@ struct recordset_struct {
     struct itemset* itemsets;
 };
 
+struct keylocator {
+    char* locator;
+    UT_hash_handle hh;
+};
+
+static struct keylocator* keylocators = NULL;
+static pthread_mutex_t keylocatorslock = PTHREAD_MUTEX_INITIALIZER;
+
+/* There are only as many key locators as keys ever used in signing, they
+ * are kept until names_recordcleanup when the signer shuts down.
+ */
+static const char*
+keylocatorintern(const char* locator)
+{
+    struct keylocator* entry;
+    if(locator == NULL)
+        return NULL;
+    pthread_mutex_lock(&keylocatorslock);
+    HASH_FIND_STR(keylocators, locator, entry);
+    if(entry == NULL) {
+        CHECKALLOC(entry = malloc(sizeof(struct keylocator)));
+        CHECKALLOC(entry->locator = strdup(locator));
+        HASH_ADD_KEYPTR(hh, keylocators, entry->locator, strlen(entry->locator), entry);
+    }
+    pthread_mutex_unlock(&keylocatorslock);
+    return entry->locator;
+}
+
+void
+names_recordcleanup(void)
+{
+    struct keylocator* entry;
+    struct keylocator* tmp;
+    pthread_mutex_lock(&keylocatorslock);
+    HASH_ITER(hh, keylocators, entry, tmp) {
+        HASH_DEL(keylocators, entry);
+        free(entry->locator);
+        free(entry);
+    }
+    pthread_mutex_unlock(&keylocatorslock);
+}
+
+static size_t
+rdatalength(const uint8_t* rdata)
+{
+    return 2 + ldns_read_uint16(rdata);
+}
+
+static uint8_t*
+rdatapack(ldns_rr* rr, size_t* length)
+{
+    size_t i, len, pos;
+    uint8_t* rdata;
+    len = 0;
+    for(i=0; i<ldns_rr_rd_count(rr); i++)
+        len += ldns_rdf_size(ldns_rr_rdf(rr, i));
+    CHECKALLOC(rdata = malloc(2 + len));
+    ldns_write_uint16(rdata, len);
+    for(i=0, pos=2; i<ldns_rr_rd_count(rr); i++) {
+        memcpy(&rdata[pos], ldns_rdf_data(ldns_rr_rdf(rr, i)), ldns_rdf_size(ldns_rr_rdf(rr, i)));
+        pos += ldns_rdf_size(ldns_rr_rdf(rr, i));
+    }
+    if(length)
+        *length = 2 + len;
+    return rdata;
+}
+
+static ldns_rr*
+rdataexpand(const ldns_rdf* owner, ldns_rr_type rrtype, ldns_rr_class rrclass, uint32_t ttl, const uint8_t* rdata)
+{
+    size_t pos = 0;
+    ldns_rr* rr;
+    CHECKALLOC(rr = ldns_rr_new());
+    ldns_rr_set_owner(rr, ldns_rdf_clone(owner));
+    ldns_rr_set_type(rr, rrtype);
+    ldns_rr_set_class(rr, rrclass);
+    ldns_rr_set_ttl(rr, ttl);
+    if(ldns_wire2rdf(rr, rdata, rdatalength(rdata), &pos) != LDNS_STATUS_OK) {
+        ldns_rr_free(rr);
+        return NULL;
+    }
+    return rr;
+}
+
+static ldns_rdf*
+recordowner(recordset_type d)
+{
+    ldns_rdf* owner;
+    CHECKALLOC(owner = ldns_dname_new_frm_str(d->name));
+    return owner;
+}
+
+/* Owner of the denial record and its signatures. */
+static ldns_rdf*
+denialowner(recordset_type d)
+{
+    if(d->spanhashrr)
+        return ldns_rdf_clone(ldns_rr_owner(d->spanhashrr));
+    return recordowner(d);
+}
+
+/* The RR types that have domain names in their rdata which compare case
+ * insensitive in canonical form (RFC 4034 section 6.2).
+ */
+static int
+rdatacaseless(ldns_rr_type rrtype)
+{
+    switch(rrtype) {
+        case LDNS_RR_TYPE_NS:
+        case LDNS_RR_TYPE_MD:
+        case LDNS_RR_TYPE_MF:
+        case LDNS_RR_TYPE_CNAME:
+        case LDNS_RR_TYPE_SOA:
+        case LDNS_RR_TYPE_MB:
+        case LDNS_RR_TYPE_MG:
+        case LDNS_RR_TYPE_MR:
+        case LDNS_RR_TYPE_PTR:
+        case LDNS_RR_TYPE_HINFO:
+        case LDNS_RR_TYPE_MINFO:
+        case LDNS_RR_TYPE_MX:
+        case LDNS_RR_TYPE_RP:
+        case LDNS_RR_TYPE_AFSDB:
+        case LDNS_RR_TYPE_RT:
+        case LDNS_RR_TYPE_SIG:
+        case LDNS_RR_TYPE_PX:
+        case LDNS_RR_TYPE_NXT:
+        case LDNS_RR_TYPE_NAPTR:
+        case LDNS_RR_TYPE_KX:
+        case LDNS_RR_TYPE_SRV:
+        case LDNS_RR_TYPE_DNAME:
+        case LDNS_RR_TYPE_A6:
+        case LDNS_RR_TYPE_RRSIG:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Find the item equal to rr as by ldns_rr_compare, returns the offset of
+ * the item in the rdata of the itemset or -1.  Canonical form does not
+ * change the length, so only for equal length rdata of caseless types the
+ * records need to be materialized to compare.
+ */
+static ssize_t
+itemfind(struct itemset* itemset, ldns_rr* rr, const uint8_t* packed)
+{
+    size_t pos, len;
+    ldns_rr* item;
+    int cmp;
+    len = rdatalength(packed);
+    for(pos=0; pos<itemset->rdatasize; pos+=rdatalength(&itemset->rdata[pos])) {
+        if(rdatalength(&itemset->rdata[pos]) != len)
+            continue;
+        if(!memcmp(&itemset->rdata[pos], packed, len))
+            return pos;
+        if(rdatacaseless(itemset->rrtype)) {
+            item = rdataexpand(ldns_rr_owner(rr), itemset->rrtype, itemset->rrclass, itemset->ttl, &itemset->rdata[pos]);
+            cmp = (item ? ldns_rr_compare(rr, item) : 1);
+            ldns_rr_free(item);
+            if(!cmp)
+                return pos;
+        }
+    }
+    return -1;
+}
+
+static ldns_rr**
+itemsetexpand(recordset_type d, struct itemset* itemset)
+{
+    int j;
+    size_t pos;
+    ldns_rr** rrs;
+    ldns_rdf* owner = recordowner(d);
+    CHECKALLOC(rrs = malloc(sizeof(ldns_rr*) * (itemset->nitems ? itemset->nitems : 1)));
+    for(j=0, pos=0; j<itemset->nitems; j++, pos+=rdatalength(&itemset->rdata[pos])) {
+        rrs[j] = rdataexpand(owner, itemset->rrtype, itemset->rrclass, itemset->ttl, &itemset->rdata[pos]);
+    }
+    ldns_rdf_deep_free(owner);
+    return rrs;
+}
+
+static void
+signaturesadd(struct signatures_struct** signatures, ldns_rr* rrsig, const char* keylocator, int keyflags)
+{
+    struct signature* sig;
+    if(!*signatures) {
+        CHECKALLOC(*signatures = malloc(sizeof(struct signatures_struct)));
+        (*signatures)->nsigs = 0;
+        (*signatures)->sigs = NULL;
+    }
+    (*signatures)->nsigs += 1;
+    CHECKALLOC((*signatures)->sigs = realloc((*signatures)->sigs, sizeof(struct signature) * (*signatures)->nsigs));
+    sig = &(*signatures)->sigs[(*signatures)->nsigs-1];
+    sig->ttl = ldns_rr_ttl(rrsig);
+    sig->keyflags = keyflags;
+    sig->keylocator = keylocatorintern(keylocator);
+    sig->rdata = rdatapack(rrsig, NULL);
+}
+
 static void
 disposesignature(struct signatures_struct** signatures)
 {
     int i;
     if(*signatures) {
         for (i=0; i<(*signatures)->nsigs; i++) {
-            free((void*)(*signatures)->sigs[i].keylocator);
-            ldns_rr_free((*signatures)->sigs[i].rr);
+            free((*signatures)->sigs[i].rdata);
         }
         free((*signatures)->sigs);
         free((*signatures));
@@ -79,43 +301,57 @@ disposesignature(struct signatures_struct** signatures)
 void
 disposeitemset(struct itemset* itemset)
 {
-    int j;
-    for(j=0; j<itemset->nitems; j++) {
-        ldns_rr_free(itemset->items[j].rr);
-    }
-    free(itemset->items);
+    free(itemset->rdata);
+    itemset->rdata = NULL;
+    itemset->rdatasize = 0;
+    itemset->nitems = 0;
     disposesignature(&(itemset->signatures));
 }
 
 void
 names_recordaddsignature(recordset_type d, ldns_rr_type rrtype, ldns_rr* rrsig, const char* keylocator, int keyflags)
 {
-    int i, j;
+    int i;
     for(i=0; i<d->nitemsets; i++)
         if(rrtype == d->itemsets[i].rrtype)
             break;
     if (i<d->nitemsets) {
-        if(!d->itemsets[i].signatures) {
-            d->itemsets[i].signatures = malloc(sizeof(struct signatures_struct));
-            d->itemsets[i].signatures->nsigs = 0;
-            d->itemsets[i].signatures->sigs = NULL;
-        }
-        d->itemsets[i].signatures->nsigs += 1;
-        d->itemsets[i].signatures->sigs = realloc(d->itemsets[i].signatures->sigs, sizeof(struct signature_struct) * d->itemsets[i].signatures->nsigs);
-        d->itemsets[i].signatures->sigs[d->itemsets[i].signatures->nsigs-1].rr = rrsig;
-        d->itemsets[i].signatures->sigs[d->itemsets[i].signatures->nsigs-1].keylocator = keylocator;
-        d->itemsets[i].signatures->sigs[d->itemsets[i].signatures->nsigs-1].keyflags = keyflags;
+        signaturesadd(&d->itemsets[i].signatures, rrsig, keylocator, keyflags);
     } else if(rrtype == LDNS_RR_TYPE_NSEC || rrtype == LDNS_RR_TYPE_NSEC3) {
-        if(!d->spansignatures) {
-            d->spansignatures = malloc(sizeof(struct signatures_struct));
-            d->spansignatures->nsigs = 0;
-            d->spansignatures->sigs = NULL;            
+        signaturesadd(&d->spansignatures, rrsig, keylocator, keyflags);
+    }
+    ldns_rr_free(rrsig);
+}
+
+/* Materialize the signatures into the list handed out to the caller. */
+static void
+signaturesexpand(struct signatures_struct* signatures, const ldns_rdf* owner, ldns_rr_class rrclass, struct signature_struct*** rrsigs, int* nrrsigs)
+{
+    int j;
+    struct signature_struct* sig;
+    if(!signatures)
+        return;
+    for(j=0; j<signatures->nsigs; j++) {
+        CHECKALLOC(sig = malloc(sizeof(struct signature_struct)));
+        sig->rr = rdataexpand(owner, LDNS_RR_TYPE_RRSIG, rrclass, signatures->sigs[j].ttl, signatures->sigs[j].rdata);
+        sig->keylocator = signatures->sigs[j].keylocator;
+        sig->keyflags = signatures->sigs[j].keyflags;
+        ++*nrrsigs;
+        CHECKALLOC(*rrsigs = realloc(*rrsigs, sizeof(struct signature_struct*) * *nrrsigs));
+        (*rrsigs)[*nrrsigs-1] = sig;
+    }
+}
+
+void
+names_recordfreesignatures(struct signature_struct** rrsigs)
+{
+    int i;
+    if(rrsigs) {
+        for(i=0; rrsigs[i]; i++) {
+            ldns_rr_free(rrsigs[i]->rr);
+            free(rrsigs[i]);
         }
-        d->spansignatures->nsigs += 1;
-        d->spansignatures->sigs = realloc(d->spansignatures->sigs, sizeof(struct signature_struct) * d->spansignatures->nsigs);
-        d->spansignatures->sigs[d->spansignatures->nsigs-1].rr = rrsig;
-        d->spansignatures->sigs[d->spansignatures->nsigs-1].keylocator = keylocator;
-        d->spansignatures->sigs[d->spansignatures->nsigs-1].keyflags = keyflags;
+        free(rrsigs);
     }
 }
 
@@ -239,7 +475,7 @@ names_recordannotate(recordset_type d, struct names_view_zone* zone)
 recordset_type
 names_recordcopy(recordset_type dict, int clear)
 {
-    int i, j;
+    int i;
     struct recordset_struct* target;
     char* name = dict->name;
     target = (struct recordset_struct*) names_recordcreate(&name);
@@ -248,12 +484,13 @@ names_recordcopy(recordset_type dict, int clear)
     CHECKALLOC(target->itemsets = malloc(sizeof(struct itemset) * target->nitemsets));
     for(i=0; i<target->nitemsets; i++) {
         target->itemsets[i].rrtype = dict->itemsets[i].rrtype;
+        target->itemsets[i].rrclass = dict->itemsets[i].rrclass;
+        target->itemsets[i].ttl = dict->itemsets[i].ttl;
         target->itemsets[i].nitems = dict->itemsets[i].nitems;
-        target->itemsets[i].items = malloc(sizeof(struct item) * dict->itemsets[i].nitems);
+        target->itemsets[i].rdatasize = dict->itemsets[i].rdatasize;
+        CHECKALLOC(target->itemsets[i].rdata = malloc(dict->itemsets[i].rdatasize ? dict->itemsets[i].rdatasize : 1));
+        memcpy(target->itemsets[i].rdata, dict->itemsets[i].rdata, dict->itemsets[i].rdatasize);
         target->itemsets[i].signatures = NULL;
-        for(j=0; j<dict->itemsets[i].nitems; j++) {
-            target->itemsets[i].items[j].rr = ldns_rr_clone(dict->itemsets[i].items[j].rr);
-        }
     }
     target->spanhash = (dict->spanhash ? strdup(dict->spanhash) : NULL);
     target->spanhashrr = (dict->spanhashrr ? ldns_rr_clone(dict->spanhashrr) : NULL);
@@ -281,7 +518,9 @@ names_recordcopy(recordset_type dict, int clear)
 int
 names_recordhasdata(recordset_type record, ldns_rr_type recordtype, ldns_rr* rr, int exact)
 {
-    int i, j;
+    int i;
+    ssize_t pos;
+    uint8_t* packed;
     if(!record)
         return 0;
     if(recordtype == 0) { /* note there is no rrtype of 0 in DNS */
@@ -294,12 +533,12 @@ names_recordhasdata(recordset_type record, ldns_rr_type recordtype, ldns_rr* rr,
             if(rr == NULL) {
                 return record->itemsets[i].nitems > 0;
             } else {
-                for(j=0; j<record->itemsets[i].nitems; j++)
-                    if(!ldns_rr_compare(rr, record->itemsets[i].items[j].rr))
-                        break;
-                if (j<record->itemsets[i].nitems) {
+                packed = rdatapack(rr, NULL);
+                pos = itemfind(&record->itemsets[i], rr, packed);
+                free(packed);
+                if (pos >= 0) {
                     if(exact) {
-                        if(ldns_rr_ttl(record->itemsets[i].items[j].rr) != ldns_rr_ttl(rr))
+                        if(record->itemsets[i].ttl != ldns_rr_ttl(rr))
                             return 0;
                         return  1;
                     } else
@@ -311,10 +550,35 @@ names_recordhasdata(recordset_type record, ldns_rr_type recordtype, ldns_rr* rr,
     return 0;
 }
 
+/* An RRset holds a single TTL, a record added with another TTL than the
+ * records already present lowers it to the smallest of the two.
+ */
+static void
+itemsetttl(const char* name, struct itemset* itemset, uint32_t ttl)
+{
+    char* type;
+    if(itemset->nitems == 0) {
+        itemset->ttl = ttl;
+    } else if(itemset->ttl != ttl) {
+        type = ldns_rr_type2str(itemset->rrtype);
+        ods_log_warning("[%s] RRset %s %s has records with TTL %u and %u, "
+            "using %u for all", recordset_str, (name ? name : "."),
+            (type ? type : "?"), (unsigned) itemset->ttl, (unsigned) ttl,
+            (unsigned) (ttl < itemset->ttl ? ttl : itemset->ttl));
+        free(type);
+        if(ttl < itemset->ttl)
+            itemset->ttl = ttl;
+    }
+}
+
+/* The rr is copied into the recordset, it remains owned by the caller.
+ */
 void
 names_recordadddata(recordset_type d, ldns_rr* rr)
 {
-    int i, j;
+    int i;
+    size_t len;
+    uint8_t* packed;
     ldns_rr_type rrtype;
     rrtype = ldns_rr_get_type(rr);
     for(i=0; i<d->nitemsets; i++)
@@ -324,69 +588,64 @@ names_recordadddata(recordset_type d, ldns_rr* rr)
         d->nitemsets += 1;
         CHECKALLOC(d->itemsets = realloc(d->itemsets, sizeof(struct itemset) * d->nitemsets));
         d->itemsets[i].rrtype = rrtype;
-        d->itemsets[i].items = NULL;
+        d->itemsets[i].rrclass = ldns_rr_get_class(rr);
+        d->itemsets[i].rdata = NULL;
+        d->itemsets[i].rdatasize = 0;
         d->itemsets[i].nitems = 0;
         d->itemsets[i].signatures = NULL;
     }
-    for(j=0; j<d->itemsets[i].nitems; j++)
-        if(!ldns_rr_compare(rr, d->itemsets[i].items[j].rr))
-            break;
-    if (j==d->itemsets[i].nitems) {
+    itemsetttl(d->name, &d->itemsets[i], ldns_rr_ttl(rr));
+    packed = rdatapack(rr, &len);
+    if (itemfind(&d->itemsets[i], rr, packed) < 0) {
         d->itemsets[i].nitems += 1;
-        d->itemsets[i].items = realloc(d->itemsets[i].items, sizeof(struct item) * d->itemsets[i].nitems);
-        d->itemsets[i].items[j].rr = ldns_rr_clone(rr);
+        CHECKALLOC(d->itemsets[i].rdata = realloc(d->itemsets[i].rdata, d->itemsets[i].rdatasize + len));
+        memcpy(&d->itemsets[i].rdata[d->itemsets[i].rdatasize], packed, len);
+        d->itemsets[i].rdatasize += len;
+    }
+    free(packed);
+}
+
+static void
+itemsetremove(recordset_type d, int i)
+{
+    disposeitemset(&d->itemsets[i]);
+    d->nitemsets -= 1;
+    for(; i<d->nitemsets; i++)
+        d->itemsets[i] = d->itemsets[i+1];
+    if(d->nitemsets > 0) {
+        CHECKALLOC(d->itemsets = realloc(d->itemsets, sizeof(struct itemset) * d->nitemsets));
+    } else {
+        free(d->itemsets);
+        d->itemsets = NULL;
     }
 }
 
 void
 names_recorddeldata(recordset_type d, ldns_rr_type rrtype, ldns_rr* rr)
 {
-    int i, j;
+    int i;
+    ssize_t pos;
+    size_t len;
+    uint8_t* packed;
     for(i=0; i<d->nitemsets; i++)
         if(rrtype == d->itemsets[i].rrtype)
             break;
     if (i<d->nitemsets) {
         if(rr) {
-            for(j=0; j<d->itemsets[i].nitems; j++)
-                if(ldns_rr_compare(rr, d->itemsets[i].items[j].rr))
-                    break;
-            if (j<d->itemsets[i].nitems) {
-                ldns_rr_free(d->itemsets[i].items[j].rr);
+            packed = rdatapack(rr, NULL);
+            pos = itemfind(&d->itemsets[i], rr, packed);
+            free(packed);
+            if (pos >= 0) {
+                len = rdatalength(&d->itemsets[i].rdata[pos]);
+                memmove(&d->itemsets[i].rdata[pos], &d->itemsets[i].rdata[pos+len], d->itemsets[i].rdatasize - pos - len);
+                d->itemsets[i].rdatasize -= len;
                 d->itemsets[i].nitems -= 1;
-                for(; j<d->itemsets[i].nitems; j++) {
-                    d->itemsets[i].items[j] = d->itemsets[i].items[j+1];
-                }
-                if(d->itemsets[i].nitems > 0) {
-                    d->itemsets[i].items = realloc(d->itemsets[i].items, sizeof(struct item) * d->itemsets[i].nitems);
-                } else {
-                    free(d->itemsets[i].items);
-                    d->itemsets[i].items = NULL;
-                    d->nitemsets -= 1;
-                    for(; i<d->nitemsets; i++)
-                        d->itemsets[i] = d->itemsets[i+1];
-                    if(d->nitemsets > 0) {
-                        CHECKALLOC(d->itemsets = realloc(d->itemsets, sizeof(struct itemset) * d->nitemsets));
-                    } else {
-                        free(d->itemsets);
-                        d->itemsets = NULL;
-                    }
+                if(d->itemsets[i].nitems == 0) {
+                    itemsetremove(d, i);
                 }
             }
         } else {
-            for(j=0; j<d->itemsets[i].nitems; j++) {
-                ldns_rr_free(d->itemsets[i].items[j].rr);
-            }
-            free(d->itemsets[i].items);
-            d->itemsets[i].items = NULL;
-            d->nitemsets -= 1;
-            for(; i<d->nitemsets; i++)
-                d->itemsets[i] = d->itemsets[i+1];
-            if(d->nitemsets > 0) {
-                CHECKALLOC(d->itemsets = realloc(d->itemsets, sizeof(struct itemset) * d->nitemsets));
-            } else {
-                free(d->itemsets);
-                d->itemsets = NULL;
-            }
+            itemsetremove(d, i);
         }
     }
 }
@@ -394,31 +653,19 @@ names_recorddeldata(recordset_type d, ldns_rr_type rrtype, ldns_rr* rr)
 void
 names_recorddelall(recordset_type d, ldns_rr_type rrtype)
 {
-    int i, j;
-    for(i=0; i<d->nitemsets; i++) {
-        if(rrtype==0 || d->itemsets[i].rrtype == rrtype) {
-            disposeitemset(&(d->itemsets[i]));
-            if(rrtype != 0)
-                break;
-        }
-    }
+    int i;
     if(rrtype == 0) {
+        for(i=0; i<d->nitemsets; i++)
+            disposeitemset(&(d->itemsets[i]));
         free(d->itemsets);
         d->itemsets = NULL;
         d->nitemsets = 0;
-    } else if(i<d->nitemsets) {
-        d->itemsets[i].items = NULL;
-        d->nitemsets -= 1;
-        for (; i < d->nitemsets; i++)
-            d->itemsets[i] = d->itemsets[i + 1];
-        if (d->nitemsets > 0) {
-            CHECKALLOC(d->itemsets = realloc(d->itemsets, sizeof (struct itemset) * d->nitemsets));
-        } else {
-            for(i=0; i<d->nitemsets; i++)
-                disposeitemset(&(d->itemsets[i]));
-            free(d->itemsets);
-            d->itemsets = NULL;
-        }        
+    } else {
+        for(i=0; i<d->nitemsets; i++)
+            if(d->itemsets[i].rrtype == rrtype)
+                break;
+        if(i<d->nitemsets)
+            itemsetremove(d, i);
     }
 }
 
@@ -437,62 +684,54 @@ names_recordalltypes(recordset_type d)
     return iter;
 }
 
-static void names_recordallvaluestrings_func(names_iterator iter, void* base, int index, void* dst)
-{
-    struct item* items = (struct item*) base;
-    char** ptr = (char**)dst;
-    free(*ptr);
-    if (index >= 0)
-        *ptr = ldns_rr2str(items[index].rr);
-    else
-        *ptr = NULL;
-}
 names_iterator
 names_recordallvaluestrings(recordset_type d, ldns_rr_type rrtype)
 {
-    int i;
+    int i, j;
+    ldns_rr** rrs;
+    ldns_rdf* owner;
+    struct signature_struct** rrsigs = NULL;
+    int nrrsigs = 0;
+    names_iterator iter;
     for(i=0; i<d->nitemsets; i++) {
         if(rrtype == d->itemsets[i].rrtype)
             break;
     }
     if(i<d->nitemsets) {
-        int j;
-        names_iterator iter = names_iterator_createrefs(free);
+        iter = names_iterator_createrefs(free);
+        rrs = itemsetexpand(d, &d->itemsets[i]);
         for(j=0; j<d->itemsets[i].nitems; j++) {
-            names_iterator_addptr(iter, ldns_rr2str(d->itemsets[i].items[j].rr));
+            names_iterator_addptr(iter, ldns_rr2str(rrs[j]));
+            ldns_rr_free(rrs[j]);
         }
-        if(d->itemsets[i].signatures) {
-            for(j=0; j<d->itemsets[i].signatures->nsigs; j++) {
-                names_iterator_addptr(iter, ldns_rr2str(d->itemsets[i].signatures->sigs[j].rr));
-            }
-        }
-        return iter;
+        free(rrs);
+        owner = recordowner(d);
+        signaturesexpand(d->itemsets[i].signatures, owner, d->itemsets[i].rrclass, &rrsigs, &nrrsigs);
+        ldns_rdf_deep_free(owner);
+    } else if(rrtype == LDNS_RR_TYPE_NSEC || rrtype == LDNS_RR_TYPE_NSEC3) {
+        iter = names_iterator_createrefs(free);
+        names_iterator_addptr(iter, ldns_rr2str(d->spanhashrr));
+        owner = denialowner(d);
+        signaturesexpand(d->spansignatures, owner, (d->spanhashrr ? ldns_rr_get_class(d->spanhashrr) : LDNS_RR_CLASS_IN), &rrsigs, &nrrsigs);
+        ldns_rdf_deep_free(owner);
     } else {
-        if(rrtype == LDNS_RR_TYPE_NSEC || rrtype == LDNS_RR_TYPE_NSEC3) {
-            int j;
-            names_iterator iter = names_iterator_createrefs(free);
-            names_iterator_addptr(iter, ldns_rr2str(d->spanhashrr));
-            if(d->spansignatures) {
-                for(j=0; j<d->spansignatures->nsigs; j++) {
-                    names_iterator_addptr(iter, ldns_rr2str(d->spansignatures->sigs[j].rr));
-                }
-            }
-            return iter;            
-        }
         return NULL;
     }
+    for(j=0; j<nrrsigs; j++) {
+        names_iterator_addptr(iter, ldns_rr2str(rrsigs[j]->rr));
+        ldns_rr_free(rrsigs[j]->rr);
+        free(rrsigs[j]);
+    }
+    free(rrsigs);
+    return iter;
 }
 
 void
 names_recorddispose(recordset_type dict)
 {
-    int i, j;
+    int i;
     for(i=0; i<dict->nitemsets; i++) {
-        for(j=0; j<dict->itemsets[i].nitems; j++) {
-            ldns_rr_free(dict->itemsets[i].items[j].rr);
-        }
-        disposesignature(&dict->itemsets[i].signatures);
-        free(dict->itemsets[i].items);
+        disposeitemset(&dict->itemsets[i]);
     }
     free(dict->itemsets);
     free(dict->name);
@@ -622,32 +861,134 @@ names_recordsetexpiry(recordset_type record, int64_t value)
     *(record->expiry) = value;
 }
 
+/* The stream format predates the compact storage and holds the records
+ * and signatures in presentation format, so these are materialized to be
+ * written and packed again after reading.
+ */
+static int
+marshallitems(marshall_handle h, recordset_type d, struct itemset* itemset)
+{
+    int j, size, nrrs;
+    ldns_rr** rrs;
+    size_t len;
+    uint8_t* packed;
+    size = 0;
+    if(marshalldirection(h) == marshall_READING) {
+        size += marshalling(h, "items", &rrs, &nrrs, sizeof(ldns_rr*), marshallself);
+        for(j=0; j<nrrs; j++) {
+            size += marshalling(h, "rr", &rrs[j], NULL, 0, marshallldnsrr);
+            size += marshalling(h, NULL, NULL, &nrrs, j, marshallself);
+        }
+        itemset->rrclass = LDNS_RR_CLASS_IN;
+        itemset->ttl = 0;
+        itemset->nitems = 0;
+        itemset->rdatasize = 0;
+        itemset->rdata = NULL;
+        for(j=0; j<nrrs; j++) {
+            if(rrs[j]) {
+                itemset->rrclass = ldns_rr_get_class(rrs[j]);
+                itemsetttl(d->name, itemset, ldns_rr_ttl(rrs[j]));
+                packed = rdatapack(rrs[j], &len);
+                CHECKALLOC(itemset->rdata = realloc(itemset->rdata, itemset->rdatasize + len));
+                memcpy(&itemset->rdata[itemset->rdatasize], packed, len);
+                itemset->rdatasize += len;
+                itemset->nitems += 1;
+                free(packed);
+                ldns_rr_free(rrs[j]);
+            }
+        }
+        free(rrs);
+    } else if(marshalldirection(h) == marshall_WRITING) {
+        nrrs = itemset->nitems;
+        rrs = itemsetexpand(d, itemset);
+        size += marshalling(h, "items", &rrs, &nrrs, sizeof(ldns_rr*), marshallself);
+        for(j=0; j<nrrs; j++) {
+            size += marshalling(h, "rr", &rrs[j], NULL, 0, marshallldnsrr);
+            size += marshalling(h, NULL, NULL, &nrrs, j, marshallself);
+        }
+        for(j=0; j<nrrs; j++)
+            ldns_rr_free(rrs[j]);
+        free(rrs);
+    }
+    return size;
+}
+
+static int
+marshallsignatures(marshall_handle h, const char* name, struct signatures_struct** signatures, const ldns_rdf* owner, ldns_rr_class rrclass)
+{
+    int j, size, nrrsigs;
+    struct signature_struct** rrsigs = NULL;
+    struct signaturelist_struct* list = NULL;
+    if(marshalldirection(h) == marshall_WRITING && *signatures) {
+        nrrsigs = 0;
+        signaturesexpand(*signatures, owner, rrclass, &rrsigs, &nrrsigs);
+        CHECKALLOC(list = malloc(sizeof(struct signaturelist_struct)));
+        list->nsigs = nrrsigs;
+        CHECKALLOC(list->sigs = malloc(sizeof(struct signature_struct) * (nrrsigs ? nrrsigs : 1)));
+        for(j=0; j<nrrsigs; j++) {
+            list->sigs[j] = *rrsigs[j];
+            free(rrsigs[j]);
+        }
+        free(rrsigs);
+    }
+    size = marshalling(h, name, &list, marshall_OPTIONAL, sizeof(struct signaturelist_struct), marshallsigs);
+    if(marshalldirection(h) == marshall_READING) {
+        *signatures = NULL;
+        if(list) {
+            for(j=0; j<list->nsigs; j++) {
+                if(list->sigs[j].rr)
+                    signaturesadd(signatures, list->sigs[j].rr, list->sigs[j].keylocator, list->sigs[j].keyflags);
+                ldns_rr_free(list->sigs[j].rr);
+                free((void*)list->sigs[j].keylocator);
+            }
+            free(list->sigs);
+            free(list);
+        }
+    } else if(list) {
+        for(j=0; j<list->nsigs; j++)
+            ldns_rr_free(list->sigs[j].rr);
+        free(list->sigs);
+        free(list);
+    }
+    return size;
+}
+
 int
 marshall(marshall_handle h, void* ptr)
 {
     recordset_type d = ptr;
     int size = 0;
-    int i, j;
+    int i;
+    ldns_rdf* owner = NULL;
     size += marshalling(h, "name", &(d->name), NULL, 0, marshallstring);
     size += marshalling(h, "marker", &(d->marker), NULL, 0, marshallinteger);
     size += marshalling(h, "revision", &(d->revision), NULL, 0, marshallinteger);
     size += marshalling(h, "spanhash", &(d->spanhash), NULL, 0, marshallstring);
-    size += marshalling(h, "spansignatures", &(d->spansignatures), marshall_OPTIONAL, sizeof(struct signatures_struct), marshallsigs);
+    if(marshalldirection(h) == marshall_WRITING && d->spansignatures) {
+        owner = denialowner(d);
+    }
+    size += marshallsignatures(h, "spansignatures", &(d->spansignatures), owner, (d->spanhashrr ? ldns_rr_get_class(d->spanhashrr) : LDNS_RR_CLASS_IN));
+    if(owner) {
+        ldns_rdf_deep_free(owner);
+        owner = NULL;
+    }
     size += marshalling(h, "spanhashrr", &(d->spanhashrr), NULL, 0, marshallldnsrr);
     size += marshalling(h, "validupto", &(d->validupto), marshall_OPTIONAL, sizeof(int), marshallinteger);
     size += marshalling(h, "validfrom", &(d->validfrom), marshall_OPTIONAL, sizeof(int), marshallinteger);
     size += marshalling(h, "expiry", &(d->expiry), marshall_OPTIONAL, sizeof(int64_t), marshallint64);
     size += marshalling(h, "itemsets", &(d->itemsets), &(d->nitemsets), sizeof(struct itemset), marshallself);
+    if(marshalldirection(h) == marshall_WRITING && d->nitemsets > 0) {
+        owner = recordowner(d);
+    }
     for(i=0; i<d->nitemsets; i++) {
         size += marshalling(h, "itemname", &(d->itemsets[i].rrtype), NULL, 0, marshallinteger);
-        size += marshalling(h, "items", &(d->itemsets[i].items), &(d->itemsets[i].nitems), sizeof(struct item), marshallself);
-        for(j=0; j<d->itemsets[i].nitems; j++) {
-            size += marshalling(h, "rr", &(d->itemsets[i].items[j].rr), NULL, 0, marshallldnsrr);
-            size += marshalling(h, NULL, NULL, &(d->itemsets[i].nitems), j, marshallself);
-        }
-        size += marshalling(h, "signatures", &(d->itemsets[i].signatures), marshall_OPTIONAL, sizeof(struct signatures_struct), marshallsigs);
+        size += marshallitems(h, d, &d->itemsets[i]);
+        size += marshallsignatures(h, "signatures", &(d->itemsets[i].signatures), owner, d->itemsets[i].rrclass);
         size += marshalling(h, NULL, NULL, &(d->nitemsets), i, marshallself);
     }
+    if(owner) {
+        ldns_rdf_deep_free(owner);
+    }
     return size;
 }
 
@@ -662,40 +1003,45 @@ names_recordmarshall(recordset_type* record, marshall_handle h)
     return rc;
 }
 
+/* The key locators are interned and not accounted per signature. */
+static size_t
+signaturesextend(struct signatures_struct* signatures)
+{
+    int j;
+    size_t size = 0;
+    if(signatures) {
+        size += sizeof(struct signatures_struct);
+        size += signatures->nsigs * sizeof(struct signature);
+        for(j=0; j<signatures->nsigs; j++) {
+            size += rdatalength(signatures->sigs[j].rdata);
+        }
+    }
+    return size;
+}
+
+/* Returns the memory used by the recordset including its signatures, the
+ * part used by the signatures alone is added to signatures if given.
+ */
 size_t
-names_recordextend(recordset_type record)
+names_recordextend(recordset_type record, size_t* signatures)
 {
-    int i, j;
-    size_t size;
+    int i;
+    size_t size, sigsize;
     size = sizeof(struct recordset_struct);
     size += record->nitemsets * sizeof(struct itemset);
+    sigsize = signaturesextend(record->spansignatures);
     for(i=0; i<record->nitemsets; i++) {
-        size += record->itemsets[i].nitems * sizeof(struct item);
-        for(j=0; j<record->itemsets[i].nitems; j++) {
-            size += ldns_rr_uncompressed_size(record->itemsets[i].items[j].rr);
-        }
-        if(record->itemsets[i].signatures) {
-            size += sizeof(struct signatures_struct);
-            size += record->itemsets[i].signatures->nsigs * sizeof(struct signature_struct);
-            for(j=0; j<record->itemsets[i].signatures->nsigs; j++) {
-                size += (record->itemsets[i].signatures->sigs[j].keylocator ? strlen(record->itemsets[i].signatures->sigs[j].keylocator) : 0);
-                size += ldns_rr_uncompressed_size(record->itemsets[i].signatures->sigs[j].rr);
-            }
-        }
+        size += record->itemsets[i].rdatasize;
+        sigsize += signaturesextend(record->itemsets[i].signatures);
     }
+    size += sigsize;
+    if(signatures)
+        *signatures += sigsize;
     size += (record->name ? strlen(record->name) : 0);
     size += (record->spanhash ? strlen(record->spanhash) : 0);
     if(record->spanhashrr) {
         size += ldns_rr_uncompressed_size(record->spanhashrr);
     }
-    if(record->spansignatures) {
-        size += sizeof(struct signatures_struct);
-        size += record->spansignatures->nsigs * sizeof(struct signature_struct);
-        for(j=0; j<record->spansignatures->nsigs; j++) {
-            size += (record->spansignatures->sigs[j].keylocator ? strlen(record->spansignatures->sigs[j].keylocator) : 0);
-            size += ldns_rr_uncompressed_size(record->spansignatures->sigs[j].rr);
-        }
-    }
     size += (record->validupto ? sizeof(int) : 0);
     size += (record->validfrom ? sizeof(int) : 0);
     size += (record->expiry ? sizeof(int64_t) : 0);
@@ -1079,58 +1425,66 @@ names_recordindexfunction(const char* keyname, int (**acceptfunc)(recordset_type
     }    
 }
 
+/* The record returned is a copy owned by the caller. */
 void
 names_recordlookupone(recordset_type record, ldns_rr_type recordtype, ldns_rr* template, ldns_rr** rr)
 {
-    int i, j;
+    int i;
+    ssize_t pos;
+    uint8_t* packed;
+    ldns_rdf* owner;
     assert(record);
     assert(recordtype != 0);
     *rr = NULL;
     for(i=0; i<record->nitemsets; i++)
         if(record->itemsets[i].rrtype == recordtype)
             break;
-    if (i<record->nitemsets) {
-        if(rr == NULL) {
-            if(record->itemsets[i].nitems > 0) {
-                *rr = record->itemsets[i].items[0].rr;
-            }
+    if (i<record->nitemsets && record->itemsets[i].nitems > 0) {
+        if(template) {
+            packed = rdatapack(template, NULL);
+            pos = itemfind(&record->itemsets[i], template, packed);
+            free(packed);
         } else {
-            for(j=0; j<record->itemsets[i].nitems; j++)
-                if(!template || !ldns_rr_compare(template, record->itemsets[i].items[j].rr))
-                    break;
-            if (j<record->itemsets[i].nitems) {
-                *rr = record->itemsets[i].items[j].rr;
-            }
+            pos = 0;
+        }
+        if (pos >= 0) {
+            owner = recordowner(record);
+            *rr = rdataexpand(owner, record->itemsets[i].rrtype, record->itemsets[i].rrclass, record->itemsets[i].ttl, &record->itemsets[i].rdata[pos]);
+            ldns_rdf_deep_free(owner);
         }
     }
 }
 
+/* The records in the list and the signatures are copies owned by the caller,
+ * the list of signatures is to be released with names_recordfreesignatures.
+ */
 void
 names_recordlookupall(recordset_type record, ldns_rr_type rrtype, ldns_rr* template, ldns_rr_list** rrs, struct signature_struct*** rrsigs)
 {
     int i, j;
     int nrrsigs = 0;
+    ssize_t pos;
+    uint8_t* packed;
+    ldns_rr** items;
+    ldns_rdf* owner;
     assert(record);
     if(rrs)
         *rrs = NULL;
     if(rrsigs)
         *rrsigs = NULL;
     if(rrtype==LDNS_RR_TYPE_RRSIG) {
-        for(i=0; i<record->nitemsets; i++) {
-            if(record->itemsets[i].signatures) {
-                for(j=0; j<record->itemsets[i].signatures->nsigs; j++) {
-                    ++nrrsigs;
-                    *rrsigs = realloc(*rrsigs, sizeof(struct signature_struct*) * nrrsigs);
-                    (*rrsigs)[nrrsigs-1] = &record->itemsets[i].signatures->sigs[j];
-                }
+        if(rrsigs) {
+            owner = recordowner(record);
+            for(i=0; i<record->nitemsets; i++) {
+                signaturesexpand(record->itemsets[i].signatures, owner, record->itemsets[i].rrclass, rrsigs, &nrrsigs);
             }
-        }
-        if(record->spansignatures)
-            for(j=0; j<record->spansignatures->nsigs; j++) {
-                ++nrrsigs;
-                *rrsigs = realloc(*rrsigs, sizeof(struct signature_struct*) * nrrsigs);
-                (*rrsigs)[nrrsigs-1] = &record->spansignatures->sigs[j];
+            ldns_rdf_deep_free(owner);
+            if(record->spansignatures) {
+                owner = denialowner(record);
+                signaturesexpand(record->spansignatures, owner, (record->spanhashrr ? ldns_rr_get_class(record->spanhashrr) : LDNS_RR_CLASS_IN), rrsigs, &nrrsigs);
+                ldns_rdf_deep_free(owner);
             }
+        }
   } else {
     for(i=0; i<record->nitemsets; i++) {
         if(record->itemsets[i].rrtype == rrtype) {
@@ -1138,54 +1492,54 @@ names_recordlookupall(recordset_type record, ldns_rr_type rrtype, ldns_rr* templ
         }
     }
     if (i<record->nitemsets) {
-        *rrs = ldns_rr_list_new();
+        if(rrs)
+            *rrs = ldns_rr_list_new();
         if(template == NULL) {
             if(record->itemsets[i].nitems > 0) {
                 if(rrs) {
+                    items = itemsetexpand(record, &record->itemsets[i]);
                     for(j=0; j<record->itemsets[i].nitems; j++) {
-                        assert(record->itemsets[i].items[j].rr);
-                        ldns_rr_list_push_rr(*rrs, record->itemsets[i].items[j].rr);
+                        assert(items[j]);
+                        ldns_rr_list_push_rr(*rrs, items[j]);
                     }
+                    free(items);
                 }
                 if(rrsigs && record->itemsets[i].signatures) {
-                    for(j=0; j<record->itemsets[i].signatures->nsigs; j++) {
-                        ++nrrsigs;
-                        *rrsigs = realloc(*rrsigs, sizeof(struct signature_struct*) * nrrsigs);
-                        (*rrsigs)[nrrsigs-1] = &record->itemsets[i].signatures->sigs[j];
-                    }
+                    owner = recordowner(record);
+                    signaturesexpand(record->itemsets[i].signatures, owner, record->itemsets[i].rrclass, rrsigs, &nrrsigs);
+                    ldns_rdf_deep_free(owner);
                 }
             }
         } else {
-            for(j=0; j<record->itemsets[i].nitems; j++)
-                if(!ldns_rr_compare(template, record->itemsets[i].items[j].rr))
-                    break;
-            if (j<record->itemsets[i].nitems) {
+            packed = rdatapack(template, NULL);
+            pos = itemfind(&record->itemsets[i], template, packed);
+            free(packed);
+            if (pos >= 0) {
                 if(rrs) {
-                    assert(record->itemsets[i].items[j].rr);
-                    ldns_rr_list_push_rr(*rrs, record->itemsets[i].items[j].rr);
+                    owner = recordowner(record);
+                    ldns_rr_list_push_rr(*rrs, rdataexpand(owner, record->itemsets[i].rrtype, record->itemsets[i].rrclass, record->itemsets[i].ttl, &record->itemsets[i].rdata[pos]));
+                    ldns_rdf_deep_free(owner);
                 }
             }
         }
     } else {
         if(rrtype == LDNS_RR_TYPE_NSEC || rrtype == LDNS_RR_TYPE_NSEC3) {
-            if(rrs)
-                *rrs = ldns_rr_list_new();
             if(rrs) {
+                *rrs = ldns_rr_list_new();
                 assert(record->spanhashrr);
-                ldns_rr_list_push_rr(*rrs, record->spanhashrr);
+                ldns_rr_list_push_rr(*rrs, ldns_rr_clone(record->spanhashrr));
+            }
+            if(rrsigs && record->spansignatures) {
+                owner = denialowner(record);
+                signaturesexpand(record->spansignatures, owner, (record->spanhashrr ? ldns_rr_get_class(record->spanhashrr) : LDNS_RR_CLASS_IN), rrsigs, &nrrsigs);
+                ldns_rdf_deep_free(owner);
             }
-            if(record->spansignatures)
-                for(j=0; j<record->spansignatures->nsigs; j++) {
-                    ++nrrsigs;
-                    *rrsigs = realloc(*rrsigs, sizeof(struct signature_struct*) * nrrsigs);
-                    (*rrsigs)[nrrsigs-1] = &record->spansignatures->sigs[j];
-                }
         }
     }
   }
     if(rrsigs) {
         ++nrrsigs;
-        *rrsigs = realloc(*rrsigs, sizeof(struct signature_struct*) * nrrsigs);
+        CHECKALLOC(*rrsigs = realloc(*rrsigs, sizeof(struct signature_struct*) * nrrsigs));
         (*rrsigs)[nrrsigs-1] = NULL;
     }
 }
@@ -55,40 +55,95 @@
 
 /* sample data */
 /*curl --data '{"apiversion": "20171113", "correlation": "CURL test", "entities": [{"name": "zone.co.uk", "type": "A", "ttl": "600", "rdata": "1.1.1.1", "class": "IN"}]}' localhost:8888/api/v1/changedelegation/co.uk/zone.co.uk*/
+/* or with the rdata in base64 encoded wire format */
+/*curl --data '{"apiversion": "20171113", "correlation": "CURL test", "entities": [{"name": "zone.co.uk", "type": "A", "ttl": 600, "wire": "AQEBAQ==", "class": "IN"}]}' localhost:8888/api/v1/changedelegation/co.uk/zone.co.uk*/
 
-struct rpc *
-rpc_decode_json(const char *url, const char *buf, size_t buflen)
+/* Old style record from presentation format. */
+static ldns_rr *
+decode_text(json_t *rr_owner, json_t *rr_class, json_t *rr_type,
+    json_t *rr_ttl, json_t *rr_rdata, ldns_rdf *origin)
 {
-    json_error_t error;
-    json_t *root = json_loadb(buf, buflen, 0, &error);
-    if (!root) {
-        fprintf(stderr, "error: on line %d: %s\n", error.line, error.text);
+    ldns_rr *rr;
+    char rr_buf[RR_BUFLEN];
+    char ttl_buf[16];
+    if (json_is_integer(rr_ttl)) {
+        snprintf(ttl_buf, sizeof(ttl_buf), "%lu", (unsigned long) json_integer_value(rr_ttl));
+    }
+    snprintf(rr_buf, RR_BUFLEN, "%s %s %s %s %s",
+        json_string_value(rr_owner),
+        (json_is_integer(rr_ttl) ? ttl_buf : json_string_value(rr_ttl)),
+        json_string_value(rr_class),
+        json_string_value(rr_type),
+        json_string_value(rr_rdata));
+    ldns_rdf *prev_owner = NULL;
+    if (ldns_rr_new_frm_str(&rr, rr_buf, 0, origin, &prev_owner) != LDNS_STATUS_OK) {
+        rr = NULL;
+    }
+    if (prev_owner) ldns_rdf_deep_free(prev_owner);
+    return rr;
+}
+
+/* Record from base64 wire format rdata, the only text parsed is the
+ * owner, which is shared by consecutive records of the same name. */
+static ldns_rr *
+decode_wire(ldns_rdf *owner, json_t *rr_class, json_t *rr_type,
+    json_t *rr_ttl, json_t *rr_wire, uint8_t *wire)
+{
+    ldns_rr *rr;
+    ldns_rr_type type;
+    ldns_rr_class klass;
+    uint32_t ttl;
+    const char *b64;
+    size_t b64len, pos;
+    int rdlen;
+
+    type = ldns_get_rr_type_by_name(json_string_value(rr_type));
+    klass = ldns_get_rr_class_by_name(json_string_value(rr_class));
+    if (type == 0 || klass == 0) {
         return NULL;
     }
-    if (!json_is_object(root)) {
-        printf("root is weird. Is it a dict?\n");
-        json_decref(root);
+    if (json_is_integer(rr_ttl)) {
+        ttl = json_integer_value(rr_ttl);
+    } else {
+        ttl = strtoul(json_string_value(rr_ttl), NULL, 10);
+    }
+    b64 = json_string_value(rr_wire);
+    b64len = strlen(b64);
+    if (ldns_b64_pton_calculate_size(b64len) > LDNS_MAX_RDFLEN) {
         return NULL;
     }
-
-    json_t *obj_version = json_object_get(root, "apiversion");
-    if (!obj_version || !json_is_string(obj_version)) {
-        printf("apiversion not found.\n");
-        json_decref(root);
+    /* ldns_wire2rdf expects the rdata length in front of the rdata */
+    rdlen = (b64len ? ldns_b64_pton(b64, &wire[2], LDNS_MAX_RDFLEN) : 0);
+    if (rdlen < 0) {
         return NULL;
     }
-    json_t *obj_correlation = json_object_get(root, "transaction");
-
-    json_t *obj_entities = json_object_get(root, "entities");
-    if (!obj_entities || !json_is_array(obj_entities)) {
-        printf("entities array not found.\n");
-        json_decref(root);
+    ldns_write_uint16(wire, rdlen);
+    rr = ldns_rr_new();
+    ldns_rr_set_owner(rr, ldns_rdf_clone(owner));
+    ldns_rr_set_type(rr, type);
+    ldns_rr_set_class(rr, klass);
+    ldns_rr_set_ttl(rr, ttl);
+    pos = 0;
+    if (ldns_wire2rdf(rr, wire, rdlen + 2, &pos) != LDNS_STATUS_OK) {
+        ldns_rr_free(rr);
         return NULL;
     }
+    return rr;
+}
 
+/* Convert the JSON entities array to resource records.  Returns the number
+ * of records or -1 on error.  Entities carry their rdata either as
+ * presentation format in "rdata" or as base64 encoded wire format in
+ * "wire". */
+static int
+decode_entities(json_t *obj_entities, ldns_rr ***rrs)
+{
     int err = 0;
     size_t rr_count = json_array_size(obj_entities);
-    ldns_rr **rr = calloc(rr_count, sizeof(ldns_rr *));
+    ldns_rr **rr = calloc(rr_count ? rr_count : 1, sizeof(ldns_rr *));
+    ldns_rdf *owner = NULL;
+    const char *owner_str = NULL;
+    uint8_t *wire = NULL;
     for (size_t i = 0; i < rr_count; i++) {
         json_t *rr_dict = json_array_get(obj_entities, i);
         if (!rr_dict || !json_is_object(rr_dict)) {
@@ -115,60 +170,61 @@ rpc_decode_json(const char *url, const char *buf, size_t buflen)
             break;
         }
         json_t *rr_ttl = json_object_get(rr_dict, "ttl");
-        if (!rr_ttl || !json_is_string(rr_ttl)) {
-            printf("rr_ttl string not found.\n");
+        if (!rr_ttl || !(json_is_string(rr_ttl) || json_is_integer(rr_ttl))) {
+            printf("rr_ttl not found.\n");
             err = 1;
             break;
         }
         json_t *rr_rdata = json_object_get(rr_dict, "rdata");
-        if (!rr_rdata || !json_is_string(rr_rdata)) {
+        json_t *rr_wire = json_object_get(rr_dict, "wire");
+        if (!(rr_rdata && json_is_string(rr_rdata)) && !(rr_wire && json_is_string(rr_wire))) {
             printf("rr_rdata string not found.\n");
             err = 1;
             break;
         }
+        if (!owner_str || strcmp(owner_str, json_string_value(rr_owner))) {
+            if (owner) ldns_rdf_deep_free(owner);
+            owner_str = json_string_value(rr_owner);
+            if (ldns_str2rdf_dname(&owner, owner_str) != LDNS_STATUS_OK) {
+                owner = NULL;
+                err = 1;
+                break;
+            }
+        }
         /* We have enough data to create a ldns_rr */
-        char rr_buf[RR_BUFLEN];
-        snprintf(rr_buf, RR_BUFLEN, "%s %s %s %s %s",
-            json_string_value(rr_owner),
-            json_string_value(rr_ttl),
-            json_string_value(rr_class),
-            json_string_value(rr_type),
-            json_string_value(rr_rdata));
-        ldns_rdf *prev_owner = NULL;
-        if (ldns_rr_new_frm_str (&rr[i], rr_buf, 0,
-            ldns_rdf_new_frm_str(LDNS_RDF_TYPE_DNAME, json_string_value(rr_owner)),
-            &prev_owner) != LDNS_STATUS_OK)
-        {
+        if (rr_wire && json_is_string(rr_wire)) {
+            if (!wire) {
+                CHECKALLOC(wire = malloc(LDNS_MAX_RDFLEN + 2));
+            }
+            rr[i] = decode_wire(owner, rr_class, rr_type, rr_ttl, rr_wire, wire);
+        } else {
+            rr[i] = decode_text(rr_owner, rr_class, rr_type, rr_ttl, rr_rdata, owner);
+        }
+        if (!rr[i]) {
             err = 1;
             break;
         }
-        if (prev_owner) ldns_rdf_deep_free(prev_owner);
     }
+    if (owner) ldns_rdf_deep_free(owner);
+    free(wire);
     if (err) {
         for (size_t i = 0; i < rr_count; i++) {
             ldns_rr_free(rr[i]);
         }
         free(rr);
-        return NULL;
-    }
-
-    char *ptr = NULL;
-    char *tok_url = strdup(url);
-    char *api = strtok_r(tok_url, "/", &ptr);
-    char *version = strtok_r(NULL, "/", &ptr);
-    char *opc = strtok_r(NULL, "/", &ptr);
-    char *zone = strtok_r(NULL, "/", &ptr);
-    char *delegation_point = strtok_r(NULL, "/", &ptr);
-    if(!api || !version || !opc || !delegation_point) {
-        printf("url is funky\n");
-        free(tok_url);
-        return NULL;
+        return -1;
     }
+    *rrs = rr;
+    return rr_count;
+}
 
+static struct rpc *
+rpc_create(const char *opc, const char *zone, const char *version,
+    json_t *obj_version, json_t *obj_correlation,
+    const char *delegation_point, ldns_rr **rr, int rr_count)
+{
     struct rpc *rpc = malloc(sizeof(struct rpc));
     if (!rpc) {
-        json_decref(root);
-        free(tok_url);
         return NULL;
     }
     if (!strcmp(opc, "changedelegation")) {
@@ -178,7 +234,6 @@ rpc_decode_json(const char *url, const char *buf, size_t buflen)
     } else {
         printf("unknown RPC\n");
         free(rpc);
-        free(tok_url);
         return NULL;
     }
     rpc->zone = strdup(zone);
@@ -189,12 +244,167 @@ rpc_decode_json(const char *url, const char *buf, size_t buflen)
     rpc->rr_count = rr_count;
     rpc->rr = rr;
     rpc->status = RPC_OK;
+    return rpc;
+}
+
+static void
+free_rrs(ldns_rr **rr, int rr_count)
+{
+    for (int i = 0; i < rr_count; i++) {
+        ldns_rr_free(rr[i]);
+    }
+    free(rr);
+}
+
+struct rpc *
+rpc_decode_json(const char *url, const char *buf, size_t buflen)
+{
+    json_error_t error;
+    json_t *root = json_loadb(buf, buflen, 0, &error);
+    if (!root) {
+        fprintf(stderr, "error: on line %d: %s\n", error.line, error.text);
+        return NULL;
+    }
+    if (!json_is_object(root)) {
+        printf("root is weird. Is it a dict?\n");
+        json_decref(root);
+        return NULL;
+    }
+
+    json_t *obj_version = json_object_get(root, "apiversion");
+    if (!obj_version || !json_is_string(obj_version)) {
+        printf("apiversion not found.\n");
+        json_decref(root);
+        return NULL;
+    }
+    json_t *obj_correlation = json_object_get(root, "transaction");
+
+    json_t *obj_entities = json_object_get(root, "entities");
+    if (!obj_entities || !json_is_array(obj_entities)) {
+        printf("entities array not found.\n");
+        json_decref(root);
+        return NULL;
+    }
+
+    ldns_rr **rr;
+    int rr_count = decode_entities(obj_entities, &rr);
+    if (rr_count < 0) {
+        json_decref(root);
+        return NULL;
+    }
+
+    char *ptr = NULL;
+    char *tok_url = strdup(url);
+    char *api = strtok_r(tok_url, "/", &ptr);
+    char *version = strtok_r(NULL, "/", &ptr);
+    char *opc = strtok_r(NULL, "/", &ptr);
+    char *zone = strtok_r(NULL, "/", &ptr);
+    char *delegation_point = strtok_r(NULL, "/", &ptr);
+    if(!api || !version || !opc || !zone || !delegation_point) {
+        printf("url is funky\n");
+        free_rrs(rr, rr_count);
+        json_decref(root);
+        free(tok_url);
+        return NULL;
+    }
+
+    struct rpc *rpc = rpc_create(opc, zone, version, obj_version,
+        obj_correlation, delegation_point, rr, rr_count);
+    if (!rpc) {
+        free_rrs(rr, rr_count);
+    }
 
     free(tok_url);
     json_decref(root); /* done with the JSON part */
     return rpc;
 }
 
+/* sample batch, each zone is committed all or nothing */
+/*curl --data '{"apiversion": "20171113", "transaction": "CURL test", "changes": [{"zone": "co.uk", "operation": "changedelegation", "name": "zone.co.uk", "entities": [{"name": "zone.co.uk", "type": "NS", "ttl": "600", "rdata": "ns.zone.co.uk.", "class": "IN"}]}]}' localhost:8888/api/v1/batch*/
+
+int
+rpc_isbatch(const char *url)
+{
+    char *ptr = NULL;
+    char *tok_url = strdup(url);
+    char *api = strtok_r(tok_url, "/", &ptr);
+    char *version = strtok_r(NULL, "/", &ptr);
+    char *opc = strtok_r(NULL, "/", &ptr);
+    int isbatch = (api && version && opc && !strcmp(opc, "batch"));
+    free(tok_url);
+    return isbatch;
+}
+
+int
+rpc_decode_json_batch(const char *url, const char *buf, size_t buflen, struct rpc ***rpcs)
+{
+    json_error_t error;
+    json_t *root = json_loadb(buf, buflen, 0, &error);
+    if (!root) {
+        fprintf(stderr, "error: on line %d: %s\n", error.line, error.text);
+        return -1;
+    }
+    json_t *obj_version = json_object_get(root, "apiversion");
+    json_t *obj_changes = json_object_get(root, "changes");
+    if (!json_is_object(root) || !obj_version || !json_is_string(obj_version)
+        || !obj_changes || !json_is_array(obj_changes)) {
+        printf("apiversion or changes array not found.\n");
+        json_decref(root);
+        return -1;
+    }
+    json_t *obj_correlation = json_object_get(root, "transaction");
+
+    char *ptr = NULL;
+    char *tok_url = strdup(url);
+    (void) strtok_r(tok_url, "/", &ptr);
+    char *version = strtok_r(NULL, "/", &ptr);
+
+    int err = 0;
+    int count = json_array_size(obj_changes);
+    struct rpc **rpc;
+    CHECKALLOC(rpc = calloc(count ? count : 1, sizeof(struct rpc *)));
+    for (int i = 0; i < count; i++) {
+        json_t *change = json_array_get(obj_changes, i);
+        json_t *obj_zone = json_object_get(change, "zone");
+        json_t *obj_opc = json_object_get(change, "operation");
+        json_t *obj_name = json_object_get(change, "name");
+        json_t *obj_entities = json_object_get(change, "entities");
+        if (!obj_zone || !json_is_string(obj_zone) || !obj_opc
+            || !json_is_string(obj_opc) || !obj_name
+            || !json_is_string(obj_name) || !obj_entities
+            || !json_is_array(obj_entities)) {
+            printf("change %d is incomplete.\n", i);
+            err = 1;
+            break;
+        }
+        ldns_rr **rr;
+        int rr_count = decode_entities(obj_entities, &rr);
+        if (rr_count < 0) {
+            err = 1;
+            break;
+        }
+        rpc[i] = rpc_create(json_string_value(obj_opc),
+            json_string_value(obj_zone), version, obj_version,
+            obj_correlation, json_string_value(obj_name), rr, rr_count);
+        if (!rpc[i]) {
+            free_rrs(rr, rr_count);
+            err = 1;
+            break;
+        }
+    }
+    free(tok_url);
+    json_decref(root);
+    if (err) {
+        for (int i = 0; i < count; i++) {
+            rpc_destroy(rpc[i]);
+        }
+        free(rpc);
+        return -1;
+    }
+    *rpcs = rpc;
+    return count;
+}
+
 int
 rpc_encode_json(struct rpc *rpc, char **buf, size_t *buflen)
 {
@@ -205,6 +415,31 @@ rpc_encode_json(struct rpc *rpc, char **buf, size_t *buflen)
     return 0;
 }
 
+int
+rpc_encode_json_batch(struct rpc **rpcs, int count, char **buf, size_t *buflen)
+{
+    const char *status;
+    json_t *results = json_array();
+    for (int i = 0; i < count; i++) {
+        switch (rpcs[i]->status) {
+            case RPC_OK: status = "ok"; break;
+            case RPC_RESOURCE_NOT_FOUND: status = "not found"; break;
+            default: status = "error"; break;
+        }
+        json_array_append_new(results, json_pack("{s:s, s:s, s:s}",
+            "zone", rpcs[i]->zone, "name", rpcs[i]->delegation_point,
+            "status", status));
+    }
+    json_t *root = json_pack("{s:o}", "results", results);
+    *buf = json_dumps(root, JSON_COMPACT);
+    json_decref(root);
+    if (!*buf) {
+        return 1;
+    }
+    *buflen = strlen(*buf);
+    return 0;
+}
+
 void
 rpc_destroy(struct rpc *rpc)
 {
@@ -222,3 +457,54 @@ rpc_destroy(struct rpc *rpc)
     free(rpc);
 }
 
+/* GET /api/v1/memory for all zones, /api/v1/memory/<zone> for one zone */
+int
+rpc_ismemory(const char *url, char **zone)
+{
+    char *ptr = NULL;
+    char *tok_url = strdup(url);
+    char *api = strtok_r(tok_url, "/", &ptr);
+    char *version = strtok_r(NULL, "/", &ptr);
+    char *opc = strtok_r(NULL, "/", &ptr);
+    char *zonename = strtok_r(NULL, "/", &ptr);
+    int ismemory = (api && version && opc && !strcmp(opc, "memory"));
+    *zone = (ismemory && zonename ? strdup(zonename) : NULL);
+    free(tok_url);
+    return ismemory;
+}
+
+int
+rpc_encode_json_memory(struct rpc_memory *zones, int count, int perview, char **buf, size_t *buflen)
+{
+    size_t bytes, total = 0;
+    json_t *results = json_array();
+    for (int i = 0; i < count; i++) {
+        json_t *views = json_array();
+        bytes = 0;
+        for (int j = 0; j < STATS_NVIEWS; j++) {
+            struct stats_memory *mem = &zones[i].views[j];
+            bytes += mem->indices + mem->recordsets + mem->signatures + mem->changelog;
+            if (!perview || !mem->view)
+                continue;
+            json_array_append_new(views, json_pack("{s:s, s:I, s:I, s:I, s:I, s:I}",
+                "view", mem->view, "records", (json_int_t) mem->records,
+                "indices", (json_int_t) mem->indices,
+                "recordsets", (json_int_t) mem->recordsets,
+                "signatures", (json_int_t) mem->signatures,
+                "changelog", (json_int_t) mem->changelog));
+        }
+        total += bytes;
+        json_array_append_new(results, json_pack("{s:s, s:I, s:b, s:b, s:o}",
+            "zone", zones[i].zone, "bytes", (json_int_t) bytes,
+            "evicted", zones[i].evicted, "current", zones[i].measured,
+            "views", views));
+    }
+    json_t *root = json_pack("{s:I, s:o}", "bytes", (json_int_t) total, "zones", results);
+    *buf = json_dumps(root, JSON_COMPACT);
+    json_decref(root);
+    if (!*buf) {
+        return 1;
+    }
+    *buflen = strlen(*buf);
+    return 0;
+}
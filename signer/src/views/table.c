@@ -174,6 +174,12 @@ names_tableput(names_table_type table, void* key)
     return (void**) &(node->data);
 }
 
+size_t
+names_tableextend(names_table_type table, size_t valuesize)
+{
+    return sizeof(struct names_table_struct) + sizeof(ldns_rbtree_t) + table->tree->count * (sizeof(ldns_rbnode_t) + valuesize);
+}
+
 names_iterator
 names_tableitems(names_table_type table)
 {
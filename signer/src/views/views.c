@@ -36,8 +36,10 @@
 #include <time.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <ctype.h>
 #include <ldns/ldns.h>
 #include "uthash.h"
 #include "utilities.h"
@@ -70,6 +72,7 @@ struct names_view_struct {
     names_commitlog_type commitlog;
     int nsearchfuncs;
     struct searchfunc* searchfuncs;
+    unsigned int materialized; /* bit set for each index that is populated */
     int nindices;
     names_index_type indices[];
 };
@@ -210,6 +213,100 @@ names_place(names_view_type view, const char* name)
     return content;
 }
 
+/* Write a wire format domain name in the presentation format that
+ * ldns_rdf2str produces, which is how records are keyed by name.
+ * The buffer must hold at least 4 * LDNS_MAX_DOMAINLEN + 2 bytes.
+ */
+static int
+ownername(const ldns_rdf* owner, char* buf)
+{
+    const uint8_t* data = ldns_rdf_data(owner);
+    size_t size = ldns_rdf_size(owner);
+    size_t pos = 0;
+    uint8_t len, i;
+    unsigned char c;
+    if (ldns_rdf_get_type(owner) != LDNS_RDF_TYPE_DNAME || size == 0 || size > LDNS_MAX_DOMAINLEN)
+        return 1;
+    if (size == 1) {
+        strcpy(buf, ".");
+        return 0;
+    }
+    while (pos < size && (len = data[pos]) > 0) {
+        if (pos + 1 + len >= size)
+            return 1;
+        for (i = 0, ++pos; i < len; i++, pos++) {
+            c = data[pos];
+            if (c == '.' || c == ';' || c == '(' || c == ')' || c == '\\') {
+                *buf++ = '\\';
+                *buf++ = c;
+            } else if (!(isascii(c) && isgraph(c))) {
+                buf += sprintf(buf, "\\%03u", c);
+            } else {
+                *buf++ = c;
+            }
+        }
+        *buf++ = '.';
+    }
+    *buf = '\0';
+    return 0;
+}
+
+void*
+names_placeowner(names_view_type view, const ldns_rdf* owner)
+{
+    char name[4 * LDNS_MAX_DOMAINLEN + 2];
+    if (ownername(owner, name))
+        return NULL;
+    return names_place(view, name);
+}
+
+void*
+names_takeowner(names_view_type view, int index, const ldns_rdf* owner)
+{
+    char name[4 * LDNS_MAX_DOMAINLEN + 2];
+    if (ownername(owner, name))
+        return NULL;
+    return names_take(view, index, name);
+}
+
+/* Secondary indices of a view derived from the base view are only
+ * populated when first used.  They reflect the last committed state of
+ * the view, so records changed in the pending changelog are taken in
+ * their original form.
+ */
+static names_index_type
+materialize(names_view_type view, int index)
+{
+    names_iterator iter;
+    names_change_type change;
+    recordset_type record;
+    if(view->materialized & (1U << index))
+        return view->indices[index];
+    for(iter=names_indexiterator(view->indices[0]); names_iterate(&iter, &record); names_advance(&iter, NULL)) {
+        names_indexinsert(view->indices[index], record, NULL);
+    }
+    for(iter=names_tableitems(view->changelog); names_iterate(&iter, &change); names_advance(&iter, NULL)) {
+        if(change->record == change->oldrecord)
+            continue;
+        if(change->record != NULL && names_indexlookup(view->indices[index], change->record) == change->record)
+            names_indexremove(view->indices[index], change->record);
+        if(change->oldrecord != NULL)
+            names_indexinsert(view->indices[index], change->oldrecord, NULL);
+    }
+    view->materialized |= (1U << index);
+    return view->indices[index];
+}
+
+static names_index_type
+materializeindex(names_view_type view, names_index_type index)
+{
+    int i;
+    for(i=0; i<view->nindices; i++)
+        if(view->indices[i] == index)
+            return materialize(view, i);
+    return index;
+}
+
 void*
 names_take(names_view_type view, int index, const char* name)
 {
@@ -218,7 +315,7 @@ names_take(names_view_type view, int index, const char* name)
         assert(view->zonedata.apex);
         name = view->zonedata.apex;
     }
-    found = names_indexlookupkey(view->indices[index], name);
+    found = names_indexlookupkey(materialize(view, index), name);
     return found;
 }
 
@@ -241,7 +338,7 @@ names_viewcreate(names_view_type base, const char* viewname, const char** keynam
     }
     for(i=nindices=0; keynames[i]; i++)
         ++nindices;
-    assert(nindices > 0);
+    assert(nindices > 0 && nindices < (int)sizeof(view->materialized) * 8);
     view = malloc(sizeof(struct names_view_struct)+sizeof(names_index_type)*(nindices));
     view->viewname = (viewname ? strdup(viewname) : NULL);
     view->base = base;
@@ -269,13 +366,11 @@ names_viewcreate(names_view_type base, const char* viewname, const char** keynam
         for(iter=names_indexiterator(base->indices[0]); names_iterate(&iter, &content); names_advance(&iter, NULL)) {
             names_indexinsert(view->indices[0], content, NULL);
         }
-        for(iter=names_indexiterator(view->indices[0]); names_iterate(&iter, &content); names_advance(&iter, NULL)) {
-            for(i=1; i<nindices; i++) {
-                names_indexinsert(view->indices[i], content, NULL);
-            }
-        }
+        view->materialized = 1U;
         view->commitlog = base->commitlog;
     } else {
+        /* the base view starts empty, its indices are kept up to date */
+        view->materialized = ~0U;
         view->commitlog = NULL;
     }
     view->viewid = names_commitlogsubscribe(view, &view->commitlog);
@@ -339,7 +434,7 @@ names_viewvalidate(names_view_type view)
     for(iter=names_indexiterator(view->indices[0]); names_iterate(&iter,&record); names_advance(&iter,NULL)) {
         ++count;
         if(view->viewid == 0) {
-            size += names_recordextend(record);
+            size += names_recordextend(record, NULL);
         }
     }
     if(view->viewid == 0) {
@@ -348,6 +443,10 @@ names_viewvalidate(names_view_type view)
     fprintf(stderr,"view %s contains %d records in primary index%s",view->viewname,count,(view->nindices>1?" in other indices:":""));
     for(i=1; i<view->nindices; i++) {
         count = 0;
+        if(!(view->materialized & (1U << i))) {
+            fprintf(stderr," -");
+            continue;
+        }
         for(iter=names_indexiterator(view->indices[i]); names_iterate(&iter,&record); names_advance(&iter,NULL)) {
             compare = names_indexlookup(view->indices[0], record);
             if(compare == NULL) {
@@ -410,7 +509,9 @@ names_viewiterator(names_view_type view, names_indexrange_func func, ...)
         for(i=0; i<view->nsearchfuncs; i++) {
             if(view->searchfuncs[i].search == func) {
                 va_start(ap, func);
+                materializeindex(view, view->searchfuncs[i].index);
                 if(view->searchfuncs[i].index2 != NULL) {
+                    materializeindex(view, view->searchfuncs[i].index2);
                     iter = view->searchfuncs[i].search(view->searchfuncs[i].index, view->searchfuncs[i].index2, ap);
                 } else {
                     iter = view->searchfuncs[i].search(view->searchfuncs[i].index, ap);
@@ -501,10 +602,70 @@ resetchangelog(names_view_type view)
     view->changelog = newchangelog;
 }
 
+/* Changes replayed into the primary index, to be replayed into the
+ * secondary indices.  These are independent of each other, so with many
+ * changes each secondary index is replayed by its own thread.
+ */
+#define REPLAY_PARALLEL 8192
+
+struct replayentry {
+    recordset_type record;
+    recordset_type existing;
+    int accepted;
+};
+
+struct replaytask {
+    names_index_type index;
+    struct replayentry* entries;
+    int count;
+    pthread_t thread;
+};
+
+static void*
+replayindex(void* arg)
+{
+    int i;
+    recordset_type tmp;
+    struct replaytask* task = arg;
+    for(i=0; i<task->count; i++) {
+        tmp = task->entries[i].existing;
+        names_indexinsert(task->index, (task->entries[i].accepted ? task->entries[i].record : NULL), (tmp ? &tmp : NULL));
+    }
+    return NULL;
+}
+
+static void
+replayindices(names_view_type view, struct replayentry* entries, int count)
+{
+    int i, ntasks, nthreads;
+    struct replaytask tasks[sizeof(view->materialized) * 8];
+    ntasks = 0;
+    for(i=1; i<view->nindices; i++) {
+        if(view->materialized & (1U << i)) {
+            tasks[ntasks].index = view->indices[i];
+            tasks[ntasks].entries = entries;
+            tasks[ntasks].count = count;
+            ++ntasks;
+        }
+    }
+    nthreads = 0;
+    if(count >= REPLAY_PARALLEL) {
+        /* the calling thread takes the last index itself */
+        while(nthreads < ntasks - 1 && !pthread_create(&tasks[nthreads].thread, NULL, replayindex, &tasks[nthreads]))
+            ++nthreads;
+    }
+    for(i=nthreads; i<ntasks; i++)
+        replayindex(&tasks[i]);
+    for(i=0; i<nthreads; i++)
+        pthread_join(tasks[i].thread, NULL);
+}
+
 static int
 updateview(names_view_type view, names_table_type* mychangelog)
 {
     int i, conflict = 0;
+    int nreplay = 0, maxreplay = 0;
+    struct replayentry* replay = NULL;
     names_iterator iter;
     names_change_type change;
     names_table_type changelog;
@@ -531,12 +692,20 @@ updateview(names_view_type view, names_table_type* mychangelog)
             existing = NULL;
             accepted = names_indexinsert(view->indices[0], change->record, &existing);
             logger_message(&names_logcommitlog,logger_noctx,logger_DIAG,"      update %s %s%s%s\n",names_recordgetsummary(change->record,&temp1),(accepted?"accepted":"dropped"),(existing?" replaces ":""),names_recordgetsummary(existing,&temp2));
-            for(i=1; i<view->nindices; i++) {
-                recordset_type tmp = existing;
-                names_indexinsert(view->indices[i], (accepted ? change->record : NULL), (existing ? &tmp : NULL));
+            if(nreplay == maxreplay) {
+                maxreplay = (maxreplay ? maxreplay * 2 : 64);
+                CHECKALLOC(replay = realloc(replay, sizeof(struct replayentry) * maxreplay));
             }
+            replay[nreplay].record = change->record;
+            replay[nreplay].existing = existing;
+            replay[nreplay].accepted = accepted;
+            ++nreplay;
         }
     }
+    if(nreplay > 0) {
+        replayindices(view, replay, nreplay);
+    }
+    free(replay);
     if(!conflict && mychangelog) {
         logger_message(&names_logcommitlog,logger_noctx,logger_DIAG,"  process submit commit log %p into %s\n",(void*)changelog,view->viewname);
         for(iter=names_tableitems(changelog); names_iterate(&iter, &change); names_advance(&iter, NULL)) {
@@ -544,6 +713,8 @@ updateview(names_view_type view, names_table_type* mychangelog)
             logger_message(&names_logcommitlog,logger_noctx,logger_DIAG,"    update %s %s%s\n",names_recordgetsummary(change->record,&temp1),(existing?" replaces ":""),names_recordgetsummary(existing,&temp2));
             for(i=1; i<view->nindices; i++) {
                 existing = change->oldrecord;
+                if(!(view->materialized & (1U << i)))
+                    continue;
                 names_indexinsert(view->indices[i], change->record, &existing);
             }
             if(change->record == NULL) {
@@ -574,6 +745,21 @@ names_viewreset(names_view_type view)
     updateview(view, NULL);
 }
 
+/* Brings a view up to date with the changes committed by other views,
+ * keeping the pending changes of the view unless they conflict.
+ */
+int
+names_viewupdate(names_view_type view)
+{
+    return updateview(view, NULL);
+}
+
+long
+names_viewcommits(names_view_type view)
+{
+    return names_commitlogcommits(view->commitlog);
+}
+
 static void
 persistfn(names_table_type table, marshall_handle store)
 {
@@ -706,6 +892,34 @@ names_dumpviewfull(FILE* fp, names_view_type view)
     marshallclose(marsh);
 }
 
+/* Adds the memory used by a view to the totals in memory.  The records
+ * and the changelogs retained for the other views are only accounted to
+ * the base view as the other views share them.  The view may not be in
+ * use while doing this.
+ */
+void
+names_viewmemory(names_view_type view, struct stats_memory* memory)
+{
+    int i;
+    size_t signatures;
+    names_iterator iter;
+    recordset_type record;
+    memory->records += view->indices[0]->tree->count;
+    memory->indices += sizeof(struct names_view_struct) + sizeof(names_index_type) * view->nindices;
+    for(i=0; i<view->nindices; i++) {
+        memory->indices += sizeof(struct names_index_struct) + sizeof(ldns_rbtree_t);
+        memory->indices += view->indices[i]->tree->count * sizeof(ldns_rbnode_t);
+    }
+    memory->changelog += names_tableextend(view->changelog, sizeof(struct names_change_struct));
+    if(view->base == NULL || view->base == view) {
+        for(iter=names_indexiterator(view->indices[0]); names_iterate(&iter,&record); names_advance(&iter,NULL)) {
+            signatures = 0;
+            memory->recordsets += names_recordextend(record, &signatures) - signatures;
+            memory->signatures += signatures;
+        }
+        memory->changelog += names_commitlogextend(view->commitlog, sizeof(struct names_change_struct));
+    }
+}
 
 void
 names_dumpviewinfo(FILE* fp, names_view_type view)
@@ -717,6 +931,7 @@ names_dumpviewinfo(FILE* fp, names_view_type view)
     ldns_rr_list* rrs;
     ldns_rr_list* rrs2;
     ldns_rr* rr;
+    struct stats_memory memory;
         count = 0;
         rrs = ldns_rr_list_new();
         for(iter = names_viewiterator(view, NULL); names_iterate(&iter,&record); names_advance(&iter,NULL)) {
@@ -725,15 +940,19 @@ names_dumpviewinfo(FILE* fp, names_view_type view)
             ldns_rr_list_push_rr_list(rrs,rrs2);
             ldns_rr_list_free(rrs2);
         }
-        fprintf(stderr,"  %-10.10s :%7d   ",view->viewname,count);
+        memset(&memory, 0, sizeof(memory));
+        names_viewmemory(view, &memory);
+        fprintf(stderr,"  %-10.10s :%7d %9lu ",view->viewname,count,
+                (unsigned long)((memory.indices+memory.recordsets+memory.signatures+memory.changelog)/1024));
         record = names_take(view, 0, NULL);
         if(record) {
             while((rr = ldns_rr_list_pop_rr(rrs))) {
                 serial = ldns_rdf2native_int32(ldns_rr_rdf(rr, 2));
                 fprintf(stderr," %d",(int)serial);
+                ldns_rr_free(rr);
             }
-            ldns_rr_list_free(rrs);
         }
+        ldns_rr_list_deep_free(rrs);
         fprintf(stderr,"\n");
 }
 
@@ -757,7 +976,7 @@ names__dumpindex(FILE* fp, names_index_type index)
 void
 names_dumpindex(FILE* fp, names_view_type view, int index)
 {
-    names__dumpindex(fp, view->indices[index]);
+    names__dumpindex(fp, materialize(view, index));
 }
 
 void
@@ -784,12 +1003,14 @@ names_viewlookupall(names_view_type view, ldns_rdf* dname, ldns_rr_type type, ld
         names_recordlookupall(record, type, NULL, rrs, &rrsigs);
         for(int i=0; rrsigs[i]; i++) {
             rrsig = rrsigs[i]->rr;
+            rrsigs[i]->rr = NULL;
             ldns_rr_list_push_rr(*signatures, rrsig);
         }
-        free(rrsigs);
+        names_recordfreesignatures(rrsigs);
     } else {
-        *rrs = NULL;
-        *rrsigs = NULL;
+        if(rrs)
+            *rrs = NULL;
+        *signatures = NULL;
     }
     if(name)
         free(name);
@@ -94,6 +94,8 @@ query_reset(query_type* q, size_t maxlen, int is_tcp)
     q->tcp = is_tcp;
     /* qname, qtype, qclass */
     q->zone = NULL;
+    q->relay = 0;
+    q->relayed = 0;
     /* domain, opcode, cname count, delegation, compression, temp */
     q->axfr_is_done = 0;
     if (q->axfr_fd) {
@@ -492,10 +494,12 @@ response_encode_rrset(query_type* q, ldns_rr_list* rrs, ldns_rr_list* rrsigs, ld
 
     while((rr = ldns_rr_list_pop_rr(rrs))) {
         added += response_encode_rr(q, rr, section);
+        ldns_rr_free(rr);
     }
     if (q->edns_rr && q->edns_rr->dnssec_ok) {
         while((rr = ldns_rr_list_pop_rr(rrsigs))) {
             added += response_encode_rr(q, rr, section);
+            ldns_rr_free(rr);
         }
     }
     /* truncation? */
@@ -536,10 +540,10 @@ query_response(names_view_type view, query_type* q, ldns_rr_type qtype)
     if (!q || !q->zone) {
         return QUERY_DISCARDED;
     }
-    r.answersection = ldns_rr_list_new();
-    r.answersectionsigs = ldns_rr_list_new();
-    r.authoritysection = ldns_rr_list_new();
-    r.authoritysectionsigs = ldns_rr_list_new();
+    r.answersection = NULL;
+    r.answersectionsigs = NULL;
+    r.authoritysection = NULL;
+    r.authoritysectionsigs = NULL;
     r.additionalsection = ldns_rr_list_new();
     r.additionalsectionsigs =  ldns_rr_list_new();
     names_viewlookupall(view, NULL, qtype, &r.answersection, &r.answersectionsigs);
@@ -550,6 +554,9 @@ query_response(names_view_type view, query_type* q, ldns_rr_type qtype)
     } else if (qtype != LDNS_RR_TYPE_SOA) {
         names_viewlookupall(view, NULL, LDNS_RR_TYPE_SOA, &r.authoritysection, &r.authoritysectionsigs);
     } else {
+        ldns_rr_list_deep_free(r.answersectionsigs);
+        ldns_rr_list_deep_free(r.additionalsection);
+        ldns_rr_list_deep_free(r.additionalsectionsigs);
         return query_servfail(q);
     }
     response_encode(q, &r);
@@ -557,8 +564,8 @@ query_response(names_view_type view, query_type* q, ldns_rr_type qtype)
     ldns_rr_list_deep_free(r.answersectionsigs);
     ldns_rr_list_deep_free(r.authoritysection);
     ldns_rr_list_deep_free(r.authoritysectionsigs);
-    ldns_rr_list_deep_free(r.answersection);
-    ldns_rr_list_deep_free(r.answersectionsigs);
+    ldns_rr_list_deep_free(r.additionalsection);
+    ldns_rr_list_deep_free(r.additionalsectionsigs);
     /* compression */
     return QUERY_PROCESSED;
 }
@@ -835,6 +842,20 @@ query_process(query_type* q, engine_type* engine)
         ods_log_debug("[%s] no RRset in query section, ignoring", query_str);
         return QUERY_DISCARDED; /* no RRset in query */
     }
+    /* steer queries for zones of other instances to their owner, unless
+       it was handed to us already */
+    if (engine->zonelist->instances > 1 && !q->relayed) {
+        char *zn = ldns_rdf2str(ldns_rr_owner(rr));
+        if (zn && !zonelist_owns(engine->zonelist, zn)) {
+            q->relay = util_instance_of(zn, engine->zonelist->instances);
+            ods_log_deeebug("[%s] relay query for zone %s to instance %d",
+                query_str, zn, q->relay);
+            free(zn);
+            ldns_pkt_free(pkt);
+            return QUERY_RELAY;
+        }
+        free(zn);
+    }
     pthread_mutex_lock(&engine->zonelist->zl_lock);
     /* we can just lookup the zone, because we will only handle SOA queries,
        zone transfers, updates and notifies */
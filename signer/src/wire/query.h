@@ -47,7 +47,8 @@ enum query_enum {
         QUERY_PROCESSED = 0,
         QUERY_DISCARDED,
         QUERY_AXFR,
-        QUERY_IXFR
+        QUERY_IXFR,
+        QUERY_RELAY
 };
 typedef enum query_enum query_state;
 
@@ -75,6 +76,8 @@ struct query_struct {
 
     /* Zone */
     zone_type* zone;
+    /* Instance owning the zone, if QUERY_RELAY */
+    int relay;
     /* Compression */
 
     /* AXFR IXFR */
@@ -86,6 +89,7 @@ struct query_struct {
     unsigned tsig_prepare_it : 1;
     unsigned tsig_update_it : 1;
     unsigned tsig_sign_it : 1;
+    unsigned relayed : 1;
 };
 
 /**
@@ -32,6 +32,7 @@
 #include "config.h"
 #include "daemon/engine.h"
 #include "log.h"
+#include "util.h"
 #include "signer/zone.h"
 #include "wire/axfr.h"
 #include "wire/netio.h"
@@ -41,12 +42,31 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <ldns/ldns.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 #define SOCK_TCP_BACKLOG 5
 
 static const char* sock_str = "socket";
 
+/**
+ * Header of a query handed to the instance owning its zone.  The query
+ * packet follows, a tcp connection is passed along as descriptor.  The
+ * client address in it is trusted for access control, the relay socket is
+ * therefore only accessible to the user the instances run as.
+ *
+ */
+struct sock_relay_hdr {
+    int udp; /* udp socket to answer from, -1 for tcp */
+    socklen_t addrlen;
+    struct sockaddr_storage addr;
+};
+
+static void sock_handle_tcp_query(netio_type* netio,
+    netio_handler_type* handler);
+
 
 /**
  * Set udp socket to non-blocking and bind.
@@ -125,6 +145,31 @@ sock_tcp_reuseaddr(sock_type* sock, const char* node, const char* port,
 }
 
 
+/**
+ * Share socket with the other signer instances.
+ *
+ */
+static void
+sock_reuseport(sock_type* sock, const char* node, const char* port,
+    const char* stype, const char* fam)
+{
+#ifdef SO_REUSEPORT
+    int on = 1;
+    ods_log_assert(sock);
+    ods_log_assert(port);
+    if (setsockopt(sock->s, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+        ods_log_error("[%s] unable to set %s/%s socket '%s:%s' to "
+            "reuse-port: setsockopt() failed (%s)", sock_str, stype, fam,
+            node?node:"localhost", port, strerror(errno));
+    }
+#else
+    ods_log_warning("[%s] unable to share %s/%s socket '%s:%s' between "
+        "instances: no SO_REUSEPORT", sock_str, stype, fam,
+        node?node:"localhost", port);
+#endif
+}
+
+
 /**
  * Listen on tcp socket.
  *
@@ -152,7 +197,7 @@ sock_tcp_listen(sock_type* sock, const char* node, const char* port,
  */
 static ods_status
 sock_server_udp(sock_type* sock, const char* node, const char* port,
-    unsigned* ip6_support)
+    unsigned* ip6_support, int reuseport)
 {
     int on = 0;
     ods_status status = ODS_STATUS_OK;
@@ -176,6 +221,9 @@ sock_server_udp(sock_type* sock, const char* node, const char* port,
     }
     /* ipv4 */
     if (sock->addr->ai_family == AF_INET) {
+        if (reuseport) {
+            sock_reuseport(sock, node, port, "udp", "ipv4");
+        }
         status = sock_fcntl_and_bind(sock, node, port, "udp", "ipv4");
     }
     /* ipv6 */
@@ -184,6 +232,9 @@ sock_server_udp(sock_type* sock, const char* node, const char* port,
         if (status != ODS_STATUS_OK) {
             return status;
         }
+        if (reuseport) {
+            sock_reuseport(sock, node, port, "udp", "ipv6");
+        }
         status = sock_fcntl_and_bind(sock, node, port, "udp", "ipv6");
     }
     return status;
@@ -196,7 +247,7 @@ sock_server_udp(sock_type* sock, const char* node, const char* port,
  */
 static ods_status
 sock_server_tcp(sock_type* sock, const char* node, const char* port,
-    unsigned* ip6_support)
+    unsigned* ip6_support, int reuseport)
 {
     int on = 0;
     ods_status status = ODS_STATUS_OK;
@@ -221,6 +272,9 @@ sock_server_tcp(sock_type* sock, const char* node, const char* port,
     /* ipv4 */
     if (sock->addr->ai_family == AF_INET) {
         sock_tcp_reuseaddr(sock, node, port, on, "ipv4");
+        if (reuseport) {
+            sock_reuseport(sock, node, port, "tcp", "ipv4");
+        }
         status = sock_fcntl_and_bind(sock, node, port, "tcp", "ipv4");
         if (status == ODS_STATUS_OK) {
             status = sock_tcp_listen(sock, node, port, "ipv4");
@@ -233,6 +287,9 @@ sock_server_tcp(sock_type* sock, const char* node, const char* port,
             return status;
         }
         sock_tcp_reuseaddr(sock, node, port, on, "ipv6");
+        if (reuseport) {
+            sock_reuseport(sock, node, port, "tcp", "ipv6");
+        }
         status = sock_fcntl_and_bind(sock, node, port, "tcp", "ipv6");
         if (status == ODS_STATUS_OK) {
             status = sock_tcp_listen(sock, node, port, "ipv6");
@@ -248,7 +305,7 @@ sock_server_tcp(sock_type* sock, const char* node, const char* port,
  */
 static ods_status
 socket_listen(sock_type* sock, struct addrinfo hints, int socktype,
-    const char* node, const char* port, unsigned* ip6_support)
+    const char* node, const char* port, unsigned* ip6_support, int reuseport)
 {
     ods_status status = ODS_STATUS_OK;
     int r = 0;
@@ -274,9 +331,9 @@ socket_listen(sock_type* sock, struct addrinfo hints, int socktype,
     }
     /* socket */
     if (socktype == SOCK_DGRAM) {
-        status = sock_server_udp(sock, node, port, ip6_support);
+        status = sock_server_udp(sock, node, port, ip6_support, reuseport);
     } else if (socktype == SOCK_STREAM) {
-        status = sock_server_tcp(sock, node, port, ip6_support);
+        status = sock_server_tcp(sock, node, port, ip6_support, reuseport);
     }
     ods_log_debug("[%s] socket listening to %s:%s", sock_str,
         node?node:"localhost", port);
@@ -289,7 +346,7 @@ socket_listen(sock_type* sock, struct addrinfo hints, int socktype,
  *
  */
 ods_status
-sock_listen(socklist_type* sockets, listener_type* listener)
+sock_listen(socklist_type* sockets, listener_type* listener, int reuseport)
 {
     ods_status status = ODS_STATUS_OK;
     struct addrinfo hints[MAX_INTERFACES];
@@ -309,6 +366,10 @@ sock_listen(socklist_type* sockets, listener_type* listener)
         sockets->udp[i].s = -1;
         sockets->tcp[i].s = -1;
     }
+    sockets->relay = -1;
+    sockets->instance = 0;
+    sockets->instances = 0;
+    sockets->relaynames = NULL;
     /* Walk interfaces */
     for (i=0; i < listener->count; i++) {
         node = NULL;
@@ -326,7 +387,7 @@ sock_listen(socklist_type* sockets, listener_type* listener)
         }
         /* udp */
         status = socket_listen(&sockets->udp[i], hints[i], SOCK_DGRAM,
-            node, port, &ip6_support);
+            node, port, &ip6_support, reuseport);
         if (status != ODS_STATUS_OK) {
             if (!ip6_support) {
                 ods_log_warning("[%s] fallback to udp/ipv4, no udp/ipv6: "
@@ -338,7 +399,7 @@ sock_listen(socklist_type* sockets, listener_type* listener)
         }
         /* tcp */
         status = socket_listen(&sockets->tcp[i], hints[i], SOCK_STREAM,
-            node, port, &ip6_support);
+            node, port, &ip6_support, reuseport);
         if (status != ODS_STATUS_OK) {
             if (!ip6_support) {
                 ods_log_warning("[%s] fallback to udp/ipv4, no udp/ipv6: "
@@ -355,6 +416,122 @@ sock_listen(socklist_type* sockets, listener_type* listener)
 }
 
 
+/**
+ * Create the socket other instances hand queries over on.
+ *
+ */
+ods_status
+sock_relay_listen(socklist_type* sockets, const char* basename,
+    int instance, int instances)
+{
+    struct sockaddr_un addr;
+    char* name = NULL;
+    int i;
+    if (!sockets || !basename || instances <= 1) {
+        return ODS_STATUS_ASSERT_ERR;
+    }
+    CHECKALLOC(sockets->relaynames = (char**) calloc(instances, sizeof(char*)));
+    sockets->instance = instance;
+    sockets->instances = instances;
+    for (i = 0; i < instances; i++) {
+        name = util_instance_file(basename, i);
+        if (!name || asprintf(&sockets->relaynames[i], "%s.relay", name) < 0) {
+            free(name);
+            return ODS_STATUS_MALLOC_ERR;
+        }
+        free(name);
+    }
+    if ((sockets->relay = socket(AF_UNIX, SOCK_DGRAM, 0)) == -1) {
+        ods_log_error("[%s] unable to create relay socket: socket() failed "
+            "(%s)", sock_str, strerror(errno));
+        return ODS_STATUS_SOCK_SOCKET_UDP;
+    }
+    if (fcntl(sockets->relay, F_SETFL, O_NONBLOCK) == -1) {
+        ods_log_error("[%s] unable to set relay socket to non-blocking: "
+            "fcntl() failed (%s)", sock_str, strerror(errno));
+        return ODS_STATUS_SOCK_FCNTL_NONBLOCK;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, sockets->relaynames[instance],
+        sizeof(addr.sun_path) - 1);
+    (void)unlink(sockets->relaynames[instance]);
+    if (bind(sockets->relay, (struct sockaddr*) &addr, sizeof(addr)) != 0) {
+        ods_log_error("[%s] unable to bind relay socket %s: bind() failed "
+            "(%s)", sock_str, sockets->relaynames[instance], strerror(errno));
+        return ODS_STATUS_SOCK_BIND;
+    }
+    if (chmod(sockets->relaynames[instance], S_IRUSR|S_IWUSR) != 0) {
+        ods_log_error("[%s] unable to restrict relay socket %s: chmod() "
+            "failed (%s)", sock_str, sockets->relaynames[instance],
+            strerror(errno));
+        return ODS_STATUS_SOCK_BIND;
+    }
+    ods_log_debug("[%s] relay socket listening to %s", sock_str,
+        sockets->relaynames[instance]);
+    return ODS_STATUS_OK;
+}
+
+
+/**
+ * Hand query over to the instance owning its zone.
+ *
+ */
+static void
+sock_relay(socklist_type* sockets, query_type* q, int udp, int fd)
+{
+    struct sock_relay_hdr hdr;
+    struct sockaddr_un peer;
+    struct iovec iov[2];
+    struct msghdr msg;
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct cmsghdr* cmsg;
+    if (!sockets || sockets->relay == -1 || q->relay < 0 ||
+        q->relay >= sockets->instances) {
+        ods_log_error("[%s] unable to relay query to instance %d: no relay",
+            sock_str, q->relay);
+        return;
+    }
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.udp = udp;
+    hdr.addrlen = q->addrlen;
+    memcpy(&hdr.addr, &q->addr, q->addrlen);
+    memset(&peer, 0, sizeof(peer));
+    peer.sun_family = AF_UNIX;
+    strncpy(peer.sun_path, sockets->relaynames[q->relay],
+        sizeof(peer.sun_path) - 1);
+    iov[0].iov_base = &hdr;
+    iov[0].iov_len = sizeof(hdr);
+    iov[1].iov_base = buffer_begin(q->buffer);
+    iov[1].iov_len = buffer_limit(q->buffer);
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &peer;
+    msg.msg_namelen = sizeof(peer);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    if (fd != -1) {
+        memset(&control, 0, sizeof(control));
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+    if (sendmsg(sockets->relay, &msg, 0) == -1) {
+        ods_log_error("[%s] unable to relay query to instance %d: sendmsg() "
+            "failed (%s)", sock_str, q->relay, strerror(errno));
+    } else {
+        ods_log_deeebug("[%s] relayed %s query to instance %d", sock_str,
+            fd != -1 ? "tcp" : "udp", q->relay);
+    }
+}
+
+
 /**
  * Send data over udp.
  *
@@ -380,6 +557,26 @@ send_udp(struct udp_data* data, query_type* q)
 }
 
 
+/**
+ * Answer a udp query, or hand it over to the instance owning its zone.
+ *
+ */
+static void
+sock_handle_udp_query(struct udp_data* data, query_type* q)
+{
+    socklist_type* sockets = data->engine->dnshandler->socklist;
+    query_state qstate = query_process(q, data->engine);
+    if (qstate == QUERY_RELAY) {
+        sock_relay(sockets, q, (int) (data->socket - sockets->udp), -1);
+    } else if (qstate != QUERY_DISCARDED) {
+        ods_log_debug("[%s] query processed qstate=%d", sock_str, qstate);
+        query_add_optional(q, data->engine);
+        buffer_flip(q->buffer);
+        send_udp(data, q);
+    }
+}
+
+
 /**
  * Handle incoming udp queries.
  *
@@ -391,7 +588,6 @@ sock_handle_udp(netio_type* ATTR_UNUSED(netio), netio_handler_type* handler,
     struct udp_data* data = (struct udp_data*) handler->user_data;
     int received = 0;
     query_type* q = data->query;
-    query_state qstate = QUERY_PROCESSED;
 
     if (!(event_types & NETIO_EVENT_READ)) {
         return;
@@ -410,13 +606,7 @@ sock_handle_udp(netio_type* ATTR_UNUSED(netio), netio_handler_type* handler,
     }
     buffer_skip(q->buffer, received);
     buffer_flip(q->buffer);
-    qstate = query_process(q, data->engine);
-    if (qstate != QUERY_DISCARDED) {
-        ods_log_debug("[%s] query processed qstate=%d", sock_str, qstate);
-        query_add_optional(q, data->engine);
-        buffer_flip(q->buffer);
-        send_udp(data, q);
-    }
+    sock_handle_udp_query(data, q);
 }
 
 
@@ -437,6 +627,43 @@ cleanup_tcp_handler(netio_type* netio, netio_handler_type* handler)
 }
 
 
+/**
+ * Set up handler for a tcp connection.
+ *
+ */
+static netio_handler_type*
+sock_tcp_handler(netio_type* netio, engine_type* engine,
+    struct tcp_accept_data* accept_data, int s,
+    struct sockaddr_storage* addr, socklen_t addrlen)
+{
+    struct tcp_data* tcp_data = NULL;
+    netio_handler_type* tcp_handler = NULL;
+    /* create tcp handler data */
+    CHECKALLOC(tcp_data = (struct tcp_data*) malloc(sizeof(struct tcp_data)));
+    tcp_data->query = query_create();
+    tcp_data->engine = engine;
+    tcp_data->tcp_accept_handler_count =
+        accept_data ? accept_data->tcp_accept_handler_count : 0;
+    tcp_data->tcp_accept_handlers =
+        accept_data ? accept_data->tcp_accept_handlers : NULL;
+    tcp_data->qstate = QUERY_PROCESSED;
+    tcp_data->bytes_transmitted = 0;
+    memcpy(&tcp_data->query->addr, addr, addrlen);
+    tcp_data->query->addrlen = addrlen;
+    CHECKALLOC(tcp_handler = (netio_handler_type*) malloc(sizeof(netio_handler_type)));
+    tcp_handler->fd = s;
+    CHECKALLOC(tcp_handler->timeout = (struct timespec*) malloc(sizeof(struct timespec)));
+    tcp_handler->timeout->tv_sec = XFRD_TCP_TIMEOUT;
+    tcp_handler->timeout->tv_nsec = 0L;
+    timespec_add(tcp_handler->timeout, netio_current_time(netio));
+    tcp_handler->user_data = tcp_data;
+    tcp_handler->event_types = NETIO_EVENT_READ | NETIO_EVENT_TIMEOUT;
+    tcp_handler->event_handler = sock_handle_tcp_read;
+    netio_add_handler(netio, tcp_handler);
+    return tcp_handler;
+}
+
+
 /**
  * Handle incoming tcp connections.
  *
@@ -448,8 +675,6 @@ sock_handle_tcp_accept(netio_type* netio, netio_handler_type* handler,
     struct tcp_accept_data* accept_data = (struct tcp_accept_data*)
         handler->user_data;
     int s = 0;
-    struct tcp_data* tcp_data = NULL;
-    netio_handler_type* tcp_handler = NULL;
     struct sockaddr_storage addr;
     socklen_t addrlen = 0;
     if (!(event_types & NETIO_EVENT_READ)) {
@@ -471,27 +696,8 @@ sock_handle_tcp_accept(netio_type* netio, netio_handler_type* handler,
         close(s);
         return;
     }
-    /* create tcp handler data */
-    CHECKALLOC(tcp_data = (struct tcp_data*) malloc(sizeof(struct tcp_data)));
-    tcp_data->query = query_create();
-    tcp_data->engine = accept_data->engine;
-    tcp_data->tcp_accept_handler_count =
-        accept_data->tcp_accept_handler_count;
-    tcp_data->tcp_accept_handlers = accept_data->tcp_accept_handlers;
-    tcp_data->qstate = QUERY_PROCESSED;
-    tcp_data->bytes_transmitted = 0;
-    memcpy(&tcp_data->query->addr, &addr, addrlen);
-    tcp_data->query->addrlen = addrlen;
-    CHECKALLOC(tcp_handler = (netio_handler_type*) malloc(sizeof(netio_handler_type)));
-    tcp_handler->fd = s;
-    CHECKALLOC(tcp_handler->timeout = (struct timespec*) malloc(sizeof(struct timespec)));
-    tcp_handler->timeout->tv_sec = XFRD_TCP_TIMEOUT;
-    tcp_handler->timeout->tv_nsec = 0L;
-    timespec_add(tcp_handler->timeout, netio_current_time(netio));
-    tcp_handler->user_data = tcp_data;
-    tcp_handler->event_types = NETIO_EVENT_READ | NETIO_EVENT_TIMEOUT;
-    tcp_handler->event_handler = sock_handle_tcp_read;
-    netio_add_handler(netio, tcp_handler);
+    (void) sock_tcp_handler(netio, accept_data->engine, accept_data, s,
+        &addr, addrlen);
 }
 
 
@@ -505,7 +711,6 @@ sock_handle_tcp_read(netio_type* netio, netio_handler_type* handler,
 {
     struct tcp_data* data = (struct tcp_data *) handler->user_data;
     ssize_t received = 0;
-    query_state qstate = QUERY_PROCESSED;
 
     if (event_types & NETIO_EVENT_TIMEOUT) {
         cleanup_tcp_handler(netio, handler);
@@ -597,7 +802,28 @@ sock_handle_tcp_read(netio_type* netio, netio_handler_type* handler,
         data->query->tcplen);
     /* we have a complete query, process it. */
     buffer_flip(data->query->buffer);
+    sock_handle_tcp_query(netio, handler);
+}
+
+
+/**
+ * Answer a complete tcp query, or hand the connection over to the
+ * instance owning its zone.
+ *
+ */
+static void
+sock_handle_tcp_query(netio_type* netio, netio_handler_type* handler)
+{
+    struct tcp_data* data = (struct tcp_data *) handler->user_data;
+    query_state qstate = QUERY_PROCESSED;
+
     qstate = query_process(data->query, data->engine);
+    if (qstate == QUERY_RELAY) {
+        sock_relay(data->engine->dnshandler->socklist, data->query, -1,
+            handler->fd);
+        cleanup_tcp_handler(netio, handler);
+        return;
+    }
     if (qstate == QUERY_DISCARDED) {
         cleanup_tcp_handler(netio, handler);
         return;
@@ -732,3 +958,102 @@ sock_handle_tcp_write(netio_type* netio, netio_handler_type* handler,
     handler->event_types = NETIO_EVENT_READ | NETIO_EVENT_TIMEOUT;
     handler->event_handler = sock_handle_tcp_read;
 }
+
+
+/**
+ * Handle queries handed over by other instances.
+ *
+ */
+void
+sock_handle_relay(netio_type* netio, netio_handler_type* handler,
+    netio_events_type event_types)
+{
+    struct relay_data* data = (struct relay_data*) handler->user_data;
+    struct sock_relay_hdr hdr;
+    struct iovec iov[2];
+    struct msghdr msg;
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct cmsghdr* cmsg;
+    query_type* q = data->query;
+    netio_handler_type* tcp_handler = NULL;
+    struct tcp_data* tcp_data = NULL;
+    struct udp_data udp_data;
+    ssize_t received = 0;
+    int fd = -1;
+
+    if (!(event_types & NETIO_EVENT_READ)) {
+        return;
+    }
+    /* a relayed tcp query may be as large as a tcp message */
+    query_reset(q, TCP_MAX_MESSAGE_LEN, 0);
+    iov[0].iov_base = &hdr;
+    iov[0].iov_len = sizeof(hdr);
+    iov[1].iov_base = buffer_begin(q->buffer);
+    iov[1].iov_len = buffer_capacity(q->buffer);
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    received = recvmsg(handler->fd, &msg, 0);
+    if (received == -1) {
+        if (errno != EAGAIN && errno != EINTR) {
+            ods_log_error("[%s] recvmsg() failed: %s", sock_str,
+                strerror(errno));
+        }
+        return;
+    }
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+    received -= sizeof(hdr);
+    if ((msg.msg_flags & (MSG_TRUNC|MSG_CTRUNC)) ||
+        received < 1 || hdr.addrlen > sizeof(hdr.addr) ||
+        (fd == -1 && (hdr.udp < 0 || hdr.udp >= MAX_INTERFACES ||
+        data->socklist->udp[hdr.udp].s == -1))) {
+        ods_log_warning("[%s] drop relayed query: bad message", sock_str);
+        if (fd != -1) {
+            close(fd);
+        }
+        return;
+    }
+    ods_log_debug("[%s] incoming relayed %s message", sock_str,
+        fd != -1 ? "tcp" : "udp");
+    if (fd == -1) {
+        q->maxlen = UDP_MAX_MESSAGE_LEN;
+        memcpy(&q->addr, &hdr.addr, hdr.addrlen);
+        q->addrlen = hdr.addrlen;
+        q->relayed = 1;
+        buffer_skip(q->buffer, received);
+        buffer_flip(q->buffer);
+        udp_data.engine = data->engine;
+        udp_data.socket = &data->socklist->udp[hdr.udp];
+        udp_data.query = q;
+        sock_handle_udp_query(&udp_data, q);
+        return;
+    }
+    /* take over the connection, continuing with the query it carried */
+    if (fcntl(fd, F_SETFL, O_NONBLOCK) == -1) {
+        ods_log_error("[%s] unable to handle relayed tcp connection: "
+            "fcntl() failed: %s", sock_str, strerror(errno));
+        close(fd);
+        return;
+    }
+    tcp_handler = sock_tcp_handler(netio, data->engine, NULL, fd, &hdr.addr,
+        hdr.addrlen);
+    tcp_data = (struct tcp_data*) tcp_handler->user_data;
+    query_reset(tcp_data->query, TCP_MAX_MESSAGE_LEN, 1);
+    memcpy(&tcp_data->query->addr, &hdr.addr, hdr.addrlen);
+    tcp_data->query->addrlen = hdr.addrlen;
+    tcp_data->query->relayed = 1;
+    tcp_data->query->tcplen = received;
+    buffer_write(tcp_data->query->buffer, buffer_begin(q->buffer), received);
+    buffer_flip(tcp_data->query->buffer);
+    tcp_data->bytes_transmitted = sizeof(uint16_t) + received;
+    sock_handle_tcp_query(netio, tcp_handler);
+}
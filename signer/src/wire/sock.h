@@ -56,6 +56,11 @@ typedef struct socklist_struct socklist_type;
 struct socklist_struct {
     sock_type tcp[MAX_INTERFACES];
     sock_type udp[MAX_INTERFACES];
+    /* Queries for zones of other instances are handed over on these */
+    int relay;
+    int instance;
+    int instances;
+    char** relaynames;
 };
 
 /**
@@ -68,6 +73,16 @@ struct udp_data {
     query_type* query;
 };
 
+/**
+ * Data for the relay handler.
+ *
+ */
+struct relay_data {
+    engine_type* engine;
+    socklist_type* socklist;
+    query_type* query;
+};
+
 /**
  * Data for tcp accept handlers.
  *
@@ -96,10 +111,36 @@ struct tcp_data {
  * Create sockets and listen.
  * \param[out] sockets sockets
  * \param[in] listener interfaces
+ * \param[in] reuseport share the sockets with other signer instances
+ * \return ods_status status
+ *
+ */
+extern ods_status sock_listen(socklist_type* sockets, listener_type* listener,
+    int reuseport);
+
+/**
+ * Create the socket on which other signer instances hand over queries
+ * for zones owned by this instance.
+ * \param[in] sockets sockets
+ * \param[in] basename configured command socket, relay sockets are
+ *            named after the per-instance command sockets
+ * \param[in] instance this instance
+ * \param[in] instances number of instances
  * \return ods_status status
  *
  */
-extern ods_status sock_listen(socklist_type* sockets, listener_type* listener);
+extern ods_status sock_relay_listen(socklist_type* sockets,
+    const char* basename, int instance, int instances);
+
+/**
+ * Handle queries handed over by other instances.
+ * \param[in] netio network I/O event handler
+ * \param[in] handler event handler
+ * \param[in] event_types the types of events that should be checked for
+ *
+ */
+extern void sock_handle_relay(netio_type* netio, netio_handler_type* handler,
+    netio_events_type event_types);
 
 /**
  * Handle incoming udp queries.
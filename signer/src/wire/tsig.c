@@ -310,6 +310,24 @@ tsig_rr_reset(tsig_rr_type* trr, tsig_algo_type* algo, tsig_key_type* key)
 }
 
 
+/**
+ * Read a name in the TSIG RR.  The name read from an earlier packet of
+ * the same transfer is kept if it did not change.
+ *
+ */
+static int
+tsig_rr_parse_dname(ldns_rdf** rdf, buffer_type* buffer, uint16_t len)
+{
+    if (*rdf && ldns_rdf_size(*rdf) == len &&
+        memcmp(ldns_rdf_data(*rdf), buffer_current(buffer), len) == 0) {
+        return 1;
+    }
+    ldns_rdf_deep_free(*rdf);
+    *rdf = ldns_dname_new_frm_data(len, (const void*) buffer_current(buffer));
+    return *rdf != NULL;
+}
+
+
 /**
  * Parse TSIG RR.
  *
@@ -335,9 +353,7 @@ tsig_rr_parse(tsig_rr_type* trr, buffer_type* buffer)
     }
     dname_len = buffer_position(buffer) - curpos;
     buffer_set_position(buffer, curpos);
-    trr->key_name = ldns_dname_new_frm_data(dname_len,
-        (const void*) buffer_current(buffer));
-    if (!trr->key_name) {
+    if (!tsig_rr_parse_dname(&trr->key_name, buffer, dname_len)) {
         buffer_set_position(buffer, trr->position);
         ods_log_debug("[%s] parse: read key name failed", tsig_str);
         return 0;
@@ -375,9 +391,7 @@ tsig_rr_parse(tsig_rr_type* trr, buffer_type* buffer)
     }
     dname_len = buffer_position(buffer) - curpos;
     buffer_set_position(buffer, curpos);
-    trr->algo_name = ldns_dname_new_frm_data(dname_len,
-        (const void*) buffer_current(buffer));
-    if (!trr->algo_name) {
+    if (!tsig_rr_parse_dname(&trr->algo_name, buffer, dname_len)) {
         ods_log_debug("[%s] parse: read algo name failed", tsig_str);
         buffer_set_position(buffer, trr->position);
         return 0;
@@ -398,6 +412,10 @@ tsig_rr_parse(tsig_rr_type* trr, buffer_type* buffer)
         trr->mac_size = 0;
         return 0;
     }
+    /* the mac of a signed request is the prior mac, which is kept */
+    if (trr->mac_data != trr->prior_mac_data) {
+        free(trr->mac_data);
+    }
     CHECKALLOC(trr->mac_data = (uint8_t *) malloc(trr->mac_size));
     memcpy(trr->mac_data, (const void*) buffer_current(buffer), trr->mac_size);
     buffer_skip(buffer, trr->mac_size);
@@ -415,6 +433,7 @@ tsig_rr_parse(tsig_rr_type* trr, buffer_type* buffer)
         buffer_set_position(buffer, trr->position);
         return 0;
     }
+    free(trr->other_data);
     CHECKALLOC(trr->other_data = (uint8_t *) malloc(trr->other_size));
     memcpy(trr->other_data, (const void*) buffer_current(buffer), trr->other_size);
     buffer_skip(buffer, trr->other_size);
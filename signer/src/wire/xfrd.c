@@ -76,9 +76,12 @@ static int xfrd_tcp_open(xfrd_type* xfrd, tcp_set_type* set);
 static void xfrd_udp_obtain(xfrd_type* xfrd);
 static void xfrd_udp_read(xfrd_type* xfrd);
 static void xfrd_udp_release(xfrd_type* xfrd);
-static int xfrd_udp_read_packet(xfrd_type* xfrd);
+static void xfrd_udp_unlink(xfrd_type* xfrd);
+static void xfrd_udp_queue(xfrd_type* xfrd);
 static int xfrd_udp_send(xfrd_type* xfrd, buffer_type* buffer);
 static int xfrd_udp_send_request_ixfr(xfrd_type* xfrd);
+static void xfrd_master_kick(xfrd_master_type* master);
+static void xfrd_master_lost(xfrd_master_type* master);
 
 static time_t xfrd_time(xfrd_type* xfrd);
 static void xfrd_set_timer(xfrd_type* xfrd, time_t t);
@@ -124,8 +127,16 @@ xfrd_create(xfrhandler_type* xfrhandler, zone_type* zone)
     xfrd->msg_new_serial = 0;
     xfrd->msg_is_ixfr = 0;
     xfrd->msg_do_retransfer = 0;
+    xfrd->msg_bytes = 0;
+    xfrd->msg_started = 0;
+    xfrd->dump_pending = 0;
     xfrd->udp_waiting = 0;
     xfrd->udp_waiting_next = NULL;
+    xfrd->udp_inflight = 0;
+    xfrd->udp_sock = NULL;
+    xfrd->udp_master = NULL;
+    xfrd->udp_sent = 0;
+    xfrd->udp_retries = 0;
     xfrd->tcp_waiting = 0;
     xfrd->tcp_waiting_next = NULL;
     xfrd->tsig_rr = tsig_rr_create();
@@ -260,6 +271,22 @@ xfrd_set_timer_retry(xfrd_type* xfrd)
 }
 
 
+/**
+ * The transfer ended without anything new for the signer.
+ *
+ */
+static void
+xfrd_transfer_done(xfrd_type* xfrd, int failed)
+{
+    xfrhandler_type* xfrhandler = (xfrhandler_type*) xfrd->xfrhandler;
+    zone_type* zone = (zone_type*) xfrd->zone;
+    if (!xfrhandler || !xfrhandler->engine || !zone) {
+        return;
+    }
+    massop_transferdone((engine_type*) xfrhandler->engine, zone->name, failed);
+}
+
+
 /**
  * Set timeout for zone transfer to REFRESH.
  *
@@ -457,6 +484,7 @@ xfrd_commit_packet(xfrd_type* xfrd)
         pthread_mutex_unlock(&xfrd->serial_lock);
         ods_log_crit("[%s] unable to commit xfr zone %s: ods_fopen() failed "
             "(%s)", xfrd_str, zone->name, strerror(errno));
+        xfrd_transfer_done(xfrd, 1);
         return;
     }
     /* update soa serial management */
@@ -484,6 +512,8 @@ xfrd_commit_packet(xfrd_type* xfrd)
             (unsigned long)xfrd->serial_xfr_acquired);
         schedule_scheduletask(engine->taskq, TASK_FORCEREAD, zone->name, zone, &zone->zone_lock, schedule_IMMEDIATELY);
         engine_wakeup_workers(engine);
+    } else {
+        xfrd_transfer_done(xfrd, 0);
     }
     /* reset retransfer */
     xfrd->msg_do_retransfer = 0;
@@ -495,57 +525,20 @@ xfrd_commit_packet(xfrd_type* xfrd)
 
 
 /**
- * Dump answer to disk.
+ * Queue answer to be dumped to disk.
  *
  */
 static void
 xfrd_dump_packet(xfrd_type* xfrd, buffer_type* buffer)
 {
-    zone_type* zone = NULL;
-    char* xfrfile = NULL;
-    FILE* fd = NULL;
-    ldns_pkt* pkt = NULL;
-    ldns_status status = LDNS_STATUS_OK;
+    xfrhandler_type* xfrhandler = NULL;
     ods_log_assert(buffer);
     ods_log_assert(xfrd);
-    zone = (zone_type*) xfrd->zone;
-    ods_log_assert(zone);
-    ods_log_assert(zone->name);
-    status = ldns_wire2pkt(&pkt, buffer_begin(buffer), buffer_limit(buffer));
-    if (status != LDNS_STATUS_OK) {
-        ods_log_crit("[%s] unable to dump packet zone %s: ldns_wire2pkt() "
-            "failed (%s)", xfrd_str, zone->name,
-            ldns_get_errorstr_by_id(status));
-        return;
-    }
-    ods_log_assert(pkt);
-    xfrfile = ods_build_path(zone->name, ".xfrd", 0, 1);
-    if (!xfrfile) {
-        ods_log_crit("[%s] unable to dump packet zone %s: build path failed",
-            xfrd_str, zone->name);
-        return;
-    }
-    pthread_mutex_lock(&xfrd->rw_lock);
-    if (xfrd->msg_do_retransfer && !xfrd->msg_seq_nr && !xfrd->msg_is_ixfr) {
-        fd = ods_fopen(xfrfile, NULL, "w");
-    } else {
-        fd = ods_fopen(xfrfile, NULL, "a");
-    }
-    free((void*) xfrfile);
-    if (!fd) {
-        ods_log_crit("[%s] unable to dump packet zone %s: ods_fopen() failed "
-            "(%s)", xfrd_str, zone->name, strerror(errno));
-        pthread_mutex_unlock(&xfrd->rw_lock);
-        return;
-    }
-    ods_log_assert(fd);
-    if (xfrd->msg_seq_nr == 0) {
-        fprintf(fd, ";;BEGINPACKET\n");
-    }
-    ldns_rr_list_print(fd, ldns_pkt_answer(pkt));
-    ods_fclose(fd);
-    pthread_mutex_unlock(&xfrd->rw_lock);
-    ldns_pkt_free(pkt);
+    xfrhandler = (xfrhandler_type*) xfrd->xfrhandler;
+    ods_log_assert(xfrhandler);
+    xfrd->msg_bytes += buffer_limit(buffer);
+    xfrdump_enqueue(xfrhandler->dump, xfrd, buffer, xfrd->msg_seq_nr == 0,
+        xfrd->msg_do_retransfer && !xfrd->msg_seq_nr && !xfrd->msg_is_ixfr);
 }
 
 
@@ -877,6 +870,7 @@ xfrd_parse_packet(xfrd_type* xfrd, buffer_type* buffer)
                     /* not notified or anything, so stop asking around */
                     xfrd->round_num = -1; /* next try start a new round */
                     xfrd_set_timer_refresh(xfrd);
+                    xfrd_transfer_done(xfrd, 0);
                     ods_log_debug("[%s] zone %s wait refresh time", xfrd_str,
                        zone->name);
                     pthread_mutex_unlock(&xfrd->serial_lock);
@@ -997,7 +991,12 @@ xfrd_handle_packet(xfrd_type* xfrd, buffer_type* buffer)
     /* done */
     buffer_clear(buffer);
     buffer_flip(buffer);
-    /* commit packet */
+    ods_log_verbose("[%s] zone %s received %lu bytes in %u packets "
+        "(%lu seconds)", xfrd_str, zone->name,
+        (unsigned long) xfrd->msg_bytes, xfrd->msg_seq_nr,
+        (unsigned long) (xfrd_time(xfrd) - xfrd->msg_started));
+    /* commit packet, once all of it is on disk */
+    xfrdump_flush(((xfrhandler_type*) xfrd->xfrhandler)->dump, xfrd);
     xfrd_commit_packet(xfrd);
     /* next time */
     pthread_mutex_lock(&xfrd->serial_lock);
@@ -1209,9 +1208,7 @@ xfrd_tcp_obtain(xfrd_type* xfrd, tcp_set_type* set)
         ods_log_assert(xfrd->tcp_conn != -1);
         xfrd->tcp_waiting = 0;
         /* stop udp use (if any) */
-        if (xfrd->handler.fd != -1) {
-            xfrd_udp_release(xfrd);
-        }
+        xfrd_udp_release(xfrd);
         if (!xfrd_tcp_open(xfrd, set)) {
             return;
         }
@@ -1274,6 +1271,8 @@ xfrd_tcp_xfr(xfrd_type* xfrd, tcp_set_type* set)
     xfrd->msg_old_serial = 0;
     xfrd->msg_new_serial = 0;
     xfrd->msg_is_ixfr = 0;
+    xfrd->msg_bytes = 0;
+    xfrd->msg_started = xfrd_time(xfrd);
     xfrd_tsig_sign(xfrd, tcp->packet);
     buffer_flip(tcp->packet);
     tcp->msglen = buffer_limit(tcp->packet);
@@ -1389,9 +1388,7 @@ xfrd_tcp_release(xfrd_type* xfrd, tcp_set_type* set, int open_waiting)
         }
         waiting_xfrd->tcp_waiting = 0;
         /* stop udp use (if any) */
-        if (waiting_xfrd->handler.fd != -1) {
-            xfrd_udp_release(waiting_xfrd);
-        }
+        xfrd_udp_release(waiting_xfrd);
         /* if xfrd_tcp_open() fails its slot in set->tcp_conn[]
          * is released. Continue to next. We don't put it back in the
          * waiting queue, it would keep the signer busy retrying, making
@@ -1407,50 +1404,391 @@ xfrd_tcp_release(xfrd_type* xfrd, tcp_set_type* set, int open_waiting)
 
 
 /**
- * Send packet over udp.
+ * Compare socket addresses, including the port.
  *
  */
 static int
-xfrd_udp_send(xfrd_type* xfrd, buffer_type* buffer)
+xfrd_sockaddr_equal(struct sockaddr_storage* a, struct sockaddr_storage* b)
+{
+    if (a->ss_family != b->ss_family) {
+        return 0;
+    }
+    if (a->ss_family == AF_INET6) {
+        struct sockaddr_in6* a6 = (struct sockaddr_in6*) a;
+        struct sockaddr_in6* b6 = (struct sockaddr_in6*) b;
+        return a6->sin6_port == b6->sin6_port &&
+            memcmp(&a6->sin6_addr, &b6->sin6_addr,
+                sizeof(struct in6_addr)) == 0;
+    } else {
+        struct sockaddr_in* a4 = (struct sockaddr_in*) a;
+        struct sockaddr_in* b4 = (struct sockaddr_in*) b;
+        return a4->sin_port == b4->sin_port &&
+            a4->sin_addr.s_addr == b4->sin_addr.s_addr;
+    }
+}
+
+
+/**
+ * Interval between two udp requests to a master, in nanoseconds.
+ *
+ */
+static uint64_t
+xfrd_master_interval(xfrd_master_type* master)
+{
+    uint64_t interval = 0;
+    if (master->xfrhandler->refresh_rate > 0) {
+        interval = 1000000000ULL / master->xfrhandler->refresh_rate;
+    }
+    if (master->backoff) {
+        if (interval < XFRD_BACKOFF_BASE * 1000000ULL) {
+            interval = XFRD_BACKOFF_BASE * 1000000ULL;
+        }
+        interval <<= master->backoff;
+    }
+    return interval;
+}
+
+
+/**
+ * Send as many waiting requests to a master as its window and pacing
+ * allow, and set its timer for the rest.
+ *
+ */
+static void
+xfrd_master_kick(xfrd_master_type* master)
+{
+    xfrd_type* xfrd = NULL;
+    const struct timespec* now = NULL;
+    uint64_t interval = 0;
+    ods_log_assert(master);
+    ods_log_assert(master->xfrhandler);
+    master->handler.timeout = NULL;
+    while (master->waiting_first && master->inflight_num < master->window) {
+        now = netio_current_time(master->xfrhandler->netio);
+        if (now->tv_sec < master->next_send.tv_sec ||
+            (now->tv_sec == master->next_send.tv_sec &&
+             now->tv_nsec < master->next_send.tv_nsec)) {
+            ods_log_deeebug("[%s] master %s paces waiting requests",
+                xfrd_str, master->address);
+            master->timeout = master->next_send;
+            master->handler.timeout = &master->timeout;
+            return;
+        }
+        /* snip off waiting list */
+        xfrd = master->waiting_first;
+        master->waiting_first = xfrd->udp_waiting_next;
+        if (master->waiting_last == xfrd) {
+            master->waiting_last = NULL;
+        }
+        xfrd->udp_waiting = 0;
+        xfrd->udp_waiting_next = NULL;
+        if (xfrd->tcp_conn != -1) {
+            continue;
+        }
+        /* on failure the request timer set before sending will retry */
+        if (xfrd_udp_send_request_ixfr(xfrd) == -1) {
+            continue;
+        }
+        xfrd->udp_inflight = 1;
+        xfrd->udp_sent = xfrd_time(xfrd);
+        xfrd->udp_waiting_next = master->inflight;
+        master->inflight = xfrd;
+        master->inflight_num++;
+        /* next slot */
+        interval = xfrd_master_interval(master);
+        if (now->tv_sec > master->next_send.tv_sec ||
+            (now->tv_sec == master->next_send.tv_sec &&
+             now->tv_nsec > master->next_send.tv_nsec)) {
+            master->next_send = *now;
+        }
+        master->next_send.tv_sec += interval / 1000000000ULL;
+        master->next_send.tv_nsec += interval % 1000000000ULL;
+        if (master->next_send.tv_nsec >= 1000000000L) {
+            master->next_send.tv_sec++;
+            master->next_send.tv_nsec -= 1000000000L;
+        }
+    }
+}
+
+
+/**
+ * Handle master timeout: the next request may be sent.
+ *
+ */
+static void
+xfrd_master_handle(netio_type* ATTR_UNUSED(netio),
+    netio_handler_type* handler, netio_events_type ATTR_UNUSED(event_types))
 {
+    if (!handler) {
+        return;
+    }
+    xfrd_master_kick((xfrd_master_type*) handler->user_data);
+}
+
+
+/**
+ * Get the request scheduler for the master in use.
+ *
+ */
+static xfrd_master_type*
+xfrd_master_get(xfrhandler_type* xfrhandler, acl_type* acl)
+{
+    xfrd_master_type* master = NULL;
     struct sockaddr_storage to;
     socklen_t to_len = 0;
-    int fd = -1;
-    int family = PF_INET;
+    ods_log_assert(xfrhandler);
+    ods_log_assert(acl);
+    to_len = xfrd_acl_sockaddr_to(acl, &to);
+    for (master = xfrhandler->masters; master; master = master->next) {
+        if (xfrd_sockaddr_equal(&master->addr, &to)) {
+            return master;
+        }
+    }
+    CHECKALLOC(master = (xfrd_master_type*) calloc(1, sizeof(xfrd_master_type)));
+    CHECKALLOC(master->address = strdup(acl->address));
+    master->xfrhandler = xfrhandler;
+    memcpy(&master->addr, &to, sizeof(to));
+    master->addrlen = to_len;
+    master->window = XFRD_MASTER_WINDOW;
+    master->backoff = 0;
+    master->handler.fd = -1;
+    master->handler.user_data = (void*) master;
+    master->handler.timeout = NULL;
+    master->handler.event_types = NETIO_EVENT_TIMEOUT;
+    master->handler.event_handler = xfrd_master_handle;
+    master->handler.free_handler = 0;
+    netio_add_handler(xfrhandler->netio, &master->handler);
+    master->next = xfrhandler->masters;
+    xfrhandler->masters = master;
+    return master;
+}
+
+
+/**
+ * A master answered: open up the window and speed up again.
+ *
+ */
+static void
+xfrd_master_answered(xfrd_master_type* master)
+{
+    if (master->backoff > 0) {
+        master->backoff--;
+    }
+    if (master->window < XFRD_MASTER_WINDOW) {
+        master->window++;
+    }
+}
+
+
+/**
+ * A master did not answer: halve the window and slow down.
+ *
+ */
+static void
+xfrd_master_lost(xfrd_master_type* master)
+{
+    if (master->backoff < XFRD_MAX_BACKOFF) {
+        master->backoff++;
+    }
+    master->window = master->window > 1 ? master->window / 2 : 1;
+    ods_log_verbose("[%s] master %s lost udp request, window %u interval "
+        "%lu ms", xfrd_str, master->address, (unsigned) master->window,
+        (unsigned long) (xfrd_master_interval(master) / 1000000ULL));
+}
+
+
+/**
+ * Take the zone off the waiting or in flight list of its master.
+ *
+ */
+static void
+xfrd_udp_unlink(xfrd_type* xfrd)
+{
+    xfrd_master_type* master = xfrd->udp_master;
+    xfrd_type** prev = NULL;
+    xfrd_type* last = NULL;
+    if (!master || (!xfrd->udp_waiting && !xfrd->udp_inflight)) {
+        return;
+    }
+    prev = xfrd->udp_waiting ? &master->waiting_first : &master->inflight;
+    while (*prev && *prev != xfrd) {
+        last = *prev;
+        prev = &(*prev)->udp_waiting_next;
+    }
+    if (*prev) {
+        *prev = xfrd->udp_waiting_next;
+        if (xfrd->udp_waiting && master->waiting_last == xfrd) {
+            master->waiting_last = last;
+        }
+        if (xfrd->udp_inflight) {
+            master->inflight_num--;
+        }
+    }
+    if (xfrd->udp_inflight && xfrd->udp_sock) {
+        xfrd->udp_sock->inflight--;
+    }
+    xfrd->udp_sock = NULL;
+    xfrd->udp_waiting_next = NULL;
+    xfrd->udp_waiting = 0;
+    xfrd->udp_inflight = 0;
+}
+
+
+/**
+ * Close a shared udp socket.
+ *
+ */
+static void
+xfrd_udp_socket_close(xfrhandler_type* xfrhandler, xfrd_udp_sock_type* sock)
+{
+    xfrd_udp_sock_type** prev = &xfrhandler->udp_socks;
+    while (*prev && *prev != sock) {
+        prev = &(*prev)->next;
+    }
+    if (*prev) {
+        *prev = sock->next;
+    }
+    netio_remove_handler(xfrhandler->netio, &sock->handler);
+    close(sock->handler.fd);
+    free(sock);
+}
+
+
+/**
+ * Close the retired udp sockets that have no requests in flight.
+ *
+ */
+static void
+xfrd_udp_socket_sweep(xfrhandler_type* xfrhandler)
+{
+    xfrd_udp_sock_type* sock = xfrhandler->udp_socks;
+    xfrd_udp_sock_type* next = NULL;
+    while (sock) {
+        next = sock->next;
+        if (sock->retired && !sock->inflight && !sock->reading) {
+            ods_log_deeebug("[%s] close retired udp socket fd %d", xfrd_str,
+                sock->handler.fd);
+            xfrd_udp_socket_close(xfrhandler, sock);
+        }
+        sock = next;
+    }
+}
+
+
+/**
+ * Open a udp socket for an address family.
+ *
+ */
+static xfrd_udp_sock_type*
+xfrd_udp_socket_open(xfrhandler_type* xfrhandler, int family)
+{
+    xfrd_udp_sock_type* sock = NULL;
+    int fd = socket(family == AF_INET6 ? PF_INET6 : PF_INET,
+        SOCK_DGRAM, IPPROTO_UDP);
+    if (fd == -1) {
+        ods_log_error("[%s] unable to create udp socket: socket() failed "
+            "(%s)", xfrd_str, strerror(errno));
+        return NULL;
+    }
+    if (fcntl(fd, F_SETFL, O_NONBLOCK) == -1) {
+        ods_log_error("[%s] unable to set udp socket non-blocking: "
+            "fcntl() failed (%s)", xfrd_str, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+    CHECKALLOC(sock = (xfrd_udp_sock_type*) malloc(sizeof(xfrd_udp_sock_type)));
+    sock->xfrhandler = xfrhandler;
+    sock->family = family;
+    sock->sent = 0;
+    sock->inflight = 0;
+    sock->retired = 0;
+    sock->reading = 0;
+    sock->handler.fd = fd;
+    sock->handler.user_data = (void*) sock;
+    sock->handler.timeout = 0;
+    sock->handler.event_types = NETIO_EVENT_READ;
+    sock->handler.event_handler = xfrd_handle_udp;
+    sock->handler.free_handler = 0;
+    sock->next = xfrhandler->udp_socks;
+    xfrhandler->udp_socks = sock;
+    netio_add_handler(xfrhandler->netio, &sock->handler);
+    return sock;
+}
+
+
+/**
+ * Get the next shared udp socket for an address family. The pool is
+ * filled up to XFRD_UDP_SOCKETS sockets and then used in turn.
+ *
+ */
+static xfrd_udp_sock_type*
+xfrd_udp_socket(xfrhandler_type* xfrhandler, int family)
+{
+    xfrd_udp_sock_type* sock = NULL;
+    xfrd_udp_sock_type* pick = NULL;
+    size_t num = 0;
+    size_t turn = 0;
+    ods_log_assert(xfrhandler);
+    xfrd_udp_socket_sweep(xfrhandler);
+    for (sock = xfrhandler->udp_socks; sock; sock = sock->next) {
+        if (sock->family == family && !sock->retired) {
+            num++;
+        }
+    }
+    if (num < XFRD_UDP_SOCKETS) {
+        pick = xfrd_udp_socket_open(xfrhandler, family);
+        if (pick || !num) {
+            return pick;
+        }
+    }
+    turn = xfrhandler->udp_next++ % num;
+    for (sock = xfrhandler->udp_socks; sock; sock = sock->next) {
+        if (sock->family == family && !sock->retired && !turn--) {
+            return sock;
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * Send packet over udp.
+ *
+ */
+static int
+xfrd_udp_send(xfrd_type* xfrd, buffer_type* buffer)
+{
+    xfrd_master_type* master = NULL;
+    xfrd_udp_sock_type* sock = NULL;
     ssize_t nb = -1;
     ods_log_assert(buffer);
     ods_log_assert(xfrd);
-    ods_log_assert(xfrd->master);
-    ods_log_assert(xfrd->master->address);
-    /* this will set the remote port to acl->port or TCP_PORT */
-    to_len = xfrd_acl_sockaddr_to(xfrd->master, &to);
-    /* get the address family of the remote host */
-    if (xfrd->master->family == AF_INET6) {
-        family = PF_INET6;
-    }
-    /* create socket */
-    fd = socket(family, SOCK_DGRAM, IPPROTO_UDP);
-    if (fd == -1) {
-        ods_log_error("[%s] unable to send data over udp to %s: "
-            "socket() failed (%s)", xfrd_str, xfrd->master->address,
-            strerror(errno));
+    ods_log_assert(xfrd->udp_master);
+    master = xfrd->udp_master;
+    sock = xfrd_udp_socket((xfrhandler_type*) xfrd->xfrhandler,
+        master->addr.ss_family);
+    if (!sock) {
         return -1;
     }
-    /* bind it? */
-
     /* send it (udp) */
     ods_log_deeebug("[%s] send %lu bytes over udp to %s", xfrd_str,
-        (unsigned long)buffer_remaining(buffer), xfrd->master->address);
-    nb = sendto(fd, buffer_current(buffer), buffer_remaining(buffer), 0,
-        (struct sockaddr*)&to, to_len);
+        (unsigned long)buffer_remaining(buffer), master->address);
+    nb = sendto(sock->handler.fd, buffer_current(buffer),
+        buffer_remaining(buffer), 0, (struct sockaddr*)&master->addr,
+        master->addrlen);
     if (nb == -1) {
         ods_log_error("[%s] unable to send data over udp to %s: "
-            "sendto() failed (%s)", xfrd_str, xfrd->master->address,
+            "sendto() failed (%s)", xfrd_str, master->address,
             strerror(errno));
-        close(fd);
         return -1;
     }
-    return fd;
+    /* the answer is only accepted on this socket */
+    xfrd->udp_sock = sock;
+    sock->inflight++;
+    if (++sock->sent >= XFRD_UDP_SOCKET_USES) {
+        sock->retired = 1;
+    }
+    return 0;
 }
 
 
@@ -1461,7 +1799,6 @@ xfrd_udp_send(xfrd_type* xfrd, buffer_type* buffer)
 static int
 xfrd_udp_send_request_ixfr(xfrd_type* xfrd)
 {
-    int fd;
     xfrhandler_type* xfrhandler = NULL;
     zone_type* zone = NULL;
     ods_log_assert(xfrd);
@@ -1487,6 +1824,8 @@ xfrd_udp_send_request_ixfr(xfrd_type* xfrd)
     xfrd->msg_old_serial = 0;
     xfrd->msg_new_serial = 0;
     xfrd->msg_is_ixfr = 0;
+    xfrd->msg_bytes = 0;
+    xfrd->msg_started = xfrd_time(xfrd);
     buffer_pkt_set_nscount(xfrhandler->packet, 1);
     xfrd_write_soa(xfrd, xfrhandler->packet);
     xfrd_tsig_sign(xfrd, xfrhandler->packet);
@@ -1494,73 +1833,56 @@ xfrd_udp_send_request_ixfr(xfrd_type* xfrd)
     xfrd_set_timer(xfrd, xfrd_time(xfrd) + XFRD_UDP_TIMEOUT);
     ods_log_info("[%s] zone %s request udp/ixfr=%u to %s", xfrd_str,
         zone->name, xfrd->soa.serial, xfrd->master->address);
-    if((fd = xfrd_udp_send(xfrd, xfrhandler->packet)) == -1) {
-        return -1;
-    }
-    return fd;
+    return xfrd_udp_send(xfrd, xfrhandler->packet);
 }
 
+
 /**
- * Obtain udp.
+ * Queue the zone for a udp request to its master.
  *
  */
 static void
-xfrd_udp_obtain(xfrd_type* xfrd)
+xfrd_udp_queue(xfrd_type* xfrd)
 {
-    xfrhandler_type* xfrhandler = NULL;
-    ods_log_assert(xfrd);
-    ods_log_assert(xfrd->xfrhandler);
+    xfrd_master_type* master = xfrd->udp_master;
+    ods_log_assert(master);
     ods_log_assert(xfrd->udp_waiting == 0);
-    xfrhandler = (void*) xfrd->xfrhandler;
-    if (xfrd->tcp_conn != -1) {
-        /* no tcp and udp at the same time */
-        xfrd_tcp_release(xfrd, xfrhandler->tcp_set, 1);
-    }
-    if (xfrhandler->udp_use_num < XFRD_MAX_UDP) {
-            xfrhandler->udp_use_num++;
-            xfrd->handler.fd = xfrd_udp_send_request_ixfr(xfrd);
-            if (xfrd->handler.fd == -1) {
-                    xfrhandler->udp_use_num--;
-            }
-            return;
-    }
+    ods_log_assert(xfrd->udp_inflight == 0);
     /* queue the zone as last */
     xfrd->udp_waiting = 1;
     xfrd->udp_waiting_next = NULL;
-    if (!xfrhandler->udp_waiting_first) {
-        xfrhandler->udp_waiting_first = xfrd;
+    if (!master->waiting_first) {
+        master->waiting_first = xfrd;
     }
-    if (xfrhandler->udp_waiting_last) {
-        xfrhandler->udp_waiting_last->udp_waiting_next = xfrd;
+    if (master->waiting_last) {
+        master->waiting_last->udp_waiting_next = xfrd;
     }
-    xfrhandler->udp_waiting_last = xfrd;
+    master->waiting_last = xfrd;
     xfrd_unset_timer(xfrd);
+    xfrd_master_kick(master);
 }
 
 
 /**
- * Read packet from udp.
+ * Obtain udp.
  *
  */
-static int
-xfrd_udp_read_packet(xfrd_type* xfrd)
+static void
+xfrd_udp_obtain(xfrd_type* xfrd)
 {
     xfrhandler_type* xfrhandler = NULL;
-    ssize_t received = 0;
     ods_log_assert(xfrd);
-    xfrhandler = (xfrhandler_type*) xfrd->xfrhandler;
-    ods_log_assert(xfrhandler);
-    /* read the data */
-    buffer_clear(xfrhandler->packet);
-    received = recvfrom(xfrd->handler.fd, buffer_begin(xfrhandler->packet),
-        buffer_remaining(xfrhandler->packet), 0, NULL, NULL);
-    if (received == -1) {
-        ods_log_error("[%s] unable to read packet: recvfrom() failed fd %d "
-            "(%s)", xfrd_str, xfrd->handler.fd, strerror(errno));
-        return 0;
+    ods_log_assert(xfrd->xfrhandler);
+    ods_log_assert(xfrd->udp_waiting == 0);
+    xfrhandler = (void*) xfrd->xfrhandler;
+    if (xfrd->tcp_conn != -1) {
+        /* no tcp and udp at the same time */
+        xfrd_tcp_release(xfrd, xfrhandler->tcp_set, 1);
     }
-    buffer_set_limit(xfrhandler->packet, received);
-    return 1;
+    xfrd_udp_unlink(xfrd);
+    xfrd->udp_master = xfrd_master_get(xfrhandler, xfrd->master);
+    xfrd->udp_retries = 0;
+    xfrd_udp_queue(xfrd);
 }
 
 
@@ -1580,12 +1902,6 @@ xfrd_udp_read(xfrd_type* xfrd)
     ods_log_assert(zone->name);
     ods_log_debug("[%s] zone %s read data from udp", xfrd_str,
         zone->name);
-    if (!xfrd_udp_read_packet(xfrd)) {
-        ods_log_error("[%s] unable to read data from udp zone %s: "
-            "xfrd_udp_read_packet() failed", xfrd_str, zone->name);
-        xfrd_udp_release(xfrd);
-        return;
-    }
     xfrhandler = (xfrhandler_type*) xfrd->xfrhandler;
     ods_log_assert(xfrhandler);
     res = xfrd_handle_packet(xfrd, xfrhandler->packet);
@@ -1623,44 +1939,123 @@ xfrd_udp_read(xfrd_type* xfrd)
 
 
 /**
- * Release udp.
+ * Handle answers on a shared udp socket.
  *
  */
-static void
-xfrd_udp_release(xfrd_type* xfrd)
+void
+xfrd_handle_udp(netio_type* ATTR_UNUSED(netio),
+    netio_handler_type* handler, netio_events_type event_types)
 {
     xfrhandler_type* xfrhandler = NULL;
-
-    ods_log_assert(xfrd);
-    ods_log_assert(xfrd->udp_waiting == 0);
-    if(xfrd->handler.fd != -1)
-        close(xfrd->handler.fd);
-    xfrd->handler.fd = -1;
-    xfrhandler = (xfrhandler_type*) xfrd->xfrhandler;
+    xfrd_udp_sock_type* sock = NULL;
+    xfrd_master_type* master = NULL;
+    xfrd_type* xfrd = NULL;
+    struct sockaddr_storage from;
+    socklen_t from_len = 0;
+    ssize_t received = 0;
+    uint16_t id = 0;
+    int n;
+    if (!handler || !(event_types & NETIO_EVENT_READ)) {
+        return;
+    }
+    sock = (xfrd_udp_sock_type*) handler->user_data;
+    ods_log_assert(sock);
+    xfrhandler = sock->xfrhandler;
     ods_log_assert(xfrhandler);
-    /* see if there are waiting zones */
-    if (xfrhandler->udp_use_num == XFRD_MAX_UDP) {
-        while (xfrhandler->udp_waiting_first) {
-            /* snip off waiting list */
-            xfrd_type* wf = xfrhandler->udp_waiting_first;
-            ods_log_assert(wf->udp_waiting);
-            wf->udp_waiting = 0;
-            xfrhandler->udp_waiting_first = wf->udp_waiting_next;
-            if (xfrhandler->udp_waiting_last == wf) {
-                xfrhandler->udp_waiting_last = NULL;
+    /* answers may kick off new requests, keep this socket open meanwhile */
+    sock->reading = 1;
+    /* do not starve the other handlers */
+    for (n = 0; n < XFRD_MASTER_WINDOW; n++) {
+        buffer_clear(xfrhandler->packet);
+        from_len = sizeof(from);
+        received = recvfrom(handler->fd, buffer_begin(xfrhandler->packet),
+            buffer_remaining(xfrhandler->packet), 0,
+            (struct sockaddr*)&from, &from_len);
+        if (received == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                ods_log_error("[%s] unable to read packet: recvfrom() "
+                    "failed fd %d (%s)", xfrd_str, handler->fd,
+                    strerror(errno));
             }
-            /* see if this zone needs udp connection */
-            if (wf->tcp_conn == -1) {
-                wf->handler.fd = xfrd_udp_send_request_ixfr(wf);
-                if (wf->handler.fd != -1) {
-                    return;
-                }
+            break;
+        }
+        buffer_set_limit(xfrhandler->packet, received);
+        if (received < BUFFER_PKT_HEADER_SIZE) {
+            continue;
+        }
+        /* demultiplex on socket, master address and query id */
+        id = buffer_pkt_id(xfrhandler->packet);
+        for (master = xfrhandler->masters; master; master = master->next) {
+            if (xfrd_sockaddr_equal(&master->addr, &from)) {
+                break;
             }
         }
+        xfrd = master ? master->inflight : NULL;
+        while (xfrd && (xfrd->query_id != id || xfrd->udp_sock != sock)) {
+            xfrd = xfrd->udp_waiting_next;
+        }
+        if (!xfrd) {
+            ods_log_debug("[%s] drop unexpected udp packet with id %u",
+                xfrd_str, (unsigned) id);
+            continue;
+        }
+        xfrd_udp_unlink(xfrd);
+        xfrd_master_answered(master);
+        xfrd_set_timer_now(xfrd);
+        xfrd_udp_read(xfrd);
     }
-    /* no waiting zones */
-    if (xfrhandler->udp_use_num > 0) {
-        xfrhandler->udp_use_num --;
+    sock->reading = 0;
+    xfrd_udp_socket_sweep(xfrhandler);
+}
+
+
+/**
+ * Release udp.
+ *
+ */
+static void
+xfrd_udp_release(xfrd_type* xfrd)
+{
+    ods_log_assert(xfrd);
+    xfrd_udp_unlink(xfrd);
+    if (xfrd->udp_master) {
+        xfrd_master_kick(xfrd->udp_master);
+    }
+}
+
+
+/**
+ * Clean up the request schedulers of all masters.
+ *
+ */
+void
+xfrd_masters_cleanup(xfrhandler_type* xfrhandler)
+{
+    xfrd_master_type* master = NULL;
+    if (!xfrhandler) {
+        return;
+    }
+    while (xfrhandler->masters) {
+        master = xfrhandler->masters;
+        xfrhandler->masters = master->next;
+        free(master->address);
+        free(master);
+    }
+}
+
+
+/**
+ * Close the udp sockets shared by the masters.
+ *
+ */
+void
+xfrd_udp_sockets_cleanup(xfrhandler_type* xfrhandler)
+{
+    if (!xfrhandler) {
+        return;
+    }
+    while (xfrhandler->udp_socks) {
+        xfrd_udp_socket_close(xfrhandler, xfrhandler->udp_socks);
     }
 }
 
@@ -1714,6 +2109,7 @@ xfrd_make_request(xfrd_type* xfrd)
             /* tried all servers that many times, wait */
             xfrd->round_num = -1;
             xfrd_set_timer_retry(xfrd);
+            xfrd_transfer_done(xfrd, 1);
             ods_log_verbose("[%s] zone %s make request wait retry",
                 xfrd_str, zone->name);
             return;
@@ -1724,6 +2120,7 @@ xfrd_make_request(xfrd_type* xfrd)
             xfrd_str, zone->name);
         xfrd->round_num = -1;
         xfrd_set_timer_retry(xfrd);
+        xfrd_transfer_done(xfrd, 1);
         return;
     }
     /* cache ixfr_disabled only for XFRD_NO_IXFR_CACHE time */
@@ -1809,20 +2206,24 @@ xfrd_handle_zone(netio_type* ATTR_UNUSED(netio),
         }
     }
 
-    if (event_types & NETIO_EVENT_READ) {
-        /* busy in udp transaction */
-        ods_log_deeebug("[%s] zone %s event udp read", xfrd_str,
-            zone->name);
-        xfrd_set_timer_now(xfrd);
-        xfrd_udp_read(xfrd);
-        return;
-    }
-
-    /* timeout */
+    /* timeout, udp answers arrive through xfrd_handle_udp */
     ods_log_deeebug("[%s] zone %s timeout", xfrd_str, zone->name);
-    if (handler->fd != -1) {
+    if (xfrd->udp_inflight) {
+        xfrd_master_type* master = xfrd->udp_master;
         ods_log_assert(xfrd->tcp_conn == -1);
-        xfrd_udp_release(xfrd);
+        xfrd_udp_unlink(xfrd);
+        if (xfrd_time(xfrd) >= xfrd->udp_sent + XFRD_UDP_TIMEOUT) {
+            /* lost, not cut short by a notify */
+            xfrd_master_lost(master);
+            if (xfrd->udp_retries < XFRD_UDP_RETRIES) {
+                xfrd->udp_retries++;
+                ods_log_verbose("[%s] zone %s resend request to %s",
+                    xfrd_str, zone->name, master->address);
+                xfrd_udp_queue(xfrd);
+                return;
+            }
+        }
+        xfrd_master_kick(master);
     }
     if (xfrd->tcp_waiting) {
         ods_log_deeebug("[%s] zone %s skips retry: tcp connections full",
@@ -1958,6 +2359,9 @@ xfrd_cleanup(xfrd_type* xfrd, int backup)
     if (!xfrd) {
         return;
     }
+    if (xfrd->xfrhandler) {
+        xfrdump_flush(xfrd->xfrhandler->dump, xfrd);
+    }
     /* backup */
     if (backup) {
         xfrd_backup(xfrd);
@@ -1965,6 +2369,7 @@ xfrd_cleanup(xfrd_type* xfrd, int backup)
         xfrd_unlink(xfrd);
     }
 
+    xfrd_udp_unlink(xfrd);
     tsig_rr_cleanup(xfrd->tsig_rr);
     pthread_mutex_destroy(&xfrd->serial_lock);
     pthread_mutex_destroy(&xfrd->rw_lock);
@@ -63,10 +63,62 @@ typedef struct xfrd_struct xfrd_type;
 #include "daemon/xfrhandler.h"
 
 #define XFRD_MAX_ROUNDS 3 /* max number of rounds along the masters */
-#define XFRD_MAX_UDP 100 /* max number of udp sockets at a time for ixfr */
 #define XFRD_NO_IXFR_CACHE 172800 /* 48h before retrying ixfr after notimpl */
 #define XFRD_TCP_TIMEOUT 120 /* seconds, before a tcp request times out */
 #define XFRD_UDP_TIMEOUT 5 /* seconds, before a udp request times out */
+#define XFRD_UDP_RETRIES 2 /* times a lost udp request is resent to a master */
+#define XFRD_MASTER_WINDOW 32 /* max number of udp requests in flight per master */
+#define XFRD_UDP_SOCKETS 4 /* udp sockets per address family in rotation */
+#define XFRD_UDP_SOCKET_USES 256 /* udp requests sent before a socket is reopened */
+#define XFRD_MAX_BACKOFF 6 /* max number of times the request interval doubles */
+#define XFRD_BACKOFF_BASE 10 /* milliseconds, interval after loss if unpaced */
+
+typedef struct xfrd_master_struct xfrd_master_type;
+typedef struct xfrd_udp_sock_struct xfrd_udp_sock_type;
+
+/*
+ * UDP socket shared by the masters. Requests rotate over a small pool of
+ * sockets per address family, and a socket that has sent its share of
+ * requests is retired and closed once its last answer is in, so the
+ * source port keeps changing.
+ */
+struct xfrd_udp_sock_struct {
+    xfrd_udp_sock_type* next;
+    xfrhandler_type* xfrhandler;
+    netio_handler_type handler;
+    int family;
+    size_t sent;
+    size_t inflight;
+    unsigned retired : 1;
+    unsigned reading : 1;
+};
+
+/*
+ * Request scheduler for one master, shared by all zones that transfer
+ * from the same address and port. UDP requests are paced to the refresh
+ * rate and sent over the shared sockets; answers are matched on socket,
+ * source address and query id. Lost requests halve the window and
+ * double the interval, answered requests restore them.
+ */
+struct xfrd_master_struct {
+    xfrd_master_type* next;
+    xfrhandler_type* xfrhandler;
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+    char* address;
+    /* zones waiting to send, in order */
+    xfrd_type* waiting_first;
+    xfrd_type* waiting_last;
+    /* zones with a request in flight */
+    xfrd_type* inflight;
+    size_t inflight_num;
+    size_t window;
+    unsigned backoff;
+    /* pacing */
+    struct timespec next_send;
+    struct timespec timeout;
+    netio_handler_type handler;
+};
 
 /*
  * Zone transfer SOA information.
@@ -131,12 +183,22 @@ struct xfrd_struct
     size_t msg_rr_count;
     uint8_t msg_is_ixfr;
     uint8_t msg_do_retransfer;
+    size_t msg_bytes;
+    time_t msg_started;
     tsig_rr_type* tsig_rr;
+    /* packets queued to be written, mutexed by the packet writer */
+    size_t dump_pending;
 
     xfrd_type* tcp_waiting_next;
+    /* next in the waiting or in flight list of udp_master */
     xfrd_type* udp_waiting_next;
+    xfrd_master_type* udp_master;
+    xfrd_udp_sock_type* udp_sock;
+    time_t udp_sent;
+    uint8_t udp_retries;
     unsigned tcp_waiting : 1;
     unsigned udp_waiting : 1;
+    unsigned udp_inflight : 1;
 
 };
 
@@ -180,6 +242,30 @@ void xfrd_set_timer_refresh(xfrd_type* xfrd);
 extern socklen_t xfrd_acl_sockaddr_to(acl_type* acl,
     struct sockaddr_storage* to);
 
+/**
+ * Handle answers on a udp socket shared by the masters.
+ * \param[in] netio netio
+ * \param[in] handler handler of the socket
+ * \param[in] event_types events
+ *
+ */
+extern void xfrd_handle_udp(netio_type* netio, netio_handler_type* handler,
+    netio_events_type event_types);
+
+/**
+ * Clean up the request schedulers of all masters.
+ * \param[in] xfrhandler zone transfer handler
+ *
+ */
+extern void xfrd_masters_cleanup(xfrhandler_type* xfrhandler);
+
+/**
+ * Close the udp sockets shared by the masters.
+ * \param[in] xfrhandler zone transfer handler
+ *
+ */
+extern void xfrd_udp_sockets_cleanup(xfrhandler_type* xfrhandler);
+
 /**
  * Cleanup zone transfer structure.
  * \param[in] xfrd zone transfer structure.
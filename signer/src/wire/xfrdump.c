@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2018 NLNet Labs.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Writing received zone transfer packets to disk.
+ *
+ */
+
+#include "config.h"
+#include "file.h"
+#include "log.h"
+#include "status.h"
+#include "signer/zone.h"
+#include "wire/xfrdump.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* xfrdump_str = "xfrdump";
+
+struct xfrdump_packet {
+    xfrd_type* xfrd;
+    uint8_t* data;
+    size_t len;
+    unsigned begin : 1;
+    unsigned truncate : 1;
+    struct xfrdump_packet* next;
+};
+
+
+/**
+ * Create packet writer.
+ *
+ */
+xfrdump_type*
+xfrdump_create(void)
+{
+    xfrdump_type* xfrdump = NULL;
+    CHECKALLOC(xfrdump = (xfrdump_type*) calloc(1, sizeof(xfrdump_type)));
+    pthread_mutex_init(&xfrdump->lock, NULL);
+    pthread_cond_init(&xfrdump->cond, NULL);
+    pthread_cond_init(&xfrdump->done, NULL);
+    return xfrdump;
+}
+
+
+static void
+xfrdump_packet_free(struct xfrdump_packet* packet)
+{
+    free(packet->data);
+    free(packet);
+}
+
+
+/**
+ * Write the packets of one zone, from first up to end, with the file
+ * opened once for all of them.
+ *
+ */
+static void
+xfrdump_write(struct xfrdump_packet* first, struct xfrdump_packet* end)
+{
+    xfrd_type* xfrd = first->xfrd;
+    zone_type* zone = NULL;
+    struct xfrdump_packet* packet = NULL;
+    char* xfrfile = NULL;
+    FILE* fd = NULL;
+    ldns_pkt* pkt = NULL;
+    ldns_status status = LDNS_STATUS_OK;
+    ods_log_assert(xfrd);
+    zone = (zone_type*) xfrd->zone;
+    ods_log_assert(zone);
+    ods_log_assert(zone->name);
+    xfrfile = ods_build_path(zone->name, ".xfrd", 0, 1);
+    if (!xfrfile) {
+        ods_log_crit("[%s] unable to dump packet zone %s: build path failed",
+            xfrdump_str, zone->name);
+        return;
+    }
+    pthread_mutex_lock(&xfrd->rw_lock);
+    for (packet = first; packet != end; packet = packet->next) {
+        status = ldns_wire2pkt(&pkt, packet->data, packet->len);
+        if (status != LDNS_STATUS_OK) {
+            ods_log_crit("[%s] unable to dump packet zone %s: "
+                "ldns_wire2pkt() failed (%s)", xfrdump_str, zone->name,
+                ldns_get_errorstr_by_id(status));
+            continue;
+        }
+        if (fd && packet->truncate) {
+            ods_fclose(fd);
+            fd = NULL;
+        }
+        if (!fd) {
+            fd = ods_fopen(xfrfile, NULL, packet->truncate ? "w" : "a");
+            if (!fd) {
+                ods_log_crit("[%s] unable to dump packet zone %s: "
+                    "ods_fopen() failed (%s)", xfrdump_str, zone->name,
+                    strerror(errno));
+                ldns_pkt_free(pkt);
+                continue;
+            }
+        }
+        if (packet->begin) {
+            fprintf(fd, ";;BEGINPACKET\n");
+        }
+        ldns_rr_list_print(fd, ldns_pkt_answer(pkt));
+        ldns_pkt_free(pkt);
+    }
+    if (fd) {
+        ods_fclose(fd);
+    }
+    pthread_mutex_unlock(&xfrd->rw_lock);
+    free(xfrfile);
+}
+
+
+/**
+ * Write a batch of packets, one run of packets of the same zone at a
+ * time, and tell whoever waits for them.
+ *
+ */
+static void
+xfrdump_process(xfrdump_type* xfrdump, struct xfrdump_packet* batch)
+{
+    struct xfrdump_packet* run = NULL;
+    struct xfrdump_packet* end = NULL;
+    struct xfrdump_packet* packet = NULL;
+    for (run = batch; run; run = end) {
+        for (end = run->next; end && end->xfrd == run->xfrd; end = end->next)
+            ;
+        xfrdump_write(run, end);
+        /* the zone may be gone as soon as nothing is pending for it */
+        pthread_mutex_lock(&xfrdump->lock);
+        for (packet = run; packet != end; packet = packet->next) {
+            packet->xfrd->dump_pending--;
+        }
+        pthread_cond_broadcast(&xfrdump->done);
+        pthread_mutex_unlock(&xfrdump->lock);
+        while (run != end) {
+            packet = run->next;
+            xfrdump_packet_free(run);
+            run = packet;
+        }
+    }
+}
+
+
+/**
+ * Queue a packet of a zone transfer.
+ *
+ */
+void
+xfrdump_enqueue(xfrdump_type* xfrdump, xfrd_type* xfrd, buffer_type* buffer,
+    int begin, int truncate)
+{
+    struct xfrdump_packet* packet = NULL;
+    ods_log_assert(xfrdump);
+    ods_log_assert(xfrd);
+    ods_log_assert(buffer);
+    CHECKALLOC(packet = (struct xfrdump_packet*) calloc(1, sizeof(struct xfrdump_packet)));
+    packet->xfrd = xfrd;
+    packet->len = buffer_limit(buffer);
+    CHECKALLOC(packet->data = (uint8_t*) malloc(packet->len));
+    memcpy(packet->data, buffer_begin(buffer), packet->len);
+    packet->begin = begin ? 1 : 0;
+    packet->truncate = truncate ? 1 : 0;
+    pthread_mutex_lock(&xfrdump->lock);
+    if (!xfrdump->started) {
+        pthread_mutex_unlock(&xfrdump->lock);
+        xfrdump_write(packet, NULL);
+        xfrdump_packet_free(packet);
+        return;
+    }
+    while (xfrdump->nqueued >= XFRDUMP_MAX_QUEUED) {
+        pthread_cond_wait(&xfrdump->done, &xfrdump->lock);
+    }
+    if (xfrdump->last) {
+        xfrdump->last->next = packet;
+    } else {
+        xfrdump->first = packet;
+    }
+    xfrdump->last = packet;
+    xfrdump->nqueued++;
+    xfrd->dump_pending++;
+    pthread_cond_signal(&xfrdump->cond);
+    pthread_mutex_unlock(&xfrdump->lock);
+}
+
+
+/**
+ * Wait until all packets queued for a zone are written.
+ *
+ */
+void
+xfrdump_flush(xfrdump_type* xfrdump, xfrd_type* xfrd)
+{
+    if (!xfrdump || !xfrd) {
+        return;
+    }
+    pthread_mutex_lock(&xfrdump->lock);
+    while (xfrd->dump_pending > 0) {
+        pthread_cond_wait(&xfrdump->done, &xfrdump->lock);
+    }
+    pthread_mutex_unlock(&xfrdump->lock);
+}
+
+
+/**
+ * Run the packet writer.
+ *
+ */
+void
+xfrdump_start(xfrdump_type* xfrdump)
+{
+    struct xfrdump_packet* batch = NULL;
+    ods_log_assert(xfrdump);
+    ods_log_debug("[%s] start", xfrdump_str);
+    pthread_mutex_lock(&xfrdump->lock);
+    for (;;) {
+        while (!xfrdump->first && !xfrdump->need_to_exit) {
+            pthread_cond_wait(&xfrdump->cond, &xfrdump->lock);
+        }
+        if (!xfrdump->first) {
+            break;
+        }
+        /* take all that is queued, that frees the queue as well */
+        batch = xfrdump->first;
+        xfrdump->first = NULL;
+        xfrdump->last = NULL;
+        xfrdump->nqueued = 0;
+        pthread_cond_broadcast(&xfrdump->done);
+        pthread_mutex_unlock(&xfrdump->lock);
+        xfrdump_process(xfrdump, batch);
+        pthread_mutex_lock(&xfrdump->lock);
+    }
+    pthread_mutex_unlock(&xfrdump->lock);
+    ods_log_debug("[%s] shutdown", xfrdump_str);
+}
+
+
+/**
+ * Have the packet writer thread exit.
+ *
+ */
+void
+xfrdump_stop(xfrdump_type* xfrdump)
+{
+    if (!xfrdump) {
+        return;
+    }
+    pthread_mutex_lock(&xfrdump->lock);
+    xfrdump->need_to_exit = 1;
+    pthread_cond_signal(&xfrdump->cond);
+    pthread_mutex_unlock(&xfrdump->lock);
+}
+
+
+/**
+ * Clean up packet writer.
+ *
+ */
+void
+xfrdump_cleanup(xfrdump_type* xfrdump)
+{
+    struct xfrdump_packet* packet = NULL;
+    if (!xfrdump) {
+        return;
+    }
+    while (xfrdump->first) {
+        packet = xfrdump->first;
+        xfrdump->first = packet->next;
+        xfrdump_packet_free(packet);
+    }
+    pthread_mutex_destroy(&xfrdump->lock);
+    pthread_cond_destroy(&xfrdump->cond);
+    pthread_cond_destroy(&xfrdump->done);
+    free(xfrdump);
+}
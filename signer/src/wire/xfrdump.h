@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2018 NLNet Labs.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Writing received zone transfer packets to disk.
+ *
+ */
+
+#ifndef WIRE_XFRDUMP_H
+#define WIRE_XFRDUMP_H
+
+#include "config.h"
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct xfrdump_struct xfrdump_type;
+
+#include "janitor.h"
+#include "locks.h"
+#include "wire/buffer.h"
+#include "wire/xfrd.h"
+
+/* maximum number of packets queued before the transfer handler waits */
+#define XFRDUMP_MAX_QUEUED 64
+
+/**
+ * Verified transfer packets are queued by the transfer handler and
+ * written as text to the <zone>.xfrd files by a thread of their own,
+ * so reading the network and converting the packets overlap.  Packets
+ * of one zone are written in the order they were queued.
+ *
+ */
+struct xfrdump_struct {
+    janitor_thread_t thread_id;
+    pthread_mutex_t lock;
+    pthread_cond_t cond; /* signalled when packets are queued */
+    pthread_cond_t done; /* signalled when packets are written */
+    struct xfrdump_packet* first;
+    struct xfrdump_packet* last;
+    size_t nqueued;
+    unsigned need_to_exit : 1;
+    unsigned started : 1;
+};
+
+/**
+ * Create packet writer, packets are written in place before its thread
+ * is started.
+ * \return xfrdump_type* created packet writer
+ *
+ */
+extern xfrdump_type* xfrdump_create(void);
+
+/**
+ * Queue a packet of a zone transfer.  The packet is copied, the caller
+ * waits while XFRDUMP_MAX_QUEUED packets are queued.
+ * \param[in] xfrdump packet writer
+ * \param[in] xfrd zone transfer structure
+ * \param[in] buffer packet, from its start up to its limit
+ * \param[in] begin first packet of the transfer
+ * \param[in] truncate start the file anew
+ *
+ */
+extern void xfrdump_enqueue(xfrdump_type* xfrdump, xfrd_type* xfrd,
+    buffer_type* buffer, int begin, int truncate);
+
+/**
+ * Wait until all packets queued for a zone are written.
+ * \param[in] xfrdump packet writer
+ * \param[in] xfrd zone transfer structure
+ *
+ */
+extern void xfrdump_flush(xfrdump_type* xfrdump, xfrd_type* xfrd);
+
+/**
+ * Run the packet writer, the body of its thread.
+ * \param[in] xfrdump packet writer
+ *
+ */
+extern void xfrdump_start(xfrdump_type* xfrdump);
+
+/**
+ * Have the packet writer thread exit, after writing the queued packets.
+ * \param[in] xfrdump packet writer
+ *
+ */
+extern void xfrdump_stop(xfrdump_type* xfrdump);
+
+/**
+ * Clean up packet writer.
+ * \param[in] xfrdump packet writer
+ *
+ */
+extern void xfrdump_cleanup(xfrdump_type* xfrdump);
+
+#endif /* WIRE_XFRDUMP_H */
@@ -0,0 +1,71 @@
+#!/usr/bin/env bash
+#
+#TEST: Allocates private keys for 20000 zones with 8 enforcer workers.
+#TEST: The zones are added in two batches, the second batch must not take
+#TEST: much longer than the first, no commit may collide on a key and no
+#TEST: key may be claimed twice or left claimed without a key referring to it.
+
+NUMBER_ZONES=10000	# zones per batch
+BOUND_FACTOR=3		# second batch may take at most this times the first
+RESULTS_OUTPUT="performance_results.log"
+SIGNCONF_DIR=$INSTALL_ROOT/var/opendnssec/signconf
+
+generate_zonelist() {
+  echo "<?xml version=\"1.0\" encoding=\"UTF-8\"?><ZoneList>"
+  for (( i = 1 ; i <= $1 ; i += 1 )); do
+    echo "<Zone name=\"txt$i\"><Policy>default</Policy>"
+    echo "<SignerConfiguration>$SIGNCONF_DIR/txt$i.xml</SignerConfiguration>"
+    echo "<Adapters><Input><Adapter type=\"File\">$INSTALL_ROOT/var/opendnssec/unsigned/txt$i</Adapter></Input>"
+    echo "<Output><Adapter type=\"File\">$INSTALL_ROOT/var/opendnssec/signed/txt$i</Adapter></Output></Adapters>"
+    echo "</Zone>"
+  done
+  echo "</ZoneList>"
+}
+
+# Add zones up to $1 and wait until they all got their KSK and ZSK, prints
+# the time it took in milliseconds.
+allocate_zones() {
+  local start end
+  generate_zonelist $1 > $INSTALL_ROOT/etc/opendnssec/zonelist.xml &&
+  ods-enforcer key generate --all --duration P1Y >/dev/null &&
+  start=`date +%s%N` &&
+  ods-enforcer zonelist import >/dev/null &&
+  while [ `grep -rl Locator $SIGNCONF_DIR 2>/dev/null | wc -l` -lt $1 ]; do
+    sleep 1
+  done &&
+  end=`date +%s%N` &&
+  echo $(( ($end - $start) / 1000000 ))
+}
+
+if [ -n "$HAVE_MYSQL" ]; then
+        ods_setup_conf conf.xml conf-mysql.xml
+fi &&
+
+ods_reset_env &&
+ods_start_enforcer &&
+
+FIRST=`allocate_zones $NUMBER_ZONES` &&
+SECOND=`allocate_zones $(( 2 * $NUMBER_ZONES ))` &&
+echo "key allocation (ms) for zones 1 to $NUMBER_ZONES and up to $(( 2 * $NUMBER_ZONES )),$FIRST,$SECOND" > $RESULTS_OUTPUT &&
+
+# Allocation must not get slower with the number of zones and keys present.
+[ $SECOND -le $(( $BOUND_FACTOR * $FIRST )) ] &&
+
+# Claims never make commits collide.
+! syslog_grep "Unable to commit changes to zone" &&
+! syslog_grep "unable to claim key" &&
+
+# Every zone has both its keys, no key is handed out twice and no key stays
+# claimed without a key referring to it.
+if [ -z "$HAVE_MYSQL" ]; then
+  [ `sqlite3 $INSTALL_ROOT/var/opendnssec/kasp.db "SELECT COUNT(*) FROM keyData"` -eq $(( 4 * $NUMBER_ZONES )) ] &&
+  [ `sqlite3 $INSTALL_ROOT/var/opendnssec/kasp.db "SELECT COUNT(*) FROM (SELECT hsmKeyId FROM keyData GROUP BY hsmKeyId HAVING COUNT(*) > 1)"` -eq 0 ] &&
+  [ `sqlite3 $INSTALL_ROOT/var/opendnssec/kasp.db "SELECT COUNT(*) FROM hsmKey WHERE state IN (2, 3) AND id NOT IN (SELECT hsmKeyId FROM keyData)"` -eq 0 ]
+fi &&
+
+ods_stop_enforcer &&
+cat $RESULTS_OUTPUT &&
+return 0
+
+ods_kill
+return 1
@@ -1,5 +1,7 @@
 NUMBER_ZONES=4000
 NUMBER_REPEATS=1
+NUMBER_SINGLE=200
+SINGLE_BOUND_MS=500
 ZONE_COUNTER=0
 STATUS=0
 MYEND=0
@@ -66,6 +68,36 @@ for (( r = 1 ; r <= $NUMBER_REPEATS ; r += 1 )); do
     #echo "$RUN" >> $RESULTS_OUTPUT 2>&1
 done
 
+# Single zone add and delete only journal the change next to the internal
+# zonelist, their cost must not grow with the number of zones present.
+if [ $OPENDNSSEC_VERSION -eq 2 ] ; then
+  echo " "  >> $RESULTS_OUTPUT 2>&1
+  echo -n "single add/delete per zone (ms) with $ZONE_COUNTER zones," >> $RESULTS_OUTPUT 2>&1
+  MYSTART=`date +%s%N`
+  for (( i = 1 ; i <= $NUMBER_SINGLE ; i += 1 )); do
+    $INSTALL_ROOT/$KSM_UTIL zone add --zone single$i --suspend >> $DEBUG_OUTPUT 2>&1
+    STATUS=$?
+    check_status zone_add_single q
+  done
+  MYEND=`date +%s%N`
+  ADDTIME=$(( ($MYEND - $MYSTART) / $NUMBER_SINGLE / 1000000 ))
+  MYSTART=`date +%s%N`
+  for (( i = 1 ; i <= $NUMBER_SINGLE ; i += 1 )); do
+    $INSTALL_ROOT/$KSM_UTIL zone delete --zone single$i >> $DEBUG_OUTPUT 2>&1
+    STATUS=$?
+    check_status zone_delete_single q
+  done
+  MYEND=`date +%s%N`
+  DELTIME=$(( ($MYEND - $MYSTART) / $NUMBER_SINGLE / 1000000 ))
+  echo -n "$ADDTIME,$DELTIME," >> $RESULTS_OUTPUT 2>&1
+  [ $ADDTIME -le $SINGLE_BOUND_MS ] ; STATUS=$?
+  check_status zone_add_time_bound
+  [ $DELTIME -le $SINGLE_BOUND_MS ] ; STATUS=$?
+  check_status zone_delete_time_bound
+  grep -q "single$NUMBER_SINGLE" $INSTALL_ROOT/var/opendnssec/enforcer/zonelist.xml.journal ; STATUS=$?
+  check_status zone_add_journaled
+fi
+
 exit 0
 
 # Do some simple sanity checks...
@@ -0,0 +1,44 @@
+#!/usr/bin/env bash
+
+#TEST: Test zone, policy and keytype filters of key list and rollover list
+
+if [ -n "$HAVE_MYSQL" ]; then
+        ods_setup_conf conf.xml conf-mysql.xml
+fi &&
+ods_reset_env &&
+
+echo -n "LINE: ${LINENO} " && ods_start_enforcer &&
+
+echo -n "LINE: ${LINENO} " && log_this ods-enforcer-key-list-all ods-enforcer key list &&
+echo -n "LINE: ${LINENO} " && log_grep ods-enforcer-key-list-all stdout "^ods  *KSK" &&
+echo -n "LINE: ${LINENO} " && log_grep ods-enforcer-key-list-all stdout "^ods2  *KSK" &&
+
+echo -n "LINE: ${LINENO} " && log_this ods-enforcer-key-list-zone ods-enforcer key list --zone ods2 &&
+echo -n "LINE: ${LINENO} " && log_grep ods-enforcer-key-list-zone stdout "^ods2  *ZSK" &&
+echo -n "LINE: ${LINENO} " && ! log_grep ods-enforcer-key-list-zone stdout "^ods  " &&
+
+echo -n "LINE: ${LINENO} " && log_this ods-enforcer-key-list-policy ods-enforcer key list --policy default &&
+echo -n "LINE: ${LINENO} " && log_grep ods-enforcer-key-list-policy stdout "^ods  *ZSK" &&
+echo -n "LINE: ${LINENO} " && ! log_grep ods-enforcer-key-list-policy stdout "^ods2 " &&
+
+echo -n "LINE: ${LINENO} " && log_this ods-enforcer-key-list-keytype ods-enforcer key list --keytype KSK &&
+echo -n "LINE: ${LINENO} " && log_grep ods-enforcer-key-list-keytype stdout "^ods2  *KSK" &&
+echo -n "LINE: ${LINENO} " && ! log_grep ods-enforcer-key-list-keytype stdout "ZSK  " &&
+
+echo -n "LINE: ${LINENO} " && log_this ods-enforcer-key-list-unknown ods-enforcer key list --zone nosuchzone &&
+echo -n "LINE: ${LINENO} " && log_grep ods-enforcer-key-list-unknown stderr "Unable to get zone nosuchzone" &&
+
+echo -n "LINE: ${LINENO} " && log_this ods-enforcer-rollover-list ods-enforcer rollover list --zone ods &&
+echo -n "LINE: ${LINENO} " && log_grep ods-enforcer-rollover-list stdout "^ods  *KSK" &&
+echo -n "LINE: ${LINENO} " && ! log_grep ods-enforcer-rollover-list stdout "^ods2 " &&
+
+echo -n "LINE: ${LINENO} " && ods_stop_enforcer &&
+return 0
+
+echo
+echo "************ERROR******************"
+echo
+ods-enforcer key list -dp
+ods-enforcer key list -v
+ods_kill
+return 1
@@ -0,0 +1,40 @@
+#!/usr/bin/env bash
+
+#TEST: Test simulate command
+
+if [ -n "$HAVE_MYSQL" ]; then
+        ods_setup_conf conf.xml conf-mysql.xml
+fi &&
+ods_reset_env &&
+
+echo -n "LINE: ${LINENO} " && ods_start_enforcer &&
+
+echo -n "LINE: ${LINENO} " && ods-enforcer key list -v > before.txt &&
+
+echo -n "LINE: ${LINENO} " && log_this ods-enforcer-simulate-zone ods-enforcer simulate -z ods -y 2 &&
+echo -n "LINE: ${LINENO} " && log_grep ods-enforcer-simulate-zone stdout "ods: submit DS of KSK" &&
+echo -n "LINE: ${LINENO} " && log_grep ods-enforcer-simulate-zone stdout "ods: introduce ZSK" &&
+echo -n "LINE: ${LINENO} " && log_grep ods-enforcer-simulate-zone stdout "ods: retire ZSK" &&
+echo -n "LINE: ${LINENO} " && log_grep ods-enforcer-simulate-zone stdout "Simulated 1 zone(s)" &&
+echo -n "LINE: ${LINENO} " && log_grep ods-enforcer-simulate-zone stdout "Busiest days for DS submissions" &&
+
+# Without --zone only the report is shown
+echo -n "LINE: ${LINENO} " && log_this ods-enforcer-simulate-all ods-enforcer simulate &&
+echo -n "LINE: ${LINENO} " && log_grep ods-enforcer-simulate-all stdout "Simulated 1 zone(s)" &&
+echo -n "LINE: ${LINENO} " && ! log_grep ods-enforcer-simulate-all stdout "ods: introduce" &&
+
+
+# The database is left alone
+echo -n "LINE: ${LINENO} " && ods-enforcer key list -v > after.txt &&
+echo -n "LINE: ${LINENO} " && diff before.txt after.txt &&
+
+echo -n "LINE: ${LINENO} " && ods_stop_enforcer &&
+return 0
+
+echo
+echo "************ERROR******************"
+echo
+ods-enforcer key list -dp
+ods-enforcer key list -v
+ods_kill
+return 1
@@ -0,0 +1,48 @@
+#!/usr/bin/env bash
+
+#TEST: Run several commands over one connection with ods-enforcer --file
+
+if [ -n "$HAVE_MYSQL" ]; then
+	ods_setup_conf conf.xml conf-mysql.xml
+fi &&
+
+ods_reset_env &&
+ods_start_enforcer &&
+
+cat >commands.txt <<END &&
+# comments and empty lines are skipped
+
+policy list
+zone list
+key list --verbose
+END
+log_this ods-enforcer-batch ods-enforcer --file commands.txt &&
+log_grep ods-enforcer-batch stdout '^default' &&
+log_grep ods-enforcer-batch stdout 'ods[[:space:]]*default' &&
+log_grep ods-enforcer-batch stdout 'ods[[:space:]]*KSK' &&
+log_grep ods-enforcer-batch stdout 'ods[[:space:]]*ZSK' &&
+! log_grep ods-enforcer-batch stderr 'Unknown command' &&
+
+# the commands can come from stdin as well
+echo "zone list" | log_this ods-enforcer-batch-stdin ods-enforcer -f - &&
+log_grep ods-enforcer-batch-stdin stdout 'ods[[:space:]]*default' &&
+
+# stop at the first failing command
+printf 'bogus command\nzone list\n' >failing.txt &&
+! log_this ods-enforcer-batch-fail ods-enforcer --file failing.txt &&
+log_grep ods-enforcer-batch-fail stderr 'Unknown command bogus command' &&
+! log_grep ods-enforcer-batch-fail stdout 'ods[[:space:]]*default' &&
+
+# many short sessions in a row reuse the pooled database connections
+i=0 &&
+while [ $i -lt 12 ]; do
+	ods-enforcer zone list >/dev/null || break
+	i=$((i+1))
+done &&
+[ $i -eq 12 ] &&
+
+ods_stop_enforcer &&
+return 0
+
+ods_kill
+return 1
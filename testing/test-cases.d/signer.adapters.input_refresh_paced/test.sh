@@ -0,0 +1,75 @@
+#!/usr/bin/env bash
+
+#TEST: Test paced SOA refresh checks of several zones toward one master
+#TEST: Start OpenDNSSEC with a low Signer/RefreshRate, see if all zones
+#TEST: get transferred and signed, a late answer is still taken, an
+#TEST: unanswered refresh check is resent and requests stay paced.
+
+## It requires setting up zones in OpenDNSSEC with Input DNS Adapter,
+## non-default zonelist.xml, non-default conf.xml, additional addns.xml.
+## It requires setting up a primary name server (ldns-testns) that
+## answers IXFR requests over UDP with the current SOA, except for ods3
+## which it answers 2 seconds late and ods4 which it never answers.
+
+if [ -n "$HAVE_MYSQL" ]; then
+	ods_setup_conf conf.xml conf-mysql.xml
+fi &&
+
+ods_reset_env &&
+
+## Most udp/ixfr requests logged within one second, the timestamp is the
+## first field with RFC 5424 syslog and the first three fields otherwise.
+max_requests_per_second () {
+	$GREP -- 'ods-signerd: .*\[xfrd\] zone .* request udp/ixfr' "_syslog.$BUILD_TAG" |
+	awk '{ print ($1 ~ /T/ ? substr($1, 1, 19) : $1 " " $2 " " $3) }' |
+	uniq -c | awk 'BEGIN { m = 0 } $1 > m { m = $1 } END { print m }'
+}
+
+## Start master name server
+ods_ldns_testns 15353 ods.datafile &&
+
+## Start OpenDNSSEC
+ods_start_ods-control &&
+
+## Wait for signed zone files
+syslog_waitfor 60 'ods-signerd: .*\[STATS\] ods ' &&
+syslog_waitfor 60 'ods-signerd: .*\[STATS\] ods2 ' &&
+syslog_waitfor 60 'ods-signerd: .*\[STATS\] ods3 ' &&
+syslog_waitfor 60 'ods-signerd: .*\[STATS\] ods4 ' &&
+test -f "$INSTALL_ROOT/var/opendnssec/signed/ods" &&
+test -f "$INSTALL_ROOT/var/opendnssec/signed/ods2" &&
+test -f "$INSTALL_ROOT/var/opendnssec/signed/ods3" &&
+test -f "$INSTALL_ROOT/var/opendnssec/signed/ods4" &&
+
+## See if the paced refresh checks are done over udp and answered
+ods-signer verbosity 5 &&
+syslog_waitfor 35 'ods-signerd: .*\[xfrd\] zone ods request udp/ixfr=1000 to 127.0.0.1' &&
+syslog_waitfor 35 'ods-signerd: .*\[xfrd\] zone ods2 request udp/ixfr=1000 to 127.0.0.1' &&
+syslog_waitfor 35 'ods-signerd: .*\[xfrd\] zone ods3 request udp/ixfr=1000 to 127.0.0.1' &&
+syslog_waitfor 35 'ods-signerd: .*\[xfrd\] zone ods4 request udp/ixfr=1000 to 127.0.0.1' &&
+syslog_waitfor 10 'ods-signerd: .*\[xfrd\] zone ods got update indicating current serial' &&
+syslog_waitfor 10 'ods-signerd: .*\[xfrd\] zone ods2 got update indicating current serial' &&
+syslog_waitfor 10 'ods-signerd: .*\[xfrd\] zone ods3 got update indicating current serial' &&
+
+## The late answer for ods3 is taken without a resend, the missing answer
+## for ods4 counts as lost and its request is resent
+syslog_waitfor 15 'ods-signerd: .*\[xfrd\] master 127.0.0.1 lost udp request' &&
+syslog_waitfor 15 'ods-signerd: .*\[xfrd\] zone ods4 resend request to 127.0.0.1' &&
+! syslog_grep 'ods-signerd: .*\[xfrd\] zone ods3 resend request' &&
+! syslog_grep 'ods-signerd: .*\[xfrd\] zone ods4 got update indicating current serial' &&
+
+## With a RefreshRate of 2 requests are at least half a second apart, so
+## no more than 2 of them fall within one second
+MAX_PER_SECOND=`max_requests_per_second` &&
+echo "most udp requests within one second: $MAX_PER_SECOND" &&
+[ "$MAX_PER_SECOND" -ge 1 -a "$MAX_PER_SECOND" -le 2 ] &&
+
+## Stop
+ods_stop_ods-control &&
+ods_ldns_testns_kill &&
+return 0
+
+## Test failed. Kill stuff
+ods_ldns_testns_kill
+ods_kill
+return 1
@@ -0,0 +1,51 @@
+#!/usr/bin/env bash
+
+#TEST: Run two signer instances from one configuration.  Each instance
+#TEST: signs the zone that hashes to it, both answer on the shared port
+#TEST: and ods-signer routes zone commands to the owning instance.
+
+if [ -n "$HAVE_MYSQL" ]; then
+        ods_setup_conf conf.xml conf-mysql.xml
+fi &&
+
+ods_reset_env &&
+
+## Start OpenDNSSEC, the first signer instance starts the second
+ods_start_ods-control &&
+
+## zone1 is signed by instance 0, ods by instance 1
+syslog_waitfor 60 'ods-signerd: .*\[STATS\] ods ' &&
+syslog_waitfor 60 'ods-signerd: .*\[STATS\] zone1 ' &&
+test "`pgrep ods-signerd | wc -l`" -eq 2 &&
+test -S "$INSTALL_ROOT/var/run/opendnssec/engine.sock" &&
+test -S "$INSTALL_ROOT/var/run/opendnssec/engine.sock.1" &&
+
+## Both zones are served on the shared port, whichever instance the
+## kernel hands the query to
+for n in 1 2 3 4 5 6 7 8; do
+        log_this_timeout soa-ods-$n 10 drill -p 15354 @127.0.0.1 soa ods &&
+        log_grep soa-ods-$n stdout 'ods\..*IN.*SOA.*ns1\.ods\..*postmaster\.ods\.' &&
+        log_this_timeout soa-zone1-$n 10 drill -p 15354 @127.0.0.1 soa zone1 &&
+        log_grep soa-zone1-$n stdout 'zone1\..*IN.*SOA.*ns1\.zone1\..*postmaster\.zone1\.' || return 1
+done &&
+log_this_timeout axfr-ods 10 drill -t -p 15354 @127.0.0.1 axfr ods &&
+log_grep axfr-ods stdout 'ods\..*600.*IN.*MX.*10.*mail\.ods\.' &&
+log_this_timeout axfr-zone1 10 drill -t -p 15354 @127.0.0.1 axfr zone1 &&
+log_grep axfr-zone1 stdout 'zone1\..*600.*IN.*A.*192\.0\.2\.2' &&
+
+## Zone commands go to the owning instance, others to both
+log_this ods-signer-sign-ods ods-signer sign ods &&
+log_grep ods-signer-sign-ods stdout 'Zone ods scheduled for immediate re-sign' &&
+log_this ods-signer-sign-zone1 ods-signer sign zone1 &&
+log_grep ods-signer-sign-zone1 stdout 'Zone zone1 scheduled for immediate re-sign' &&
+log_this ods-signer-zones ods-signer zones &&
+log_grep ods-signer-zones stdout 'ods' &&
+log_grep ods-signer-zones stdout 'zone1' &&
+
+## Stop
+ods_stop_ods-control &&
+! pgrep ods-signerd &&
+return 0
+
+ods_kill
+return 1